@@ -29,6 +29,15 @@
 #include "sccp_utils.h"
 #include "sccp_hint.h"		// use __constructor__ to remove this entry
 #include "sccp_conference.h"	// use __constructor__ to remove this entry
+#include "sccp_quota.h"
+#include "sccp_cac.h"
+#include "sccp_huntgroup.h"
+#include "sccp_callhistory.h"
+#include "sccp_ctievents.h"
+#include "sccp_provision.h"
+#include "sccp_textmessage.h"
+#include "sccp_replication.h"
+#include "sccp_callback.h"
 #include "revision.h"
 #ifdef CS_DEVSTATE_FEATURE
 #include "sccp_devstate.h"
@@ -125,6 +134,15 @@ boolean_t sccp_prePBXLoad(void)
 	sccp_devstate_module_start();
 #endif
 	sccp_hint_module_start();
+	sccp_quota_module_start();
+	sccp_cac_module_start();
+	sccp_huntgroup_module_start();
+	sccp_callhistory_module_start();
+	sccp_ctievents_module_start();
+	sccp_provision_module_start();
+	sccp_textmessage_module_start();
+	sccp_replication_module_start();
+	sccp_callback_module_start();
 	sccp_manager_module_start();
 #ifdef CS_SCCP_CONFERENCE
 	sccp_conference_module_start();
@@ -217,6 +235,7 @@ boolean_t sccp_postPBX_load(void)
 		}
 	}
 #endif
+	sccp_replication_reload();
 	return TRUE /* ? */;
 }
 
@@ -314,6 +333,15 @@ int sccp_preUnload(void)
 #ifdef CS_SCCP_CONFERENCE
 	sccp_conference_module_stop();
 #endif
+	sccp_callback_module_stop();
+	sccp_replication_module_stop();
+	sccp_textmessage_module_stop();
+	sccp_provision_module_stop();
+	sccp_ctievents_module_stop();
+	sccp_callhistory_module_stop();
+	sccp_huntgroup_module_stop();
+	sccp_cac_module_stop();
+	sccp_quota_module_stop();
 	sccp_softkey_clear();
 	sccp_threadpool_destroy(GLOB(general_threadpool));
 	sccp_refcount_destroy();
@@ -393,8 +421,10 @@ int sccp_reload(void)
 #ifdef HAVE_LIBSSL
 			if(GLOB(srvcontexts[SCCP_SERVERCONTEXT_TLS])) {
 				returnval = sccp_servercontext_reload(GLOB(srvcontexts[SCCP_SERVERCONTEXT_TLS]), &GLOB(secbindaddr)) ? 0 : 3;
+				sccp_transport_tls_rotate();							/* certfile may point at a renewed certificate, only new connections use it */
 			}
 #endif
+			sccp_replication_reload();
 			break;
 		case CONFIG_STATUS_FILE_OLD:
 			pbx_log(LOG_ERROR, "Error reloading from '%s'\n", GLOB(config_file_name));
@@ -420,6 +450,9 @@ int sccp_reload(void)
 EXIT:
 	GLOB(reload_in_progress) = FALSE;
 	pbx_rwlock_unlock(&GLOB(lock));
+	if (readingtype == SCCP_CONFIG_READRELOAD) {
+		sccp_device_schedulePendingUpdates(NULL);
+	}
 	return returnval;
 }
 
@@ -60,6 +60,10 @@ typedef struct sccp_buttonconfig sccp_buttonconfig_t;
 typedef struct sccp_hotline sccp_hotline_t;                                                                   //!< SCCP Hotline Structure
 typedef struct sccp_callinfo sccp_callinfo_t;                                                                 //!< SCCP Call Information Structure
 typedef struct sccp_call_statistics sccp_call_statistics_t;                                                   //!< SCCP Call Statistic Structure
+typedef struct sccp_quota sccp_quota_t;                                                                       //!< SCCP Call Quota Structure
+typedef struct sccp_cac_location sccp_cac_location_t;                                                         //!< SCCP Bandwidth Location Structure
+typedef struct sccp_huntgroup sccp_huntgroup_t;                                                               //!< SCCP Hunt Group Structure
+typedef struct sccp_callhistory sccp_callhistory_t;                                                           //!< SCCP Call History Structure
 typedef struct softKeySetConfiguration sccp_softKeySetConfiguration_t;                                        //!< SoftKeySet configuration
 typedef struct sccp_mailbox sccp_mailbox_t;                                                                   //!< SCCP Mailbox Type Definition
 typedef struct subscriptionId sccp_subscription_id_t;                                                         //!< SCCP SubscriptionId Structure
@@ -25,6 +25,7 @@
 #include "sccp_rtp.h"
 #include "sccp_session.h"		// required for sccp_session_getOurIP
 #include "sccp_labels.h"
+#include "sccp_textmessage.h"
 #include "sccp_enum.h" 
 #include "pbx_impl/ast112/ast112.h"
 #include "pbx_impl/ast_announce/ast_announce.h"
@@ -1987,22 +1988,14 @@ static int sccp_astwrap_update_rtp_peer(PBX_CHANNEL_TYPE * ast, PBX_RTP_TYPE * r
 			instance = trtp;
 		}
 
-		if (d->directrtp && d->nat < SCCP_NAT_ON && !nat_active && !c->conference) {			// asume directrtp
+		if (!c->conference) {										// media anchoring decision, see sccp_rtp_allowDirectMedia
+			struct ast_sockaddr sin_local;
+			struct sockaddr_storage localsas = { 0, };
 			ast_rtp_instance_get_remote_address(instance, &sin_tmp);
 			memcpy(&sas, &sin_tmp, sizeof(struct sockaddr_storage));
-			//ast_sockaddr_to_sin(&sin_tmp, &sin);
-			if (d->nat == SCCP_NAT_OFF) {								// forced nat off to circumvent autodetection + direcrtp, requires checking both phone_ip and external session ip address against devices permit/deny
-				struct ast_sockaddr sin_local;
-				struct sockaddr_storage localsas = { 0, };
-				ast_rtp_instance_get_local_address(instance, &sin_local);
-				memcpy(&localsas, &sin_local, sizeof(struct sockaddr_storage));
-				if (sccp_apply_ha(d->ha, &sas) == AST_SENSE_ALLOW && sccp_apply_ha(d->ha, &localsas) == AST_SENSE_ALLOW) {
-					directmedia = TRUE;
-				}
-			} else if (sccp_apply_ha(d->ha, &sas) == AST_SENSE_ALLOW) {					// check remote sin against local device acl (to match netmask)
-				directmedia = TRUE;
-				// ast_channel_defer_dtmf(ast);
-			}
+			ast_rtp_instance_get_local_address(instance, &sin_local);
+			memcpy(&localsas, &sin_local, sizeof(struct sockaddr_storage));
+			directmedia = sccp_rtp_allowDirectMedia(d, c, rtp ? &c->rtp.audio : &c->rtp.video, &sas, &localsas, nat_active ? TRUE : FALSE);
 		}
 		if (!directmedia) {										// fallback to indirectrtp
 			ast_rtp_instance_get_local_address(instance, &sin_tmp);
@@ -3115,18 +3108,7 @@ static int sccp_astwrap_message_send(const struct ast_msg *msg, const char *to,
 		return -1;
 	}
 
-	/** \todo move this to line implementation */
-	sccp_linedevice_t * ld = NULL;
-	sccp_push_result_t pushResult;
-
-	SCCP_LIST_LOCK(&line->devices);
-	SCCP_LIST_TRAVERSE(&line->devices, ld, list) {
-		pushResult = ld->device->pushTextMessage(ld->device, messageText, from, 1, SKINNY_TONE_ZIP);
-		if (SCCP_PUSH_RESULT_SUCCESS == pushResult) {
-			res = 0;
-		}
-	}
-	SCCP_LIST_UNLOCK(&line->devices);
+	res = sccp_textmessage_send(line, messageText, from) ? 0 : -1;
 
 	return res;
 }
@@ -25,6 +25,7 @@
 #include "sccp_rtp.h"
 #include "sccp_session.h"		// required for sccp_session_getOurIP
 #include "sccp_labels.h"
+#include "sccp_textmessage.h"
 #include "sccp_enum.h" 
 #include "pbx_impl/ast116/ast116.h"
 #include "pbx_impl/ast_announce/ast_announce.h"
@@ -583,29 +584,87 @@ static void __find_joint_capabilities(sccp_channel_t *c, PBX_CHANNEL_TYPE* peer,
 	}
 }
 
-static void pbx_retrieve_remote_capabilities(sccp_channel_t *c)
+/*!
+ * \brief Find the remote peer of a call: the bridge peer, the channel recorded in remotePeerName, or as a last resort any channel sharing the linkedid
+ * \return remote peer (pbx_channel_ref +1) or NULL
+ */
+static PBX_CHANNEL_TYPE *pbx_find_remote_peer(sccp_channel_t *c, PBX_CHANNEL_TYPE *ast)
 {
-	pbx_assert(c != NULL);
-	PBX_CHANNEL_TYPE *ast = c->owner;
-	PBX_CHANNEL_TYPE *remotePeer;
+	PBX_CHANNEL_TYPE *remotePeer = NULL;
+	const char *linkedId = ast_channel_linkedid(ast);
 
+	if ((remotePeer = ast_channel_bridge_peer(ast))) {
+		return remotePeer;
+	}
+	if (!sccp_strlen_zero(c->remotePeerName) && (remotePeer = ast_channel_get_by_name(c->remotePeerName))) {
+		if (pbx_find_channel_by_linkid(ast, remotePeer, (void *) linkedId)) {
+			return remotePeer;
+		}
+		pbx_channel_unref(remotePeer);
+		remotePeer = NULL;
+	}
+
+	/* fallback: scan all channels */
 	struct ast_channel_iterator *iterator = ast_channel_iterator_all_new();
 	if (!iterator)
-		return;
+		return NULL;
 	((struct ao2_iterator *) iterator)->flags |= AO2_ITERATOR_DONTLOCK;
 
 	//! \todo handle multiple remotePeers i.e. DIAL(SCCP/400&SIP/300), find smallest common codecs, what order to use ?
-	for (; iterator && (remotePeer = ast_channel_iterator_next(iterator)); pbx_channel_unref(remotePeer)) {
-		if (pbx_find_channel_by_linkid(ast, remotePeer, (void *) ast_channel_linkedid(ast))) {
-			__find_joint_capabilities(c, remotePeer, AST_MEDIA_TYPE_AUDIO, c->remoteCapabilities.audio);
-#if CS_SCCP_VIDEO
-			__find_joint_capabilities(c, remotePeer, AST_MEDIA_TYPE_VIDEO, c->remoteCapabilities.video);
-#endif
-			pbx_channel_unref(remotePeer);
+	for (; (remotePeer = ast_channel_iterator_next(iterator)); pbx_channel_unref(remotePeer)) {
+		if (pbx_find_channel_by_linkid(ast, remotePeer, (void *) linkedId)) {
 			break;
 		}
 	}
 	ast_channel_iterator_destroy(iterator);
+	return remotePeer;
+}
+
+#if ASTERISK_VERSION_GROUP >= 117
+#define SNAPSHOT_NAME(_snapshot) (_snapshot)->base->name
+#else
+#define SNAPSHOT_NAME(_snapshot) (_snapshot)->name
+#endif
+static struct stasis_subscription *dial_sub = NULL;
+
+/*!
+ * \brief Record the dialed peer on an outbound sccp channel, so that pbx_find_remote_peer does not have to scan all channels while ringing
+ */
+static void dial_event_cb(void *data, struct stasis_subscription *sub, struct stasis_message *message)
+{
+	if (stasis_subscription_final_message(sub, message) || stasis_message_type(message) != ast_channel_dial_type()) {
+		return;
+	}
+	struct ast_multi_channel_blob *payload = stasis_message_data(message);
+	struct ast_channel_snapshot *caller = ast_multi_channel_blob_get_channel(payload, "caller");
+	struct ast_channel_snapshot *peer = ast_multi_channel_blob_get_channel(payload, "peer");
+
+	if (!caller || !peer || strncasecmp(SNAPSHOT_NAME(caller), "SCCP/", 5)) {
+		return;
+	}
+	RAII(struct ast_channel *, callerChan, ast_channel_get_by_name(SNAPSHOT_NAME(caller)), ast_channel_cleanup);
+	if (!callerChan) {
+		return;
+	}
+	AUTO_RELEASE(sccp_channel_t, c, get_sccp_channel_from_pbx_channel(callerChan));
+	if (c && sccp_strlen_zero(c->remotePeerName)) {
+		sccp_copy_string(c->remotePeerName, SNAPSHOT_NAME(peer), sizeof(c->remotePeerName));
+	}
+}
+
+static void pbx_retrieve_remote_capabilities(sccp_channel_t *c)
+{
+	pbx_assert(c != NULL);
+	PBX_CHANNEL_TYPE *ast = c->owner;
+	PBX_CHANNEL_TYPE *remotePeer = pbx_find_remote_peer(c, ast);
+
+	if (remotePeer) {
+		__find_joint_capabilities(c, remotePeer, AST_MEDIA_TYPE_AUDIO, c->remoteCapabilities.audio);
+#if CS_SCCP_VIDEO
+		__find_joint_capabilities(c, remotePeer, AST_MEDIA_TYPE_VIDEO, c->remoteCapabilities.video);
+#endif
+		pbx_channel_unref(remotePeer);
+	}
 }
 
 
@@ -1879,6 +1938,13 @@ static PBX_CHANNEL_TYPE *sccp_astwrap_request(const char *type, struct ast_forma
 	/* end */
 
 	if (requestor) {
+		/* remember the peers, so that pbx_retrieve_remote_capabilities does not have to scan all channels */
+		sccp_copy_string(channel->remotePeerName, ast_channel_name((PBX_CHANNEL_TYPE *) requestor), sizeof(channel->remotePeerName));
+		AUTO_RELEASE(sccp_channel_t, requestorChannel, get_sccp_channel_from_pbx_channel(requestor));
+		if (requestorChannel) {
+			sccp_copy_string(requestorChannel->remotePeerName, ast_channel_name(channel->owner), sizeof(requestorChannel->remotePeerName));
+		}
+
 		/* set calling party */
 		sccp_callinfo_t *ci = sccp_channel_getCallInfo(channel);
 		iCallInfo.Setter(ci, 
@@ -2259,22 +2325,14 @@ static int sccp_astwrap_update_rtp_peer(PBX_CHANNEL_TYPE * ast, PBX_RTP_TYPE * r
 			instance = trtp;
 		}
 
-		if (d->directrtp && d->nat < SCCP_NAT_ON && !nat_active && !c->conference) {			// assume directrtp
+		if (!c->conference) {										// media anchoring decision, see sccp_rtp_allowDirectMedia
+			struct ast_sockaddr sin_local;
+			struct sockaddr_storage localsas = { 0, };
 			ast_rtp_instance_get_remote_address(instance, &sin_tmp);
 			memcpy(&sas, &sin_tmp, sizeof(struct sockaddr_storage));
-			//ast_sockaddr_to_sin(&sin_tmp, &sin);
-			if (d->nat == SCCP_NAT_OFF) {								// forced nat off to circumvent autodetection + direcrtp, requires checking both phone_ip and external session ip address against devices permit/deny
-				struct ast_sockaddr sin_local;
-				struct sockaddr_storage localsas = { 0, };
-				ast_rtp_instance_get_local_address(instance, &sin_local);
-				memcpy(&localsas, &sin_local, sizeof(struct sockaddr_storage));
-				if (sccp_apply_ha(d->ha, &sas) == AST_SENSE_ALLOW && sccp_apply_ha(d->ha, &localsas) == AST_SENSE_ALLOW) {
-					directmedia = TRUE;
-				}
-			} else if (sccp_apply_ha(d->ha, &sas) == AST_SENSE_ALLOW) {					// check remote sin against local device acl (to match netmask)
-				directmedia = TRUE;
-				// ast_channel_defer_dtmf(ast);
-			}
+			ast_rtp_instance_get_local_address(instance, &sin_local);
+			memcpy(&localsas, &sin_local, sizeof(struct sockaddr_storage));
+			directmedia = sccp_rtp_allowDirectMedia(d, c, rtp ? &c->rtp.audio : &c->rtp.video, &sas, &localsas, nat_active ? TRUE : FALSE);
 		}
 		if (!directmedia) {										// fallback to indirectrtp
 			ast_rtp_instance_get_local_address(instance, &sin_tmp);
@@ -3423,18 +3481,7 @@ static int sccp_astwrap_message_send(const struct ast_msg *msg, const char *to,
 		return -1;
 	}
 
-	/** \todo move this to line implementation */
-	sccp_linedevice_t * ld = NULL;
-	sccp_push_result_t pushResult;
-
-	SCCP_LIST_LOCK(&line->devices);
-	SCCP_LIST_TRAVERSE(&line->devices, ld, list) {
-		pushResult = ld->device->pushTextMessage(ld->device, messageText, from, 1, SKINNY_TONE_ZIP);
-		if (SCCP_PUSH_RESULT_SUCCESS == pushResult) {
-			res = 0;
-		}
-	}
-	SCCP_LIST_UNLOCK(&line->devices);
+	res = sccp_textmessage_send(line, messageText, from) ? 0 : -1;
 
 	return res;
 }
@@ -3848,6 +3895,9 @@ static int unload_module(void)
 	ast_rtp_glue_unregister(&sccp_rtp);
 	sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_2 "SCCP: Unregister SCCP Channel Tech\n");
 
+	if (dial_sub) {
+		dial_sub = stasis_unsubscribe_and_join(dial_sub);
+	}
 	unregister_channel_tech(&sccp_tech);
 	sccp_unregister_dialplan_functions();
 	sccp_unregister_cli();
@@ -3933,6 +3983,14 @@ static enum ast_module_load_result load_module(void)
 			pbx_log(LOG_ERROR, "Unable to register channel class SCCP\n");
 			break;
 		}
+		if (!(dial_sub = stasis_subscribe(ast_channel_topic_all(), dial_event_cb, NULL))) {
+			pbx_log(LOG_ERROR, "Unable to subscribe to dial events\n");
+			break;
+		}
+#if CS_AST_HAS_STASIS_SUBSCRIPTION_SET_FILTER
+		stasis_subscription_accept_message_type(dial_sub, ast_channel_dial_type());
+		stasis_subscription_set_filter(dial_sub, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
+#endif
 #ifdef HAVE_PBX_MESSAGE_H
 		if (ast_msg_tech_register(&sccp_msg_tech)) {
 			pbx_log(LOG_ERROR, "Unable to register message interface\n");
@@ -51,6 +51,8 @@ SCCP_FILE_VERSION(__FILE__, "");
 #include <math.h>
 #include <asterisk/localtime.h>
 
+#define SCCP_BUTTONTEMPLATE_REFRESH_MIN_PROTOCOLVERSION 11						/* older phones ignore an unsolicited button template */
+
 /* prototypes */
 void handle_unknown_message(constSessionPtr s, devicePtr d, constMessagePtr msg_in)			__NONNULL(1,2,3);
 void handle_dialedphonebook_message(constSessionPtr s, devicePtr d, constMessagePtr msg_in)		__NONNULL(1,2,3);
@@ -211,6 +213,37 @@ static const struct messageMap_cb spcpMessagesCbMap[SPCP_MESSAGE_HIGH_BOUNDARY +
 	//[UnknownVGMessage - SPCP_MESSAGE_OFFSET] = {NULL, FALSE},
 };
 
+/*!
+ * \brief Lookup the Message Handler for a MessageId
+ * \param mid MessageId
+ * \return messageMap_cb or NULL when the messageId is out of bounds
+ */
+static gcc_inline const struct messageMap_cb * sccp_lookup_message_cb(sccp_mid_t mid)
+{
+	//if ((mid >= SCCP_MESSAGE_LOW_BOUNDARY && mid <= SCCP_MESSAGE_HIGH_BOUNDARY)) {
+	if (mid <= SCCP_MESSAGE_HIGH_BOUNDARY) {
+		return &sccpMessagesCbMap[mid];
+	}
+	if ((mid >= SPCP_MESSAGE_LOW_BOUNDARY && mid <= SPCP_MESSAGE_HIGH_BOUNDARY)) {
+		return &spcpMessagesCbMap[mid - SPCP_MESSAGE_OFFSET];
+	}
+	return NULL;
+}
+
+/*!
+ * \brief Check if a Received Message would be dispatched to a Message Handler, without calling it
+ * \param mid MessageId
+ * \return TRUE when a handler is registered for the messageId
+ *
+ * \note Used by "sccp test decoder" to measure the dispatch lookup, sccp_session_decodeStream does not dispatch
+ */
+boolean_t sccp_handle_message_lookup(sccp_mid_t mid)
+{
+	const struct messageMap_cb *messageMap_cb = sccp_lookup_message_cb(mid);
+
+	return (messageMap_cb && messageMap_cb->messageHandler_cb) ? TRUE : FALSE;
+}
+
 /*!
  * \brief       Controller function to handle Received Messages
  * \param       msg Message as sccp_msg_t
@@ -234,12 +267,7 @@ int sccp_handle_message(constMessagePtr msg, constSessionPtr s)
 	mid = letohl(msg->header.lel_messageId);
 
 	/* search for message handler */
-	//if ((mid >= SCCP_MESSAGE_LOW_BOUNDARY && mid <= SCCP_MESSAGE_HIGH_BOUNDARY)) {
-	if (mid <= SCCP_MESSAGE_HIGH_BOUNDARY) {
-		messageMap_cb = &sccpMessagesCbMap[mid];
-	} else if ((mid >= SPCP_MESSAGE_LOW_BOUNDARY && mid <= SPCP_MESSAGE_HIGH_BOUNDARY)) {
-		messageMap_cb = &spcpMessagesCbMap[mid - SPCP_MESSAGE_OFFSET]; 
-	} else {
+	if (!(messageMap_cb = sccp_lookup_message_cb(mid))) {
 		pbx_log(LOG_WARNING, "SCCP: Unknown Message %x. Don't know how to handle it. Skipping.\n", mid);
 		handle_unknown_message(s, NULL, msg);
 		return 0;
@@ -1015,11 +1043,13 @@ FUNC_EXIT:
 }
 
 /*!
- * \brief Make Button Template for Device
+ * \brief Lay out a Button Template for Device from a list of button configs
  * \param d SCCP Device as sccp_device_t
+ * \param buttonconfigs Button configs to place, the ones without an instance get one assigned
+ * \param attach Create the linedevices and set the default line on the device. FALSE when laying out copies of the button configs
  * \return Linked List of ButtonDefinitions
  */
-static btnlist *sccp_make_button_template(devicePtr d)
+static btnlist *sccp_build_button_template(devicePtr d, struct sccp_buttonconfig_list * buttonconfigs, boolean_t attach)
 {
 	int i = 0;
 	btnlist * btn = NULL;
@@ -1039,8 +1069,8 @@ static btnlist *sccp_make_button_template(devicePtr d)
 	boolean_t defaultLineSet = FALSE;
 
 	if (!d->isAnonymous) {
-		SCCP_LIST_LOCK(&d->buttonconfig);
-		SCCP_LIST_TRAVERSE(&d->buttonconfig, buttonconfig, list) {
+		SCCP_LIST_LOCK(buttonconfigs);
+		SCCP_LIST_TRAVERSE(buttonconfigs, buttonconfig, list) {
 			//sccp_log((DEBUGCAT_BUTTONTEMPLATE)) (VERBOSE_PREFIX_3 "\n%s: searching for position of button type %d\n", DEV_ID_LOG(d), buttonconfig->type);
 
 			if (buttonconfig->instance > 0) {
@@ -1061,10 +1091,12 @@ static btnlist *sccp_make_button_template(devicePtr d)
 						/*! retains new line in btn[i].ptr, finally released in sccp_dev_clean */
 						if ((btn[i].ptr = sccp_line_find_byname(buttonconfig->button.line.name, TRUE))) {
 							buttonconfig->instance = btn[i].instance = lineInstance++;
-							sccp_linedevice_create(d, btn[i].ptr, btn[i].instance, buttonconfig->button.line.subscriptionId);
-							if (FALSE == defaultLineSet && !d->defaultLineInstance) {
-								d->defaultLineInstance = buttonconfig->instance;
-								defaultLineSet = TRUE;
+							if (attach) {
+								sccp_linedevice_create(d, btn[i].ptr, btn[i].instance, buttonconfig->button.line.subscriptionId);
+								if (FALSE == defaultLineSet && !d->defaultLineInstance) {
+									d->defaultLineInstance = buttonconfig->instance;
+									defaultLineSet = TRUE;
+								}
 							}
 						} else {
 							btn[i].type = SKINNY_BUTTONTYPE_UNUSED;
@@ -1270,7 +1302,7 @@ static btnlist *sccp_make_button_template(devicePtr d)
 			}
 			//sccp_log_and((DEBUGCAT_BUTTONTEMPLATE + DEBUGCAT_FEATURE_BUTTON)) (VERBOSE_PREFIX_3 "%s: Configured %d Phone Button [%.2d] = %s(%d), label:%s\n", d->id, buttonconfig->index + 1, buttonconfig->instance, skinny_buttontype2str(btn[i].type), btn[i].type, buttonconfig->label);
 		}
-		SCCP_LIST_UNLOCK(&d->buttonconfig);
+		SCCP_LIST_UNLOCK(buttonconfigs);
 	} else {
 		/* reserve one line as hotline */
 		buttonconfig = SCCP_LIST_FIRST(&d->buttonconfig);
@@ -1287,18 +1319,31 @@ static btnlist *sccp_make_button_template(devicePtr d)
 		}
 	}
 
-	SCCP_LIST_LOCK(&d->buttonconfig);
-	SCCP_LIST_TRAVERSE(&d->buttonconfig, buttonconfig, list) {
+	if (!attach) {
+		return btn;
+	}
+	SCCP_LIST_LOCK(buttonconfigs);
+	SCCP_LIST_TRAVERSE(buttonconfigs, buttonconfig, list) {
 		if (buttonconfig->type == LINE && buttonconfig->button.line.options && strcasestr(buttonconfig->button.line.options, "default")) {
 			d->defaultLineInstance = buttonconfig->instance;
 			sccp_log((DEBUGCAT_LINE))(VERBOSE_PREFIX_3 "set defaultLineInstance to: %u\n", buttonconfig->instance);
 			break;
 		}
 	}
-	SCCP_LIST_UNLOCK(&d->buttonconfig);
+	SCCP_LIST_UNLOCK(buttonconfigs);
 	return btn;
 }
 
+/*!
+ * \brief Make Button Template for Device
+ * \param d SCCP Device as sccp_device_t
+ * \return Linked List of ButtonDefinitions
+ */
+static btnlist *sccp_make_button_template(devicePtr d)
+{
+	return d ? sccp_build_button_template(d, &d->buttonconfig, TRUE) : NULL;
+}
+
 /*!
  * \brief Handle Available Lines
  * \param s SCCP Session
@@ -1401,46 +1446,17 @@ void handle_unregister(constSessionPtr s, devicePtr device, constMessagePtr msg_
 }
 
 /*!
- * \brief Handle Button Template Request for Session
- * \param s SCCP Session
+ * \brief Send Button Template Message to Device
  * \param d SCCP Device
- * \param none SCCP Message
- *
- * \warning
- *   - device->buttonconfig is not always locked
+ * \param btn Button Template
  */
-void sccp_handle_button_template_req(constSessionPtr s, devicePtr d, constMessagePtr none)
+static void sccp_send_button_template(devicePtr d, btnlist * btn)
 {
-	btnlist * btn = NULL;
 	int i = 0;
 	uint8_t buttonCount = 0;
-
 	uint8_t lastUsedButtonPosition = 0;
-
 	sccp_msg_t *msg_out = NULL;
 
-	skinny_registrationstate_t registrationState=sccp_device_getRegistrationState(d);
-	if (registrationState != SKINNY_DEVICE_RS_PROGRESS && registrationState != SKINNY_DEVICE_RS_OK) {
-		pbx_log(LOG_WARNING, "%s: Received a button template request from unregistered device\n", d->id);
-		sccp_session_stopthread(s, SKINNY_DEVICE_RS_FAILED);
-		return;
-	}
-
-	/* pre-attach lines. We will wait for button template req if the phone does support it */
-	if (d->buttonTemplate) {
-		sccp_free(d->buttonTemplate);
-	}
-	btn = d->buttonTemplate = sccp_make_button_template(d);
-
-	/* update lineButtons array */
-	sccp_linedevice_createButtonsArray(d);
-
-	if (!btn) {
-		pbx_log(LOG_ERROR, "%s: No memory allocated for button template\n", d->id);
-		sccp_session_stopthread(s, SKINNY_DEVICE_RS_FAILED);
-		return;
-	}
-
 	REQ(msg_out, ButtonTemplateMessage);
 	if (!msg_out) {
 		return;
@@ -1507,16 +1523,53 @@ void sccp_handle_button_template_req(constSessionPtr s, devicePtr d, constMessag
 }
 
 /*!
- * \brief Handle Line Number for Session
+ * \brief Handle Button Template Request for Session
  * \param s SCCP Session
  * \param d SCCP Device
- * \param msg_in SCCP Message
+ * \param none SCCP Message
+ *
+ * \warning
+ *   - device->buttonconfig is not always locked
  */
-void handle_line_number(constSessionPtr s, devicePtr d, constMessagePtr msg_in)
+void sccp_handle_button_template_req(constSessionPtr s, devicePtr d, constMessagePtr none)
+{
+	btnlist * btn = NULL;
+
+	skinny_registrationstate_t registrationState=sccp_device_getRegistrationState(d);
+	if (registrationState != SKINNY_DEVICE_RS_PROGRESS && registrationState != SKINNY_DEVICE_RS_OK) {
+		pbx_log(LOG_WARNING, "%s: Received a button template request from unregistered device\n", d->id);
+		sccp_session_stopthread(s, SKINNY_DEVICE_RS_FAILED);
+		return;
+	}
+
+	/* pre-attach lines. We will wait for button template req if the phone does support it */
+	if (d->buttonTemplate) {
+		sccp_free(d->buttonTemplate);
+	}
+	btn = d->buttonTemplate = sccp_make_button_template(d);
+
+	/* update lineButtons array */
+	sccp_linedevice_createButtonsArray(d);
+
+	if (!btn) {
+		pbx_log(LOG_ERROR, "%s: No memory allocated for button template\n", d->id);
+		sccp_session_stopthread(s, SKINNY_DEVICE_RS_FAILED);
+		return;
+	}
+
+	sccp_send_button_template(d, btn);
+}
+
+/*!
+ * \brief Send Line Status for a Line or Speeddial Button
+ * \param s SCCP Session
+ * \param d SCCP Device
+ * \param lineNumber Line Instance
+ */
+static void sccp_send_line_status(constSessionPtr s, devicePtr d, uint8_t lineNumber)
 {
 	sccp_speed_t k;
 	sccp_buttonconfig_t * config = NULL;
-	uint8_t lineNumber = letohl(msg_in->data.LineStatReqMessage.lel_lineNumber);
 
 	char * dirNumber = "<undef>";
 	char * fullyQualifiedDisplayName = "";
@@ -1568,6 +1621,175 @@ void handle_line_number(constSessionPtr s, devicePtr d, constMessagePtr msg_in)
 	d->protocol->sendLineStatResp(d, lineNumber, dirNumber, fullyQualifiedDisplayName, displayName);
 }
 
+/*!
+ * \brief Handle Line Number for Session
+ * \param s SCCP Session
+ * \param d SCCP Device
+ * \param msg_in SCCP Message
+ */
+void handle_line_number(constSessionPtr s, devicePtr d, constMessagePtr msg_in)
+{
+	uint8_t lineNumber = letohl(msg_in->data.LineStatReqMessage.lel_lineNumber);
+
+	sccp_send_line_status(s, d, lineNumber);
+}
+
+/*!
+ * \brief Release a Button Template, including the line references held by its line buttons
+ * \param btn Button Template
+ */
+static void sccp_release_button_template(btnlist * btn)
+{
+	int i = 0;
+
+	for (i = 0; i < StationMaxButtonTemplateSize; i++) {
+		if ((btn[i].type == SKINNY_BUTTONTYPE_LINE) && btn[i].ptr) {
+			sccp_line_t * tmp = btn[i].ptr; /* implicit cast without type change */
+			sccp_line_release(&tmp);
+			btn[i].ptr = NULL;
+		}
+	}
+	sccp_free(btn);
+}
+
+/*!
+ * \brief Refresh the Button Template of a registered Device in place, after buttons have been added to its buttonconfig
+ * \param d SCCP Device
+ * \return TRUE when the new template and the status of the new lines have been sent, FALSE when the device needs a restart instead
+ *
+ * \note The phone keeps using the instances it learned during registration, so this only succeeds when all existing buttons keep their instance,
+ *       which is the case when buttons have been appended. Removed or changed buttons, active channels and older protocol versions still require a restart.
+ * \note The session thread keeps reading d->buttonTemplate and the button configs. The new template is laid out on copies of the button configs,
+ *       and only the buttons it adds are filled into the unused slots of the live template, which is never freed or reallocated here.
+ *
+ * \lock
+ *  - device->buttonconfig
+ */
+boolean_t sccp_handle_button_template_refresh(devicePtr d)
+{
+	struct sccp_buttonconfig_list copies;
+	sccp_buttonconfig_t * config = NULL;
+	sccp_buttonconfig_t * copy = NULL;
+	btnlist * btn = NULL;
+	btnlist * live = d->buttonTemplate;
+	uint8_t newLines[StationMaxButtonTemplateSize];
+	uint8_t numNewLines = 0;
+	uint8_t idx = 0;
+	int i = 0;
+	boolean_t keepsInstances = TRUE;
+
+	if (!d->session || !live || d->isAnonymous || sccp_device_getRegistrationState(d) != SKINNY_DEVICE_RS_OK) {
+		return FALSE;
+	}
+	if (d->inuseprotocolversion < SCCP_BUTTONTEMPLATE_REFRESH_MIN_PROTOCOLVERSION) {
+		sccp_log((DEBUGCAT_BUTTONTEMPLATE)) (VERBOSE_PREFIX_3 "%s: protocol version %d does not support a button template refresh\n", d->id, d->inuseprotocolversion);
+		return FALSE;
+	}
+	if (sccp_device_numberOfChannels(d) > 0) {
+		return FALSE;
+	}
+
+	/* lay out the template from scratch on copies (without instances), the strings stay owned by the live button configs, which are locked until we are done */
+	SCCP_LIST_HEAD_INIT(&copies);
+	SCCP_LIST_LOCK(&d->buttonconfig);
+	SCCP_LIST_TRAVERSE(&d->buttonconfig, config, list) {
+		if (config->pendingDelete || config->pendingUpdate) {
+			keepsInstances = FALSE;
+			break;
+		}
+		if (!(copy = (sccp_buttonconfig_t *)sccp_malloc(sizeof(sccp_buttonconfig_t)))) {
+			pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, d->id);
+			keepsInstances = FALSE;
+			break;
+		}
+		memcpy(copy, config, sizeof(sccp_buttonconfig_t));
+		memset(&copy->list, 0, sizeof(copy->list));
+		copy->instance = 0;
+		SCCP_LIST_INSERT_TAIL(&copies, copy, list);
+	}
+	if (keepsInstances) {
+		btn = sccp_build_button_template(d, &copies, FALSE);
+	}
+
+	/* all existing buttons have to keep their instance and their position */
+	copy = SCCP_LIST_FIRST(&copies);
+	SCCP_LIST_TRAVERSE(&d->buttonconfig, config, list) {
+		if (!btn || !copy) {
+			keepsInstances = FALSE;
+			break;
+		}
+		if (config->instance && config->instance != copy->instance) {
+			keepsInstances = FALSE;
+		}
+		copy = SCCP_LIST_NEXT(copy, list);
+	}
+	for (i = 0; btn && keepsInstances && i < StationMaxButtonTemplateSize; i++) {
+		if (live[i].type != SKINNY_BUTTONTYPE_UNUSED && (live[i].type != btn[i].type || live[i].instance != btn[i].instance || live[i].ptr != btn[i].ptr)) {
+			keepsInstances = FALSE;
+		}
+	}
+
+	if (keepsInstances) {
+		/* fill the new buttons into the unused slots of the live template, handing over the line reference */
+		for (i = 0; i < StationMaxButtonTemplateSize; i++) {
+			if (live[i].type == SKINNY_BUTTONTYPE_UNUSED && btn[i].type != SKINNY_BUTTONTYPE_UNUSED) {
+				live[i].instance = btn[i].instance;
+				live[i].devicetype = btn[i].devicetype;
+				live[i].ptr = btn[i].ptr;
+				btn[i].ptr = NULL;
+				live[i].type = btn[i].type;
+			}
+		}
+		copy = SCCP_LIST_FIRST(&copies);
+		SCCP_LIST_TRAVERSE(&d->buttonconfig, config, list) {
+			if (!config->instance && copy->instance) {
+				config->instance = copy->instance;
+				if (config->type == FEATURE) {
+					config->button.feature.status = copy->button.feature.status;
+				}
+				for (i = 0; config->type == LINE && i < StationMaxButtonTemplateSize; i++) {
+					if (live[i].type == SKINNY_BUTTONTYPE_LINE && live[i].instance == config->instance && live[i].ptr) {
+						sccp_linedevice_create(d, live[i].ptr, config->instance, config->button.line.subscriptionId);
+						newLines[numNewLines++] = config->instance;
+						break;
+					}
+				}
+			}
+			copy = SCCP_LIST_NEXT(copy, list);
+		}
+	}
+	SCCP_LIST_UNLOCK(&d->buttonconfig);
+
+	while ((copy = SCCP_LIST_REMOVE_HEAD(&copies, list))) {
+		sccp_free(copy);
+	}
+	SCCP_LIST_HEAD_DESTROY(&copies);
+	if (btn) {
+		sccp_release_button_template(btn);
+	}
+	if (!keepsInstances) {
+		sccp_log((DEBUGCAT_BUTTONTEMPLATE)) (VERBOSE_PREFIX_3 "%s: existing buttons would move, button template cannot be refreshed in place\n", d->id);
+		return FALSE;
+	}
+
+	sccp_log((DEBUGCAT_BUTTONTEMPLATE + DEBUGCAT_DEVICE)) (VERBOSE_PREFIX_3 "%s: refreshing button template in place, %d new line(s)\n", d->id, numNewLines);
+	sccp_linedevice_createButtonsArray(d);
+	sccp_send_button_template(d, live);
+
+	/* the phone only requests line status during registration, announce the new lines ourselves */
+	for (idx = 0; idx < numNewLines; idx++) {
+		sccp_send_line_status(d->session, d, newLines[idx]);
+		AUTO_RELEASE(sccp_linedevice_t, ld, sccp_linedevice_findByLineinstance(d, newLines[idx]));
+		if (ld) {
+			sccp_dev_forward_status(ld->line, ld->lineInstance, d);
+			sccp_linedevice_indicateMWI(ld);
+		}
+	}
+	sccp_device_setMWI(d);
+	sccp_dev_check_displayprompt(d);
+	return TRUE;
+}
+
 /*!
  * \brief Handle SpeedDial Status Request for Session
  * \param s SCCP Session
@@ -3445,7 +3667,8 @@ void handle_openReceiveChannelAck(constSessionPtr s, devicePtr d, constMessagePt
 				break;
 		}
 		sccp_rtp_setState(audio, SCCP_RTP_RECEPTION, resultingChannelState);
-	} else {
+		sccp_session_completeTransaction(s, OpenReceiveChannel, passThruPartyId, mediastatus == SKINNY_MEDIASTATUS_Ok);
+	} else if (!sccp_session_completeTransaction(s, OpenReceiveChannel, passThruPartyId, mediastatus == SKINNY_MEDIASTATUS_Ok)) {
 		// we successfully opened receive channel, but have no channel active -> close receive (maybe the call was already (being) terminated)
 		if (mediastatus == SKINNY_MEDIASTATUS_Ok) {
 			callReference = callReference ? callReference : passThruPartyId ^ 0xFFFFFFFF;
@@ -3508,7 +3731,8 @@ void handle_startMediaTransmissionAck(constSessionPtr s, devicePtr d, constMessa
 				break;
 		}
 		sccp_rtp_setState(audio, SCCP_RTP_TRANSMISSION, resultingChannelState);
-	} else {
+		sccp_session_completeTransaction(s, StartMediaTransmission, passThruPartyId, mediastatus == SKINNY_MEDIASTATUS_Ok);
+	} else if (!sccp_session_completeTransaction(s, StartMediaTransmission, passThruPartyId, mediastatus == SKINNY_MEDIASTATUS_Ok)) {
 		// we successfully opened receive channel, but have no channel active -> close receive (maybe the call was already (being) terminated)
 		if (mediastatus == SKINNY_MEDIASTATUS_Ok) {
 			callReference = callReference ? callReference : (callReference1 ? callReference1 : passThruPartyId ^ 0xFFFFFFFF);
@@ -3876,6 +4100,7 @@ void handle_ConnectionStatistics(constSessionPtr s, devicePtr device, constMessa
 		call_stats[SCCP_CALLSTATISTIC_AVG].variance_opinion_score_listening_quality = CALC_AVG(call_stats[SCCP_CALLSTATISTIC_LAST].variance_opinion_score_listening_quality, call_stats[SCCP_CALLSTATISTIC_AVG].variance_opinion_score_listening_quality, call_stats[SCCP_CALLSTATISTIC_AVG].num);
 
 		call_stats[SCCP_CALLSTATISTIC_AVG].num++;
+		sccp_device_updateLinkQuality(d, &call_stats[SCCP_CALLSTATISTIC_LAST]);
 		pbx_str_append(&output_buf, buffersize, "         Mean Statistics  : #Calls: %d Packets sent: %d rcvd: %d lost: %d jitter: %d latency: %d\n", call_stats[SCCP_CALLSTATISTIC_AVG].num, call_stats[SCCP_CALLSTATISTIC_AVG].packets_sent, call_stats[SCCP_CALLSTATISTIC_AVG].packets_received, call_stats[SCCP_CALLSTATISTIC_AVG].packets_lost, call_stats[SCCP_CALLSTATISTIC_AVG].jitter, call_stats[SCCP_CALLSTATISTIC_AVG].latency);
 
 		pbx_str_append(&output_buf, buffersize, "         Mean Quality     : MLQK=%.4f;MLQKav=%.4f;MLQKmn=%.4f;MLQKmx=%.4f;MLQKvr=%.2f|ICR=%.4f;CCR=%.4f;ICRmx=%.4f|CS=%d;SCS=%d\n",
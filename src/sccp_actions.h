@@ -13,6 +13,7 @@
 __BEGIN_C_EXTERN__
 
 SCCP_API int SCCP_CALL sccp_handle_message(constMessagePtr msg, constSessionPtr s);
+SCCP_API boolean_t SCCP_CALL sccp_handle_message_lookup(sccp_mid_t mid);
 
 /* externally used handlers */
 SCCP_API void SCCP_CALL sccp_handle_backspace(constDevicePtr d, const uint8_t lineInstance, const uint32_t callid)	__NONNULL(1);
@@ -21,5 +22,6 @@ SCCP_API void SCCP_CALL sccp_handle_AvailableLines(constSessionPtr s, devicePtr
 SCCP_API void SCCP_CALL sccp_handle_soft_key_template_req(constSessionPtr s, devicePtr d, constMessagePtr none)		__NONNULL(1,2);
 SCCP_API void SCCP_CALL sccp_handle_time_date_req(constSessionPtr s, devicePtr d, constMessagePtr none)			__NONNULL(1,2);
 SCCP_API void SCCP_CALL sccp_handle_button_template_req(constSessionPtr s, devicePtr d, constMessagePtr none)		__NONNULL(1,2);
+SCCP_API boolean_t SCCP_CALL sccp_handle_button_template_refresh(devicePtr d)						__NONNULL(1);
 __END_C_EXTERN__
 // kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
@@ -0,0 +1,417 @@
+/*!
+ * \file        sccp_cac.c
+ * \brief       SCCP Call Admission Control
+ * \note        Bandwidth budget per location (a group of devices, matched by network or by the device 'location' setting).
+ *              New calls are admitted with the preferred codec, downgraded to a cheaper codec from the device preferences
+ *              or refused once the budget of the location is used up. The charge is released on hold and when the channel
+ *              is destroyed.
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#include "config.h"
+#include "common.h"
+#include "sccp_cac.h"
+#include "sccp_codec.h"
+#include "sccp_device.h"
+#include "sccp_line.h"
+#include "sccp_session.h"
+#include "sccp_utils.h"
+
+SCCP_FILE_VERSION(__FILE__, "");
+
+void sccp_cac_module_start(void)
+{
+	SCCP_LIST_HEAD_INIT(&GLOB(cac_locations));
+}
+
+void sccp_cac_module_stop(void)
+{
+	sccp_cac_location_t * location = NULL;
+
+	SCCP_LIST_LOCK(&GLOB(cac_locations));
+	while ((location = SCCP_LIST_REMOVE_HEAD(&GLOB(cac_locations), list))) {
+		if (location->ha) {
+			sccp_free_ha(location->ha);
+		}
+		sccp_free(location);
+	}
+	SCCP_LIST_UNLOCK(&GLOB(cac_locations));
+	SCCP_LIST_HEAD_DESTROY(&GLOB(cac_locations));
+}
+
+/*!
+ * \brief Audio codecs the device would use for a new call, in order of preference
+ */
+static void sccp_cac_getCodecs(constDevicePtr d, constLinePtr l, skinny_codec_t codecs[SKINNY_MAX_CAPABILITIES])
+{
+	const skinny_codec_t * preferences = (l && l->preferences_set_on_line_level) ? l->preferences.audio : d->preferences.audio;
+
+	memset(codecs, 0, sizeof(skinny_codec_t) * SKINNY_MAX_CAPABILITIES);
+	if (d->capabilities.audio[0] == SKINNY_CODEC_NONE || !sccp_codec_getReducedSet(preferences, d->capabilities.audio, codecs)) {
+		memcpy(codecs, preferences, sizeof(skinny_codec_t) * SKINNY_MAX_CAPABILITIES);
+	}
+	if (codecs[0] == SKINNY_CODEC_NONE) {									// nothing known yet, account for g711
+		codecs[0] = SKINNY_CODEC_G711_ULAW_64K;
+	}
+}
+
+/*!
+ * \brief Find the location of a device: the configured location name, otherwise the first location whose networks contain the device address
+ * \note GLOB(cac_locations) needs to be locked
+ */
+static sccp_cac_location_t * sccp_cac_findLocation(constDevicePtr d, const struct sockaddr_storage * sas)
+{
+	sccp_cac_location_t * location = NULL;
+
+	SCCP_LIST_TRAVERSE(&GLOB(cac_locations), location, list) {
+		if (!sccp_strlen_zero(d->location)) {
+			if (sccp_strcaseequals(location->name, d->location)) {
+				return location;
+			}
+		} else if (sas && location->ha && sccp_apply_ha_default(location->ha, sas, AST_SENSE_DENY) == AST_SENSE_ALLOW) {
+			return location;
+		}
+	}
+	return NULL;
+}
+
+/*!
+ * \brief Find a location by name
+ * \note GLOB(cac_locations) needs to be locked
+ */
+static sccp_cac_location_t * sccp_cac_findLocationByName(const char * name)
+{
+	sccp_cac_location_t * location = NULL;
+
+	SCCP_LIST_TRAVERSE(&GLOB(cac_locations), location, list) {
+		if (sccp_strcaseequals(location->name, name)) {
+			return location;
+		}
+	}
+	return NULL;
+}
+
+/*!
+ * \brief Bandwidth of the first codec (in order of preference) that fits into the available bandwidth of a location
+ * \return 0 when none fits
+ * \note GLOB(cac_locations) needs to be locked
+ */
+static uint16_t sccp_cac_fit(const sccp_cac_location_t * location, const skinny_codec_t codecs[SKINNY_MAX_CAPABILITIES])
+{
+	uint32_t available = (location->bandwidth > location->used) ? location->bandwidth - location->used : 0;
+	uint16_t bandwidth = 0;
+
+	for (uint8_t x = 0; x < SKINNY_MAX_CAPABILITIES && codecs[x] != SKINNY_CODEC_NONE; x++) {
+		bandwidth = sccp_codec_getBandwidth(codecs[x]);
+		if (!location->bandwidth || bandwidth <= available) {
+			return bandwidth;
+		}
+	}
+	return 0;
+}
+
+/*!
+ * \brief Check whether a new call could be admitted on this device, without charging anything
+ * \note a device that would not be offered the call counts as rejected
+ *
+ * \lock
+ *  - cac_locations
+ */
+boolean_t sccp_cac_check(constDevicePtr d, constLinePtr l)
+{
+	skinny_codec_t codecs[SKINNY_MAX_CAPABILITIES];
+	struct sockaddr_storage sas = { 0 };
+	sccp_cac_location_t * location = NULL;
+	char name[SCCP_MAX_LABEL] = "";
+	boolean_t admitted = TRUE;
+
+	if (!d || SCCP_LIST_EMPTY(&GLOB(cac_locations))) {
+		return TRUE;
+	}
+	sccp_cac_getCodecs(d, l, codecs);
+	boolean_t hasSas = d->session ? sccp_session_getSas(d->session, &sas) : FALSE;
+
+	SCCP_LIST_LOCK(&GLOB(cac_locations));
+	if ((location = sccp_cac_findLocation(d, hasSas ? &sas : NULL)) && !sccp_cac_fit(location, codecs)) {
+		location->rejected++;
+		sccp_copy_string(name, location->name, sizeof(name));
+		admitted = FALSE;
+	}
+	SCCP_LIST_UNLOCK(&GLOB(cac_locations));
+
+	if (!admitted) {
+		pbx_log(LOG_NOTICE, "%s: Not enough bandwidth in location %s, call not offered\n", d->id, name);
+	}
+	return admitted;
+}
+
+/*!
+ * \brief Charge a new call against the location of the device
+ * \param d Device
+ * \param l Line (for line level codec preferences)
+ * \param charge filled in with what was charged, to be passed to sccp_cac_release
+ * \param force charge the cheapest codec even when the budget is exhausted (call resumed / answered, it cannot be refused anymore)
+ * \return FALSE when there is not enough bandwidth left for any of the device codecs, nothing is charged in that case
+ *
+ * \lock
+ *  - cac_locations
+ */
+boolean_t sccp_cac_acquire(constDevicePtr d, constLinePtr l, sccp_cac_charge_t * const charge, boolean_t force)
+{
+	skinny_codec_t codecs[SKINNY_MAX_CAPABILITIES];
+	struct sockaddr_storage sas = { 0 };
+	sccp_cac_location_t * location = NULL;
+	char name[SCCP_MAX_LABEL] = "";
+	uint16_t preferred = 0;
+	uint16_t bandwidth = 0;
+	uint32_t budget = 0;
+	uint32_t used = 0;
+
+	charge->location[0] = '\0';
+	charge->bandwidth = 0;
+	if (!d || SCCP_LIST_EMPTY(&GLOB(cac_locations))) {
+		return TRUE;
+	}
+	sccp_cac_getCodecs(d, l, codecs);
+	preferred = sccp_codec_getBandwidth(codecs[0]);
+	boolean_t hasSas = d->session ? sccp_session_getSas(d->session, &sas) : FALSE;
+
+	SCCP_LIST_LOCK(&GLOB(cac_locations));
+	if (!(location = sccp_cac_findLocation(d, hasSas ? &sas : NULL))) {
+		SCCP_LIST_UNLOCK(&GLOB(cac_locations));
+		return TRUE;
+	}
+	bandwidth = sccp_cac_fit(location, codecs);
+	if (!bandwidth && force) {
+		for (uint8_t x = 0; x < SKINNY_MAX_CAPABILITIES && codecs[x] != SKINNY_CODEC_NONE; x++) {
+			uint16_t codecBandwidth = sccp_codec_getBandwidth(codecs[x]);
+			if (!bandwidth || codecBandwidth < bandwidth) {
+				bandwidth = codecBandwidth;
+			}
+		}
+	}
+	if (bandwidth) {
+		location->used += bandwidth;
+		location->calls++;
+		if (bandwidth < preferred) {
+			location->downgraded++;
+		}
+		sccp_copy_string(charge->location, location->name, sizeof(charge->location));
+		charge->bandwidth = bandwidth;
+	} else {
+		location->rejected++;
+	}
+	sccp_copy_string(name, location->name, sizeof(name));
+	budget = location->bandwidth;
+	used = location->used;
+	SCCP_LIST_UNLOCK(&GLOB(cac_locations));
+
+	if (!bandwidth) {
+		pbx_log(LOG_NOTICE, "%s: Not enough bandwidth in location %s (%u/%u kbit/s in use), refusing new call\n", d->id, name, used, budget);
+		return FALSE;
+	}
+	if (bandwidth < preferred) {
+		sccp_log((DEBUGCAT_CHANNEL + DEBUGCAT_CODEC))(VERBOSE_PREFIX_3 "%s: Location %s (%u/%u kbit/s in use), downgrading new call to %u kbit/s\n", d->id, name, used, budget, bandwidth);
+	}
+	return TRUE;
+}
+
+/*!
+ * \brief Correct the charge once the codec of the call is known
+ *
+ * \lock
+ *  - cac_locations
+ */
+void sccp_cac_adjust(sccp_cac_charge_t * const charge, skinny_codec_t codec)
+{
+	sccp_cac_location_t * location = NULL;
+	uint16_t bandwidth = sccp_codec_getBandwidth(codec);
+
+	if (sccp_strlen_zero(charge->location) || !bandwidth || bandwidth == charge->bandwidth) {
+		return;
+	}
+	SCCP_LIST_LOCK(&GLOB(cac_locations));
+	if ((location = sccp_cac_findLocationByName(charge->location))) {
+		location->used = (location->used > charge->bandwidth) ? location->used - charge->bandwidth : 0;
+		location->used += bandwidth;
+		charge->bandwidth = bandwidth;
+	}
+	SCCP_LIST_UNLOCK(&GLOB(cac_locations));
+}
+
+/*!
+ * \brief Release the bandwidth charged by sccp_cac_acquire
+ * \note the location is looked up by name, a location removed by a reload is simply skipped
+ *
+ * \lock
+ *  - cac_locations
+ */
+void sccp_cac_release(sccp_cac_charge_t * const charge)
+{
+	sccp_cac_location_t * location = NULL;
+
+	if (sccp_strlen_zero(charge->location)) {
+		return;
+	}
+	SCCP_LIST_LOCK(&GLOB(cac_locations));
+	if ((location = sccp_cac_findLocationByName(charge->location))) {
+		location->used = (location->used > charge->bandwidth) ? location->used - charge->bandwidth : 0;
+		if (location->calls) {
+			location->calls--;
+		}
+	}
+	SCCP_LIST_UNLOCK(&GLOB(cac_locations));
+	charge->location[0] = '\0';
+	charge->bandwidth = 0;
+}
+
+/*!
+ * \brief Reserve bandwidth for offering an inbound call to a device, in the location of the device
+ * \return FALSE when there is not enough bandwidth left in the location, the call should not be offered to this device
+ *
+ * \note the reservation is shared with the devices in the same location that were offered the call before,
+ *       it is handed to the answering device by sccp_cac_claim and released by sccp_cac_releaseOffer
+ */
+boolean_t sccp_cac_reserve(constDevicePtr d, constLinePtr l, sccp_cac_offer_t * const offer)
+{
+	char name[SCCP_MAX_LABEL] = "";
+	sccp_cac_charge_t * slot = NULL;
+
+	if (!d || SCCP_LIST_EMPTY(&GLOB(cac_locations)) || sccp_strlen_zero(sccp_cac_getLocationName(d, name, sizeof(name)))) {
+		return TRUE;
+	}
+	for (uint8_t x = 0; x < SCCP_CAC_MAX_OFFERS; x++) {
+		if (sccp_strequals(offer->charge[x].location, name)) {
+			return TRUE;
+		}
+		if (!slot && sccp_strlen_zero(offer->charge[x].location)) {
+			slot = &offer->charge[x];
+		}
+	}
+	if (!slot) {
+		return sccp_cac_check(d, l);								/* too many locations to keep track of, check without reserving */
+	}
+	return sccp_cac_acquire(d, l, slot, FALSE);
+}
+
+/*!
+ * \brief The call was answered by device d: move the reservation for its location to charge and release all other reservations
+ * \note charge is left alone when it was already charged, or when nothing was reserved in the location of the device
+ */
+void sccp_cac_claim(sccp_cac_offer_t * const offer, constDevicePtr d, sccp_cac_charge_t * const charge)
+{
+	char name[SCCP_MAX_LABEL] = "";
+
+	if (d) {
+		sccp_cac_getLocationName(d, name, sizeof(name));
+	}
+	for (uint8_t x = 0; x < SCCP_CAC_MAX_OFFERS; x++) {
+		if (sccp_strlen_zero(offer->charge[x].location)) {
+			continue;
+		}
+		if (sccp_strlen_zero(charge->location) && sccp_strequals(offer->charge[x].location, name)) {
+			memcpy(charge, &offer->charge[x], sizeof(sccp_cac_charge_t));
+			offer->charge[x].location[0] = '\0';
+			offer->charge[x].bandwidth = 0;
+		} else {
+			sccp_cac_release(&offer->charge[x]);
+		}
+	}
+}
+
+/*!
+ * \brief Release all bandwidth reserved while offering a call (rejected, not answered, hung up)
+ */
+void sccp_cac_releaseOffer(sccp_cac_offer_t * const offer)
+{
+	for (uint8_t x = 0; x < SCCP_CAC_MAX_OFFERS; x++) {
+		sccp_cac_release(&offer->charge[x]);
+	}
+}
+
+/*!
+ * \brief Remove the codecs that need more bandwidth than was charged, keeping the order (downgrade)
+ * \note the set is left alone when none of the codecs would fit
+ */
+void sccp_cac_reduceSet(const sccp_cac_charge_t * const charge, skinny_codec_t codecs[SKINNY_MAX_CAPABILITIES])
+{
+	skinny_codec_t result[SKINNY_MAX_CAPABILITIES] = { SKINNY_CODEC_NONE };
+	uint8_t pos = 0;
+
+	if (sccp_strlen_zero(charge->location) || !charge->bandwidth) {
+		return;
+	}
+	for (uint8_t x = 0; x < SKINNY_MAX_CAPABILITIES && codecs[x] != SKINNY_CODEC_NONE; x++) {
+		if (sccp_codec_getBandwidth(codecs[x]) <= charge->bandwidth) {
+			result[pos++] = codecs[x];
+		}
+	}
+	if (pos) {
+		memcpy(codecs, result, sizeof(result));
+	}
+}
+
+/*!
+ * \brief Name of the location a device currently belongs to (empty when none)
+ *
+ * \lock
+ *  - cac_locations
+ */
+char * sccp_cac_getLocationName(constDevicePtr d, char * buf, size_t size)
+{
+	struct sockaddr_storage sas = { 0 };
+	sccp_cac_location_t * location = NULL;
+	boolean_t hasSas = d->session ? sccp_session_getSas(d->session, &sas) : FALSE;
+
+	buf[0] = '\0';
+	SCCP_LIST_LOCK(&GLOB(cac_locations));
+	if ((location = sccp_cac_findLocation(d, hasSas ? &sas : NULL))) {
+		sccp_copy_string(buf, location->name, size);
+	}
+	SCCP_LIST_UNLOCK(&GLOB(cac_locations));
+	return buf;
+}
+
+/*!
+ * \brief Show Bandwidth Locations
+ * \param fd Fd as int
+ * \param totals Total number of lines as int
+ * \param s AMI Session
+ * \param m Message
+ * \param argc Argc as int
+ * \param argv[] Argv[] as char
+ * \return Result as int
+ *
+ * \called_from_asterisk
+ */
+#include <asterisk/cli.h>
+int sccp_show_locations(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[])
+{
+	int local_line_total = 0;
+	int local_table_total = 0;
+
+#define CLI_AMI_TABLE_NAME Locations
+#define CLI_AMI_TABLE_PER_ENTRY_NAME Location
+#define CLI_AMI_TABLE_LIST_ITER_HEAD &GLOB(cac_locations)
+#define CLI_AMI_TABLE_LIST_ITER_TYPE sccp_cac_location_t
+#define CLI_AMI_TABLE_LIST_ITER_VAR location
+#define CLI_AMI_TABLE_LIST_LOCK SCCP_LIST_LOCK
+#define CLI_AMI_TABLE_LIST_ITERATOR SCCP_LIST_TRAVERSE
+#define CLI_AMI_TABLE_LIST_UNLOCK SCCP_LIST_UNLOCK
+#define CLI_AMI_TABLE_FIELDS 															\
+ 		CLI_AMI_TABLE_FIELD(Name,		"-20.20",	s,	20,	location->name)						\
+ 		CLI_AMI_TABLE_FIELD(Bandwidth,		"-9",		d,	9,	location->bandwidth)					\
+ 		CLI_AMI_TABLE_FIELD(Used,		"-9",		d,	9,	location->used)						\
+ 		CLI_AMI_TABLE_FIELD(Calls,		"-5",		d,	5,	location->calls)					\
+ 		CLI_AMI_TABLE_FIELD(Downgraded,		"-10",		d,	10,	location->downgraded)					\
+ 		CLI_AMI_TABLE_FIELD(Rejected,		"-8",		d,	8,	location->rejected)
+#include "sccp_cli_table.h"
+	local_table_total++;
+
+	if (s) {
+		totals->lines = local_line_total;
+		totals->tables = local_table_total;
+	}
+	return RESULT_SUCCESS;
+}
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
@@ -0,0 +1,43 @@
+/*!
+ * \file        sccp_cac.h
+ * \brief       SCCP Call Admission Control Header
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#pragma once
+#include "sccp_cli.h"
+
+/*!
+ * \brief Bandwidth charged for one channel, released on hold / destroy
+ */
+typedef struct sccp_cac_charge {
+	char location[SCCP_MAX_LABEL];										/*!< Location charged (empty when nothing was charged) */
+	uint16_t bandwidth;											/*!< kbit/s charged, codecs above this are not offered */
+} sccp_cac_charge_t;
+
+#define SCCP_CAC_MAX_OFFERS 8
+
+/*!
+ * \brief Bandwidth reserved while an inbound call is offered (ringing), one charge per location of the offered devices
+ * \note only one of the offered devices can answer, devices in the same location share the reservation
+ */
+typedef struct sccp_cac_offer {
+	sccp_cac_charge_t charge[SCCP_CAC_MAX_OFFERS];
+} sccp_cac_offer_t;
+
+__BEGIN_C_EXTERN__
+SCCP_API void SCCP_CALL sccp_cac_module_start(void);
+SCCP_API void SCCP_CALL sccp_cac_module_stop(void);
+SCCP_API boolean_t SCCP_CALL sccp_cac_check(constDevicePtr d, constLinePtr l);
+SCCP_API boolean_t SCCP_CALL sccp_cac_acquire(constDevicePtr d, constLinePtr l, sccp_cac_charge_t * const charge, boolean_t force);
+SCCP_API void SCCP_CALL sccp_cac_adjust(sccp_cac_charge_t * const charge, skinny_codec_t codec);
+SCCP_API void SCCP_CALL sccp_cac_release(sccp_cac_charge_t * const charge);
+SCCP_API boolean_t SCCP_CALL sccp_cac_reserve(constDevicePtr d, constLinePtr l, sccp_cac_offer_t * const offer);
+SCCP_API void SCCP_CALL sccp_cac_claim(sccp_cac_offer_t * const offer, constDevicePtr d, sccp_cac_charge_t * const charge);
+SCCP_API void SCCP_CALL sccp_cac_releaseOffer(sccp_cac_offer_t * const offer);
+SCCP_API void SCCP_CALL sccp_cac_reduceSet(const sccp_cac_charge_t * const charge, skinny_codec_t codecs[SKINNY_MAX_CAPABILITIES]);
+SCCP_API char * SCCP_CALL sccp_cac_getLocationName(constDevicePtr d, char * buf, size_t size);
+
+SCCP_API int SCCP_CALL sccp_show_locations(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[]);
+__END_C_EXTERN__
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
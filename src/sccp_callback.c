@@ -0,0 +1,346 @@
+/*!
+ * \file        sccp_callback.c
+ * \brief       SCCP Camp-On CallBack
+ * \note        Pressing CallBack on a call to a busy (or not answering) extension ends the call and camps on the target.
+ *              The target is followed through the pbx hint of exten@context (or through the line state events when the
+ *              target is an sccp line without a dialplan hint). Once the target has been in use and becomes idle again,
+ *              the caller is notified, or the call is placed again (callback_autodial). One pending callback per device,
+ *              pending callbacks expire after callback_timeout seconds (checked on every access to the list).
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#include "config.h"
+#include "common.h"
+#include "sccp_callback.h"
+#include "sccp_channel.h"
+#include "sccp_device.h"
+#include "sccp_indicate.h"											// only for SCCP_CHANNELSTATE_Idling
+#include "sccp_labels.h"
+#include "sccp_line.h"
+#include "sccp_threadpool.h"
+#include "sccp_utils.h"
+
+SCCP_FILE_VERSION(__FILE__, "");
+
+/*!
+ * \brief Pending CallBack
+ */
+typedef struct sccp_callback sccp_callback_t;
+struct sccp_callback {
+	char deviceId[StationMaxDeviceNameSize];								/*!< caller */
+	char lineName[StationMaxNameSize];									/*!< caller's line, used to call back */
+	char exten[SCCP_MAX_EXTENSION];										/*!< target */
+	char context[SCCP_MAX_CONTEXT];
+	int stateid;												/*!< pbx extension state subscription, -1 when following the sccp line */
+	boolean_t armed;											/*!< target was seen in use, the next idle fires the callback */
+	time_t expires;
+	SCCP_LIST_ENTRY (sccp_callback_t) list;
+};
+
+static SCCP_LIST_HEAD (, sccp_callback_t) callbacks;
+
+static void sccp_callback_eventListener(const sccp_event_t * event);
+
+void sccp_callback_module_start(void)
+{
+	SCCP_LIST_HEAD_INIT(&callbacks);
+	sccp_event_subscribe(SCCP_EVENT_LINESTATUS_CHANGED | SCCP_EVENT_DEVICE_UNREGISTERED, sccp_callback_eventListener, TRUE);
+}
+
+void sccp_callback_module_stop(void)
+{
+	sccp_callback_t * cb = NULL;
+
+	sccp_event_unsubscribe(SCCP_EVENT_LINESTATUS_CHANGED | SCCP_EVENT_DEVICE_UNREGISTERED, sccp_callback_eventListener);
+	SCCP_LIST_LOCK(&callbacks);
+	while ((cb = SCCP_LIST_REMOVE_HEAD(&callbacks, list))) {
+		if (cb->stateid > -1) {
+			pbx_extension_state_del(cb->stateid, NULL);
+		}
+		sccp_free(cb);
+	}
+	SCCP_LIST_UNLOCK(&callbacks);
+	SCCP_LIST_HEAD_DESTROY(&callbacks);
+}
+
+/*!
+ * \brief Drop a callback that is no longer needed (expired, replaced, device gone)
+ * \note runs from the threadpool, removing the extension state subscription from within its own callback is not safe
+ */
+static void *sccp_callback_cancel(void *data)
+{
+	sccp_callback_t * cb = (sccp_callback_t *) data;
+
+	if (cb->stateid > -1) {
+		pbx_extension_state_del(cb->stateid, NULL);
+	}
+	sccp_log((DEBUGCAT_FEATURE)) (VERBOSE_PREFIX_3 "%s: (callback) camp-on on %s@%s cancelled\n", cb->deviceId, cb->exten, cb->context);
+	sccp_free(cb);
+	return NULL;
+}
+
+/*!
+ * \brief Run fn (sccp_callback_cancel or sccp_callback_fire) for an unlinked callback from the threadpool
+ * \note when the threadpool refuses the work (shutting down), the callback is cancelled inline instead of leaking it and its
+ *       extension state subscription
+ */
+static void sccp_callback_dispatch(void *(*fn)(void *), sccp_callback_t * cb)
+{
+	if (!GLOB(general_threadpool) || !sccp_threadpool_add_work(GLOB(general_threadpool), fn, cb)) {
+		sccp_callback_cancel(cb);
+	}
+}
+
+/*!
+ * \brief Hand the callbacks that passed their expiry time to sccp_callback_cancel
+ * \note called on every access to the callbacks list, with the list locked
+ */
+static void sccp_callback_expire(time_t now)
+{
+	sccp_callback_t * cb = NULL;
+
+	SCCP_LIST_TRAVERSE_SAFE_BEGIN(&callbacks, cb, list) {
+		if (cb->expires <= now) {
+			SCCP_LIST_REMOVE_CURRENT(list);
+			sccp_callback_dispatch(sccp_callback_cancel, cb);
+		}
+	}
+	SCCP_LIST_TRAVERSE_SAFE_END;
+}
+
+/*!
+ * \brief Target became available: notify the caller or place the call again
+ * \note runs from the threadpool
+ */
+static void *sccp_callback_fire(void *data)
+{
+	sccp_callback_t * cb = (sccp_callback_t *) data;
+	char msg[StationMaxDisplayNotifySize] = "";
+
+	if (cb->stateid > -1) {
+		pbx_extension_state_del(cb->stateid, NULL);
+	}
+	AUTO_RELEASE(sccp_device_t, d, sccp_device_find_byid(cb->deviceId, FALSE));
+	AUTO_RELEASE(sccp_line_t, l, sccp_line_find_byname(cb->lineName, FALSE));
+	if (d && l && sccp_device_getRegistrationState(d) == SKINNY_DEVICE_RS_OK) {
+		AUTO_RELEASE(sccp_channel_t, active, sccp_device_getActiveChannel(d));
+		if (GLOB(callback_autodial) && !active) {
+			sccp_log((DEBUGCAT_FEATURE)) (VERBOSE_PREFIX_3 "%s: (callback) %s is available, calling back\n", d->id, cb->exten);
+			AUTO_RELEASE(sccp_channel_t, c, sccp_channel_newcall(l, d, cb->exten, SKINNY_CALLTYPE_OUTBOUND, NULL, NULL));
+		} else {
+			sccp_log((DEBUGCAT_FEATURE)) (VERBOSE_PREFIX_3 "%s: (callback) %s is available\n", d->id, cb->exten);
+			snprintf(msg, sizeof(msg), "%s: %s", SKINNY_DISP_CALLBACK, cb->exten);
+			sccp_dev_displayprinotify(d, msg, SCCP_MESSAGE_PRIORITY_TIMEOUT, 30);
+			sccp_dev_starttone(d, SKINNY_TONE_ZIPZIP, 0, 0, SKINNY_TONEDIRECTION_USER);
+		}
+	}
+	sccp_free(cb);
+	return NULL;
+}
+
+/*!
+ * \brief Target exten@context (or sccp line 'exten' when context is NULL) changed state
+ * \param busy target is in use (arms the callback) or idle (fires an armed callback)
+ *
+ * \lock
+ *  - callbacks
+ */
+static void sccp_callback_targetChanged(const char * const exten, const char * const context, boolean_t busy)
+{
+	sccp_callback_t * cb = NULL;
+	time_t now = time(0);
+
+	SCCP_LIST_LOCK(&callbacks);
+	sccp_callback_expire(now);
+	SCCP_LIST_TRAVERSE_SAFE_BEGIN(&callbacks, cb, list) {
+		if (!sccp_strequals(cb->exten, exten) || (context ? (cb->stateid < 0 || !sccp_strequals(cb->context, context)) : cb->stateid > -1)) {
+			continue;
+		}
+		if (busy) {
+			cb->armed = TRUE;
+		} else if (cb->armed) {
+			SCCP_LIST_REMOVE_CURRENT(list);
+			sccp_callback_dispatch(sccp_callback_fire, cb);
+		}
+	}
+	SCCP_LIST_TRAVERSE_SAFE_END;
+	SCCP_LIST_UNLOCK(&callbacks);
+}
+
+/*!
+ * \brief asterisk callback for extension state changes (we subscribed with ast_extension_state_add)
+ */
+#if ASTERISK_VERSION_GROUP >= 111
+#ifdef CS_AST_HAS_EXTENSION_STATE_CB_TYPE_CONST_CHAR
+static int sccp_callback_devstate_cb(const char *context, const char *id, struct ast_state_cb_info *info, void *data)
+#else
+static int sccp_callback_devstate_cb(char *context, char *id, struct ast_state_cb_info *info, void *data)
+#endif
+#elif ASTERISK_VERSION_GROUP >= 110
+static int sccp_callback_devstate_cb(const char *context, const char *id, enum ast_extension_states state, void *data)
+#else
+static int sccp_callback_devstate_cb(char *context, char *id, enum ast_extension_states state, void *data)
+#endif
+{
+#if ASTERISK_VERSION_GROUP >= 111
+	int extensionState = info->exten_state;
+#else
+	int extensionState = state;
+#endif
+	switch (extensionState) {
+		case AST_EXTENSION_NOT_INUSE:
+			sccp_callback_targetChanged(id, context, FALSE);
+			break;
+		case AST_EXTENSION_REMOVED:
+		case AST_EXTENSION_DEACTIVATED:
+		case AST_EXTENSION_UNAVAILABLE:
+			break;
+		default:
+			sccp_callback_targetChanged(id, context, TRUE);
+			break;
+	}
+	return 0;
+}
+
+static void sccp_callback_eventListener(const sccp_event_t * event)
+{
+	sccp_callback_t * cb = NULL;
+
+	if (!event || SCCP_LIST_EMPTY(&callbacks)) {
+		return;
+	}
+	switch (event->type) {
+		case SCCP_EVENT_LINESTATUS_CHANGED:
+			if (event->lineStatusChanged.line) {
+				/* the channel going onhook is still on the line at this point */
+				sccp_line_t * line = event->lineStatusChanged.line;
+				boolean_t idle = (SCCP_CHANNELSTATE_Idling(event->lineStatusChanged.state) && SCCP_LIST_GETSIZE(&line->channels) <= 1) ? TRUE : FALSE;
+				sccp_callback_targetChanged(line->name, NULL, !idle);
+			}
+			break;
+		case SCCP_EVENT_DEVICE_UNREGISTERED:
+			if (event->deviceRegistered.device) {
+				SCCP_LIST_LOCK(&callbacks);
+				sccp_callback_expire(time(0));
+				SCCP_LIST_TRAVERSE_SAFE_BEGIN(&callbacks, cb, list) {
+					if (sccp_strequals(cb->deviceId, event->deviceRegistered.device->id)) {
+						SCCP_LIST_REMOVE_CURRENT(list);
+						sccp_callback_dispatch(sccp_callback_cancel, cb);
+					}
+				}
+				SCCP_LIST_TRAVERSE_SAFE_END;
+				SCCP_LIST_UNLOCK(&callbacks);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/*!
+ * \brief Camp on the number dialed on channel c
+ * \return TRUE when the callback is pending, FALSE when the target can not be followed (no hint and not an sccp line)
+ *
+ * \note a pending callback of the same device is replaced
+ *
+ * \lock
+ *  - callbacks
+ */
+boolean_t sccp_callback_request(constDevicePtr d, constLinePtr l, constChannelPtr c)
+{
+	sccp_callback_t * cb = NULL;
+	sccp_callback_t * previous = NULL;
+
+	if (!d || !l || !c || sccp_strlen_zero(c->dialedNumber)) {
+		return FALSE;
+	}
+	if (!(cb = (sccp_callback_t *) sccp_calloc(1, sizeof(sccp_callback_t)))) {
+		pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, d->id);
+		return FALSE;
+	}
+	sccp_copy_string(cb->deviceId, d->id, sizeof(cb->deviceId));
+	sccp_copy_string(cb->lineName, l->name, sizeof(cb->lineName));
+	sccp_copy_string(cb->exten, c->dialedNumber, sizeof(cb->exten));
+	sccp_copy_string(cb->context, !sccp_strlen_zero(l->context) ? l->context : GLOB(context), sizeof(cb->context));
+	cb->expires = time(0) + GLOB(callback_timeout);
+	cb->armed = (c->state == SCCP_CHANNELSTATE_BUSY) ? TRUE : FALSE;				/* no answer: wait for the target to be used first */
+
+	cb->stateid = -1;
+	if (pbx_get_hint(NULL, 0, NULL, 0, NULL, cb->context, cb->exten)) {
+		cb->stateid = pbx_extension_state_add(cb->context, cb->exten, sccp_callback_devstate_cb, NULL);
+	}
+	if (cb->stateid < 0) {
+		AUTO_RELEASE(sccp_line_t, target, sccp_line_find_byname(cb->exten, FALSE));
+		cb->stateid = target ? -1 : -2;
+	}
+	if (cb->stateid < -1) {
+		sccp_log((DEBUGCAT_FEATURE)) (VERBOSE_PREFIX_3 "%s: (callback) no hint for %s@%s and no such line, can not camp on\n", d->id, cb->exten, cb->context);
+		sccp_free(cb);
+		return FALSE;
+	}
+
+	SCCP_LIST_LOCK(&callbacks);
+	sccp_callback_expire(time(0));
+	SCCP_LIST_TRAVERSE_SAFE_BEGIN(&callbacks, previous, list) {
+		if (sccp_strequals(previous->deviceId, cb->deviceId)) {
+			SCCP_LIST_REMOVE_CURRENT(list);
+			sccp_callback_dispatch(sccp_callback_cancel, previous);
+		}
+	}
+	SCCP_LIST_TRAVERSE_SAFE_END;
+	SCCP_LIST_INSERT_TAIL(&callbacks, cb, list);
+	SCCP_LIST_UNLOCK(&callbacks);
+
+	sccp_log((DEBUGCAT_FEATURE)) (VERBOSE_PREFIX_3 "%s: (callback) camping on %s@%s via %s\n", d->id, cb->exten, cb->context, cb->stateid > -1 ? "hint" : "line state");
+	return TRUE;
+}
+
+/*!
+ * \brief Show Pending CallBacks
+ * \param fd Fd as int
+ * \param totals Total number of lines as int
+ * \param s AMI Session
+ * \param m Message
+ * \param argc Argc as int
+ * \param argv[] Argv[] as char
+ * \return Result as int
+ *
+ * \called_from_asterisk
+ */
+#include <asterisk/cli.h>
+int sccp_show_callbacks(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[])
+{
+	int local_line_total = 0;
+	int local_table_total = 0;
+	time_t now = time(0);
+
+	SCCP_LIST_LOCK(&callbacks);
+	sccp_callback_expire(now);
+	SCCP_LIST_UNLOCK(&callbacks);
+
+#define CLI_AMI_TABLE_NAME Callbacks
+#define CLI_AMI_TABLE_PER_ENTRY_NAME Callback
+#define CLI_AMI_TABLE_LIST_ITER_HEAD &callbacks
+#define CLI_AMI_TABLE_LIST_ITER_TYPE sccp_callback_t
+#define CLI_AMI_TABLE_LIST_ITER_VAR cb
+#define CLI_AMI_TABLE_LIST_LOCK SCCP_LIST_LOCK
+#define CLI_AMI_TABLE_LIST_ITERATOR SCCP_LIST_TRAVERSE
+#define CLI_AMI_TABLE_LIST_UNLOCK SCCP_LIST_UNLOCK
+#define CLI_AMI_TABLE_FIELDS 															\
+ 		CLI_AMI_TABLE_FIELD(Device,		"-16.16",	s,	16,	cb->deviceId)						\
+ 		CLI_AMI_TABLE_FIELD(Line,		"-16.16",	s,	16,	cb->lineName)						\
+ 		CLI_AMI_TABLE_FIELD(Target,		"-20.20",	s,	20,	cb->exten)						\
+ 		CLI_AMI_TABLE_FIELD(Context,		"-16.16",	s,	16,	cb->context)						\
+ 		CLI_AMI_TABLE_FIELD(Via,		"-5.5",		s,	5,	cb->stateid > -1 ? "hint" : "line")			\
+ 		CLI_AMI_TABLE_FIELD(Armed,		"-5.5",		s,	5,	cb->armed ? "yes" : "no")				\
+ 		CLI_AMI_TABLE_FIELD(Expires,		"-7",		d,	7,	cb->expires > now ? (int) (cb->expires - now) : 0)
+#include "sccp_cli_table.h"
+	local_table_total++;
+
+	if (s) {
+		totals->lines = local_line_total;
+		totals->tables = local_table_total;
+	}
+	return RESULT_SUCCESS;
+}
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
@@ -0,0 +1,268 @@
+/*!
+ * \file        sccp_callhistory.c
+ * \brief       SCCP Call History
+ * \note        Bounded list of the most recent placed, received and missed calls per line, recorded when a channel is
+ *              cleaned up. Shared by all devices on the line and served as a paged CiscoIPPhoneDirectory by the webservice:
+ *              <baseurl>/sccp?handler=callhistory&line=<linename>[&type=missed|received|placed][&page=<n>]
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#include "config.h"
+#include "common.h"
+#include "sccp_callhistory.h"
+#include "sccp_channel.h"
+#include "sccp_line.h"
+#include "sccp_utils.h"
+#include "sccp_webservice.h"
+
+SCCP_FILE_VERSION(__FILE__, "");
+
+#define SCCP_CALLHISTORY_PAGESIZE 10										/*!< entries per directory page (phones accept at most 32) */
+
+typedef enum {
+	SCCP_CALLHISTORY_ALL,
+	SCCP_CALLHISTORY_PLACED,
+	SCCP_CALLHISTORY_RECEIVED,
+	SCCP_CALLHISTORY_MISSED,
+} sccp_callhistory_type_t;
+
+static const char * const callhistory_type2str[] = {
+	[SCCP_CALLHISTORY_ALL]      = "all",
+	[SCCP_CALLHISTORY_PLACED]   = "placed",
+	[SCCP_CALLHISTORY_RECEIVED] = "received",
+	[SCCP_CALLHISTORY_MISSED]   = "missed",
+};
+
+struct sccp_callhistory_entry {
+	time_t time;
+	sccp_callhistory_type_t type;
+	char number[StationMaxDirnumSize];
+	char name[StationMaxNameSize];
+};
+
+/*!
+ * \brief Ring of the last 'size' calls on a line, newest at entries[next - 1]
+ */
+struct sccp_callhistory {
+	uint16_t size;
+	uint16_t count;
+	uint16_t next;
+	struct sccp_callhistory_entry entries[];
+};
+
+AST_MUTEX_DEFINE_STATIC(historyLock);
+
+static boolean_t sccp_callhistory_handler(const char * const uri, PBX_VARIABLE_TYPE * params, PBX_VARIABLE_TYPE * headers, pbx_str_t ** result);
+
+void sccp_callhistory_module_start(void)
+{
+	if (iWebService.addHandler && iWebService.isRunning()) {
+		iWebService.addHandler("callhistory", sccp_callhistory_handler, SCCP_XML_OUTPUTFMT_CXML);
+	}
+}
+
+void sccp_callhistory_module_stop(void)
+{
+	if (iWebService.removeHandler && iWebService.isRunning()) {
+		iWebService.removeHandler("callhistory");
+	}
+}
+
+void sccp_callhistory_destroy(sccp_callhistory_t ** history)
+{
+	pbx_mutex_lock(&historyLock);
+	if (*history) {
+		sccp_free(*history);
+		*history = NULL;
+	}
+	pbx_mutex_unlock(&historyLock);
+}
+
+/*!
+ * \brief Get the n-th newest entry
+ * \note historyLock needs to be held
+ */
+static struct sccp_callhistory_entry * sccp_callhistory_get(sccp_callhistory_t * history, uint16_t n)
+{
+	return &history->entries[(history->next + history->size - 1 - n) % history->size];
+}
+
+/*!
+ * \brief (Re)Allocate the history of a line, keeping the newest entries when the configured size changed
+ * \note historyLock needs to be held
+ */
+static sccp_callhistory_t * sccp_callhistory_resize(sccp_callhistory_t * history, uint16_t size)
+{
+	sccp_callhistory_t * resized = (sccp_callhistory_t *) sccp_calloc(sizeof(sccp_callhistory_t) + size * sizeof(struct sccp_callhistory_entry), 1);
+	if (!resized) {
+		return history;
+	}
+	resized->size = size;
+	if (history) {
+		uint16_t n = history->count < size ? history->count : size;
+		while (n > 0) {
+			resized->entries[resized->next++] = *sccp_callhistory_get(history, --n);
+		}
+		resized->count = resized->next;
+		resized->next %= size;
+		sccp_free(history);
+	}
+	return resized;
+}
+
+/*!
+ * \brief Record a channel which is being cleaned up in the history of its line
+ * \param channel SCCP Channel
+ * \param answered channel has been connected
+ */
+void sccp_callhistory_record(constChannelPtr channel, boolean_t answered)
+{
+	struct sccp_callhistory_entry entry = { 0 };
+	sccp_line_t * l = channel->line;
+	uint16_t size = GLOB(callhistory_size);
+
+	if (!size || !l || channel->parentChannel) {						/* forwarded calls are recorded by the parent */
+		return;
+	}
+	if (channel->calltype == SKINNY_CALLTYPE_OUTBOUND) {
+		entry.type = SCCP_CALLHISTORY_PLACED;
+		iCallInfo.Getter(sccp_channel_getCallInfo(channel),
+			SCCP_CALLINFO_CALLEDPARTY_NUMBER, &entry.number,
+			SCCP_CALLINFO_CALLEDPARTY_NAME, &entry.name,
+			SCCP_CALLINFO_KEY_SENTINEL);
+		if (sccp_strlen_zero(entry.number)) {
+			sccp_copy_string(entry.number, channel->dialedNumber, sizeof(entry.number));
+		}
+	} else if (channel->calltype == SKINNY_CALLTYPE_INBOUND && (answered || !channel->answered_elsewhere)) {
+		entry.type = answered ? SCCP_CALLHISTORY_RECEIVED : SCCP_CALLHISTORY_MISSED;
+		iCallInfo.Getter(sccp_channel_getCallInfo(channel),
+			SCCP_CALLINFO_CALLINGPARTY_NUMBER, &entry.number,
+			SCCP_CALLINFO_CALLINGPARTY_NAME, &entry.name,
+			SCCP_CALLINFO_KEY_SENTINEL);
+	} else {
+		return;
+	}
+	if (sccp_strlen_zero(entry.number)) {
+		return;
+	}
+	entry.time = time(0);
+
+	pbx_mutex_lock(&historyLock);
+	if (!l->callhistory || l->callhistory->size != size) {
+		l->callhistory = sccp_callhistory_resize(l->callhistory, size);
+	}
+	if (l->callhistory) {
+		sccp_callhistory_t * history = l->callhistory;
+		history->entries[history->next] = entry;
+		history->next = (history->next + 1) % history->size;
+		if (history->count < history->size) {
+			history->count++;
+		}
+	}
+	pbx_mutex_unlock(&historyLock);
+	sccp_log((DEBUGCAT_LINE)) (VERBOSE_PREFIX_3 "%s: (callhistory) %s: %s <%s>\n", l->name, callhistory_type2str[entry.type], entry.name, entry.number);
+}
+
+static void sccp_callhistory_append_escaped(pbx_str_t ** buf, const char * str)
+{
+	for (; str && *str; str++) {
+		switch (*str) {
+			case '<':
+				pbx_str_append(buf, 0, "&lt;");
+				break;
+			case '>':
+				pbx_str_append(buf, 0, "&gt;");
+				break;
+			case '&':
+				pbx_str_append(buf, 0, "&amp;");
+				break;
+			case '"':
+				pbx_str_append(buf, 0, "&quot;");
+				break;
+			case '\'':
+				pbx_str_append(buf, 0, "&apos;");
+				break;
+			default:
+				pbx_str_append(buf, 0, "%c", *str);
+				break;
+		}
+	}
+}
+
+/*!
+ * \brief Webservice Handler, returning one page of the call history of a line as CiscoIPPhoneDirectory
+ */
+static boolean_t sccp_callhistory_handler(const char * const uri, PBX_VARIABLE_TYPE * params, PBX_VARIABLE_TYPE * headers, pbx_str_t ** result)
+{
+	struct sccp_callhistory_entry page[SCCP_CALLHISTORY_PAGESIZE];
+	const char * linename = sccp_retrieve_str_variable_byKey(params, "line");
+	const char * typestr = sccp_retrieve_str_variable_byKey(params, "type");
+	sccp_callhistory_type_t type = SCCP_CALLHISTORY_ALL;
+	int pagenum = sccp_retrieve_int_variable_byKey(params, "page");
+	int total = 0;
+	int entries = 0;
+
+	if (sccp_strlen_zero(linename)) {
+		pbx_log(LOG_WARNING, "SCCP: (callhistory) no 'line' parameter provided in request\n");
+		return FALSE;
+	}
+	AUTO_RELEASE(sccp_line_t, l, sccp_line_find_byname(linename, FALSE));
+	if (!l) {
+		pbx_log(LOG_WARNING, "SCCP: (callhistory) line '%s' not found\n", linename);
+		return FALSE;
+	}
+	for (sccp_callhistory_type_t t = SCCP_CALLHISTORY_PLACED; t <= SCCP_CALLHISTORY_MISSED; t++) {
+		if (sccp_strcaseequals(typestr, callhistory_type2str[t])) {
+			type = t;
+		}
+	}
+	if (pagenum < 1 || pagenum > UINT16_MAX) {
+		pagenum = 1;
+	}
+
+	/* copy the requested page, so that the output can be generated without holding the lock */
+	pbx_mutex_lock(&historyLock);
+	if (l->callhistory) {
+		int first = (pagenum - 1) * SCCP_CALLHISTORY_PAGESIZE;
+		for (uint16_t n = 0; n < l->callhistory->count; n++) {
+			struct sccp_callhistory_entry * entry = sccp_callhistory_get(l->callhistory, n);
+			if (type != SCCP_CALLHISTORY_ALL && entry->type != type) {
+				continue;
+			}
+			if (total >= first && entries < SCCP_CALLHISTORY_PAGESIZE) {
+				page[entries++] = *entry;
+			}
+			total++;
+		}
+	}
+	pbx_mutex_unlock(&historyLock);
+	int pages = total ? (total + SCCP_CALLHISTORY_PAGESIZE - 1) / SCCP_CALLHISTORY_PAGESIZE : 1;
+
+	pbx_str_append(result, 0, "<CiscoIPPhoneDirectory>\n");
+	pbx_str_append(result, 0, "<Title>%s (%d/%d)</Title>\n", type == SCCP_CALLHISTORY_MISSED ? "Missed Calls" : type == SCCP_CALLHISTORY_RECEIVED ? "Received Calls" : type == SCCP_CALLHISTORY_PLACED ? "Placed Calls" : "Call History", pagenum, pages);
+	pbx_str_append(result, 0, "<Prompt>");
+	sccp_callhistory_append_escaped(result, !sccp_strlen_zero(l->description) ? l->description : l->name);
+	pbx_str_append(result, 0, "</Prompt>\n");
+	for (int i = 0; i < entries; i++) {
+		struct tm tm;
+		char timestr[16] = "";
+		strftime(timestr, sizeof(timestr), "%d/%m %H:%M", localtime_r(&page[i].time, &tm));
+
+		pbx_str_append(result, 0, "<DirectoryEntry><Name>%s%s ", type == SCCP_CALLHISTORY_ALL ? (page[i].type == SCCP_CALLHISTORY_MISSED ? "! " : page[i].type == SCCP_CALLHISTORY_PLACED ? "> " : "< ") : "", timestr);
+		sccp_callhistory_append_escaped(result, !sccp_strlen_zero(page[i].name) ? page[i].name : page[i].number);
+		pbx_str_append(result, 0, "</Name><Telephone>");
+		sccp_callhistory_append_escaped(result, page[i].number);
+		pbx_str_append(result, 0, "</Telephone></DirectoryEntry>\n");
+	}
+	pbx_str_append(result, 0, "<SoftKeyItem><Name>Dial</Name><URL>SoftKey:Dial</URL><Position>1</Position></SoftKeyItem>\n");
+	if (pagenum > 1) {
+		pbx_str_append(result, 0, "<SoftKeyItem><Name>Prev</Name><URL>%s/sccp?handler=%s&amp;line=%s&amp;type=%s&amp;page=%d</URL><Position>2</Position></SoftKeyItem>\n", iWebService.getBaseURL(), uri, l->name, callhistory_type2str[type], pagenum - 1);
+	}
+	if (pagenum < pages) {
+		pbx_str_append(result, 0, "<SoftKeyItem><Name>Next</Name><URL>%s/sccp?handler=%s&amp;line=%s&amp;type=%s&amp;page=%d</URL><Position>3</Position></SoftKeyItem>\n", iWebService.getBaseURL(), uri, l->name, callhistory_type2str[type], pagenum + 1);
+	}
+	pbx_str_append(result, 0, "<SoftKeyItem><Name>Exit</Name><URL>SoftKey:Exit</URL><Position>4</Position></SoftKeyItem>\n");
+	pbx_str_append(result, 0, "</CiscoIPPhoneDirectory>\n");
+	return TRUE;
+}
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
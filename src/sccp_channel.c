@@ -26,10 +26,13 @@ SCCP_FILE_VERSION(__FILE__, "");
 #include "sccp_pbx.h"
 #include "sccp_conference.h"
 #include "sccp_atomic.h"
+#include "sccp_callhistory.h"
 #include "sccp_feature.h"
 #include "sccp_indicate.h"
 #include "sccp_line.h"
 #include "sccp_linedevice.h"
+#include "sccp_quota.h"
+#include "sccp_cac.h"
 #include "sccp_rtp.h"
 #include "sccp_netsock.h"
 #include "sccp_utils.h"
@@ -65,6 +68,15 @@ struct sccp_private_channel_data {
 		skinny_toneDirection_t direction;
 	} tone;
 	boolean_t firewall_holepunch;
+	boolean_t answered;											/*!< channel has been connected, for the call history */
+	boolean_t historyRecorded;
+	struct {
+		boolean_t charged;
+		devicePtr device;
+		char context[SCCP_MAX_CONTEXT];
+	} quota;												/*!< what was charged by sccp_quota_acquire, released on destroy */
+	sccp_cac_charge_t cac;											/*!< bandwidth charged against the location of the device, released on hold / destroy */
+	sccp_cac_offer_t cacOffer;										/*!< bandwidth reserved while ringing, claimed on answer, released on hangup */
 };
 
 /*!
@@ -164,6 +176,18 @@ boolean_t __PURE__ sccp_channel_isAnswering(constChannelPtr c)
 	return c && c->privateData ? c->privateData->isAnswering : TRUE;
 }
 
+/*!
+ * \brief Reserve bandwidth in the location of device before offering the (inbound) channel to it
+ * \return FALSE when the location has no bandwidth left, the call should not be offered to this device
+ */
+boolean_t sccp_channel_reserveBandwidth(constChannelPtr c, constDevicePtr device)
+{
+	if (!c || !c->privateData) {
+		return TRUE;
+	}
+	return sccp_cac_reserve(device, c->line, &c->privateData->cacOffer);
+}
+
 /*!
  * \brief Allocate SCCP Channel on Device
  * \param l SCCP Line
@@ -195,6 +219,20 @@ channelPtr sccp_channel_allocate(constLinePtr l, constDevicePtr device)
 		pbx_log(LOG_ERROR, "SCCP: Tried to open channel on device %s without a session\n", device->id);
 		return NULL;
 	}
+	boolean_t quotaCharged = FALSE;
+	if (!sccp_quota_acquire(refLine, device, &quotaCharged)) {
+		sccp_line_release(&refLine);							// explicit release
+		return NULL;
+	}
+	sccp_cac_charge_t cac = { "", 0 };
+	if (!sccp_cac_acquire(device, refLine, &cac, FALSE)) {
+		sccp_dev_displayprompt(device, 0, 0, SKINNY_DISP_NOT_ENOUGH_BANDWIDTH, SCCP_DISPLAYSTATUS_TIMEOUT);
+		if (quotaCharged) {
+			sccp_quota_release(refLine, device, refLine->context);
+		}
+		sccp_line_release(&refLine);							// explicit release
+		return NULL;
+	}
 
 	int32_t callid = 0;
 	char designator[32];
@@ -297,6 +335,13 @@ channelPtr sccp_channel_allocate(constLinePtr l, constDevicePtr device)
 		}
 		channel->videomode = l->videomode;
 
+		if (quotaCharged) {
+			private_data->quota.charged = TRUE;
+			private_data->quota.device = device ? sccp_device_retain(device) : NULL;
+			sccp_copy_string(private_data->quota.context, refLine->context, sizeof(private_data->quota.context));
+		}
+		memcpy(&private_data->cac, &cac, sizeof(private_data->cac));
+
 		/* run setters */
 		sccp_line_addChannel(l, channel);
 		if (refLine->capabilities.audio[0] == SKINNY_CODEC_NONE) {
@@ -320,9 +365,11 @@ channelPtr sccp_channel_allocate(constLinePtr l, constDevicePtr device)
 	if (channel) {
 		sccp_channel_release(&channel);							// explicit release
 	}
-	if (refLine) {
-		sccp_line_release(&refLine);							// explicit release
+	if (quotaCharged) {
+		sccp_quota_release(refLine, device, refLine->context);
 	}
+	sccp_cac_release(&cac);
+	sccp_line_release(&refLine);								// explicit release
 	return NULL;
 }
 
@@ -364,6 +411,11 @@ void sccp_channel_setDevice(channelPtr channel, constDevicePtr device, boolean_t
 		return;
 	}
 
+	/* the bandwidth charge follows the device, it is released on hold and charged again on resume / answer */
+	if (channel->privateData->device && channel->privateData->device != device) {
+		sccp_cac_release(&channel->privateData->cac);
+	}
+
 	/** for previous device,set active channel to null */
 	if (!device) {
 		sccp_linedevice_refreplace(&channel->privateData->ld, NULL);
@@ -385,6 +437,10 @@ void sccp_channel_setDevice(channelPtr channel, constDevicePtr device, boolean_t
 #if CS_REFCOUNT_DEBUG
 		sccp_refcount_addRelationship(device, channel);
 #endif
+		sccp_cac_claim(&channel->privateData->cacOffer, device, &channel->privateData->cac);	// reserved while ringing
+		if (sccp_strlen_zero(channel->privateData->cac.location)) {
+			sccp_cac_acquire(device, channel->line, &channel->privateData->cac, TRUE);	// call is already established, cannot be refused anymore
+		}
 	}
 
 	if (channel->privateData && channel->privateData->device) {
@@ -471,10 +527,17 @@ static void sccp_channel_recalculateAudioCodecFormat(channelPtr channel)
 			sccp_codec_reduceSet(preferences->audio, channel->privateData->device->capabilities.audio);
 		}
 		sccp_codec_reduceSet(preferences->audio, channel->capabilities.audio);
-		joint = sccp_codec_findBestJoint(channel, preferences->audio, channel->remoteCapabilities.audio, TRUE);
+		skinny_codec_t codecs[SKINNY_MAX_CAPABILITIES];
+		memcpy(codecs, preferences->audio, sizeof(codecs));
+		if (channel->privateData->device && sccp_device_hasDegradedLink(channel->privateData->device)) {	// lossy / congested link, steer towards robust codecs
+			sccp_codec_preferRobust(codecs);
+		}
+		sccp_cac_reduceSet(&channel->privateData->cac, codecs);					// downgraded by call admission control
+		joint = sccp_codec_findBestJoint(channel, codecs, channel->remoteCapabilities.audio, TRUE);
 		if (SKINNY_CODEC_NONE == joint) {
-			joint = preferences->audio[0] ? preferences->audio[0] : SKINNY_CODEC_WIDEBAND_256K;
+			joint = codecs[0] ? codecs[0] : SKINNY_CODEC_WIDEBAND_256K;
 		}
+		sccp_cac_adjust(&channel->privateData->cac, joint);
 		if (channel->rtp.audio.instance) {                      // Fix nativeAudioFormats
 			skinny_codec_t codecs[SKINNY_MAX_CAPABILITIES] = { joint, SKINNY_CODEC_NONE};
 			iPbx.set_nativeAudioFormats(channel, codecs);
@@ -646,6 +709,9 @@ void sccp_channel_setChannelstate(channelPtr channel, sccp_channelstate_t state)
 {
 	channel->previousChannelState = channel->state;
 	channel->state = state;
+	if (state == SCCP_CHANNELSTATE_CONNECTED || state == SCCP_CHANNELSTATE_CONNECTEDCONFERENCE) {
+		channel->privateData->answered = TRUE;
+	}
 }
 
 /*!
@@ -761,17 +827,14 @@ void sccp_channel_StatisticsRequest(constChannelPtr channel)
  * \brief a simple way to punch a whole in the firewall by sending a short burst of packets during progress
  * transmission will be stopped again as soon as the first packet has been received from the device in astwrap_rtp_read
  */
-static void sccp_channel_startHolePunch(constChannelPtr c)
+static void sccp_channel_startHolePunch(constDevicePtr d, constChannelPtr c)
 {
 	pbx_assert(c != NULL && c->privateData && !c->privateData->firewall_holepunch);
 	sccp_rtp_t * audio = (sccp_rtp_t *)&(c->rtp.audio);
-	/*! \todo
-		// punching is only necessary if the rtp-instance ip-address+mask differs from the rtp->phone+mask
-		// ie: they are in different networks and there is a potential firewall in between
-		sccp_rtp_t * audio = (sccp_rtp_t *)&(c->rtp.audio);
-		apply_netmask()
-		if (sccp_netsock_cmp_addr(&audio->phone, &audio->phone_remote)) {
-	*/
+	if (!sccp_rtp_needsHolePunch(d, audio)) {							// same network, no firewall in between
+		sccp_log(DEBUGCAT_RTP)(VERBOSE_PREFIX_3 "%s: (%s) phone is reachable without punching a hole through the firewall\n", c->designator, __func__);
+		return;
+	}
 	if(!sccp_rtp_getState(audio, SCCP_RTP_TRANSMISSION) && pbx_channel_state(c->owner) != AST_STATE_UP && c->wantsEarlyRTP()) {
 		sccp_log(DEBUGCAT_RTP)(VERBOSE_PREFIX_3 "%s: (%s) start Punching a hole through the firewall (if necessary)\n", c->designator, __func__);
 		c->privateData->firewall_holepunch = TRUE;
@@ -885,7 +948,7 @@ int sccp_channel_receiveChannelOpen(sccp_device_t *d, sccp_channel_t *c)
 		sccp_rtp_runCallback(audio, SCCP_RTP_RECEPTION, c);
 		if(c->calltype != SKINNY_CALLTYPE_INBOUND) {
 			if(d->nat >= SCCP_NAT_ON) {
-				sccp_channel_startHolePunch(c);
+				sccp_channel_startHolePunch(d, c);
 			}
 			iPbx.queue_control(c->owner, (enum ast_control_frame_type)-1);						// 'PROD' the remote side to let them know
 																// we can receive inband signalling from this
@@ -2273,6 +2336,7 @@ void sccp_channel_clean(channelPtr channel)
 	if (ATOMIC_FETCH(&channel->scheduler.deny, &channel->scheduler.lock) == 0) {
 		sccp_channel_stop_and_deny_scheduled_tasks(channel);
 	}
+	sccp_cac_releaseOffer(&channel->privateData->cacOffer);
 
 	/* mark the channel DOWN so any pending thread will terminate */
 	if (channel->owner) {
@@ -2320,8 +2384,13 @@ void sccp_channel_clean(channelPtr channel)
 		}
 		sccp_dev_setActiveLine(d, NULL);
 		sccp_dev_check_displayprompt(d);
+		sccp_device_schedulePendingUpdates(d);							/* apply config changes postponed by this call */
 	}
 	if (channel->privateData) {
+		if (!channel->privateData->historyRecorded) {
+			channel->privateData->historyRecorded = TRUE;
+			sccp_callhistory_record(channel, channel->privateData->answered);
+		}
 		if (channel->privateData->device) {
 			sccp_channel_setDevice(channel, NULL, FALSE);
 		}
@@ -2389,6 +2458,14 @@ int __sccp_channel_destroy(const void * data)
 	sccp_free(*(char **)&channel->musicclass);
 	sccp_free(*(char **)&channel->designator);
 	SCCP_LIST_HEAD_DESTROY(&(channel->privateData->cleanup_jobs));
+	sccp_cac_releaseOffer(&channel->privateData->cacOffer);
+	sccp_cac_release(&channel->privateData->cac);
+	if (channel->privateData->quota.charged) {
+		sccp_quota_release(channel->line, channel->privateData->quota.device, channel->privateData->quota.context);
+		if (channel->privateData->quota.device) {
+			sccp_device_release(&channel->privateData->quota.device);		// explicit release
+		}
+	}
 	sccp_free(*(struct sccp_private_channel_data **)&channel->privateData);
 	sccp_line_release((sccp_line_t **)&channel->line);
 	/* */
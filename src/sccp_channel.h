@@ -53,6 +53,7 @@ struct sccp_channel {
 	skinny_capabilities_t capabilities;									/*!< our channel Capability in preference order */
 	skinny_capabilities_t preferences;
 	skinny_capabilities_t remoteCapabilities;
+	char remotePeerName[SCCP_MAX_EXTENSION];								/*!< Name of the pbx channel dialed by / dialing this channel, used to find the remoteCapabilities */
 	
 #if ASTERISK_VERSION_GROUP >= 113
 	struct ast_format_cap *caps;
@@ -147,6 +148,7 @@ SCCP_API boolean_t SCCP_CALL sccp_channel_set_originalCalledparty(constChannelPt
 SCCP_API void SCCP_CALL sccp_channel_set_calleridPresentation(constChannelPtr channel, sccp_callerid_presentation_t presentation);
 SCCP_API boolean_t SCCP_CALL sccp_channel_finishHolePunch(constChannelPtr channel);
 SCCP_API boolean_t __PURE__ SCCP_CALL      sccp_channel_isAnswering(constChannelPtr c);
+SCCP_API boolean_t SCCP_CALL sccp_channel_reserveBandwidth(constChannelPtr c, constDevicePtr device);
 SCCP_API void SCCP_CALL sccp_channel_openReceiveChannel(constChannelPtr channel);
 SCCP_API int SCCP_CALL sccp_channel_receiveChannelOpen(devicePtr d, channelPtr c);
 SCCP_API void SCCP_CALL sccp_channel_closeReceiveChannel(constChannelPtr channel, boolean_t KeepPortOpen);
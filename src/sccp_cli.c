@@ -56,6 +56,7 @@ SCCP_FILE_VERSION(__FILE__, "");
 #include "sccp_line.h"
 #include "sccp_linedevice.h"
 #include "sccp_session.h"
+#include "sccp_transport.h"
 #include "sccp_conference.h"
 #include "sccp_utils.h"
 #include "sccp_config.h"
@@ -63,6 +64,11 @@ SCCP_FILE_VERSION(__FILE__, "");
 #include "sccp_mwi.h"
 #include "sccp_hint.h"
 #include "sccp_labels.h"
+#include "sccp_quota.h"
+#include "sccp_cac.h"
+#include "sccp_huntgroup.h"
+#include "sccp_replication.h"
+#include "sccp_callback.h"
 #include "sccp_threadpool.h"
 #include "sccp_indicate.h"
 #include <sys/stat.h>
@@ -699,6 +705,10 @@ static int sccp_show_globals(int fd, sccp_cli_totals_t *totals, struct mansessio
 	char apref_buf[256];
 #if CS_SCCP_VIDEO
 	char vpref_buf[256];
+#endif
+	char replication_buf[128];
+#ifdef HAVE_LIBSSL
+	time_t rotated = 0;
 #endif
 	pbx_str_t *callgroup_buf = pbx_str_alloca(DEFAULT_PBX_STR_BUFFERSIZE);
 
@@ -747,13 +757,23 @@ static int sccp_show_globals(int fd, sccp_cli_totals_t *totals, struct mansessio
 	CLI_AMI_OUTPUT_PARAM("Secure Bind Address", CLI_AMI_LIST_WIDTH, "%s",
 			     GLOB(srvcontexts[SCCP_SERVERCONTEXT_TLS]) ? sccp_netsock_stringify(sccp_servercontext_getBoundAddr(GLOB(srvcontexts[SCCP_SERVERCONTEXT_TLS]))) : "(null)");
 	CLI_AMI_OUTPUT_PARAM("Certificate File", CLI_AMI_LIST_WIDTH, "%s", GLOB(cert_file));
+	CLI_AMI_OUTPUT_PARAM("Certificate Rotations", CLI_AMI_LIST_WIDTH, "%u", sccp_transport_tls_getRotations(&rotated));
+#endif
+#ifdef CS_EXPERIMENTAL
+	if (!sccp_strlen_zero(GLOB(transport_faults))) {
+		uint32_t delays = 0, interrupts = 0, shorts = 0, resets = 0;
+		sccp_transport_fault_getCounters(&delays, &interrupts, &shorts, &resets);
+		CLI_AMI_OUTPUT_PARAM("Transport Faults", CLI_AMI_LIST_WIDTH, "%s (injected delays:%u, eintr:%u, short:%u, resets:%u)", GLOB(transport_faults), delays, interrupts, shorts, resets);
+	}
 #endif
 	CLI_AMI_OUTPUT_PARAM("Extern IP", CLI_AMI_LIST_WIDTH, "%s", !sccp_netsock_is_any_addr(&GLOB(externip)) ? sccp_netsock_stringify_addr(&GLOB(externip)) : (GLOB(externhost) ? "Not Set -> using externhost" : "Not Set -> falling back to Incoming Interface IP-addres (expect issue if running natted !)."));
 	CLI_AMI_OUTPUT_PARAM("Localnet", CLI_AMI_LIST_WIDTH, "%s", pbx_str_buffer(ha_localnet_buf));
 	CLI_AMI_OUTPUT_PARAM("Deny/Permit", CLI_AMI_LIST_WIDTH, "%s", pbx_str_buffer(ha_buf));
 	CLI_AMI_OUTPUT_BOOL("Direct RTP", CLI_AMI_LIST_WIDTH, GLOB(directrtp));
+	CLI_AMI_OUTPUT_BOOL("Auto Direct RTP", CLI_AMI_LIST_WIDTH, GLOB(autodirectrtp));
 	CLI_AMI_OUTPUT_PARAM("Nat", CLI_AMI_LIST_WIDTH, "%s", sccp_nat2str(GLOB(nat)));
 	CLI_AMI_OUTPUT_PARAM("Keepalive", CLI_AMI_LIST_WIDTH, "%d", GLOB(keepalive));
+	CLI_AMI_OUTPUT_PARAM("Reregister grace", CLI_AMI_LIST_WIDTH, "%d", GLOB(reregister_grace));
 	CLI_AMI_OUTPUT_PARAM("Debug", CLI_AMI_LIST_WIDTH, "(%d) %s", GLOB(debug), debugcategories);
 	CLI_AMI_OUTPUT_PARAM("Date format", CLI_AMI_LIST_WIDTH, "%s", GLOB(dateformat));
 	CLI_AMI_OUTPUT_PARAM("First digit timeout", CLI_AMI_LIST_WIDTH, "%d", GLOB(firstdigittimeout));
@@ -829,6 +849,7 @@ static int sccp_show_globals(int fd, sccp_cli_totals_t *totals, struct mansessio
 #endif
 	CLI_AMI_OUTPUT_PARAM("Token FallBack", CLI_AMI_LIST_WIDTH, "%s", GLOB(token_fallback));
 	CLI_AMI_OUTPUT_PARAM("Token Backoff-Time", CLI_AMI_LIST_WIDTH, "%d", GLOB(token_backoff_time));
+	CLI_AMI_OUTPUT_PARAM("Replication", CLI_AMI_LIST_WIDTH, "%s", sccp_replication_status(replication_buf, sizeof(replication_buf)));
 	CLI_AMI_OUTPUT_BOOL("Hotline_Enabled", CLI_AMI_LIST_WIDTH, GLOB(allowAnonymous));
 	CLI_AMI_OUTPUT_PARAM("Hotline_Exten", CLI_AMI_LIST_WIDTH, "%s", GLOB(hotline->exten));
 	CLI_AMI_OUTPUT_PARAM("Hotline_Context", CLI_AMI_LIST_WIDTH, "%s", GLOB(hotline)->line->context ? GLOB(hotline)->line->context : "<not set>");
@@ -953,6 +974,139 @@ CLI_AMI_ENTRY(show_devices, sccp_show_devices, "List defined SCCP devices", cli_
 #undef CLI_COMPLETE
 #undef AMI_COMMAND
 #undef CLI_COMMAND
+#endif														/* DOXYGEN_SHOULD_SKIP_THIS */
+    /* -----------------------------------------------------------------------------------------------------SHOW TOP DEVICES- */
+/*!
+ * \brief Snapshot of the resources used on behalf of one device
+ */
+typedef struct {
+	char id[StationMaxDeviceNameSize];
+	size_t key;												/*!< value sorted on */
+	size_t messagesIn;
+	size_t bytesIn;
+	size_t messagesOut;
+	size_t bytesOut;
+	size_t async;
+	size_t cpu;
+	size_t registrations;
+	time_t since;
+} sccp_cli_topdevice_t;
+
+static int sccp_cli_topdevice_compare(const void *a, const void *b)
+{
+	const sccp_cli_topdevice_t *x = (const sccp_cli_topdevice_t *) a;
+	const sccp_cli_topdevice_t *y = (const sccp_cli_topdevice_t *) b;
+
+	return (x->key < y->key) ? 1 : (x->key > y->key) ? -1 : 0;
+}
+
+    /*!
+     * \brief Show the devices using the most resources (messages, bytes, session thread cpu, messages sent on their behalf, registrations)
+     * \param fd Fd as int
+     * \param totals Total number of lines as int
+     * \param s AMI Session
+     * \param m Message
+     * \param argc Argc as int
+     * \param argv[] Argv[] as char
+     * \return Result as int
+     * 
+     * \called_from_asterisk
+     */
+static int sccp_show_topdevices(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[])
+{
+	int local_line_total = 0;
+	const char *sortby = (argc > 3 && !sccp_strlen_zero(argv[3])) ? argv[3] : "cpu";
+	int limit = (argc > 4 && !sccp_strlen_zero(argv[4])) ? sccp_atoi(argv[4], strlen(argv[4])) : 20;
+	sccp_cli_topdevice_t *top = NULL;
+	sccp_device_t *d = NULL;
+	int count = 0;
+	time_t now = time(0);
+
+	if (argc < 3 || argc > 5 || limit <= 0) {
+		return RESULT_SHOWUSAGE;
+	}
+	if (!sccp_strcaseequals(sortby, "cpu") && !sccp_strcaseequals(sortby, "messages") && !sccp_strcaseequals(sortby, "bytes") && !sccp_strcaseequals(sortby, "async") && !sccp_strcaseequals(sortby, "registrations")) {
+		return RESULT_SHOWUSAGE;
+	}
+
+	SCCP_RWLIST_RDLOCK(&GLOB(devices));
+	if ((top = (sccp_cli_topdevice_t *) sccp_calloc(SCCP_RWLIST_GETSIZE(&GLOB(devices)) + 1, sizeof(sccp_cli_topdevice_t)))) {
+		SCCP_RWLIST_TRAVERSE(&GLOB(devices), d, list) {
+			sccp_cli_topdevice_t *entry = &top[count++];
+			sccp_copy_string(entry->id, d->id, sizeof(entry->id));
+			entry->messagesIn = d->accounting.messagesIn;
+			entry->bytesIn = d->accounting.bytesIn;
+			entry->messagesOut = d->accounting.messagesOut;
+			entry->bytesOut = d->accounting.bytesOut;
+			entry->async = d->accounting.async;
+			entry->cpu = d->accounting.cpu;
+			entry->registrations = d->accounting.registrations;
+			entry->since = d->accounting.since;
+		}
+	}
+	SCCP_RWLIST_UNLOCK(&GLOB(devices));
+	if (!top) {
+		pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+		CLI_AMI_RETURN_ERROR(fd, s, m, "%s", "Out of memory\n");					/* explicit return */
+	}
+	for (int idx = 0; idx < count; idx++) {
+		sccp_cli_topdevice_t *entry = &top[idx];
+		if (sccp_strcaseequals(sortby, "messages")) {
+			entry->key = entry->messagesIn + entry->messagesOut;
+		} else if (sccp_strcaseequals(sortby, "bytes")) {
+			entry->key = entry->bytesIn + entry->bytesOut;
+		} else if (sccp_strcaseequals(sortby, "async")) {
+			entry->key = entry->async;
+		} else if (sccp_strcaseequals(sortby, "registrations")) {
+			entry->key = entry->registrations;
+		} else {
+			entry->key = entry->cpu;
+		}
+	}
+	qsort(top, count, sizeof(sccp_cli_topdevice_t), sccp_cli_topdevice_compare);
+	if (limit > count) {
+		limit = count;
+	}
+
+#define CLI_AMI_TABLE_NAME TopDevices
+#define CLI_AMI_TABLE_PER_ENTRY_NAME TopDevice
+#define CLI_AMI_TABLE_ITERATOR for (int idx = 0; idx < limit; idx++)
+#define CLI_AMI_TABLE_BEFORE_ITERATION sccp_cli_topdevice_t *entry = &top[idx];
+#define CLI_AMI_TABLE_FIELDS 															\
+		CLI_AMI_TABLE_FIELD(Device,		"-16.16",	s,	16,	entry->id)						\
+		CLI_AMI_TABLE_FIELD(CpuMs,		"-8",		zu,	8,	entry->cpu / 1000)					\
+		CLI_AMI_TABLE_FIELD(MsgsIn,		"-8",		zu,	8,	entry->messagesIn)					\
+		CLI_AMI_TABLE_FIELD(MsgsOut,		"-8",		zu,	8,	entry->messagesOut)					\
+		CLI_AMI_TABLE_FIELD(BytesIn,		"-10",		zu,	10,	entry->bytesIn)						\
+		CLI_AMI_TABLE_FIELD(BytesOut,		"-10",		zu,	10,	entry->bytesOut)					\
+		CLI_AMI_TABLE_FIELD(Async,		"-8",		zu,	8,	entry->async)						\
+		CLI_AMI_TABLE_FIELD(Regs,		"-5",		zu,	5,	entry->registrations)					\
+		CLI_AMI_TABLE_FIELD(Minutes,		"-7",		d,	7,	(int) ((now - entry->since) / 60))
+#include "sccp_cli_table.h"
+	sccp_free(top);
+
+	if (s) {
+		totals->lines = local_line_total;
+		totals->tables = 1;
+	}
+	return RESULT_SUCCESS;
+}
+
+static char cli_topdevices_usage[] = "Usage: sccp show topdevices [cpu|messages|bytes|async|registrations] [count]\n"
+	"       Lists the devices using the most resources, sorted on session thread cpu time (default), messages or bytes (in + out),\n"
+	"       messages sent on their behalf by other threads (async: hints, blf, pbx events) or registration attempts. Shows 20 devices by default.\n";
+static char ami_topdevices_usage[] = "Usage: SCCPShowTopDevices\n" "Lists the devices using the most resources.\n\n" "PARAMS: SortBy (cpu|messages|bytes|async|registrations), Count\n";
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+#define CLI_COMMAND "sccp", "show", "topdevices"
+#define AMI_COMMAND "SCCPShowTopDevices"
+#define CLI_COMPLETE SCCP_CLI_NULL_COMPLETER
+#define CLI_AMI_PARAMS "SortBy", "Count"
+CLI_AMI_ENTRY(show_topdevices, sccp_show_topdevices, "List the SCCP devices using the most resources", cli_topdevices_usage, FALSE, TRUE)
+#undef CLI_AMI_PARAMS
+#undef CLI_COMPLETE
+#undef AMI_COMMAND
+#undef CLI_COMMAND
 #endif														/* DOXYGEN_SHOULD_SKIP_THIS */
     /* --------------------------------------------------------------------------------------------------------SHOW DEVICE- */
     /*!
@@ -980,6 +1134,8 @@ static int sccp_show_device(int fd, sccp_cli_totals_t *totals, struct mansession
 	const char *actionid = "";
 	char clientAddress[INET6_ADDRSTRLEN];
 	char serverAddress[INET6_ADDRSTRLEN];
+	char quota_buf[64];
+	char location_buf[SCCP_MAX_LABEL];
 
 	const char * dev = NULL;
 
@@ -1108,10 +1264,14 @@ static int sccp_show_device(int fd, sccp_cli_totals_t *totals, struct mansession
 	CLI_AMI_OUTPUT_YES_NO("Allow ringin notification", CLI_AMI_LIST_WIDTH, d->allowRinginNotification);
 	CLI_AMI_OUTPUT_BOOL("Private softkey",		CLI_AMI_LIST_WIDTH, d->privacyFeature.enabled);
 	CLI_AMI_OUTPUT_PARAM("Dtmf mode",		CLI_AMI_LIST_WIDTH, "%s", sccp_dtmfmode2str(d->getDtmfMode(d)));
+	CLI_AMI_OUTPUT_PARAM("Call Quota",		CLI_AMI_LIST_WIDTH, "%s", sccp_quota2str(&d->quota, quota_buf, sizeof(quota_buf)));
 //	CLI_AMI_OUTPUT_PARAM("digit timeout",		CLI_AMI_LIST_WIDTH, "%d", d->digittimeout);
 	CLI_AMI_OUTPUT_PARAM("Nat",			CLI_AMI_LIST_WIDTH, "%s", sccp_nat2str(d->nat));
+	CLI_AMI_OUTPUT_PARAM("Location",		CLI_AMI_LIST_WIDTH, "%s", sccp_cac_getLocationName(d, location_buf, sizeof(location_buf)));
+	CLI_AMI_OUTPUT_PARAM("Link Quality",		CLI_AMI_LIST_WIDTH, "loss:%.1f%%, jitter:%.0fms%s", d->linkQuality.loss, d->linkQuality.jitter, sccp_device_hasDegradedLink(d) ? " (degraded)" : "");
 	CLI_AMI_OUTPUT_YES_NO("Videosupport?",		CLI_AMI_LIST_WIDTH, sccp_device_isVideoSupported(d));
 	CLI_AMI_OUTPUT_BOOL("Direct RTP",		CLI_AMI_LIST_WIDTH, d->directrtp);
+	CLI_AMI_OUTPUT_BOOL("Auto Direct RTP",	CLI_AMI_LIST_WIDTH, d->autodirectrtp);
 	CLI_AMI_OUTPUT_BOOL("Trust phone ip (deprecated)", CLI_AMI_LIST_WIDTH, d->trustphoneip);
 	CLI_AMI_OUTPUT_PARAM("Phone IPv4", CLI_AMI_LIST_WIDTH, "%s", sccp_netsock_stringify(&d->ipv4));
 	CLI_AMI_OUTPUT_PARAM("Phone IPv6", CLI_AMI_LIST_WIDTH, "%s", sccp_netsock_stringify(&d->ipv6));
@@ -1518,6 +1678,7 @@ static int sccp_show_line(int fd, sccp_cli_totals_t *totals, struct mansession *
 	PBX_VARIABLE_TYPE * v = NULL;
 	pbx_str_t * callgroup_buf = pbx_str_alloca(DEFAULT_PBX_STR_BUFFERSIZE);
 	const char * actionid = "";
+	char quota_buf[64];
 
 #ifdef CS_SCCP_PICKUP
 	pbx_str_t *pickupgroup_buf = pbx_str_alloca(DEFAULT_PBX_STR_BUFFERSIZE);
@@ -1603,6 +1764,7 @@ static int sccp_show_line(int fd, sccp_cli_totals_t *totals, struct mansession *
 	CLI_AMI_OUTPUT_PARAM("Caller ID number",	CLI_AMI_LIST_WIDTH, "%s", l->cid_num);
 	CLI_AMI_OUTPUT_PARAM("Incoming Calls limit",	CLI_AMI_LIST_WIDTH, "%d", l->incominglimit);
 	CLI_AMI_OUTPUT_PARAM("Active Channel Count",	CLI_AMI_LIST_WIDTH, "%d", SCCP_RWLIST_GETSIZE(&l->channels));
+	CLI_AMI_OUTPUT_PARAM("Call Quota",		CLI_AMI_LIST_WIDTH, "%s", sccp_quota2str(&l->quota, quota_buf, sizeof(quota_buf)));
 	CLI_AMI_OUTPUT_PARAM("Sec. Dialtone Digits",	CLI_AMI_LIST_WIDTH, "%s", l->secondary_dialtone_digits);
 	CLI_AMI_OUTPUT_PARAM("Sec. Dialtone",		CLI_AMI_LIST_WIDTH, "%s (0x%02x)", skinny_tone2str(l->secondary_dialtone_tone), l->secondary_dialtone_tone);
 	CLI_AMI_OUTPUT_BOOL("Echo Cancellation",	CLI_AMI_LIST_WIDTH, l->echocancel);
@@ -1912,9 +2074,105 @@ CLI_AMI_ENTRY(show_hint_subscriptions, sccp_show_hint_subscriptions, "Show all S
 #undef CLI_COMPLETE
 #undef AMI_COMMAND
 #undef CLI_COMMAND
+#endif														/* DOXYGEN_SHOULD_SKIP_THIS */
+    /* ---------------------------------------------------------------------------------------------------SHOW_QUOTAS - */
+static char cli_show_quotas_usage[] = "Usage: sccp show quotas\n" "	Show call quota usage per line, device and context.\n";
+static char ami_show_quotas_usage[] = "Usage: SCCPShowQuotas\n" "Show call quota usage per line, device and context.\n\n" "PARAMS: None\n";
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+#define CLI_COMMAND "sccp", "show", "quotas"
+#define AMI_COMMAND "SCCPShowQuotas"
+#define CLI_COMPLETE SCCP_CLI_NULL_COMPLETER
+#define CLI_AMI_PARAMS ""
+CLI_AMI_ENTRY(show_quotas, sccp_show_quotas, "Show call quota usage", cli_show_quotas_usage, FALSE, TRUE)
+#undef CLI_AMI_PARAMS
+#undef CLI_COMPLETE
+#undef AMI_COMMAND
+#undef CLI_COMMAND
+#endif														/* DOXYGEN_SHOULD_SKIP_THIS */
+    /* ------------------------------------------------------------------------------------------------SHOW_LOCATIONS - */
+static char cli_show_locations_usage[] = "Usage: sccp show locations\n" "	Show bandwidth usage per location (call admission control).\n";
+static char ami_show_locations_usage[] = "Usage: SCCPShowLocations\n" "Show bandwidth usage per location (call admission control).\n\n" "PARAMS: None\n";
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+#define CLI_COMMAND "sccp", "show", "locations"
+#define AMI_COMMAND "SCCPShowLocations"
+#define CLI_COMPLETE SCCP_CLI_NULL_COMPLETER
+#define CLI_AMI_PARAMS ""
+CLI_AMI_ENTRY(show_locations, sccp_show_locations, "Show bandwidth usage per location", cli_show_locations_usage, FALSE, TRUE)
+#undef CLI_AMI_PARAMS
+#undef CLI_COMPLETE
+#undef AMI_COMMAND
+#undef CLI_COMMAND
+#endif														/* DOXYGEN_SHOULD_SKIP_THIS */
+    /* -----------------------------------------------------------------------------------------------SHOW_HUNTGROUPS - */
+static char cli_show_huntgroups_usage[] = "Usage: sccp show huntgroups\n" "	Show hunt groups, their free members and call counters.\n";
+static char ami_show_huntgroups_usage[] = "Usage: SCCPShowHuntgroups\n" "Show hunt groups, their free members and call counters.\n\n" "PARAMS: None\n";
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+#define CLI_COMMAND "sccp", "show", "huntgroups"
+#define AMI_COMMAND "SCCPShowHuntgroups"
+#define CLI_COMPLETE SCCP_CLI_NULL_COMPLETER
+#define CLI_AMI_PARAMS ""
+CLI_AMI_ENTRY(show_huntgroups, sccp_show_huntgroups, "Show hunt groups", cli_show_huntgroups_usage, FALSE, TRUE)
+#undef CLI_AMI_PARAMS
+#undef CLI_COMPLETE
+#undef AMI_COMMAND
+#undef CLI_COMMAND
+#endif														/* DOXYGEN_SHOULD_SKIP_THIS */
+    /* ----------------------------------------------------------------------------------------------SHOW_REPLICATION - */
+static char cli_show_replication_usage[] = "Usage: sccp show replication\n" "	Show the device state sent to the standby (primary) or received from the primary (standby).\n";
+static char ami_show_replication_usage[] = "Usage: SCCPShowReplication\n" "Show the device state sent to the standby (primary) or received from the primary (standby).\n\n" "PARAMS: None\n";
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+#define CLI_COMMAND "sccp", "show", "replication"
+#define AMI_COMMAND "SCCPShowReplication"
+#define CLI_COMPLETE SCCP_CLI_NULL_COMPLETER
+#define CLI_AMI_PARAMS ""
+CLI_AMI_ENTRY(show_replication, sccp_show_replication, "Show replicated device state", cli_show_replication_usage, FALSE, TRUE)
+#undef CLI_AMI_PARAMS
+#undef CLI_COMPLETE
+#undef AMI_COMMAND
+#undef CLI_COMMAND
+#endif														/* DOXYGEN_SHOULD_SKIP_THIS */
+    /* ------------------------------------------------------------------------------------------------SHOW_CALLBACKS - */
+static char cli_show_callbacks_usage[] = "Usage: sccp show callbacks\n" "	Show pending callbacks (camp-on busy / no answer).\n";
+static char ami_show_callbacks_usage[] = "Usage: SCCPShowCallbacks\n" "Show pending callbacks (camp-on busy / no answer).\n\n" "PARAMS: None\n";
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+#define CLI_COMMAND "sccp", "show", "callbacks"
+#define AMI_COMMAND "SCCPShowCallbacks"
+#define CLI_COMPLETE SCCP_CLI_NULL_COMPLETER
+#define CLI_AMI_PARAMS ""
+CLI_AMI_ENTRY(show_callbacks, sccp_show_callbacks, "Show pending callbacks", cli_show_callbacks_usage, FALSE, TRUE)
+#undef CLI_AMI_PARAMS
+#undef CLI_COMPLETE
+#undef AMI_COMMAND
+#undef CLI_COMMAND
 #endif														/* DOXYGEN_SHOULD_SKIP_THIS */
     /* -------------------------------------------------------------------------------------------------------TEST- */
 #ifdef CS_EXPERIMENTAL
+/*!
+ * \brief Append a Message to the "sccp test decoder" Corpus, the message is freed
+ * \return TRUE when the message fitted in the corpus
+ */
+static boolean_t sccp_test_decoder_addMessage(unsigned char * const corpus, size_t corpusSize, size_t * corpusLen, size_t * offsets, uint32_t * numMessages, sccp_msg_t * msg)
+{
+	boolean_t res = FALSE;
+
+	if (msg) {
+		size_t msgLen = letohl(msg->header.length) + 8;
+		if (*corpusLen + msgLen <= corpusSize) {
+			memcpy(corpus + *corpusLen, msg, msgLen);
+			offsets[(*numMessages)++] = *corpusLen;
+			*corpusLen += msgLen;
+			res = TRUE;
+		}
+		sccp_free(msg);
+	}
+	return res;
+}
+
 /*!
  * \brief Test Message
  * \param fd Fd as int
@@ -2316,10 +2574,158 @@ static int sccp_test(int fd, int argc, char *argv[])
 		}
 		return RESULT_SUCCESS;
 	}
+	if (!strcasecmp(argv[2], "decoder")) {
+		/* feed the inbound decoder from a corpus of well-formed and mutated messages */
+		int iterations = (argc > 3) ? sccp_atoi(argv[3], strlen(argv[3])) : 1000;
+		unsigned char corpus[SCCP_MAX_PACKET * 2] = "";
+		unsigned char stream[SCCP_MAX_PACKET * 2] = "";
+		size_t offsets[SCCP_MAX_PACKET * 2 / SCCP_PACKET_HEADER] = { 0 };
+		size_t corpusLen = 0;
+		uint32_t numMessages = 0;
+		uint32_t decoded = 0;
+		uint32_t rejected = 0;
+		uint32_t violations = 0;
+
+		if (iterations <= 0) {
+			return RESULT_SHOWUSAGE;
+		}
+		/* seed the corpus with the layouts of a registration and a simple call, as sent by a 7960 */
+		sccp_msg_t * msg = NULL;
+		REQ(msg, RegisterMessage);
+		if (msg) {
+			sccp_copy_string(msg->data.RegisterMessage.sId.deviceName, "SEP001B535CD3D6", sizeof(msg->data.RegisterMessage.sId.deviceName));
+			msg->data.RegisterMessage.sId.lel_instance = htolel(1);
+			msg->data.RegisterMessage.lel_deviceType = htolel(SKINNY_DEVICETYPE_CISCO7960);
+			msg->data.RegisterMessage.lel_maxStreams = htolel(5);
+			msg->data.RegisterMessage.protocolFeatures.protocolVersion = 11;
+		}
+		sccp_test_decoder_addMessage(corpus, sizeof(corpus), &corpusLen, offsets, &numMessages, msg);
+		REQCMD(msg, KeepAliveMessage);
+		sccp_test_decoder_addMessage(corpus, sizeof(corpus), &corpusLen, offsets, &numMessages, msg);
+		REQ(msg, OffHookMessage);
+		if (msg) {
+			msg->data.OffHookMessage.lel_lineInstance = htolel(1);
+		}
+		sccp_test_decoder_addMessage(corpus, sizeof(corpus), &corpusLen, offsets, &numMessages, msg);
+		REQ(msg, KeypadButtonMessage);
+		if (msg) {
+			msg->data.KeypadButtonMessage.lel_kpButton = htolel(1);
+			msg->data.KeypadButtonMessage.lel_lineInstance = htolel(1);
+			msg->data.KeypadButtonMessage.lel_callReference = htolel(1);
+		}
+		sccp_test_decoder_addMessage(corpus, sizeof(corpus), &corpusLen, offsets, &numMessages, msg);
+		REQ(msg, StimulusMessage);
+		if (msg) {
+			msg->data.StimulusMessage.lel_stimulus = htolel(SKINNY_STIMULUS_LINE);
+			msg->data.StimulusMessage.lel_stimulusInstance = htolel(1);
+			msg->data.StimulusMessage.lel_callReference = htolel(1);
+		}
+		sccp_test_decoder_addMessage(corpus, sizeof(corpus), &corpusLen, offsets, &numMessages, msg);
+		REQ(msg, SoftKeyEventMessage);
+		if (msg) {
+			msg->data.SoftKeyEventMessage.lel_softKeyEvent = htolel(SKINNY_LBL_ENDCALL);
+			msg->data.SoftKeyEventMessage.lel_lineInstance = htolel(1);
+			msg->data.SoftKeyEventMessage.lel_callReference = htolel(1);
+		}
+		sccp_test_decoder_addMessage(corpus, sizeof(corpus), &corpusLen, offsets, &numMessages, msg);
+		REQ(msg, OnHookMessage);
+		if (msg) {
+			msg->data.OnHookMessage.lel_buttonIndex = htolel(1);
+			msg->data.OnHookMessage.lel_callReference = htolel(1);
+		}
+		sccp_test_decoder_addMessage(corpus, sizeof(corpus), &corpusLen, offsets, &numMessages, msg);
+
+		/* fill up with one message of every other known type, with a random payload, as many as fit a receive buffer */
+		for (uint32_t messageId = SCCP_MESSAGE_LOW_BOUNDARY; messageId <= SCCP_MESSAGE_HIGH_BOUNDARY; messageId++) {
+			struct messageinfo * msginfo = lookupMsgInfoStruct(messageId);
+			if (!msginfo || msginfo->messageId != messageId || !msginfo->text) {
+				continue;
+			}
+			size_t msgLen = msginfo->size + SCCP_PACKET_HEADER;
+			if (corpusLen + msgLen > sizeof(corpus)) {
+				continue;
+			}
+			sccp_header_t header = { htolel(msgLen - 8), 0, htolel(messageId) };
+			memcpy(corpus + corpusLen, &header, SCCP_PACKET_HEADER);
+			for (size_t idx = SCCP_PACKET_HEADER; idx < msgLen; idx++) {
+				corpus[corpusLen + idx] = (unsigned char)sccp_random();
+			}
+			offsets[numMessages++] = corpusLen;
+			corpusLen += msgLen;
+		}
+		pbx_cli(fd, "Decoder corpus: %u well-formed messages, %zu bytes\n", numMessages, corpusLen);
+		if (!numMessages) {
+			pbx_cli(fd, "Decoder corpus is empty, nothing to test\n");
+			return RESULT_FAILURE;
+		}
+
+		/* throughput */
+		struct timeval start = pbx_tvnow();
+		for (int i = 0; i < iterations; i++) {
+			size_t len = corpusLen;
+			memcpy(stream, corpus, corpusLen);
+			if (sccp_session_decodeStream(stream, &len, &decoded) != 0 || len != 0) {
+				violations++;
+			}
+		}
+		intmax_t elapsed = ast_tvdiff_ms(pbx_tvnow(), start);
+		pbx_cli(fd, "Well-formed: decoded %u messages in %jd ms (%jd messages/sec), %u rejected streams\n", decoded, elapsed, elapsed ? (intmax_t) decoded * 1000 / elapsed : (intmax_t) 0, violations);
+
+		/* dispatch lookup: find the handler of every message in the corpus, sccp_session_decodeStream does not dispatch */
+		uint32_t lookups = 0;
+		uint32_t handled = 0;
+		start = pbx_tvnow();
+		for (int i = 0; i < iterations; i++) {
+			for (uint32_t idx = 0; idx < numMessages; idx++) {
+				uint32_t messageId = 0;
+				memcpy(&messageId, corpus + offsets[idx] + 8, sizeof(messageId));
+				if (sccp_handle_message_lookup(letohl(messageId))) {
+					handled++;
+				}
+				lookups++;
+			}
+		}
+		elapsed = ast_tvdiff_ms(pbx_tvnow(), start);
+		pbx_cli(fd, "Dispatch: looked up %u handlers in %jd ms (%jd lookups/sec), %u messages have a handler\n", lookups, elapsed, elapsed ? (intmax_t) lookups * 1000 / elapsed : (intmax_t) 0, handled / (uint32_t) iterations);
+
+		/* robustness: mutate one message per stream, the decoder has to reject or skip it without consuming past the data */
+		decoded = 0;
+		for (int i = 0; i < iterations; i++) {
+			size_t len = corpusLen;
+			size_t offset = offsets[sccp_random() % numMessages];
+			uint32_t value = (uint32_t)sccp_random();
+			memcpy(stream, corpus, corpusLen);
+			switch (sccp_random() % 4) {
+				case 0:										/* header length */
+					memcpy(stream + offset, &value, sizeof(value));
+					break;
+				case 1:										/* messageId */
+					memcpy(stream + offset + 8, &value, sizeof(value));
+					break;
+				case 2:										/* truncated stream */
+					len = offset + (value % SCCP_PACKET_HEADER);
+					break;
+				default:									/* corrupted header byte */
+					stream[offset + (value % SCCP_PACKET_HEADER)] ^= (unsigned char)(value >> 8 | 1);
+					break;
+			}
+			size_t before = len;
+			int res = sccp_session_decodeStream(stream, &len, &decoded);
+			if (res < 0) {
+				rejected++;
+			}
+			if (len > before || res < -2) {
+				pbx_cli(fd, "Mutation %d at offset %zu (value:0x%08x): decoder returned %d, %zu bytes left of %zu\n", i, offset, value, res, len, before);
+				violations++;
+			}
+		}
+		pbx_cli(fd, "Mutated: %d streams, decoded %u messages, %u streams rejected, %u invariant violations\n", iterations, decoded, rejected, violations);
+		return violations ? RESULT_FAILURE : RESULT_SUCCESS;
+	}
 	return RESULT_FAILURE;
 }
 
-static char cli_test_usage[] = "Usage: sccp test [test_name]\n" "	Test [test_name].\n";
+static char cli_test_usage[] = "Usage: sccp test [test_name]\n" "	Test [test_name].\n" "	decoder [iterations]: feed the message decoder with well-formed and mutated messages, report throughput and robustness\n" "	(mutated messages are logged by the decoder, run a sanitizer build to catch memory errors)\n";
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 #define CLI_COMMAND "sccp", "test"
@@ -2588,7 +2994,8 @@ CLI_AMI_ENTRY(message_device, sccp_message_device, "Send a message to SCCP Devic
      */
 static int sccp_system_message(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[])
 {
-	sccp_device_t *d = NULL;
+	uint32_t broadcastId = 0;
+	int queued = 0;
 	int timeout = 0;
 	char timeoutStr[5] = "";
 	boolean_t beep = FALSE;
@@ -2596,11 +3003,7 @@ static int sccp_system_message(int fd, sccp_cli_totals_t *totals, struct mansess
 	int res = RESULT_FAILURE;
 
 	if (argc == 3) {
-		SCCP_RWLIST_RDLOCK(&GLOB(devices));
-		SCCP_RWLIST_TRAVERSE(&GLOB(devices), d, list) {
-			sccp_dev_clear_message(d, TRUE);
-		}
-		SCCP_RWLIST_UNLOCK(&GLOB(devices));
+		sccp_device_clearBroadcastMessage();
 		CLI_AMI_OUTPUT(fd, s, "Message Cleared\n");
 		return RESULT_SUCCESS;
 	}
@@ -2622,12 +3025,10 @@ static int sccp_system_message(int fd, sccp_cli_totals_t *totals, struct mansess
 	snprintf(timeoutStr, sizeof(timeoutStr), "%d", timeout);
 
 	sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "Sending system message '%s' to all devices (beep: %d, timeout: %d)\n", argv[3], beep, timeout);
-	SCCP_RWLIST_RDLOCK(&GLOB(devices));
-	SCCP_RWLIST_TRAVERSE(&GLOB(devices), d, list) {
-		sccp_dev_set_message(d, argv[3], timeout, TRUE, beep);
+	if ((broadcastId = sccp_device_broadcastMessage(argv[3], timeout, beep, &queued)) && queued) {
+		CLI_AMI_OUTPUT(fd, s, "Broadcast %d queued for %d devices, use 'sccp show broadcast' to follow delivery\n", broadcastId, queued);
 		res = RESULT_SUCCESS;
 	}
-	SCCP_RWLIST_UNLOCK(&GLOB(devices));
 
 	if (s) {
 		totals->lines = local_line_total;
@@ -2647,6 +3048,68 @@ CLI_AMI_ENTRY(system_message, sccp_system_message, "Send a system wide message t
 #undef AMI_COMMAND
 #undef CLI_COMPLETE
 #undef CLI_COMMAND
+#endif														/* DOXYGEN_SHOULD_SKIP_THIS */
+
+    /*!
+     * \brief Show the delivery status of the last System Message broadcast
+     * \param fd Fd as int
+     * \param totals Total number of lines as int
+     * \param s AMI Session
+     * \param m Message
+     * \param argc Argc as int
+     * \param argv[] Argv[] as char
+     * \return Result as int
+     * 
+     * \called_from_asterisk
+     */
+static int sccp_show_broadcast(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[])
+{
+	uint32_t broadcastId = 0;
+	int queued = 0;
+	int delivered = 0;
+	boolean_t finished = FALSE;
+	int local_line_total = 0;
+	const char *actionid = "";
+
+	if (argc != 3) {
+		return RESULT_SHOWUSAGE;
+	}
+	if (!sccp_device_getBroadcastStatus(&broadcastId, &queued, &delivered, &finished)) {
+		CLI_AMI_RETURN_ERROR(fd, s, m, "%s", "No system message has been broadcast yet\n");
+	}
+	if (s) {
+		astman_append(s, "Response: Success\r\n");
+		astman_append(s, "Message: SCCPShowBroadcast\r\n");
+		actionid = astman_get_header(m, "ActionID");
+		if (!pbx_strlen_zero(actionid)) {
+			astman_append(s, "ActionID: %s\r\n", actionid);
+		}
+		local_line_total++;
+	}
+	CLI_AMI_OUTPUT_PARAM("Broadcast", CLI_AMI_LIST_WIDTH, "%d", broadcastId);
+	CLI_AMI_OUTPUT_PARAM("Queued", CLI_AMI_LIST_WIDTH, "%d", queued);
+	CLI_AMI_OUTPUT_PARAM("Delivered", CLI_AMI_LIST_WIDTH, "%d", delivered);
+	CLI_AMI_OUTPUT_BOOL("Finished", CLI_AMI_LIST_WIDTH, finished);
+
+	if (s) {
+		totals->lines = local_line_total;
+	}
+	return RESULT_SUCCESS;
+}
+
+static char cli_show_broadcast_usage[] = "Usage: sccp show broadcast\n" "       Show how many devices the last system message has been delivered to.\n";
+static char ami_show_broadcast_usage[] = "Usage: SCCPShowBroadcast\n" "Show how many devices the last system message has been delivered to.\n\n" "PARAMS: None\n";
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+#define CLI_COMMAND "sccp", "show", "broadcast"
+#define AMI_COMMAND "SCCPShowBroadcast"
+#define CLI_COMPLETE SCCP_CLI_NULL_COMPLETER
+#define CLI_AMI_PARAMS ""
+CLI_AMI_ENTRY(show_broadcast, sccp_show_broadcast, "Show delivery status of the last system message", cli_show_broadcast_usage, FALSE, FALSE)
+#undef CLI_AMI_PARAMS
+#undef AMI_COMMAND
+#undef CLI_COMPLETE
+#undef CLI_COMMAND
 #endif														/* DOXYGEN_SHOULD_SKIP_THIS */
     /* -----------------------------------------------------------------------------------------------------DND DEVICE- */
     /*!
@@ -2847,7 +3310,7 @@ static int sccp_remove_line_from_device(int fd, int argc, char *argv[])
 			SCCP_LIST_UNLOCK(&d->buttonconfig);
 			
 			pbx_cli(fd, "Line %s has been removed from device %s. Reloading Device...\n", line->name, d->id);
-			sccp_device_check_update(d);
+			sccp_device_schedulePendingUpdates(d);
 			res = RESULT_SUCCESS;
 		} else {
 			pbx_log(LOG_ERROR, "Error: Line %s not found\n", argv[4]);
@@ -2892,14 +3355,17 @@ static int sccp_add_line_to_device(int fd, int argc, char *argv[])
 		AUTO_RELEASE(sccp_line_t, l , sccp_line_find_byname(argv[4], FALSE));
 		if (!l) {
 			pbx_log(LOG_ERROR, "Error: Line %s not found\n", argv[4]);
+			return RESULT_FAILURE;
 		}
- 		d->pendingUpdate = 1;
 		if (sccp_config_addButton(&d->buttonconfig, -1, LINE, l->name, NULL, NULL) == SCCP_CONFIG_CHANGE_CHANGED) {
-			pbx_cli(fd, "Line %s has been added to device %s\n", l->name, d->id);
-			sccp_device_check_update(d);
+			if (sccp_handle_button_template_refresh(d)) {
+				pbx_cli(fd, "Line %s has been added to device %s\n", l->name, d->id);
+			} else {
+				pbx_cli(fd, "Line %s has been added to device %s, restarting device\n", l->name, d->id);
+				d->pendingUpdate = 1;
+				sccp_device_schedulePendingUpdates(d);
+			}
 			res = RESULT_SUCCESS;
-		} else {
-	 		d->pendingUpdate = 0;;
 		}
 	} else {
 		pbx_log(LOG_ERROR, "Error: Device %s not found\n", argv[3]);
@@ -3066,7 +3532,7 @@ static int sccp_cli_reload(int fd, int argc, char *argv[])
 					pbx_cli(fd, "%s: device has %s\n", device->id, change ? "major changes -> restarting device" : "no major changes -> restart not required");
 					if (change == SCCP_CONFIG_NEEDDEVICERESET) {
 						device->pendingUpdate = 1;
-						sccp_device_check_update(device);				// Will cleanup after reload and restart the device if necessary
+						sccp_device_schedulePendingUpdates(device);				// Will cleanup after reload and restart the device if necessary
 					}
 #ifdef CS_SCCP_REALTIME
 					if (device->realtime) {
@@ -3148,7 +3614,7 @@ static int sccp_cli_reload(int fd, int argc, char *argv[])
 									}
 								}
 								device->pendingUpdate = 1;
-								sccp_device_check_update(device);				// Will cleanup after reload and restart the device if necessary
+								sccp_device_schedulePendingUpdates(device);				// Will cleanup after reload and restart the device if necessary
 #ifdef CS_SCCP_REALTIME
 								if (device->realtime && dv) {
 									pbx_variables_destroy(dv);
@@ -3256,6 +3722,7 @@ EXIT:
 	pbx_rwlock_wrlock(&GLOB(lock));
 	GLOB(reload_in_progress) = FALSE;
 	pbx_rwlock_unlock(&GLOB(lock));
+	sccp_device_schedulePendingUpdates(NULL);							/* apply updates which were postponed during the reload */
 	return returnval;
 }
 
@@ -3694,6 +4161,7 @@ static int sccp_set_object(int fd, int argc, char *argv[])
 
 			if (res & SCCP_CONFIG_NEEDDEVICERESET) {
 				device->pendingUpdate = 1;
+				sccp_device_schedulePendingUpdates(device);
 			}
 		}
 	} else if (sccp_strcaseequals("fallback", argv[2])) {
@@ -3980,6 +4448,78 @@ CLI_AMI_ENTRY(tokenack, sccp_tokenack, "Send TokenAck", cli_tokenack_usage, FALS
 #undef CLI_COMMAND
 #endif														/* DOXYGEN_SHOULD_SKIP_THIS */
 
+#ifdef HAVE_LIBSSL
+    /* -------------------------------------------------------------------------------------------------------------- TLS ROTATE - */
+    /*!
+     * \brief Load the tls certificate again, new handshakes use the new certificate, established sessions are not touched
+     * \param fd Fd as int
+     * \param totals Total number of lines as int
+     * \param s AMI Session
+     * \param m Message
+     * \param argc Argc as int
+     * \param argv[] Argv[] as char
+     * \return Result as int
+     * 
+     * \called_from_asterisk
+     */
+static int sccp_tls_rotate(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[])
+{
+	int local_line_total = 0;
+	time_t rotated = 0;
+	uint32_t rotations = 0;
+	char rotatedtime[64] = "";
+	struct ast_tm tm;
+	const char *actionid = "";
+
+	if (argc != 3) {
+		return RESULT_SHOWUSAGE;
+	}
+	if (!GLOB(srvcontexts[SCCP_SERVERCONTEXT_TLS])) {
+		CLI_AMI_RETURN_ERROR(fd, s, m, "%s", "TLS listener is not active\n");				/* explicit return */
+	}
+	if (!sccp_transport_tls_rotate()) {
+		CLI_AMI_RETURN_ERROR(fd, s, m, "Could not load certificate/key from %s, the current certificate stays in use (see log)\n", GLOB(cert_file));	/* explicit return */
+	}
+	rotations = sccp_transport_tls_getRotations(&rotated);
+	struct timeval when = { rotated, 0 };
+	ast_localtime(&when, &tm, NULL);
+	ast_strftime(rotatedtime, sizeof(rotatedtime), "%c", &tm);
+
+	if (s) {
+		astman_append(s, "Response: Success\r\n");
+		astman_append(s, "Message: SCCPTlsRotate\r\n");
+		actionid = astman_get_header(m, "ActionID");
+		if (!pbx_strlen_zero(actionid)) {
+			astman_append(s, "ActionID: %s\r\n", actionid);
+		}
+		local_line_total++;
+	}
+	CLI_AMI_OUTPUT_PARAM("Certificate File", CLI_AMI_LIST_WIDTH, "%s", GLOB(cert_file));
+	CLI_AMI_OUTPUT_PARAM("Rotations", CLI_AMI_LIST_WIDTH, "%u", rotations);
+	CLI_AMI_OUTPUT_PARAM("Rotated", CLI_AMI_LIST_WIDTH, "%s", rotatedtime);
+
+	if (s) {
+		totals->lines = local_line_total;
+	}
+	return RESULT_SUCCESS;
+}
+
+static char cli_tls_rotate_usage[] = "Usage: sccp tls rotate\n" "       Load certfile again and use it for new TLS connections, connected phones keep their session.\n";
+static char ami_tls_rotate_usage[] = "Usage: SCCPTlsRotate\n" "Load certfile again and use it for new TLS connections, connected phones keep their session.\n\n" "PARAMS: None\n";
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+#define CLI_COMMAND "sccp", "tls", "rotate"
+#define AMI_COMMAND "SCCPTlsRotate"
+#define CLI_COMPLETE SCCP_CLI_NULL_COMPLETER
+#define CLI_AMI_PARAMS ""
+CLI_AMI_ENTRY(tls_rotate, sccp_tls_rotate, "Load the TLS certificate again", cli_tls_rotate_usage, FALSE, FALSE)
+#undef CLI_AMI_PARAMS
+#undef AMI_COMMAND
+#undef CLI_COMPLETE
+#undef CLI_COMMAND
+#endif														/* DOXYGEN_SHOULD_SKIP_THIS */
+#endif														/* HAVE_LIBSSL */
+
 /* --------------------------------------------------------------------------------------------------------------MICROPHONE CONTROL- */
 /*!
  * \brief Control Microphone/Mute on remote phone
@@ -4058,6 +4598,7 @@ CLI_AMI_ENTRY(microphone, sccp_microphone, "Turn microphone <on/off> on active c
 static struct pbx_cli_entry cli_entries[] = {
 	AST_CLI_DEFINE(cli_show_globals, "Show SCCP global settings."),
 	AST_CLI_DEFINE(cli_show_devices, "Show all SCCP Devices."),
+	AST_CLI_DEFINE(cli_show_topdevices, "Show the SCCP Devices using the most resources."),
 	AST_CLI_DEFINE(cli_show_device, "Show an SCCP Device"),
 	AST_CLI_DEFINE(cli_show_lines, "Show All SCCP Lines."),
 	AST_CLI_DEFINE(cli_show_line, "Show an SCCP Line."),
@@ -4067,6 +4608,7 @@ static struct pbx_cli_entry cli_entries[] = {
 	AST_CLI_DEFINE(cli_show_softkeysets, "Show all mwi configured SoftKeySets"),
 	AST_CLI_DEFINE(cli_unregister, "Unregister an SCCP device"),
 	AST_CLI_DEFINE(cli_system_message, "Set the SCCP system message."),
+	AST_CLI_DEFINE(cli_show_broadcast, "Show delivery status of the last SCCP system message."),
 	AST_CLI_DEFINE(cli_message_devices, "Send a message to all SCCP Devices."),
 	AST_CLI_DEFINE(cli_message_device, "Send a message to an SCCP Device."),
 	AST_CLI_DEFINE(cli_remove_line_from_device, "Remove a line from a device."),
@@ -4095,6 +4637,9 @@ static struct pbx_cli_entry cli_entries[] = {
 #endif
 	AST_CLI_DEFINE(cli_show_refcount, "Test message."),
 	AST_CLI_DEFINE(cli_tokenack, "Send Token Acknowledgement."),
+#ifdef HAVE_LIBSSL
+	AST_CLI_DEFINE(cli_tls_rotate, "Load the TLS certificate again."),
+#endif
 #ifdef CS_SCCP_CONFERENCE
 	AST_CLI_DEFINE(cli_show_conferences, "Show running SCCP Conferences."),
 	AST_CLI_DEFINE(cli_show_conference, "Show SCCP Conference Info."),
@@ -4102,6 +4647,11 @@ static struct pbx_cli_entry cli_entries[] = {
 #endif
 	AST_CLI_DEFINE(cli_show_hint_lineStates, "Show all hint lineStates"),
 	AST_CLI_DEFINE(cli_show_hint_subscriptions, "Show all hint subscriptions"),
+	AST_CLI_DEFINE(cli_show_quotas, "Show call quota usage"),
+	AST_CLI_DEFINE(cli_show_locations, "Show bandwidth usage per location"),
+	AST_CLI_DEFINE(cli_show_huntgroups, "Show hunt groups"),
+	AST_CLI_DEFINE(cli_show_replication, "Show replicated device state"),
+	AST_CLI_DEFINE(cli_show_callbacks, "Show pending callbacks"),
 	AST_CLI_DEFINE(handle_backward_softkeysets, "Backward compatible version"),
 };
 
@@ -4131,6 +4681,7 @@ int sccp_register_cli(void)
 #endif
 	res |= pbx_manager_register("SCCPShowGlobals", _MAN_REP_FLAGS, manager_show_globals, "show globals setting", ami_globals_usage);
 	res |= pbx_manager_register("SCCPShowDevices", _MAN_REP_FLAGS, manager_show_devices, "show devices", ami_devices_usage);
+	res |= pbx_manager_register("SCCPShowTopDevices", _MAN_REP_FLAGS, manager_show_topdevices, "show top devices", ami_topdevices_usage);
 	res |= pbx_manager_register("SCCPShowDevice", _MAN_REP_FLAGS, manager_show_device, "show device settings", ami_device_usage);
 	res |= pbx_manager_register("SCCPShowLines", _MAN_REP_FLAGS, manager_show_lines, "show lines", ami_lines_usage);
 	res |= pbx_manager_register("SCCPShowLine", _MAN_REP_FLAGS, manager_show_line, "show line", ami_line_usage);
@@ -4140,6 +4691,7 @@ int sccp_register_cli(void)
 	res |= pbx_manager_register("SCCPShowSoftkeySets", _MAN_REP_FLAGS, manager_show_softkeysets, "show softkey sets", ami_show_softkeysets_usage);
 	res |= pbx_manager_register("SCCPMessageDevices", _MAN_REP_FLAGS, manager_message_devices, "message devices", ami_message_devices_usage);
 	res |= pbx_manager_register("SCCPMessageDevice", _MAN_REP_FLAGS, manager_message_device, "message device", ami_message_device_usage);
+	res |= pbx_manager_register("SCCPShowBroadcast", _MAN_REP_FLAGS, manager_show_broadcast, "show broadcast", ami_show_broadcast_usage);
 	res |= pbx_manager_register("SCCPMicrophone", _MAN_REP_FLAGS, manager_microphone, "Control Microphone on/off on active call", ami_microphone_usage);
 #ifdef CS_SCCP_CONFERENCE
 	res |= pbx_manager_register("SCCPShowConferences", _MAN_REP_FLAGS, manager_show_conferences, "show conferences", ami_conferences_usage);
@@ -4148,7 +4700,15 @@ int sccp_register_cli(void)
 #endif
 	res |= pbx_manager_register("SCCPShowHintLineStates", _MAN_REP_FLAGS, manager_show_hint_lineStates, "show hint lineStates", ami_show_hint_lineStates_usage);
 	res |= pbx_manager_register("SCCPShowHintSubscriptions", _MAN_REP_FLAGS, manager_show_hint_subscriptions, "show hint subscriptions", ami_show_hint_subscriptions_usage);
+	res |= pbx_manager_register("SCCPShowQuotas", _MAN_REP_FLAGS, manager_show_quotas, "show quotas", ami_show_quotas_usage);
+	res |= pbx_manager_register("SCCPShowLocations", _MAN_REP_FLAGS, manager_show_locations, "show locations", ami_show_locations_usage);
+	res |= pbx_manager_register("SCCPShowHuntgroups", _MAN_REP_FLAGS, manager_show_huntgroups, "show huntgroups", ami_show_huntgroups_usage);
+	res |= pbx_manager_register("SCCPShowReplication", _MAN_REP_FLAGS, manager_show_replication, "show replication", ami_show_replication_usage);
+	res |= pbx_manager_register("SCCPShowCallbacks", _MAN_REP_FLAGS, manager_show_callbacks, "show callbacks", ami_show_callbacks_usage);
 	res |= pbx_manager_register("SCCPShowRefcount", _MAN_REP_FLAGS, manager_show_refcount, "show refcount", ami_show_refcount_usage);
+#ifdef HAVE_LIBSSL
+	res |= pbx_manager_register("SCCPTlsRotate", _MAN_COM_FLAGS, manager_tls_rotate, "tls rotate", ami_tls_rotate_usage);
+#endif
 
 	res |= iPbx.register_manager(answerCall1_command, _MAN_REP_FLAGS, manager_answercall, NULL, NULL);
 	res |= iPbx.register_manager(callForward_command, _MAN_REP_FLAGS, manager_callforward, NULL, NULL);
@@ -4170,6 +4730,7 @@ int sccp_unregister_cli(void)
 	}
 	res |= pbx_manager_unregister("SCCPShowGlobals");
 	res |= pbx_manager_unregister("SCCPShowDevices");
+	res |= pbx_manager_unregister("SCCPShowTopDevices");
 	res |= pbx_manager_unregister("SCCPShowDevice");
 	res |= pbx_manager_unregister("SCCPShowLines");
 	res |= pbx_manager_unregister("SCCPShowLine");
@@ -4179,6 +4740,7 @@ int sccp_unregister_cli(void)
 	res |= pbx_manager_unregister("SCCPShowSoftkeySets");
 	res |= pbx_manager_unregister("SCCPMessageDevices");
 	res |= pbx_manager_unregister("SCCPMessageDevice");
+	res |= pbx_manager_unregister("SCCPShowBroadcast");
 	res |= pbx_manager_unregister("SCCPMicrophone");
 #ifdef CS_SCCP_CONFERENCE
 	res |= pbx_manager_unregister("SCCPShowConferences");
@@ -4187,7 +4749,15 @@ int sccp_unregister_cli(void)
 #endif
 	res |= pbx_manager_unregister("SCCPShowHintLineStates");
 	res |= pbx_manager_unregister("SCCPShowHintSubscriptions");
+	res |= pbx_manager_unregister("SCCPShowQuotas");
+	res |= pbx_manager_unregister("SCCPShowLocations");
+	res |= pbx_manager_unregister("SCCPShowHuntgroups");
+	res |= pbx_manager_unregister("SCCPShowReplication");
+	res |= pbx_manager_unregister("SCCPShowCallbacks");
 	res |= pbx_manager_unregister("SCCPShowRefcount");
+#ifdef HAVE_LIBSSL
+	res |= pbx_manager_unregister("SCCPTlsRotate");
+#endif
 
 	res |= pbx_manager_unregister(answerCall1_command);
 	res |= pbx_manager_unregister(callForward_command);
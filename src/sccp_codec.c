@@ -362,6 +362,105 @@ void sccp_codec_combineSets(skinny_codec_t base[SKINNY_MAX_CAPABILITIES], const
 	}
 }
 
+/*!
+ * \brief Rank of a codec on a degraded link: loss tolerant / low bitrate codecs first, wideband and high bitrate last
+ */
+static uint8_t __CONST__ sccp_codec_robustnessRank(skinny_codec_t codec)
+{
+	switch (codec) {
+		case SKINNY_CODEC_OPUS:
+		case SKINNY_CODEC_G729_B_LOW:										// iLBC
+			return 0;
+		case SKINNY_CODEC_G729:
+		case SKINNY_CODEC_G729_A:
+		case SKINNY_CODEC_G729_B:
+		case SKINNY_CODEC_G729_AB:
+		case SKINNY_CODEC_G729_ANNEX_B:
+		case SKINNY_CODEC_G723_1:
+		case SKINNY_CODEC_AMR:
+			return 1;
+		case SKINNY_CODEC_GSM:
+		case SKINNY_CODEC_GSM_FULLRATE:
+		case SKINNY_CODEC_GSM_HALFRATE:
+		case SKINNY_CODEC_GSM_ENH_FULLRATE:
+		case SKINNY_CODEC_G726_16K:
+		case SKINNY_CODEC_G726_24K:
+		case SKINNY_CODEC_G726_32K:
+		case SKINNY_CODEC_G728:
+		case SKINNY_CODEC_G722_1_24K:
+		case SKINNY_CODEC_AMR_WB:
+			return 2;
+		default:
+			return 3;
+	}
+}
+
+/*!
+ * \brief Reorder a preference list for a lossy / congested link, keeping the configured order within each rank
+ */
+void sccp_codec_preferRobust(skinny_codec_t codecs[SKINNY_MAX_CAPABILITIES])
+{
+	skinny_codec_t result[SKINNY_MAX_CAPABILITIES] = { SKINNY_CODEC_NONE };
+	uint8_t pos = 0;
+
+	for (uint8_t rank = 0; rank <= 3; rank++) {
+		for (uint8_t x = 0; x < SKINNY_MAX_CAPABILITIES && codecs[x] != SKINNY_CODEC_NONE; x++) {
+			if (sccp_codec_robustnessRank(codecs[x]) == rank) {
+				result[pos++] = codecs[x];
+			}
+		}
+	}
+	memcpy(codecs, result, sizeof(result));
+}
+
+/*!
+ * \brief Estimated network bandwidth of one audio stream in kbit/s, including the IP/UDP/RTP headers at 20ms packetization (30ms for g723)
+ */
+uint16_t __CONST__ sccp_codec_getBandwidth(skinny_codec_t codec)
+{
+	switch (codec) {
+		case SKINNY_CODEC_NONE:
+			return 0;
+		case SKINNY_CODEC_G723_1:
+			return 17;
+		case SKINNY_CODEC_G729:
+		case SKINNY_CODEC_G729_A:
+		case SKINNY_CODEC_G729_B:
+		case SKINNY_CODEC_G729_AB:
+		case SKINNY_CODEC_G729_ANNEX_B:
+			return 24;
+		case SKINNY_CODEC_G729_B_LOW:										// iLBC
+		case SKINNY_CODEC_AMR:
+			return 28;
+		case SKINNY_CODEC_GSM:
+		case SKINNY_CODEC_GSM_FULLRATE:
+		case SKINNY_CODEC_GSM_HALFRATE:
+		case SKINNY_CODEC_GSM_ENH_FULLRATE:
+			return 29;
+		case SKINNY_CODEC_G726_16K:
+		case SKINNY_CODEC_G728:
+			return 32;
+		case SKINNY_CODEC_G726_24K:
+		case SKINNY_CODEC_G722_1_24K:
+		case SKINNY_CODEC_AMR_WB:
+			return 40;
+		case SKINNY_CODEC_G726_32K:
+		case SKINNY_CODEC_G722_1_32K:
+		case SKINNY_CODEC_OPUS:
+			return 48;
+		case SKINNY_CODEC_G722_48K:
+			return 64;
+		case SKINNY_CODEC_G711_ALAW_56K:
+		case SKINNY_CODEC_G711_ULAW_56K:
+		case SKINNY_CODEC_G722_56K:
+			return 72;
+		case SKINNY_CODEC_WIDEBAND_256K:
+			return 272;
+		default:											// g711, g722 and anything unknown
+			return 80;
+	}
+}
+
 skinny_codec_t sccp_codec_findBestJoint(constChannelPtr c, const skinny_codec_t ourPreferences[], const skinny_codec_t remotePeerPreferences[], boolean_t fallback)
 {
 	skinny_codec_t   res                                = SKINNY_CODEC_NONE;
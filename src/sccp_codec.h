@@ -145,6 +145,8 @@ SCCP_API boolean_t __PURE__ SCCP_CALL   sccp_codec_isCompatible(skinny_codec_t c
 SCCP_API int SCCP_CALL            sccp_codec_getReducedSet(const skinny_codec_t base[SKINNY_MAX_CAPABILITIES], const skinny_codec_t reduceByCodecs[SKINNY_MAX_CAPABILITIES], skinny_codec_t result[SKINNY_MAX_CAPABILITIES]);
 SCCP_API void SCCP_CALL           sccp_codec_reduceSet(skinny_codec_t base[SKINNY_MAX_CAPABILITIES], const skinny_codec_t reduceByCodecs[SKINNY_MAX_CAPABILITIES]);
 SCCP_API void SCCP_CALL           sccp_codec_combineSets(skinny_codec_t base[SKINNY_MAX_CAPABILITIES], const skinny_codec_t addCodecs[SKINNY_MAX_CAPABILITIES]);
+SCCP_API void SCCP_CALL           sccp_codec_preferRobust(skinny_codec_t codecs[SKINNY_MAX_CAPABILITIES]);
+SCCP_API uint16_t __CONST__ SCCP_CALL sccp_codec_getBandwidth(skinny_codec_t codec);
 SCCP_API skinny_codec_t SCCP_CALL sccp_codec_findBestJoint(constChannelPtr c, const skinny_codec_t ourPreferences[], const skinny_codec_t remotePeerPreferences[], boolean_t fallback);
 
 __END_C_EXTERN__
@@ -197,12 +197,15 @@
 #include "sccp_config.h"
 #include "sccp_device.h"
 #include "sccp_featureButton.h"
+#include "sccp_huntgroup.h"
 #include "sccp_line.h"
 #include "sccp_linedevice.h"
 #include "sccp_mwi.h"
+#include "sccp_provision.h"
 #include "sccp_session.h"
 #include "sccp_utils.h"
 #include "sccp_labels.h"
+#include "sccp_webservice.h"
 #include "revision.h"
 
 SCCP_FILE_VERSION(__FILE__, "");
@@ -304,6 +307,8 @@ sccp_value_changed_t sccp_config_parse_group(void * const dest, const size_t siz
 sccp_value_changed_t sccp_config_parse_deny_permit(void * const dest, const size_t size, PBX_VARIABLE_TYPE * v, const sccp_config_segment_t segment);
 sccp_value_changed_t sccp_config_parse_button(void * const dest, const size_t size, PBX_VARIABLE_TYPE * vars, const sccp_config_segment_t segment);
 sccp_value_changed_t sccp_config_parse_permithosts(void * const dest, const size_t size, PBX_VARIABLE_TYPE * vroot, const sccp_config_segment_t segment);
+sccp_value_changed_t sccp_config_parse_location(void * const dest, const size_t size, PBX_VARIABLE_TYPE * vroot, const sccp_config_segment_t segment);
+sccp_value_changed_t sccp_config_parse_huntgroup(void * const dest, const size_t size, PBX_VARIABLE_TYPE * vroot, const sccp_config_segment_t segment);
 sccp_value_changed_t sccp_config_parse_addons(void * const dest, const size_t size, PBX_VARIABLE_TYPE * v, const sccp_config_segment_t segment);
 sccp_value_changed_t sccp_config_parse_privacyFeature(void * const dest, const size_t size, PBX_VARIABLE_TYPE * v, const sccp_config_segment_t segment);
 sccp_value_changed_t sccp_config_parse_debug(void * const dest, const size_t size, PBX_VARIABLE_TYPE * v, const sccp_config_segment_t segment);
@@ -521,7 +526,7 @@ EXIT:
  * \todo add errormsg return to sccpConfigOption->converter_f: so we can have a fixed format the returned errors to the user
  */
 static sccp_configurationchange_t sccp_config_object_setValue(void * const obj, PBX_VARIABLE_TYPE * cat_root, const char * name, const char * value, int lineno, const sccp_config_segment_t segment, boolean_t * SetEntries,
-							      boolean_t default_run)
+							      boolean_t default_run, sccp_value_changed_t * const valueChanged)
 {
 	const SCCPConfigSegment * sccpConfigSegment = sccp_find_segment(segment);
 	if (!sccpConfigSegment) {
@@ -869,6 +874,9 @@ static sccp_configurationchange_t sccp_config_object_setValue(void * const obj,
 	if (SCCP_CONFIG_CHANGE_ERROR == changed) {
 		pbx_log(LOG_NOTICE, "SCCP: Exception/Error during parsing of: %s\n", sccpConfigOption->description);
 	}
+	if (valueChanged) {
+		*valueChanged = changed;
+	}
 	return changes;
 }
 
@@ -970,27 +978,27 @@ static void sccp_config_set_defaults(void * const obj, const sccp_config_segment
 
 				if (referralValueFound && v) { /* if referred to other segment and a value was found, pass the newly found cat_root directly to setValue */
 					sccp_log_and((DEBUGCAT_CONFIG + DEBUGCAT_HIGH))(VERBOSE_PREFIX_3 "Refer default value lookup for parameter:'%s' through '%s' segment\n", sccpDstConfig[cur_elem].name, referral_cat);
-					sccp_config_object_setValue(obj, cat_root, sccpDstConfig[cur_elem].name, v->value, __LINE__, segment, SetEntries, TRUE);
+					sccp_config_object_setValue(obj, cat_root, sccpDstConfig[cur_elem].name, v->value, __LINE__, segment, SetEntries, TRUE, NULL);
 					continue;
 				} else { /* if referred but no default value was found, pass on the defaultValue of the referred segment in raw string form (including tokens) */
 					sccpDefaultConfigOption = sccp_find_config(search_segment_type, sccpDstConfig[cur_elem].name);
 					if (sccpDefaultConfigOption && !sccp_strlen_zero(sccpDefaultConfigOption->defaultValue)) {
 						sccp_log_and((DEBUGCAT_CONFIG + DEBUGCAT_HIGH))(VERBOSE_PREFIX_3 "Set parameter '%s' to segment default, being:'%s'\n", sccpDstConfig[cur_elem].name,
 												sccpDstConfig[cur_elem].defaultValue);
-						sccp_config_object_setValue(obj, NULL, sccpDstConfig[cur_elem].name, sccpDefaultConfigOption->defaultValue, __LINE__, segment, SetEntries, TRUE);
+						sccp_config_object_setValue(obj, NULL, sccpDstConfig[cur_elem].name, sccpDefaultConfigOption->defaultValue, __LINE__, segment, SetEntries, TRUE, NULL);
 						continue;
 					}
 				}
 
 			} else if (!sccp_strlen_zero(sccpDstConfig[cur_elem].defaultValue)) { /* Non-Referral, pass defaultValue on in raw string format (including tokens) */
 				sccp_log_and((DEBUGCAT_CONFIG + DEBUGCAT_HIGH))(VERBOSE_PREFIX_3 "Set parameter '%s' to own default, being:'%s'\n", sccpDstConfig[cur_elem].name, sccpDstConfig[cur_elem].defaultValue);
-				sccp_config_object_setValue(obj, NULL, sccpDstConfig[cur_elem].name, sccpDstConfig[cur_elem].defaultValue, __LINE__, segment, SetEntries, TRUE);
+				sccp_config_object_setValue(obj, NULL, sccpDstConfig[cur_elem].name, sccpDstConfig[cur_elem].defaultValue, __LINE__, segment, SetEntries, TRUE, NULL);
 				continue;
 			}
 
 			if (type == SCCP_CONFIG_DATATYPE_STRINGPTR || type == SCCP_CONFIG_DATATYPE_PARSER) { /* If nothing was found, clear variable, incase of a STRINGPTR */
 				sccp_log_and((DEBUGCAT_CONFIG + DEBUGCAT_HIGH))(VERBOSE_PREFIX_3 "Clearing parameter %s\n", sccpDstConfig[cur_elem].name);
-				sccp_config_object_setValue(obj, NULL, sccpDstConfig[cur_elem].name, "", __LINE__, segment, SetEntries, TRUE);
+				sccp_config_object_setValue(obj, NULL, sccpDstConfig[cur_elem].name, "", __LINE__, segment, SetEntries, TRUE, NULL);
 			}
 		}
 	}
@@ -1768,6 +1776,231 @@ sccp_value_changed_t sccp_config_parse_permithosts(void * const dest, const size
 	return changed;
 }
 
+static void sccp_config_freeLocation(sccp_cac_location_t * location)
+{
+	if (location->ha) {
+		sccp_free_ha(location->ha);
+	}
+	sccp_free(location);
+}
+
+/*!
+ * \brief Config Converter/Parser for Bandwidth Locations (call admission control)
+ *
+ * \note multi_entry
+ * \note format: location = <name>,<kbit/s>[,<network/mask>...]
+ * \note bandwidth in use is carried over to the new list by name, so calls in progress are still accounted for after a reload
+ *
+ * \lock
+ *  - cac_locations
+ */
+sccp_value_changed_t sccp_config_parse_location(void * const dest, const size_t size, PBX_VARIABLE_TYPE * vroot, const sccp_config_segment_t segment)
+{
+	sccp_value_changed_t changed = SCCP_CONFIG_CHANGE_NOCHANGE;
+	SCCP_LIST_HEAD(cac_locations, sccp_cac_location_t) * locationList = (struct cac_locations *)dest;
+	SCCP_LIST_HEAD(, sccp_cac_location_t) newLocations;
+	sccp_cac_location_t * location = NULL;
+	sccp_cac_location_t * current = NULL;
+	PBX_VARIABLE_TYPE * v = NULL;
+	int error = 0;
+	int errors = 0;
+	int found = 0;
+
+	SCCP_LIST_HEAD_INIT(&newLocations);
+	for (v = vroot; v && !errors; v = v->next) {
+		if (sccp_strlen_zero(v->value)) {
+			continue;
+		}
+		char * value = pbx_strdupa(v->value);
+		char * tokenptr = NULL;
+		char * name = strtok_r(value, ",", &tokenptr);
+		char * bandwidth = strtok_r(NULL, ",", &tokenptr);
+		char * network = NULL;
+
+		if (!name || !bandwidth || sccp_strlen_zero(name = pbx_strip(name)) || !sccp_strIsNumeric(bandwidth = pbx_strip(bandwidth))) {
+			pbx_log(LOG_WARNING, "SCCP: Invalid location '%s', expected <name>,<kbit/s>[,<network/mask>...]\n", v->value);
+			errors++;
+			break;
+		}
+		if (!(location = (sccp_cac_location_t *) sccp_calloc(sizeof *location, 1))) {
+			pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+			errors++;
+			break;
+		}
+		sccp_copy_string(location->name, name, sizeof(location->name));
+		location->bandwidth = sccp_atoi(bandwidth, strlen(bandwidth) + 1);
+		while ((network = strtok_r(NULL, ",", &tokenptr))) {
+			location->ha = sccp_append_ha("permit", pbx_strip(network), location->ha, &error);
+			errors |= error;
+		}
+		SCCP_LIST_INSERT_TAIL(&newLocations, location, list);
+	}
+
+	if (errors) {
+		sccp_log(DEBUGCAT_CONFIG)(VERBOSE_PREFIX_3 "SCCP: (sccp_config_parse_location) Invalid\n");
+		changed = SCCP_CONFIG_CHANGE_INVALIDVALUE;
+	} else {
+		struct ast_str * ha_buf = pbx_str_alloca(DEFAULT_PBX_STR_BUFFERSIZE);
+		struct ast_str * prev_ha_buf = pbx_str_alloca(DEFAULT_PBX_STR_BUFFERSIZE);
+
+		SCCP_LIST_LOCK(locationList);
+		SCCP_LIST_TRAVERSE(&newLocations, location, list) {
+			SCCP_LIST_TRAVERSE(locationList, current, list) {
+				if (sccp_strcaseequals(current->name, location->name) && current->bandwidth == location->bandwidth) {
+					pbx_str_reset(ha_buf);
+					pbx_str_reset(prev_ha_buf);
+					sccp_print_ha(ha_buf, DEFAULT_PBX_STR_BUFFERSIZE, location->ha);
+					sccp_print_ha(prev_ha_buf, DEFAULT_PBX_STR_BUFFERSIZE, current->ha);
+					if (sccp_strequals(pbx_str_buffer(ha_buf), pbx_str_buffer(prev_ha_buf))) {
+						found++;
+					}
+					break;
+				}
+			}
+		}
+		if (found != SCCP_LIST_GETSIZE(&newLocations) || found != SCCP_LIST_GETSIZE(locationList)) {		// replace list, keeping the counters
+			SCCP_LIST_TRAVERSE(&newLocations, location, list) {
+				SCCP_LIST_TRAVERSE(locationList, current, list) {
+					if (sccp_strcaseequals(current->name, location->name)) {
+						location->used = current->used;
+						location->calls = current->calls;
+						location->downgraded = current->downgraded;
+						location->rejected = current->rejected;
+						break;
+					}
+				}
+			}
+			while ((current = SCCP_LIST_REMOVE_HEAD(locationList, list))) {
+				sccp_config_freeLocation(current);
+			}
+			while ((location = SCCP_LIST_REMOVE_HEAD(&newLocations, list))) {
+				SCCP_LIST_INSERT_TAIL(locationList, location, list);
+			}
+			changed = SCCP_CONFIG_CHANGE_CHANGED;
+		}
+		SCCP_LIST_UNLOCK(locationList);
+	}
+
+	/* cleanup resources when not passed on to dest */
+	while ((location = SCCP_LIST_REMOVE_HEAD(&newLocations, list))) {
+		sccp_config_freeLocation(location);
+	}
+	SCCP_LIST_HEAD_DESTROY(&newLocations);
+	return changed;
+}
+
+/*!
+ * \brief Config Converter/Parser for Hunt Groups
+ *
+ * \note multi_entry
+ * \note format: huntgroup = <name>,<linear|circular|longestidle>,<line>[,<line>...]
+ * \note unchanged hunt groups keep their member state, changed ones start over with all members free
+ *
+ * \lock
+ *  - huntgroups
+ */
+sccp_value_changed_t sccp_config_parse_huntgroup(void * const dest, const size_t size, PBX_VARIABLE_TYPE * vroot, const sccp_config_segment_t segment)
+{
+	sccp_value_changed_t changed = SCCP_CONFIG_CHANGE_NOCHANGE;
+	SCCP_LIST_HEAD(huntgroups, sccp_huntgroup_t) * huntgroupList = (struct huntgroups *)dest;
+	SCCP_LIST_HEAD(, sccp_huntgroup_t) newHuntgroups;
+	sccp_huntgroup_t * huntgroup = NULL;
+	sccp_huntgroup_t * current = NULL;
+	PBX_VARIABLE_TYPE * v = NULL;
+	int errors = 0;
+	int found = 0;
+
+	SCCP_LIST_HEAD_INIT(&newHuntgroups);
+	for (v = vroot; v && !errors; v = v->next) {
+		if (sccp_strlen_zero(v->value)) {
+			continue;
+		}
+		char * value = pbx_strdupa(v->value);
+		char * tokenptr = NULL;
+		char * name = strtok_r(value, ",", &tokenptr);
+		char * strategy = strtok_r(NULL, ",", &tokenptr);
+		char * member = NULL;
+		int strategyValue = strategy ? sccp_huntgroup_str2strategy(pbx_strip(strategy)) : -1;
+
+		if (!name || sccp_strlen_zero(name = pbx_strip(name)) || strategyValue < 0) {
+			pbx_log(LOG_WARNING, "SCCP: Invalid huntgroup '%s', expected <name>,<linear|circular|longestidle>,<line>[,<line>...]\n", v->value);
+			errors++;
+			break;
+		}
+		if (!(huntgroup = (sccp_huntgroup_t *) sccp_calloc(sizeof *huntgroup, 1))) {
+			pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+			errors++;
+			break;
+		}
+		sccp_copy_string(huntgroup->name, name, sizeof(huntgroup->name));
+		huntgroup->strategy = (sccp_huntgroup_strategy_t) strategyValue;
+		while ((member = strtok_r(NULL, ",", &tokenptr))) {
+			if (sccp_strlen_zero(member = pbx_strip(member))) {
+				continue;
+			}
+			if (huntgroup->size >= SCCP_HUNTGROUP_MAX_MEMBERS) {
+				pbx_log(LOG_WARNING, "SCCP: Huntgroup %s has more than %d members, ignoring %s\n", huntgroup->name, SCCP_HUNTGROUP_MAX_MEMBERS, member);
+				continue;
+			}
+			sccp_copy_string(huntgroup->members[huntgroup->size++].name, member, sizeof(huntgroup->members[0].name));
+		}
+		SCCP_LIST_INSERT_TAIL(&newHuntgroups, huntgroup, list);
+		if (!huntgroup->size) {
+			pbx_log(LOG_WARNING, "SCCP: Huntgroup %s has no members\n", huntgroup->name);
+			errors++;
+			break;
+		}
+		sccp_huntgroup_initMembers(huntgroup);
+	}
+
+	if (errors) {
+		sccp_log(DEBUGCAT_CONFIG)(VERBOSE_PREFIX_3 "SCCP: (sccp_config_parse_huntgroup) Invalid\n");
+		changed = SCCP_CONFIG_CHANGE_INVALIDVALUE;
+	} else {
+		SCCP_LIST_LOCK(huntgroupList);
+		SCCP_LIST_TRAVERSE(&newHuntgroups, huntgroup, list) {
+			SCCP_LIST_TRAVERSE(huntgroupList, current, list) {
+				if (sccp_strcaseequals(current->name, huntgroup->name)) {
+					if (current->strategy == huntgroup->strategy && current->size == huntgroup->size) {
+						uint8_t x = 0;
+						while (x < current->size && sccp_strequals(current->members[x].name, huntgroup->members[x].name)) {
+							x++;
+						}
+						found += (x == current->size) ? 1 : 0;
+					}
+					break;
+				}
+			}
+		}
+		if (found != SCCP_LIST_GETSIZE(&newHuntgroups) || found != SCCP_LIST_GETSIZE(huntgroupList)) {		// replace list, keeping the counters
+			SCCP_LIST_TRAVERSE(&newHuntgroups, huntgroup, list) {
+				SCCP_LIST_TRAVERSE(huntgroupList, current, list) {
+					if (sccp_strcaseequals(current->name, huntgroup->name)) {
+						huntgroup->calls = current->calls;
+						huntgroup->overflows = current->overflows;
+						break;
+					}
+				}
+			}
+			while ((current = SCCP_LIST_REMOVE_HEAD(huntgroupList, list))) {
+				sccp_free(current);
+			}
+			while ((huntgroup = SCCP_LIST_REMOVE_HEAD(&newHuntgroups, list))) {
+				SCCP_LIST_INSERT_TAIL(huntgroupList, huntgroup, list);
+			}
+			changed = SCCP_CONFIG_CHANGE_CHANGED;
+		}
+		SCCP_LIST_UNLOCK(huntgroupList);
+	}
+
+	/* cleanup resources when not passed on to dest */
+	while ((huntgroup = SCCP_LIST_REMOVE_HEAD(&newHuntgroups, list))) {
+		sccp_free(huntgroup);
+	}
+	SCCP_LIST_HEAD_DESTROY(&newHuntgroups);
+	return changed;
+}
+
 static skinny_devicetype_t addonstr2enum(const char * addonstr)
 {
 	if (sccp_strcaseequals(addonstr, "7914")) {
@@ -2503,7 +2736,7 @@ sccp_configurationchange_t sccp_config_applyGlobalConfiguration(PBX_VARIABLE_TYP
 	PBX_VARIABLE_TYPE * cat_root                                       = v;
 
 	for (; v; v = v->next) {
-		res |= sccp_config_object_setValue(sccp_globals, cat_root, v->name, v->value, v->lineno, SCCP_CONFIG_GLOBAL_SEGMENT, SetEntries, FALSE);
+		res |= sccp_config_object_setValue(sccp_globals, cat_root, v->name, v->value, v->lineno, SCCP_CONFIG_GLOBAL_SEGMENT, SetEntries, FALSE, NULL);
 	}
 	if (res) {
 		sccp_log((DEBUGCAT_CONFIG))(VERBOSE_PREFIX_2 "Update Needed (%d)\n", res);
@@ -2792,6 +3025,9 @@ boolean_t sccp_config_readDevicesLines(sccp_readingtype_t readingtype)
 	}
 	sccp_config_add_default_softkeyset();
 
+	/* devices and lines provisioned through the manager override sccp.conf */
+	sccp_provision_readDevicesLines();
+
 #ifdef CS_SCCP_REALTIME
 	/* reload realtime lines */
 	sccp_configurationchange_t res = SCCP_CONFIG_NOUPDATENEEDED;
@@ -2888,6 +3124,10 @@ boolean_t sccp_config_readDevicesLines(sccp_readingtype_t readingtype)
 		sccp_device_post_reload();
 		sccp_log((DEBUGCAT_CONFIG))(VERBOSE_PREFIX_2 "Softkey Post Reload\n");
 		sccp_softkey_post_reload();
+		/* rendered provisioning files are out of date now */
+		if (iWebService.invalidateCache) {
+			iWebService.invalidateCache();
+		}
 	}
 	return TRUE;
 }
@@ -2914,7 +3154,7 @@ sccp_configurationchange_t sccp_config_applyLineConfiguration(linePtr l, PBX_VAR
 	}
 
 	for (; v; v = v->next) {
-		res |= sccp_config_object_setValue(l, cat_root, v->name, v->value, v->lineno, SCCP_CONFIG_LINE_SEGMENT, SetEntries, FALSE);
+		res |= sccp_config_object_setValue(l, cat_root, v->name, v->value, v->lineno, SCCP_CONFIG_LINE_SEGMENT, SetEntries, FALSE, NULL);
 	}
 
 	l->preferences_set_on_line_level = (l->preferences.audio[0] != SKINNY_CODEC_NONE) ? TRUE : FALSE;
@@ -2954,7 +3194,7 @@ sccp_configurationchange_t sccp_config_applyDeviceConfiguration(devicePtr d, PBX
 		sccp_dev_clean_restart(d, FALSE);
 	}
 	for (; v; v = v->next) {
-		res |= sccp_config_object_setValue(d, cat_root, v->name, v->value, v->lineno, SCCP_CONFIG_DEVICE_SEGMENT, SetEntries, FALSE);
+		res |= sccp_config_object_setValue(d, cat_root, v->name, v->value, v->lineno, SCCP_CONFIG_DEVICE_SEGMENT, SetEntries, FALSE, NULL);
 	}
 
 	sccp_config_set_defaults(d, SCCP_CONFIG_DEVICE_SEGMENT, SetEntries);
@@ -2965,6 +3205,66 @@ sccp_configurationchange_t sccp_config_applyDeviceConfiguration(devicePtr d, PBX
 	return (sccp_configurationchange_t)res;
 }
 
+/*!
+ * \brief Validate a Device or Line Configuration without applying it
+ * \param segment SCCP_CONFIG_DEVICE_SEGMENT or SCCP_CONFIG_LINE_SEGMENT
+ * \param v Asterisk Variable
+ * \param errorbuf Receives the reason when validation fails
+ * \param size Size of errorbuf
+ * \return TRUE when every parameter is known and has a valid value
+ *
+ * \note the values are parsed into a scratch object, which is never added to the globals
+ */
+boolean_t sccp_config_validateConfiguration(const sccp_config_segment_t segment, PBX_VARIABLE_TYPE * v, char * const errorbuf, const size_t size)
+{
+	const SCCPConfigSegment * sccpConfigSegment = sccp_find_segment(segment);
+	const SCCPConfigOption *  sccpConfigOption  = NULL;
+	PBX_VARIABLE_TYPE *       cat_root          = v;
+	sccp_value_changed_t      changed           = SCCP_CONFIG_CHANGE_NOCHANGE;
+	boolean_t *               SetEntries        = NULL;
+	boolean_t                 res               = TRUE;
+	void *                    obj               = NULL;
+
+	if (!sccpConfigSegment || (segment != SCCP_CONFIG_DEVICE_SEGMENT && segment != SCCP_CONFIG_LINE_SEGMENT)) {
+		snprintf(errorbuf, size, "unsupported config segment");
+		return FALSE;
+	}
+	if (!(SetEntries = (boolean_t *)sccp_calloc(sccpConfigSegment->config_size, sizeof(boolean_t)))) {
+		snprintf(errorbuf, size, "out of memory");
+		return FALSE;
+	}
+	AUTO_RELEASE(sccp_device_t, d, segment == SCCP_CONFIG_DEVICE_SEGMENT ? sccp_device_create("SCCPVALIDATE") : NULL);
+	AUTO_RELEASE(sccp_line_t, l, segment == SCCP_CONFIG_LINE_SEGMENT ? sccp_line_create("SCCPVALIDATE") : NULL);
+	if (!(obj = d ? (void *)d : (void *)l)) {
+		snprintf(errorbuf, size, "unable to create scratch %s", sccpConfigSegment->name);
+		sccp_free(SetEntries);
+		return FALSE;
+	}
+
+	for (; v && res; v = v->next) {
+		if (!(sccpConfigOption = sccp_find_config(segment, v->name))) {
+			if (v->name[0] != '_') {
+				snprintf(errorbuf, size, "unknown %s parameter '%s'", sccpConfigSegment->name, v->name);
+				res = FALSE;
+			}
+			continue;
+		}
+		if ((sccpConfigOption->flags & SCCP_CONFIG_FLAG_OBSOLETE) == SCCP_CONFIG_FLAG_OBSOLETE) {
+			snprintf(errorbuf, size, "obsolete %s parameter '%s'", sccpConfigSegment->name, v->name);
+			res = FALSE;
+			continue;
+		}
+		changed = SCCP_CONFIG_CHANGE_NOCHANGE;
+		sccp_config_object_setValue(obj, cat_root, v->name, v->value, v->lineno, segment, SetEntries, FALSE, &changed);
+		if (SCCP_CONFIG_CHANGE_INVALIDVALUE == changed || SCCP_CONFIG_CHANGE_ERROR == changed) {
+			snprintf(errorbuf, size, "invalid value '%s' for %s parameter '%s'", v->value, sccpConfigSegment->name, v->name);
+			res = FALSE;
+		}
+	}
+	sccp_free(SetEntries);
+	return res;
+}
+
 /*!
  * \brief Find the Correct Config File
  * \return Asterisk Config Object as ast_config
@@ -37,6 +37,8 @@ static const SCCPConfigOption sccpGlobalConfigOptions[]={
 	{"servername", 			G_OBJ_REF(servername), 			TYPE_STRINGPTR,									SCCP_CONFIG_FLAG_REQUIRED,					SCCP_CONFIG_NOUPDATENEEDED,		"Asterisk",			"show this name on the device registration\n"},
 	{"keepalive", 			G_OBJ_REF(keepalive), 			TYPE_UINT,									SCCP_CONFIG_FLAG_REQUIRED,					SCCP_CONFIG_NEEDDEVICERESET,		"60",				"Phone keep alive message every 60 secs. Used to check the voicemail and keep an open connection between server and phone (nat).\n"
 																										  											"Don't set any lower than 60 seconds.\n"},
+	{"reregister_grace",		G_OBJ_REF(reregister_grace),		TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"30",				"Seconds a device stays warm after losing its connection. When the same phone registers again from the same address within this time (switch port flap, wifi roam),\n"
+																																					"its call forwards and feature states are restored from memory instead of the database and the background/ringtone are not pushed again. 0 = disabled\n"},
 	{"context", 			G_OBJ_REF(context), 			TYPE_STRINGPTR,									SCCP_CONFIG_FLAG_REQUIRED,					SCCP_CONFIG_NEEDDEVICERESET,		"default",			"pbx dialplan context\n"},
 	{"dateformat", 			G_OBJ_REF(dateformat), 			TYPE_STRING,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NEEDDEVICERESET,		"M/D/Y",			"M-D-Y in any order. Use M/D/YA (for 12h format)\n"},
 	{"bindaddr", 			G_OBJ_REF(bindaddr), 			TYPE_PARSER(sccp_config_parse_ipaddress),					SCCP_CONFIG_FLAG_REQUIRED,					SCCP_CONFIG_NEEDDEVICERESET,		"0.0.0.0",			"replace with the ip address of the asterisk server (RTP important param)\n"}, 
@@ -44,7 +46,13 @@ static const SCCPConfigOption sccpGlobalConfigOptions[]={
 #ifdef HAVE_OPENSSL
 	{"secbindaddr", 		G_OBJ_REF(secbindaddr),			TYPE_PARSER(sccp_config_parse_ipaddress),					SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NEEDDEVICERESET,		"0.0.0.0",			"ip-address to use for for secure ssl/tls connections\n"}, 
 	{"secport", 			G_OBJ_REF(secbindaddr),			TYPE_PARSER(sccp_config_parse_port),						SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NEEDDEVICERESET,		"2443",				"secure port to list on (Skinny default:2443)\n"},
-	{"certfile",			G_OBJ_REF(cert_file),			TYPE_STRINGPTR,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NEEDDEVICERESET,		NULL,				"security certificate file (search path:Asterisk etc directory). If this field starts with '/' the absolute path will be used.\n"},
+	{"certfile",			G_OBJ_REF(cert_file),			TYPE_STRINGPTR,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"security certificate file (search path:Asterisk etc directory). If this field starts with '/' the absolute path will be used.\n"
+																																					"A renewed certificate is picked up for new connections on 'sccp reload' or with 'sccp tls rotate' (AMI: SCCPTlsRotate), without resetting devices.\n"},
+#endif
+#ifdef CS_EXPERIMENTAL
+	{"transport_faults",		G_OBJ_REF(transport_faults),		TYPE_STRINGPTR,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"",				"Inject faults into the tcp transport, for testing only. Read when the listener is created (module load).\n"
+																																					"example: transport_faults = seed=42,delay=10:250,eintr=2,shortread=5,shortwrite=5,reset=1\n"
+																																					"(percentage of operations affected, delay=percentage:maximum milliseconds, the same seed gives the same fault sequence)\n"},
 #endif
 	{"disallow|allow", 		G_OBJ_REF(global_preferences),		TYPE_PARSER(sccp_config_parse_codec_preferences),				SCCP_CONFIG_FLAG_MULTI_ENTRY,					SCCP_CONFIG_NEEDDEVICERESET,		"all|ulaw,alaw",		"First disallow all codecs, for example 'all', then allow codecs in order of preference (Multiple lines allowed)\n"},
 	{"deny|permit", 		G_OBJ_REF(ha),	 			TYPE_PARSER(sccp_config_parse_deny_permit),					SCCP_CONFIG_FLAG_REQUIRED | SCCP_CONFIG_FLAG_MULTI_ENTRY,	SCCP_CONFIG_NEEDDEVICERESET,		"0.0.0.0/0.0.0.0|internal",	"Deny every address except for the only one allowed. example: '0.0.0.0/0.0.0.0'\n"
@@ -75,6 +83,8 @@ static const SCCPConfigOption sccpGlobalConfigOptions[]={
 	{"dnd_tone", 			G_OBJ_REF(dnd_tone),	 		TYPE_ENUM(skinny,tone),								SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"Silence",			"Sets to 0 to disable the dnd tone\n"},
 	{"callwaiting_tone", 		G_OBJ_REF(callwaiting_tone), 		TYPE_ENUM(skinny,tone),								SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"Call Waiting Tone",		"Sets to 0 to disable the callwaiting tone\n"},
 	{"callwaiting_interval", 	G_OBJ_REF(callwaiting_interval),	TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"0",				"Callwaiting ring interval in seconds. Set to 0 to disable the callwaiting ringing interval.\n"},
+	{"callback_autodial",		G_OBJ_REF(callback_autodial),		TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"no",				"When the target of a CallBack becomes available, place the call again (if the phone is idle) instead of notifying the caller.\n"},
+	{"callback_timeout",		G_OBJ_REF(callback_timeout),		TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"1800",				"Seconds a CallBack (camp-on busy / no answer, 'callback' softkey) stays pending.\n"},
 	{"musicclass", 			G_OBJ_REF(musicclass), 			TYPE_STRINGPTR,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"default",			"Sets the default music on hold class\n"},
 	{"language", 			G_OBJ_REF(language), 			TYPE_STRINGPTR,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NEEDDEVICERESET,		"en",				"Default language setting\n"},
 #ifdef CS_MANAGER_EVENTS
@@ -106,8 +116,20 @@ static const SCCPConfigOption sccpGlobalConfigOptions[]={
 	{"cfwdbusy", 			G_OBJ_REF(cfwdbusy), 			TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NEEDDEVICERESET,		"yes",				"activate the callforward BUSY stuff and softkeys\n"},
 	{"cfwdnoanswer", 		G_OBJ_REF(cfwdnoanswer), 		TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NEEDDEVICERESET,		"yes",				"activate the callforward NOANSWER stuff and softkeys\n"},
 	{"cfwdnoanswer_timeout",	G_OBJ_REF(cfwdnoanswer_timeout),	TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"30",				"timeout after which callforward noanswer (when active) will be triggered. default is 30 seconds\n"},
+	{"context_maxcalls",		G_OBJ_REF(context_quota.maxcalls),	TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"0",				"maximum number of concurrent sccp calls per dialplan context (of the line), summed over all lines using that context (0 = unlimited)\n"},
+	{"context_maxcallrate",		G_OBJ_REF(context_quota.maxcallrate),	TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"0",				"maximum number of sccp call setups per minute per dialplan context (0 = unlimited)\n"},
+	{"callhistory",			G_OBJ_REF(callhistory_size),		TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"20",				"number of placed, received and missed calls remembered per line, served as a paged directory by the webservice (handler=callhistory). 0 = disabled\n"},
+	{"ctievents",			G_OBJ_REF(ctievents),			TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"no",				"publish line, device and feature state changes to desktop / call-centre clients as a long-poll on the webservice (handler=ctievents)\n"},
+	{"textmessage_queue",		G_OBJ_REF(textmessage_queuesize),	TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"10",				"number of MESSAGE() text messages kept per device while it is not registered, delivered when it registers again. 0 = only deliver to registered devices\n"},
+	{"textmessage_retention",	G_OBJ_REF(textmessage_retention),	TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"3600",				"seconds a queued text message is kept before it is discarded\n"},
+	{"adaptivecodecs",		G_OBJ_REF(adaptivecodecs),		TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"no",				"prefer loss tolerant / low bitrate codecs (opus, ilbc, g729, ...) for devices whose recent calls reported high packet loss or jitter, back to the configured order once the link has recovered\n"},
+	{"adaptivecodecs_loss",		G_OBJ_REF(adaptivecodecs_loss),		TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"3",				"packet loss in percent (averaged over the most recent calls) at which a device's link counts as degraded\n"},
+	{"adaptivecodecs_jitter",	G_OBJ_REF(adaptivecodecs_jitter),	TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"60",				"jitter in ms (averaged over the most recent calls) at which a device's link counts as degraded\n"},
+	{"location",			G_OBJ_REF(cac_locations),		TYPE_PARSER(sccp_config_parse_location),					SCCP_CONFIG_FLAG_MULTI_ENTRY,					SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"bandwidth location for call admission control, format: <name>,<kbit/s>[,<network/mask>...]. Devices are grouped by their address (or their 'location' setting), new calls in a location are admitted with the preferred codec, downgraded to a cheaper codec or refused with 'Not Enough Bandwidth' once the budget is used up (kbit/s per call including ip/udp/rtp overhead, g711 ~80, g729 ~24). 0 kbit/s = only account. Can be specified multiple times\n"},
+	{"huntgroup",			G_OBJ_REF(huntgroups),			TYPE_PARSER(sccp_config_parse_huntgroup),					SCCP_CONFIG_FLAG_MULTI_ENTRY,					SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"hunt group, dialed as SCCP/<name>, format: <name>,<linear|circular|longestidle>,<line>[,<line>...] (max 64 lines). Each call goes to one free member line (registered, no calls): the first in configured order (linear), the next one after the previous call (circular) or the one idle the longest (longestidle). Can be specified multiple times\n"},
 	{"nat", 			G_OBJ_REF(nat), 			TYPE_ENUM(sccp,nat),								SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NEEDDEVICERESET,		"auto",				"Global NAT support.\n"},
 	{"directrtp", 			G_OBJ_REF(directrtp), 			TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"no",				"This option allow devices to do direct RTP sessions.\n"},
+	{"autodirectrtp", 		G_OBJ_REF(autodirectrtp), 		TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"no",				"Decide direct RTP per call when directrtp is off: media flows directly when the phone and the remote rtp endpoint are both inside 'localnet' and no NAT is involved, otherwise it stays anchored on asterisk. Firewall hole punching is skipped for phones inside 'localnet'.\n"},
 	{"allowoverlap", 		G_OBJ_REF(useoverlap), 			TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"no",				"Enable overlap dialing support. If enabled, starts dialing immediately and sends remaing digits as DTMF/inband.\n"
 																																					"Use with extreme caution as it is very dialplan and provider dependent.\n"},
 	{"callgroup", 			G_OBJ_REF(callgroup), 			TYPE_PARSER(sccp_config_parse_group),						SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"",				"We are in caller groups 1,3,4. Valid for all lines\n"},
@@ -177,6 +199,11 @@ static const SCCPConfigOption sccpGlobalConfigOptions[]={
 	{"backoff_time", 		G_OBJ_REF(token_backoff_time),		TYPE_INT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"60",				"Time to wait before re-asking to fallback to primary server (Token Reject Backoff Time)\n"},
 	{"server_priority", 		G_OBJ_REF(server_priority),		TYPE_INT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"1",				"Server Priority for fallback: 1=Primary, 2=Secondary, 3=Tertiary etc\n"
 																																					"For active-active (fallback=odd/even) use 1 for both\n"},
+	{"replication",			G_OBJ_REF(replication),			TYPE_STRINGPTR,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"off",				"Hot-standby state replication: off, primary or standby. The primary streams device registration, dnd, privacy, monitor and call forward state to the standby,\n"
+																																					"which stores it in astdb so that phones failing over find their state ready and only have to register\n"},
+	{"replication_addr",		G_OBJ_REF(replication_addr),		TYPE_PARSER(sccp_config_parse_ipaddress),					SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"0.0.0.0",			"primary: ip-address of the standby to stream to. standby: ip-address of the primary to accept state from\n"},
+	{"replication_port",		G_OBJ_REF(replication_addr),		TYPE_PARSER(sccp_config_parse_port),						SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"2010",				"udp port the standby listens on for replication\n"},
+	{"replication_secret",		G_OBJ_REF(replication_secret),		TYPE_STRINGPTR,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"",				"shared secret (max 127 characters) used to authenticate the replication messages, must be the same on primary and standby. Required for replication\n"},
 //#if defined(CS_EXPERIMENTAL_XML)
 //	{"webdir",			G_OBJ_REF(webdir),			TYPE_PARSER(sccp_config_parse_webdir),						SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"",				"Directory where xslt stylesheets can be found.\n"},
 //#endif
@@ -200,6 +227,9 @@ static const SCCPConfigOption sccpDeviceConfigOptions[] = {
 	{"cfwdbusy", 			D_OBJ_REF(cfwdbusy), 			TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_GET_GLOBAL_DEFAULT,				SCCP_CONFIG_NOUPDATENEEDED,		"no",				"allow call forward when line is busy\n"},
 	{"cfwdnoanswer", 		D_OBJ_REF(cfwdnoanswer),		TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_GET_GLOBAL_DEFAULT,				SCCP_CONFIG_NOUPDATENEEDED,		"no",				"allow call forward when line if not being answered\n"},
 	{"dndFeature",	 		D_OBJ_REF(dndFeature.enabled),		TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_GET_GLOBAL_DEFAULT,				SCCP_CONFIG_NOUPDATENEEDED,		"yes",				"allow usage do not disturb button\n"},
+	{"maxcalls", 			D_OBJ_REF(quota.maxcalls),		TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"0",				"maximum number of concurrent calls on this device, over all of its lines (0 = unlimited)\n"},
+	{"maxcallrate", 		D_OBJ_REF(quota.maxcallrate),		TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"0",				"maximum number of call setups per minute on this device (0 = unlimited)\n"},
+	{"location",			D_OBJ_REF(location),			TYPE_STRING,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"bandwidth location (see 'location' in [general]) this device belongs to, instead of matching its address against the location networks\n"},
 	{"dnd",				D_OBJ_REF(dndmode),			TYPE_ENUM(sccp,dndmode),							SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"",				"allow setting dnd action for this device. Valid values are 'off', 'reject' (busy signal), 'silent' (ringer = silent) or 'user' (not used at the moment). . The value 'on' has been made obsolete in favor of 'reject'\n"},
 	{"dtmfmode", 			0,				0,	TYPE_STRING,									SCCP_CONFIG_FLAG_OBSOLETE,					SCCP_CONFIG_NOUPDATENEEDED,		"",				"(OBSOLETE) (don't use).\n"},
 	{"force_dtmfmode", 		D_OBJ_REF(dtmfmode), 			TYPE_ENUM(sccp,dtmfmode),							SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"auto",				"auto, skinny or rfc2833. Some phone models with bad firmware do send dtmf in a messed up order and need to be forced to skinny mode.\n"},
@@ -214,6 +244,7 @@ static const SCCPConfigOption sccpDeviceConfigOptions[] = {
 																																					"we don't have to trust the phone ip address, but the ip address of the connection.\n"},
 	{"nat", 			D_OBJ_REF(nat), 			TYPE_ENUM(sccp,nat),								SCCP_CONFIG_FLAG_GET_GLOBAL_DEFAULT,				SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"Device NAT support. Currently nat is automatically detected in most cases.\n"},
 	{"directrtp", 			D_OBJ_REF(directrtp), 			TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_GET_GLOBAL_DEFAULT,				SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"This option allow devices to do direct RTP sessions.\n"},
+	{"autodirectrtp", 		D_OBJ_REF(autodirectrtp), 		TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_GET_GLOBAL_DEFAULT,				SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"Decide direct RTP per call when directrtp is off: media flows directly when the phone and the remote rtp endpoint are both inside 'localnet' and no NAT is involved, otherwise it stays anchored on asterisk. Firewall hole punching is skipped for phones inside 'localnet'.\n"},
 	{"earlyrtp", 			D_OBJ_REF(earlyrtp), 			TYPE_PARSER(sccp_config_parse_earlyrtp),					SCCP_CONFIG_FLAG_GET_GLOBAL_DEFAULT,				SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"valid options: yes / no."
 																																					"Deprecated options: none, offhook, immediate, dial, ringout and progress. 'none' maps to 'no' and the rest maps to 'yes'.\n"
 																																					"The audio stream will be open in the 'true' state by default.\n"},
@@ -305,6 +336,8 @@ static const SCCPConfigOption sccpLineConfigOptions[] = {
 																																					"Other options (app_meetme: A,a,b,c,C,d,D,E,e,F,i,I,l,L,m,M,o,p,P,q,r,s,S,t,T,w,x,X,1) see conferencing app for specific documentation\n"},
 	{"transfer", 			L_OBJ_REF(transfer),			TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_GET_GLOBAL_DEFAULT,				SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"per line transfer capability\n"},
 	{"incominglimit", 		L_OBJ_REF(incominglimit),		TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"6",				"allow x number of incoming calls (call waiting)\n"},
+	{"maxcalls", 			L_OBJ_REF(quota.maxcalls),		TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"0",				"maximum number of concurrent calls (inbound and outbound) on this line, new channels beyond this limit are refused (0 = unlimited)\n"},
+	{"maxcallrate", 		L_OBJ_REF(quota.maxcallrate),		TYPE_UINT,									SCCP_CONFIG_FLAG_NONE,						SCCP_CONFIG_NOUPDATENEEDED,		"0",				"maximum number of call setups per minute on this line (0 = unlimited)\n"},
 	{"echocancel",			L_OBJ_REF(echocancel),			TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_GET_GLOBAL_DEFAULT,				SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"sets the phone echocancel for this line\n"},
 	{"silencesuppression",		L_OBJ_REF(silencesuppression),		TYPE_BOOLEAN,									SCCP_CONFIG_FLAG_GET_GLOBAL_DEFAULT,				SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"sets the silence suppression for this line\n"},
 	{"language",			L_OBJ_REF(language),			TYPE_STRINGPTR,									SCCP_CONFIG_FLAG_GET_GLOBAL_DEFAULT,				SCCP_CONFIG_NOUPDATENEEDED,		NULL,				"sets the language setting per line\n"},
@@ -357,7 +390,7 @@ static const SCCPConfigOption sccpSoftKeyConfigOptions[] = {
 	  "displayed when we are connected and could transfer a call" },
 	{ "digitsfoll", S_OBJ_REF(modes[KEYMODE_DIGITSFOLL]), TYPE_STRING, SCCP_CONFIG_FLAG_NONE, SCCP_CONFIG_NOUPDATENEEDED, "back, endcall, dial", "displayed when one or more digits have been entered, more are expected" },
 	{ "connconf", S_OBJ_REF(modes[KEYMODE_CONNCONF]), TYPE_STRING, SCCP_CONFIG_FLAG_NONE, SCCP_CONFIG_NOUPDATENEEDED, "conflist, newcall, endcall, hold, vidmode, monitor", "displayed when we are in a conference" },
-	{ "ringout", S_OBJ_REF(modes[KEYMODE_RINGOUT]), TYPE_STRING, SCCP_CONFIG_FLAG_NONE, SCCP_CONFIG_NOUPDATENEEDED, "empty, endcall, transfer", "displayed when We are calling someone" },
+	{ "ringout", S_OBJ_REF(modes[KEYMODE_RINGOUT]), TYPE_STRING, SCCP_CONFIG_FLAG_NONE, SCCP_CONFIG_NOUPDATENEEDED, "callback, endcall, transfer", "displayed when We are calling someone, or the one we are calling is busy" },
 	{ "offhookfeat", S_OBJ_REF(modes[KEYMODE_OFFHOOKFEAT]), TYPE_STRING, SCCP_CONFIG_FLAG_NONE, SCCP_CONFIG_NOUPDATENEEDED, "resume, newcall, endcall", "displayed wenn we went offhook using a feature" },
 	{ "onhint", S_OBJ_REF(modes[KEYMODE_INUSEHINT]), TYPE_STRING, SCCP_CONFIG_FLAG_NONE, SCCP_CONFIG_NOUPDATENEEDED, "redial, newcall, pickup, gpickup", "displayed when a hint is activated" },
 	{ "onstealable", S_OBJ_REF(modes[KEYMODE_ONHOOKSTEALABLE]), TYPE_STRING, SCCP_CONFIG_FLAG_NONE, SCCP_CONFIG_NOUPDATENEEDED, "redial, newcall, barge, intrcpt",
@@ -0,0 +1,257 @@
+/*!
+ * \file        sccp_ctievents.c
+ * \brief       SCCP CTI Event Stream
+ * \note        Line, device and feature state changes taken from the internal event system, kept in a bounded ring and
+ *              served to desktop / call-centre clients as a long-poll by the webservice:
+ *              <baseurl>/sccp?handler=ctievents&outformat=json[&lines=<line>,...][&devices=<device>,...][&since=<seq>][&timeout=<seconds>]
+ *              The request returns as soon as an event newer than 'since' matches the filter, or with an empty list after the timeout.
+ *              Clients pass the returned 'seq' as 'since' on the next request; 'lost' tells them they fell behind the ring and should resync.
+ *              Every waiting request occupies an asterisk http session thread, so at most SCCP_CTIEVENTS_MAXWAITERS requests wait at
+ *              the same time, further requests return immediately and clients are expected to poll again after a short pause.
+ *              Only enabled when 'ctievents' is set in sccp.conf.
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#include "config.h"
+#include "common.h"
+#include "sccp_ctievents.h"
+#include "sccp_device.h"
+#include "sccp_line.h"
+#include "sccp_linedevice.h"
+#include "sccp_utils.h"
+#include "sccp_webservice.h"
+
+SCCP_FILE_VERSION(__FILE__, "");
+
+#define SCCP_CTIEVENTS_SIZE 512											/*!< events kept for clients catching up, must be a power of two */
+#define SCCP_CTIEVENTS_TIMEOUT 25										/*!< default seconds a request waits for a matching event */
+#define SCCP_CTIEVENTS_MAXTIMEOUT 60
+#define SCCP_CTIEVENTS_MAXFILTER 32										/*!< maximum number of lines/devices a client can follow */
+#define SCCP_CTIEVENTS_MAXWAITERS 32										/*!< keep well below the http session_limit, so provisioning and the other handlers still get a thread */
+
+typedef enum {
+	SCCP_CTIEVENT_LINE,
+	SCCP_CTIEVENT_DEVICE,
+	SCCP_CTIEVENT_FEATURE,
+} sccp_ctievent_type_t;
+
+static const char * const ctievent_type2str[] = {
+	[SCCP_CTIEVENT_LINE]    = "line",
+	[SCCP_CTIEVENT_DEVICE]  = "device",
+	[SCCP_CTIEVENT_FEATURE] = "feature",
+};
+
+struct sccp_ctievent {
+	uint32_t seq;
+	time_t time;
+	sccp_ctievent_type_t type;
+	char line[StationMaxNameSize];
+	char device[StationMaxDeviceNameSize];
+	char state[40];
+};
+
+/*!
+ * \brief Ring of the last SCCP_CTIEVENTS_SIZE events, event 'seq' lives at events[seq % SCCP_CTIEVENTS_SIZE]
+ */
+static struct {
+	uint32_t seq;												/*!< sequence number of the last event, 0 = none yet */
+	uint16_t waiters;											/*!< requests currently waiting for an event */
+	boolean_t stopping;
+	struct sccp_ctievent events[SCCP_CTIEVENTS_SIZE];
+} stream;
+AST_MUTEX_DEFINE_STATIC(streamLock);
+static pbx_cond_t streamCond;
+
+static boolean_t sccp_ctievents_handler(const char * const uri, PBX_VARIABLE_TYPE * params, PBX_VARIABLE_TYPE * headers, pbx_str_t ** result);
+static void sccp_ctievents_eventListener(const sccp_event_t * event);
+
+void sccp_ctievents_module_start(void)
+{
+	memset(&stream, 0, sizeof(stream));
+	pbx_cond_init(&streamCond, NULL);
+	sccp_event_subscribe(SCCP_EVENT_LINESTATUS_CHANGED | SCCP_EVENT_DEVICE_REGISTERED | SCCP_EVENT_DEVICE_UNREGISTERED | SCCP_EVENT_FEATURE_CHANGED, sccp_ctievents_eventListener, TRUE);
+	if (iWebService.addHandler && iWebService.isRunning()) {
+		iWebService.addHandler("ctievents", sccp_ctievents_handler, SCCP_XML_OUTPUTFMT_JSON);
+	}
+}
+
+/*!
+ * \brief Wake the waiting requests and wait until they have returned, new requests return immediately once stopping is set
+ */
+static void sccp_ctievents_drainWaiters(void)
+{
+	pbx_mutex_lock(&streamLock);
+	stream.stopping = TRUE;
+	pbx_cond_broadcast(&streamCond);
+	while (stream.waiters) {
+		pbx_mutex_unlock(&streamLock);
+		usleep(10000);
+		pbx_mutex_lock(&streamLock);
+	}
+	pbx_mutex_unlock(&streamLock);
+}
+
+void sccp_ctievents_module_stop(void)
+{
+	/* release the waiting requests before removing the handler they are running in */
+	sccp_ctievents_drainWaiters();
+	if (iWebService.removeHandler && iWebService.isRunning()) {
+		iWebService.removeHandler("ctievents");
+	}
+	sccp_event_unsubscribe(SCCP_EVENT_LINESTATUS_CHANGED | SCCP_EVENT_DEVICE_REGISTERED | SCCP_EVENT_DEVICE_UNREGISTERED | SCCP_EVENT_FEATURE_CHANGED, sccp_ctievents_eventListener);
+
+	/* a request might have slipped in before the handler was removed, drain again before tearing down the condition */
+	sccp_ctievents_drainWaiters();
+	pbx_cond_destroy(&streamCond);
+}
+
+static void sccp_ctievents_push(sccp_ctievent_type_t type, const char * line, const char * device, const char * state)
+{
+	pbx_mutex_lock(&streamLock);
+	struct sccp_ctievent * entry = &stream.events[++stream.seq % SCCP_CTIEVENTS_SIZE];
+	entry->seq = stream.seq;
+	entry->time = time(0);
+	entry->type = type;
+	sccp_copy_string(entry->line, line ? line : "", sizeof(entry->line));
+	sccp_copy_string(entry->device, device ? device : "", sizeof(entry->device));
+	sccp_copy_string(entry->state, state ? state : "", sizeof(entry->state));
+	if (stream.waiters) {
+		pbx_cond_broadcast(&streamCond);
+	}
+	pbx_mutex_unlock(&streamLock);
+}
+
+static void sccp_ctievents_eventListener(const sccp_event_t * event)
+{
+	if (!event || !GLOB(ctievents)) {
+		return;
+	}
+	switch (event->type) {
+		case SCCP_EVENT_LINESTATUS_CHANGED:
+			sccp_ctievents_push(SCCP_CTIEVENT_LINE, event->lineStatusChanged.line->name,
+					    event->lineStatusChanged.optional_device ? event->lineStatusChanged.optional_device->id : NULL,
+					    sccp_channelstate2str((sccp_channelstate_t)event->lineStatusChanged.state));
+			break;
+		case SCCP_EVENT_DEVICE_REGISTERED:
+			sccp_ctievents_push(SCCP_CTIEVENT_DEVICE, NULL, event->deviceRegistered.device->id, "REGISTERED");
+			break;
+		case SCCP_EVENT_DEVICE_UNREGISTERED:
+			sccp_ctievents_push(SCCP_CTIEVENT_DEVICE, NULL, event->deviceRegistered.device->id, "UNREGISTERED");
+			break;
+		case SCCP_EVENT_FEATURE_CHANGED:
+			sccp_ctievents_push(SCCP_CTIEVENT_FEATURE,
+					    event->featureChanged.optional_linedevice ? event->featureChanged.optional_linedevice->line->name : NULL,
+					    event->featureChanged.device->id, sccp_feature_type2str(event->featureChanged.featureType));
+			break;
+		default:
+			break;
+	}
+}
+
+/*!
+ * \brief Split a comma separated request parameter into filter entries (pointing into buf)
+ */
+static uint8_t sccp_ctievents_parseFilter(char * buf, const char * filter[SCCP_CTIEVENTS_MAXFILTER])
+{
+	uint8_t count = 0;
+	char * entry = NULL;
+
+	while (buf && count < SCCP_CTIEVENTS_MAXFILTER && (entry = strsep(&buf, ","))) {
+		if (!sccp_strlen_zero(entry)) {
+			filter[count++] = pbx_strip(entry);
+		}
+	}
+	return count;
+}
+
+static boolean_t sccp_ctievents_inFilter(const char * name, const char * filter[SCCP_CTIEVENTS_MAXFILTER], uint8_t count)
+{
+	for (uint8_t i = 0; i < count; i++) {
+		if (sccp_strcaseequals(name, filter[i])) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void sccp_ctievents_appendEscaped(pbx_str_t ** result, const char * str)
+{
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\') {
+			pbx_str_append(result, 0, "\\%c", *str);
+		} else if ((unsigned char)*str >= 0x20) {
+			pbx_str_append(result, 0, "%c", *str);
+		}
+	}
+}
+
+/*!
+ * \brief Long-poll for the next events matching the lines/devices filter
+ * \note blocks the calling webservice thread for at most 'timeout' seconds
+ */
+static boolean_t sccp_ctievents_handler(const char * const uri, PBX_VARIABLE_TYPE * params, PBX_VARIABLE_TYPE * headers, pbx_str_t ** result)
+{
+	const char * lines[SCCP_CTIEVENTS_MAXFILTER];
+	const char * devices[SCCP_CTIEVENTS_MAXFILTER];
+	const char * linesparam = sccp_retrieve_str_variable_byKey(params, "lines");
+	const char * devicesparam = sccp_retrieve_str_variable_byKey(params, "devices");
+	const char * sinceparam = sccp_retrieve_str_variable_byKey(params, "since");
+	int timeout = sccp_retrieve_int_variable_byKey(params, "timeout");
+	uint8_t numLines = sccp_ctievents_parseFilter(linesparam ? pbx_strdupa(linesparam) : NULL, lines);
+	uint8_t numDevices = sccp_ctievents_parseFilter(devicesparam ? pbx_strdupa(devicesparam) : NULL, devices);
+	int matched = 0;
+	boolean_t lost = FALSE;
+
+	if (!GLOB(ctievents)) {
+		pbx_log(LOG_NOTICE, "SCCP: (ctievents) request ignored, set 'ctievents = yes' in sccp.conf to enable the event stream\n");
+		return FALSE;
+	}
+	if (timeout <= 0) {
+		timeout = SCCP_CTIEVENTS_TIMEOUT;
+	} else if (timeout > SCCP_CTIEVENTS_MAXTIMEOUT) {
+		timeout = SCCP_CTIEVENTS_MAXTIMEOUT;
+	}
+	struct timeval absolute_timeout = ast_tvadd(ast_tvnow(), ast_tv(timeout, 0));
+	struct timespec timeout_spec = {
+		.tv_sec = absolute_timeout.tv_sec,
+		.tv_nsec = absolute_timeout.tv_usec * 1000,
+	};
+
+	pbx_mutex_lock(&streamLock);
+	uint32_t since = sccp_strlen_zero(sinceparam) ? stream.seq : (uint32_t) strtoul(sinceparam, NULL, 10);
+	if (since > stream.seq) {										/* restarted since the client last asked */
+		since = stream.seq;
+		lost = TRUE;
+	}
+	boolean_t wait = stream.waiters < SCCP_CTIEVENTS_MAXWAITERS;
+	if (!wait) {
+		sccp_log(DEBUGCAT_WEBSERVICE)(VERBOSE_PREFIX_3 "SCCP: (ctievents) %d requests already waiting, not waiting for new events\n", stream.waiters);
+	}
+	stream.waiters++;
+	pbx_str_set(result, 0, "{\"events\":[");
+	do {
+		uint32_t oldest = stream.seq >= SCCP_CTIEVENTS_SIZE ? stream.seq - SCCP_CTIEVENTS_SIZE + 1 : 1;
+		if (since + 1 < oldest) {
+			lost = TRUE;
+			since = oldest - 1;
+		}
+		for (; since < stream.seq; since++) {
+			const struct sccp_ctievent * entry = &stream.events[(since + 1) % SCCP_CTIEVENTS_SIZE];
+			if ((numLines || numDevices) && !(numLines && sccp_ctievents_inFilter(entry->line, lines, numLines)) && !(numDevices && sccp_ctievents_inFilter(entry->device, devices, numDevices))) {
+				continue;
+			}
+			pbx_str_append(result, 0, "%s{\"seq\":%u,\"time\":%jd,\"type\":\"%s\",\"line\":\"", matched++ ? "," : "", entry->seq, (intmax_t) entry->time, ctievent_type2str[entry->type]);
+			sccp_ctievents_appendEscaped(result, entry->line);
+			pbx_str_append(result, 0, "\",\"device\":\"");
+			sccp_ctievents_appendEscaped(result, entry->device);
+			pbx_str_append(result, 0, "\",\"state\":\"%s\"}", entry->state);
+		}
+	} while (!matched && wait && !stream.stopping && pbx_cond_timedwait(&streamCond, &streamLock, &timeout_spec) != ETIMEDOUT);
+	pbx_str_append(result, 0, "],\"seq\":%u,\"lost\":%s}\n", since, lost ? "true" : "false");
+	stream.waiters--;
+	pbx_mutex_unlock(&streamLock);
+
+	sccp_log(DEBUGCAT_WEBSERVICE)(VERBOSE_PREFIX_3 "SCCP: (ctievents) returning %d event(s) up to seq:%u\n", matched, since);
+	return TRUE;
+}
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
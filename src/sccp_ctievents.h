@@ -0,0 +1,13 @@
+/*!
+ * \file        sccp_ctievents.h
+ * \brief       SCCP CTI Event Stream Header
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#pragma once
+
+__BEGIN_C_EXTERN__
+SCCP_API void SCCP_CALL sccp_ctievents_module_start(void);
+SCCP_API void SCCP_CALL sccp_ctievents_module_stop(void);
+__END_C_EXTERN__
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
@@ -31,6 +31,7 @@
 //#include "sccp_devstate.h"
 #include "sccp_featureParkingLot.h"
 #include "sccp_labels.h"
+#include "sccp_threadpool.h"
 
 SCCP_FILE_VERSION(__FILE__, "");
 
@@ -454,6 +455,90 @@ boolean_t sccp_device_check_update(devicePtr device)
 	return res;
 }
 
+/*!
+ * \brief Apply pending Device Updates, in the background
+ * \param data retained device, or NULL to check all devices with a pending update
+ */
+static void *sccp_device_pendingUpdates_thread(void *data)
+{
+	sccp_device_t *device = (sccp_device_t *) data;
+	sccp_device_t **devices = NULL;
+	sccp_device_t *d = NULL;
+	int count = 0;
+
+	pbx_rwlock_rdlock(&GLOB(lock));
+	boolean_t reload_in_progress = GLOB(reload_in_progress);
+	pbx_rwlock_unlock(&GLOB(lock));
+
+	if (device) {
+		size_t handled = 0;
+		size_t queued = 0;
+		do {													/* requests arriving while we run are handled by another pass, not by a second worker */
+			handled = device->pendingUpdates.queued;
+			if (!reload_in_progress && !sccp_device_check_update(device)) {
+				sccp_log((DEBUGCAT_CONFIG + DEBUGCAT_DEVICE)) (VERBOSE_PREFIX_3 "%s: Update still pending, device has active channels\n", device->id);
+			}
+			queued = ATOMIC_DECR(&device->pendingUpdates.queued, handled, &device->pendingUpdates.lock);
+		} while (queued != handled);
+		sccp_device_release(&device);								/* explicit release of the device retained by sccp_device_schedulePendingUpdates */
+		return NULL;
+	}
+	if (reload_in_progress) {										/* will be rescheduled when the reload finishes */
+		return NULL;
+	}
+
+	/* snapshot, check_update might remove the device from the list */
+	SCCP_RWLIST_RDLOCK(&GLOB(devices));
+	if ((devices = (sccp_device_t **) sccp_calloc(SCCP_RWLIST_GETSIZE(&GLOB(devices)) + 1, sizeof(sccp_device_t *)))) {
+		SCCP_RWLIST_TRAVERSE(&GLOB(devices), d, list) {
+			if ((d->pendingUpdate || d->pendingDelete) && (devices[count] = sccp_device_retain(d))) {
+				count++;
+			}
+		}
+	}
+	SCCP_RWLIST_UNLOCK(&GLOB(devices));
+	if (!devices) {
+		pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+		return NULL;
+	}
+
+	sccp_log((DEBUGCAT_CONFIG + DEBUGCAT_DEVICE)) (VERBOSE_PREFIX_3 "SCCP: Scheduling pending updates for %d devices\n", count);
+	for (int idx = 0; idx < count; idx++) {
+		sccp_device_schedulePendingUpdates(devices[idx]);						/* one worker per device at a time */
+		sccp_device_release(&devices[idx]);							/* explicit release */
+	}
+	sccp_free(devices);
+	return NULL;
+}
+
+/*!
+ * \brief Schedule the application of pending Device Updates
+ * \param device Device which may have become idle, or NULL after a reload has finished
+ *
+ * \note Replaces polling of the reload state from every session thread. Updates are applied when they can
+ * be: when the reload has finished or when the last channel on the device has been cleaned up.
+ */
+void sccp_device_schedulePendingUpdates(constDevicePtr device)
+{
+	sccp_device_t *d = NULL;
+
+	if (device) {
+		if (!device->pendingUpdate && !device->pendingDelete) {
+			return;
+		}
+		if (!(d = sccp_device_retain(device))) {
+			return;
+		}
+		if (ATOMIC_INCR(&d->pendingUpdates.queued, 1, &d->pendingUpdates.lock) != 0) {
+			sccp_device_release(&d);								/* worker already queued for this device, it will do another pass */
+			return;
+		}
+	}
+	if (!GLOB(general_threadpool) || !sccp_threadpool_add_work(GLOB(general_threadpool), sccp_device_pendingUpdates_thread, (void *) d)) {
+		sccp_device_pendingUpdates_thread(d);							/* fallback to applying synchronously */
+	}
+}
+
 /*!
  * \brief run after the new device config is loaded during the reload process
  * \note See \ref sccp_config_reload
@@ -675,7 +760,10 @@ devicePtr sccp_device_create(const char * id)
 	}
 #ifndef SCCP_ATOMIC
 	sccp_mutex_unlock(&d->messageStack.lock);
+	pbx_mutex_init(&d->accounting.lock);
+	pbx_mutex_init(&d->pendingUpdates.lock);
 #endif
+	d->accounting.since = time(0);
 #if HAVE_ICONV
 	d->privateData->iconv = (iconv_t) -1;
 #endif
@@ -1393,6 +1481,7 @@ void sccp_dev_set_registered(devicePtr d, skinny_registrationstate_t state)
 		}
 		sccp_dev_postregistration(d);
 	} else if (state == SKINNY_DEVICE_RS_PROGRESS) {
+		(void) ATOMIC_INCR(&d->accounting.registrations, 1, &d->accounting.lock);
 		sccp_event_t *event = sccp_event_allocate(SCCP_EVENT_DEVICE_PREREGISTERED);
 		if (event) {
 			event->deviceRegistered.device = sccp_device_retain(d);
@@ -1402,6 +1491,42 @@ void sccp_dev_set_registered(devicePtr d, skinny_registrationstate_t state)
 	d->registrationTime = time(0);
 }
 
+/*!
+ * \brief Account messages / bytes received from the device (called from the session thread)
+ */
+void sccp_device_accountInbound(constDevicePtr d, size_t messages, size_t bytes)
+{
+	devicePtr device = (devicePtr) d;									/* discard const */
+
+	(void) ATOMIC_INCR(&device->accounting.messagesIn, messages, &device->accounting.lock);
+	(void) ATOMIC_INCR(&device->accounting.bytesIn, bytes, &device->accounting.lock);
+}
+
+/*!
+ * \brief Account a message sent to the device
+ * \param async message was not sent by the device's own session thread, but on its behalf by another thread (hints, blf, pbx events)
+ */
+void sccp_device_accountOutbound(constDevicePtr d, size_t bytes, boolean_t async)
+{
+	devicePtr device = (devicePtr) d;									/* discard const */
+
+	(void) ATOMIC_INCR(&device->accounting.messagesOut, 1, &device->accounting.lock);
+	(void) ATOMIC_INCR(&device->accounting.bytesOut, bytes, &device->accounting.lock);
+	if (async) {
+		(void) ATOMIC_INCR(&device->accounting.async, 1, &device->accounting.lock);
+	}
+}
+
+/*!
+ * \brief Account session thread cpu time (called from the session thread)
+ */
+void sccp_device_accountCpu(constDevicePtr d, size_t usec)
+{
+	devicePtr device = (devicePtr) d;									/* discard const */
+
+	(void) ATOMIC_INCR(&device->accounting.cpu, usec, &device->accounting.lock);
+}
+
 /*!
  * \brief Sets the SCCP Device's SoftKey Mode Specified by opt
  * \param d SCCP Device
@@ -1694,6 +1819,14 @@ void sccp_dev_stoptone(constDevicePtr d, uint8_t lineInstance, uint32_t callid)
 	sccp_log((DEBUGCAT_DEVICE)) (VERBOSE_PREFIX_3 "%s: Stop tone on line %d with callid %d\n", d->id, lineInstance, callid);
 }
 
+/*!
+ * \brief 69xx phones have no prinotify line, messages go to the display prompt instead
+ */
+static inline boolean_t sccp_device_usesDisplayPrompt(constDevicePtr d)
+{
+	return (d->skinny_type == SKINNY_DEVICETYPE_CISCO6901 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6921 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6941 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6945 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6961) ? TRUE : FALSE;
+}
+
 /*!
  * \brief Set Message on Display Prompt of Device
  * \param d SCCP Device
@@ -1716,7 +1849,7 @@ void sccp_dev_set_message(devicePtr d, const char *msg, const int timeout, const
 	}
 	
 	if (timeout) {
-		if (d->skinny_type == SKINNY_DEVICETYPE_CISCO6901 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6921 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6941 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6945 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6961) {
+		if (sccp_device_usesDisplayPrompt(d)) {
 			sccp_dev_displayprompt(d, 0, 0, msg, timeout);
 		} else {
 			sccp_dev_displayprinotify(d, msg, SCCP_MESSAGE_PRIORITY_TIMEOUT, timeout);
@@ -1745,13 +1878,202 @@ void sccp_dev_clear_message(devicePtr d, const boolean_t cleardb)
 	}
 
 	sccp_device_clearMessageFromStack(d, SCCP_MESSAGE_PRIORITY_IDLE);
-	if (d->skinny_type == SKINNY_DEVICETYPE_CISCO6901 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6921 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6941 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6945 || d->skinny_type == SKINNY_DEVICETYPE_CISCO6961) {
+	if (sccp_device_usesDisplayPrompt(d)) {
 		sccp_dev_clearprompt(d, 0, 0);
 	} else {
 		sccp_dev_cleardisplayprinotify(d, SCCP_MESSAGE_PRIORITY_TIMEOUT);
 	}
 }
 
+/* begin broadcast */
+/*!
+ * \brief System Message Broadcast (Job)
+ */
+typedef struct sccp_broadcast {
+	uint32_t id;
+	int timeout;
+	boolean_t beep;
+	int count;
+	sccp_device_t **devices;										/*!< retained */
+	char text[1];
+} sccp_broadcast_t;
+
+AST_MUTEX_DEFINE_STATIC(broadcastLock);
+static struct {
+	uint32_t id;
+	int queued;
+	int delivered;
+	boolean_t finished;
+} broadcastStatus = { 0, 0, 0, TRUE };										/* protected by broadcastLock */
+
+/*!
+ * \brief Deliver a broadcast to every device in the job
+ *
+ * Timed messages are encoded once per protocol variant ([prompt/prinotify][static/dynamic]) and a copy of the encoded message is
+ * sent to each device. Messages without a timeout go onto the device message stack, which is per device state anyway.
+ */
+static void *sccp_device_broadcast_thread(void *data)
+{
+	sccp_broadcast_t *bc = (sccp_broadcast_t *) data;
+	sccp_msg_t *encoded[2][2] = { { NULL, NULL }, { NULL, NULL } };
+	int delivered = 0;
+	int idx = 0;
+
+	for (idx = 0; idx < bc->count; idx++) {
+		sccp_device_t *d = bc->devices[idx];
+		boolean_t sent = FALSE;
+
+		if (d->session && d->protocol && (d->hasDisplayPrompt() || d->hasLabelLimitedDisplayPrompt())) {
+			if (bc->timeout) {
+				boolean_t prompt = sccp_device_usesDisplayPrompt(d);
+				boolean_t dynamic = sccp_protocol_hasDynamicDisplay(d->protocol);
+				sccp_msg_t **template = &encoded[prompt][dynamic];
+				sccp_msg_t *msg = NULL;
+
+				if (!*template) {
+					*template = sccp_protocol_buildDisplayMessage(d->protocol, prompt, SCCP_MESSAGE_PRIORITY_TIMEOUT, bc->timeout, bc->text);
+				}
+				if (*template && (msg = sccp_protocol_cloneMessage(*template))) {
+					sent = (sccp_dev_send(d, msg) > 0) ? TRUE : FALSE;
+				}
+			} else {
+				sccp_device_addMessageToStack(d, SCCP_MESSAGE_PRIORITY_IDLE, bc->text);
+				sent = TRUE;
+			}
+			if (sent && bc->beep) {
+				sccp_dev_starttone(d, SKINNY_TONE_ZIPZIP, 0, 0, SKINNY_TONEDIRECTION_USER);
+			}
+		}
+		if (sent) {
+			delivered++;
+		}
+		sccp_device_release(&bc->devices[idx]);							/* explicit release */
+
+		/* publish progress, so that large fleets can be followed while the broadcast is running */
+		if ((idx & 0x3f) == 0x3f || idx == bc->count - 1) {
+			pbx_mutex_lock(&broadcastLock);
+			if (broadcastStatus.id == bc->id) {
+				broadcastStatus.delivered = delivered;
+				broadcastStatus.finished = (idx == bc->count - 1) ? TRUE : FALSE;
+			}
+			pbx_mutex_unlock(&broadcastLock);
+		}
+	}
+	for (idx = 0; idx < 4; idx++) {
+		if (encoded[idx / 2][idx % 2]) {
+			sccp_free(encoded[idx / 2][idx % 2]);
+		}
+	}
+	if (bc->count == 0) {
+		pbx_mutex_lock(&broadcastLock);
+		if (broadcastStatus.id == bc->id) {
+			broadcastStatus.finished = TRUE;
+		}
+		pbx_mutex_unlock(&broadcastLock);
+	}
+	sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "SCCP: Broadcast %d delivered to %d of %d devices\n", bc->id, delivered, bc->count);
+	sccp_free(bc->devices);
+	sccp_free(bc);
+	return NULL;
+}
+
+/*!
+ * \brief Send a System Message to all Devices
+ * \param msg Message Text
+ * \param timeout Timeout in seconds, 0 keeps the message on the idle status line
+ * \param beep Play Zip Zip Tone
+ * \return Broadcast id (0 on failure), the number of devices it has been queued for is returned in queued
+ *
+ * The message is persisted to the pbx database once, for devices registering later on, and delivered to the currently known
+ * devices by the general threadpool. Delivery progress can be retrieved using sccp_device_getBroadcastStatus.
+ */
+uint32_t sccp_device_broadcastMessage(const char *msg, const int timeout, const boolean_t beep, int *queued)
+{
+	static uint32_t lastBroadcastId = 0;
+	sccp_broadcast_t *bc = NULL;
+	sccp_device_t *d = NULL;
+	char msgtimeout[10];
+	size_t len = strlen(msg);
+
+	*queued = 0;
+	snprintf(msgtimeout, sizeof(msgtimeout), "%d", timeout);
+	iPbx.feature_addToDatabase("SCCP/message", "timeout", msgtimeout);
+	iPbx.feature_addToDatabase("SCCP/message", "text", msg);
+
+	if (!(bc = (sccp_broadcast_t *) sccp_calloc(1, sizeof(sccp_broadcast_t) + len))) {
+		pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+		return 0;
+	}
+	memcpy(bc->text, msg, len + 1);
+	bc->timeout = timeout;
+	bc->beep = beep;
+
+	SCCP_RWLIST_RDLOCK(&GLOB(devices));
+	if ((bc->devices = (sccp_device_t **) sccp_calloc(SCCP_RWLIST_GETSIZE(&GLOB(devices)) + 1, sizeof(sccp_device_t *)))) {
+		SCCP_RWLIST_TRAVERSE(&GLOB(devices), d, list) {
+			if ((bc->devices[bc->count] = sccp_device_retain(d))) {
+				bc->count++;
+			}
+		}
+	}
+	SCCP_RWLIST_UNLOCK(&GLOB(devices));
+	if (!bc->devices) {
+		pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+		sccp_free(bc);
+		return 0;
+	}
+
+	pbx_mutex_lock(&broadcastLock);
+	bc->id = ++lastBroadcastId;
+	broadcastStatus.id = bc->id;
+	broadcastStatus.queued = bc->count;
+	broadcastStatus.delivered = 0;
+	broadcastStatus.finished = FALSE;
+	pbx_mutex_unlock(&broadcastLock);
+	*queued = bc->count;
+
+	sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "SCCP: Broadcast %d of '%s' queued for %d devices (beep: %d, timeout: %d)\n", bc->id, msg, bc->count, beep, timeout);
+	if (!GLOB(general_threadpool) || !sccp_threadpool_add_work(GLOB(general_threadpool), sccp_device_broadcast_thread, (void *) bc)) {
+		uint32_t id = bc->id;
+		sccp_device_broadcast_thread(bc);							/* fallback to delivering synchronously */
+		return id;
+	}
+	return bc->id;
+}
+
+/*!
+ * \brief Clear the System Message from the pbx database and all Devices
+ */
+void sccp_device_clearBroadcastMessage(void)
+{
+	sccp_device_t *d = NULL;
+
+	iPbx.feature_removeTreeFromDatabase("SCCP/message", "timeout");
+	iPbx.feature_removeTreeFromDatabase("SCCP/message", "text");
+
+	SCCP_RWLIST_RDLOCK(&GLOB(devices));
+	SCCP_RWLIST_TRAVERSE(&GLOB(devices), d, list) {
+		sccp_dev_clear_message(d, FALSE);
+	}
+	SCCP_RWLIST_UNLOCK(&GLOB(devices));
+}
+
+/*!
+ * \brief Retrieve the delivery status of the last broadcast
+ * \return FALSE if no broadcast has been sent yet
+ */
+boolean_t sccp_device_getBroadcastStatus(uint32_t *id, int *queued, int *delivered, boolean_t *finished)
+{
+	pbx_mutex_lock(&broadcastLock);
+	*id = broadcastStatus.id;
+	*queued = broadcastStatus.queued;
+	*delivered = broadcastStatus.delivered;
+	*finished = broadcastStatus.finished;
+	pbx_mutex_unlock(&broadcastLock);
+	return *id ? TRUE : FALSE;
+}
+/* end broadcast */
+
 /*!
  * \brief Send Clear Prompt to Device
  * \param d SCCP Device
@@ -2202,6 +2524,67 @@ void sccp_dev_forward_status(constLinePtr l, uint8_t lineInstance, constDevicePt
 	}
 }
 
+/*!
+ * \brief Drop the state kept for a quick re-registration
+ */
+static void sccp_device_forgetWarm(devicePtr d)
+{
+	if (d->warm.cfwd) {
+		sccp_free(d->warm.cfwd);
+	}
+	if (d->warm.lineName) {
+		sccp_free(d->warm.lineName);
+	}
+	d->warm.size = 0;
+	d->warm.unregistered = 0;
+}
+
+/*!
+ * \brief Keep the state a quick re-registration needs to restore (reregister_grace), called while the device is being cleaned
+ * \note the line devices (and their call forwards) are destroyed during cleanup, the rest of the restored state stays on the device
+ */
+static void sccp_device_keepWarm(devicePtr d)
+{
+	uint8_t instance = 0;
+
+	sccp_device_forgetWarm(d);
+	if (GLOB(reregister_grace) <= 0) {
+		return;
+	}
+	if (d->lineButtons.size) {
+		d->warm.cfwd = (sccp_cfwd_information_t *) sccp_calloc(d->lineButtons.size * SCCP_CFWD_SENTINEL, sizeof(sccp_cfwd_information_t));
+		d->warm.lineName = (char (*)[StationMaxNameSize]) sccp_calloc(d->lineButtons.size, sizeof(*d->warm.lineName));
+		if (!d->warm.cfwd || !d->warm.lineName) {
+			pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, d->id);
+			sccp_device_forgetWarm(d);
+			return;
+		}
+		for (instance = SCCP_FIRST_LINEINSTANCE; instance < d->lineButtons.size; instance++) {
+			if (d->lineButtons.instance[instance] && d->lineButtons.instance[instance]->line) {
+				sccp_copy_string(d->warm.lineName[instance], d->lineButtons.instance[instance]->line->name, sizeof(d->warm.lineName[instance]));
+				memcpy(&d->warm.cfwd[instance * SCCP_CFWD_SENTINEL], d->lineButtons.instance[instance]->cfwd, sizeof(d->lineButtons.instance[instance]->cfwd));
+			}
+		}
+		d->warm.size = d->lineButtons.size;
+	}
+	d->warm.unregistered = time(0);
+}
+
+/*!
+ * \brief Is this registration a quick re-registration of the same phone within reregister_grace
+ * \note the call forwards are restored per line instance, only where the same line is still on that instance
+ */
+static boolean_t sccp_device_isWarm(constDevicePtr d, const struct sockaddr_storage * const sas)
+{
+	if (GLOB(reregister_grace) <= 0 || !d->warm.unregistered || time(0) - d->warm.unregistered > GLOB(reregister_grace)) {
+		return FALSE;
+	}
+	if (sccp_netsock_cmp_addr(&d->warm.sas, sas) != 0) {
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /*!
  * \brief Handle Post Device Registration
  * \param data Data
@@ -2223,12 +2606,20 @@ void sccp_dev_postregistration(devicePtr d)
 	char family[ASTDB_FAMILY_KEY_LEN] = { 0 };
 	char buffer[ASTDB_RESULT_LEN] = { 0 };
 	int instance = 0;
+	struct sockaddr_storage sas = { 0 };
+	boolean_t warm = FALSE;
 
 	if (!d) {
 		return;
 	}
 	sccp_log((DEBUGCAT_DEVICE + DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "%s: Device registered; performing post registration tasks...\n", d->id);
 
+	if (d->session && sccp_session_getSas(d->session, &sas)) {
+		warm = sccp_device_isWarm(d, &sas);
+		memcpy(&d->warm.sas, &sas, sizeof(d->warm.sas));
+	}
+	d->warm.unregistered = 0;
+
 	// Post event to interested listeners (hints, mwi) that device was registered.
 	sccp_event_t *event = sccp_event_allocate(SCCP_EVENT_DEVICE_REGISTERED);
 	if (event) {
@@ -2236,7 +2627,34 @@ void sccp_dev_postregistration(devicePtr d)
 		sccp_event_fire(event);
 	}
 
-	if (iPbx.feature_getFromDatabase) {
+	if (warm) {
+		/* quick re-registration: restore the state kept during cleanup instead of reading it back from db */
+		sccp_log((DEBUGCAT_DEVICE)) (VERBOSE_PREFIX_3 "%s: Re-registered within %d seconds, restoring kept state...\n", d->id, GLOB(reregister_grace));
+		for (instance = SCCP_FIRST_LINEINSTANCE; instance < d->lineButtons.size && instance < d->warm.size; instance++) {
+			if (d->lineButtons.instance[instance]) {
+				AUTO_RELEASE(sccp_linedevice_t, ld, sccp_linedevice_retain(d->lineButtons.instance[instance]));
+				if (!ld || !ld->line || !sccp_strequals(d->warm.lineName[instance], ld->line->name)) {
+					continue;								// different line on this instance after a config change
+				}
+				for(uint x = SCCP_CFWD_ALL; x < SCCP_CFWD_SENTINEL; x++) {
+					if (d->warm.cfwd[instance * SCCP_CFWD_SENTINEL + x].enabled) {
+						memcpy(&ld->cfwd[x], &d->warm.cfwd[instance * SCCP_CFWD_SENTINEL + x], sizeof(ld->cfwd[x]));
+						sccp_feat_changed(d, ld, sccp_cfwd2feature((sccp_cfwd_t)x));
+					}
+				}
+			}
+		}
+		/* dnd, privacy, monitor, redial and the message stack are not reset by sccp_dev_clean */
+		if (d->dndFeature.status) {
+			sccp_feat_changed(d, NULL, SCCP_FEATURE_DND);
+		}
+		if (d->privacyFeature.status) {
+			sccp_feat_changed(d, NULL, SCCP_FEATURE_PRIVACY);
+		}
+		if (d->monitorFeature.status) {
+			sccp_feat_changed(d, NULL, SCCP_FEATURE_MONITOR);
+		}
+	} else if (iPbx.feature_getFromDatabase) {
 		/* read last line/device states from db */
 		sccp_log((DEBUGCAT_DEVICE)) (VERBOSE_PREFIX_3 "%s: Getting Database Settings...\n", d->id);
 		for (instance = SCCP_FIRST_LINEINSTANCE; instance < d->lineButtons.size; instance++) {
@@ -2292,11 +2710,14 @@ void sccp_dev_postregistration(devicePtr d)
 			}
 		}
 	}
-	if (d->backgroundImage && !sccp_strlen_zero(d->backgroundImage)) {
+	sccp_device_forgetWarm(d);
+
+	/* the phone still has its background and ringtone when it only lost the connection */
+	if (!warm && d->backgroundImage && !sccp_strlen_zero(d->backgroundImage)) {
 		d->setBackgroundImage(d, d->backgroundImage, d->backgroundTN ? d->backgroundTN : d->backgroundImage);
 	}
 
-	if (d->ringtone && !sccp_strlen_zero(d->ringtone)) {
+	if (!warm && d->ringtone && !sccp_strlen_zero(d->ringtone)) {
 		d->setRingTone(d, d->ringtone);
 	}
 
@@ -2422,6 +2843,11 @@ void _sccp_dev_clean(devicePtr device, boolean_t remove_from_global, boolean_t r
 
 		d->linesRegistered = FALSE;
 		__saveLastDialedNumberToDatabase(d);
+		if (remove_from_global || restart_device) {
+			sccp_device_forgetWarm(d);
+		} else {
+			sccp_device_keepWarm(d);
+		}
 		
 		if (d->active_channel) {
 			sccp_device_setActiveChannel(d, NULL);
@@ -2627,6 +3053,9 @@ int __sccp_device_destroy(const void *ptr)
 		d->ha = NULL;
 	}
 
+	// cleanup kept re-registration state
+	sccp_device_forgetWarm(d);
+
 	// cleanup message stack
 	{
 #ifndef SCCP_ATOMIC
@@ -2640,6 +3069,8 @@ int __sccp_device_destroy(const void *ptr)
 #ifndef SCCP_ATOMIC
 		sccp_mutex_unlock(&d->messageStack.lock);
 		pbx_mutex_destroy(&d->messageStack.lock);
+		pbx_mutex_destroy(&d->accounting.lock);
+		pbx_mutex_destroy(&d->pendingUpdates.lock);
 #endif
 	}
 	
@@ -2687,6 +3118,57 @@ boolean_t sccp_device_isVideoSupported(constDevicePtr device)
 	return res;
 }
 
+#define SCCP_LINKQUALITY_WEIGHT 0.4										/*!< weight of the last call in the moving average */
+#define SCCP_LINKQUALITY_MINPACKETS 50										/*!< ignore calls too short to say anything about the link */
+#define SCCP_LINKQUALITY_MAXAGE 3600										/*!< forget the history when no calls were measured for this long */
+
+/*!
+ * \brief Fold the statistics of the last call into the device's link quality history
+ * \note the link is marked degraded when loss or jitter crosses adaptivecodecs_loss / adaptivecodecs_jitter, and
+ *       only recovers when both have dropped below half of that, so the codec choice does not flap between calls.
+ */
+void sccp_device_updateLinkQuality(devicePtr device, const sccp_call_statistics_t * const stats)
+{
+	uint32_t packets = stats->packets_received + stats->packets_lost;
+	time_t now = time(0);
+
+	if (packets < SCCP_LINKQUALITY_MINPACKETS) {
+		return;
+	}
+	float loss = (float)stats->packets_lost * 100 / packets;
+	if (!device->linkQuality.updated || now - device->linkQuality.updated > SCCP_LINKQUALITY_MAXAGE) {
+		device->linkQuality.loss = loss;
+		device->linkQuality.jitter = stats->jitter;
+		device->linkQuality.degraded = FALSE;
+	} else {
+		device->linkQuality.loss = device->linkQuality.loss * (1 - SCCP_LINKQUALITY_WEIGHT) + loss * SCCP_LINKQUALITY_WEIGHT;
+		device->linkQuality.jitter = device->linkQuality.jitter * (1 - SCCP_LINKQUALITY_WEIGHT) + stats->jitter * SCCP_LINKQUALITY_WEIGHT;
+	}
+	device->linkQuality.updated = now;
+
+	boolean_t degraded = device->linkQuality.degraded;
+	if (!degraded && (device->linkQuality.loss >= GLOB(adaptivecodecs_loss) || device->linkQuality.jitter >= GLOB(adaptivecodecs_jitter))) {
+		degraded = TRUE;
+	} else if (degraded && device->linkQuality.loss < (float)GLOB(adaptivecodecs_loss) / 2 && device->linkQuality.jitter < (float)GLOB(adaptivecodecs_jitter) / 2) {
+		degraded = FALSE;
+	}
+	if (degraded != device->linkQuality.degraded) {
+		sccp_log(DEBUGCAT_CODEC)(VERBOSE_PREFIX_3 "%s: link quality %s (loss:%.1f%%, jitter:%.0fms)\n", device->id, degraded ? "degraded, preferring robust codecs" : "recovered", device->linkQuality.loss, device->linkQuality.jitter);
+		device->linkQuality.degraded = degraded;
+	}
+}
+
+/*!
+ * \brief Should codec selection for this device prefer loss tolerant / low bitrate codecs
+ */
+boolean_t sccp_device_hasDegradedLink(constDevicePtr device)
+{
+	if (!GLOB(adaptivecodecs) || !device->linkQuality.degraded) {
+		return FALSE;
+	}
+	return (time(0) - device->linkQuality.updated <= SCCP_LINKQUALITY_MAXAGE) ? TRUE : FALSE;
+}
+
 /*!
  * \brief Find ServiceURL by index
  * \param device SCCP Device
@@ -145,6 +145,7 @@ struct sccp_device {
 	uint8_t protocolversion;										/*!< Skinny Supported Protocol Version */
 	uint8_t inuseprotocolversion;										/*!< Skinny Used Protocol Version */
 	uint16_t directrtp;											/*!< Direct RTP Support (Boolean, default=on) */
+	boolean_t autodirectrtp;										/*!< Decide Direct RTP per call from the endpoint addresses and localnet */
 
 	sccp_nat_t nat;												/*!< Network Address Translation Support (Boolean, default=on) */
 	sccp_session_t *session;										/*!< Current Session */
@@ -284,6 +285,40 @@ struct sccp_device {
 	} messageStack;
 	
 	sccp_call_statistics_t call_statistics[2];								/*!< Call statistics */
+	struct {
+		float loss;											/*!< Packet loss in percent, weighted towards the most recent calls */
+		float jitter;											/*!< Jitter in ms, weighted towards the most recent calls */
+		time_t updated;											/*!< Last time call statistics were received */
+		boolean_t degraded;										/*!< Prefer loss tolerant / low bitrate codecs (adaptivecodecs) */
+	} linkQuality;
+	sccp_quota_t quota;											/*!< Call Quota for this device */
+	char location[SCCP_MAX_LABEL];										/*!< Bandwidth Location, overrides matching the device address against the location networks */
+	struct {
+		time_t unregistered;										/*!< When the last session was cleaned up, 0 when there is nothing to restore */
+		struct sockaddr_storage sas;									/*!< Address the last session was registered from */
+		uint8_t size;											/*!< Number of line instances in cfwd */
+		sccp_cfwd_information_t *cfwd;									/*!< Call forwards per line instance (size * SCCP_CFWD_SENTINEL) at the time the device unregistered */
+		char (*lineName)[StationMaxNameSize];								/*!< Line per line instance (size), the call forwards are only restored onto the same line */
+	} warm;													/*!< State kept for a quick re-registration (reregister_grace) */
+	struct {
+#ifndef SCCP_ATOMIC
+		sccp_mutex_t lock;										/*!< Accounting Lock */
+#endif
+		volatile size_t messagesIn;									/*!< Messages received from the device */
+		volatile size_t bytesIn;									/*!< Bytes received from the device */
+		volatile size_t messagesOut;									/*!< Messages sent to the device */
+		volatile size_t bytesOut;									/*!< Bytes sent to the device */
+		volatile size_t async;										/*!< Messages sent to the device by other threads than its session thread (hints, blf, pbx events) */
+		volatile size_t cpu;										/*!< Session thread cpu time in microseconds */
+		volatile size_t registrations;									/*!< Registration attempts */
+		time_t since;											/*!< Accounting started */
+	} accounting;												/*!< Resources used on behalf of this device (sccp show topdevices) */
+	struct {
+#ifndef SCCP_ATOMIC
+		sccp_mutex_t lock;										/*!< Pending Updates Lock */
+#endif
+		volatile size_t queued;										/*!< Update requests since the worker was queued, 0 when no worker is queued (sccp_device_schedulePendingUpdates) */
+	} pendingUpdates;											/*!< Serializes the application of pendingUpdate/pendingDelete per device */
 	char *softkeyDefinition;										/*!< requested softKey configuration */
 	sccp_softKeySetConfiguration_t *softkeyset;								/*!< Allow for a copy of the softkeyset, if any of the softkeys needs to be redefined, for example for urihook/uriaction */
 
@@ -389,6 +424,9 @@ SCCP_API void SCCP_CALL sccp_dev_set_keyset(constDevicePtr d, uint8_t lineInstan
 SCCP_API void SCCP_CALL sccp_dev_set_ringer(constDevicePtr d, skinny_ringtype_t ringtype, skinny_ringduration_t duration, uint8_t lineInstance, uint32_t callid);
 SCCP_API void SCCP_CALL sccp_dev_cleardisplay(constDevicePtr d);
 SCCP_API void SCCP_CALL sccp_dev_set_registered(devicePtr d, skinny_registrationstate_t state);
+SCCP_API void SCCP_CALL sccp_device_accountInbound(constDevicePtr d, size_t messages, size_t bytes);
+SCCP_API void SCCP_CALL sccp_device_accountOutbound(constDevicePtr d, size_t bytes, boolean_t async);
+SCCP_API void SCCP_CALL sccp_device_accountCpu(constDevicePtr d, size_t usec);
 SCCP_API void SCCP_CALL sccp_dev_set_speaker(constDevicePtr d, uint8_t mode);
 SCCP_API void SCCP_CALL sccp_dev_set_microphone(devicePtr d, uint8_t mode);
 SCCP_API void SCCP_CALL sccp_dev_set_cplane(constDevicePtr device, uint8_t lineInstance, int status);
@@ -410,6 +448,9 @@ SCCP_API void SCCP_CALL _sccp_dev_clean(devicePtr device, boolean_t remove_from_
 SCCP_API void SCCP_CALL sccp_dev_keypadbutton(devicePtr d, char digit, uint8_t line, uint32_t callid);
 SCCP_API void SCCP_CALL sccp_dev_set_message(devicePtr d, const char *msg, const int timeout, const boolean_t storedb, const boolean_t beep);
 SCCP_API void SCCP_CALL sccp_dev_clear_message(devicePtr d, const boolean_t cleardb);
+SCCP_API uint32_t SCCP_CALL sccp_device_broadcastMessage(const char *msg, const int timeout, const boolean_t beep, int *queued);
+SCCP_API void SCCP_CALL sccp_device_clearBroadcastMessage(void);
+SCCP_API boolean_t SCCP_CALL sccp_device_getBroadcastStatus(uint32_t *id, int *queued, int *delivered, boolean_t *finished);
 SCCP_API void SCCP_CALL sccp_device_addMessageToStack(devicePtr device, const uint8_t priority, const char *message);
 SCCP_API void SCCP_CALL sccp_device_clearMessageFromStack(devicePtr device, const uint8_t priority);
 SCCP_API void SCCP_CALL sccp_device_featureChangedDisplay(const sccp_event_t * event);
@@ -420,7 +461,10 @@ SCCP_API int SCCP_CALL sccp_device_sendReset(devicePtr d, skinny_resetType_t res
 SCCP_API uint8_t SCCP_CALL sccp_device_find_index_for_line(constDevicePtr d, const char *lineName);
 SCCP_API uint8_t SCCP_CALL sccp_device_numberOfChannels(constDevicePtr device);
 SCCP_API boolean_t SCCP_CALL sccp_device_isVideoSupported(constDevicePtr device);
+SCCP_API void SCCP_CALL sccp_device_updateLinkQuality(devicePtr device, const sccp_call_statistics_t * const stats);
+SCCP_API boolean_t SCCP_CALL sccp_device_hasDegradedLink(constDevicePtr device);
 SCCP_API boolean_t SCCP_CALL sccp_device_check_update(devicePtr device);
+SCCP_API void SCCP_CALL sccp_device_schedulePendingUpdates(constDevicePtr device);
 SCCP_INLINE SCCP_CALL int16_t sccp_device_buttonIndex2lineInstance(constDevicePtr d, uint16_t buttonIndex);
 
 // find device
@@ -33,11 +33,73 @@ struct subscriptionId {
 	boolean_t replaceCid;											/*!< Should cidnumber be replaced instead of appended to, controled by the '=' subscription flag */
 };
 
+/*!
+ * \brief SCCP Call Quota (per line, device or context)
+ * \note limits are set by the configuration, the counters are maintained by sccp_quota.c under its own lock
+ */
+struct sccp_quota {
+	uint16_t maxcalls;											/*!< Maximum number of concurrent calls (0 = unlimited) */
+	uint16_t maxcallrate;											/*!< Maximum number of call setups per minute (0 = unlimited) */
+	uint16_t active;											/*!< Current number of calls charged */
+	uint16_t rateCount;											/*!< Number of call setups in the current rate window */
+	time_t rateWindow;											/*!< Start of the current rate window */
+	uint32_t rejected;											/*!< Number of call setups rejected by this quota */
+};
+
+/*!
+ * \brief SCCP Bandwidth Location (call admission control)
+ * \note configured by the 'location' entries in [general], the counters are maintained by sccp_cac.c under the list lock
+ */
+struct sccp_cac_location {
+	char name[SCCP_MAX_LABEL];										/*!< Location Name, referenced by the device 'location' setting */
+	uint32_t bandwidth;											/*!< Bandwidth budget in kbit/s (0 = unlimited) */
+	struct sccp_ha *ha;											/*!< Networks belonging to this location */
+	uint32_t used;												/*!< Bandwidth currently charged in kbit/s */
+	uint16_t calls;												/*!< Number of calls currently charged */
+	uint32_t downgraded;											/*!< Number of calls admitted with a cheaper codec */
+	uint32_t rejected;											/*!< Number of calls refused for lack of bandwidth */
+	SCCP_LIST_ENTRY (sccp_cac_location_t) list;
+};
+
+#define SCCP_HUNTGROUP_MAX_MEMBERS 64										/*!< one bit per member in sccp_huntgroup.available */
+
+/*!
+ * \brief SCCP Hunt Group Distribution
+ */
+typedef enum {
+	SCCP_HUNTGROUP_LINEAR = 0,										/*!< first free member in configured order */
+	SCCP_HUNTGROUP_CIRCULAR,										/*!< first free member after the one that got the previous call */
+	SCCP_HUNTGROUP_LONGESTIDLE,										/*!< free member that has been idle the longest */
+} sccp_huntgroup_strategy_t;
+
+/*!
+ * \brief SCCP Hunt Group
+ * \note configured by the 'huntgroup' entries in [general], the member state is maintained by sccp_huntgroup.c under the list lock
+ */
+struct sccp_huntgroup {
+	char name[SCCP_MAX_EXTENSION];										/*!< Hunt Group Name, dialed as SCCP/<name> */
+	sccp_huntgroup_strategy_t strategy;									/*!< Distribution */
+	uint8_t size;												/*!< Number of members */
+	uint8_t cursor;												/*!< Next member to try (circular) */
+	int8_t idleHead;											/*!< Longest idle free member (-1 = none) */
+	int8_t idleTail;											/*!< Most recently freed member (-1 = none) */
+	uint64_t available;											/*!< Bit per member: registered, without calls and not in dnd reject */
+	uint32_t calls;												/*!< Number of calls handed to a member */
+	uint32_t overflows;											/*!< Number of calls that found no free member */
+	struct {
+		char name[SCCP_MAX_EXTENSION];									/*!< Member Line Name */
+		int8_t prev;											/*!< Idle list (longest idle) */
+		int8_t next;
+	} members[SCCP_HUNTGROUP_MAX_MEMBERS];
+	SCCP_LIST_ENTRY (sccp_huntgroup_t) list;
+};
+
 /*!
  * \brief SCCP Global Variable Structure
  */
 struct sccp_global_vars {
 	int keepalive;												/*!< KeepAlive */
+	int reregister_grace;											/*!< Seconds a device stays warm after unregistering */
 	int32_t debug;												/*!< Debug */
 	int module_running;
 	pbx_rwlock_t lock;											/*!< Asterisk: Lock Me Up and Tie me Down */
@@ -68,6 +130,9 @@ struct sccp_global_vars {
 	struct sockaddr_storage bindaddr;									/*!< Bind IP Address */
 	struct sockaddr_storage secbindaddr;                                                                    /*!< Bind IP Address */
 	char * cert_file;
+#ifdef CS_EXPERIMENTAL
+	char * transport_faults;										/*!< Fault Injection Specification for the TCP Transport */
+#endif
 	struct sccp_ha *localaddr;										/*!< Localnet for Network Address Translation */
 
 	struct sockaddr_storage externip;									/*!< External IP Address (\todo should change to an array of external ip's, because externhost could resolv to multiple ip-addresses (h_addr_list)) */
@@ -88,6 +153,8 @@ struct sccp_global_vars {
 	skinny_tone_t callwaiting_tone;										/*!< Call Waiting Tone */
 
 	uint8_t callwaiting_interval;										/*!< Call Waiting Ring Interval */
+	boolean_t callback_autodial;										/*!< CallBack places the call again instead of notifying the caller */
+	int callback_timeout;											/*!< Seconds a CallBack stays pending */
 	uint8_t sccp_tos;											/*!< SCCP Socket Type of Service (TOS) (QOS) (Signaling) */
 	uint8_t audio_tos;											/*!< Audio Socket Type of Service (TOS) (QOS) (RTP) */
 	uint8_t video_tos;											/*!< Video Socket Type of Service (TOS) (QOS) (VRTP) */
@@ -106,12 +173,23 @@ struct sccp_global_vars {
 	boolean_t privacy;											/*!< Privacy Support (Length=2) */
 	boolean_t mwioncall;											/*!< MWI On Call Support (Boolean, default=on) */
 	boolean_t directrtp;											/*!< Direct RTP */
+	boolean_t autodirectrtp;										/*!< Decide Direct RTP per call */
 	boolean_t useoverlap;											/*!< Overlap Dial Support */
 	boolean_t transfer;											/*!< Transfer Feature Enabled */
 	boolean_t cfwdall;                                                                                      /*!< Call Forward All Support (Boolean, default=on) */
 	boolean_t cfwdbusy;                                                                                     /*!< Call Forward on Busy Support (Boolean, default=on) */
 	boolean_t cfwdnoanswer;                                                                                 /*!< Call Forward on No-Answer Support (Boolean, default=on) */
 	uint16_t cfwdnoanswer_timeout;                                                                          /*!< Call Forward on No-Answer timeout */
+	sccp_quota_t context_quota;										/*!< Call Quota applied to every dialplan context (limits only) */
+	SCCP_LIST_HEAD (, sccp_cac_location_t) cac_locations;							/*!< Bandwidth Locations for Call Admission Control */
+	SCCP_LIST_HEAD (, sccp_huntgroup_t) huntgroups;								/*!< Hunt Groups */
+	uint8_t callhistory_size;										/*!< Number of calls remembered per line (0 = disabled) */
+	boolean_t ctievents;											/*!< Publish state changes to webservice clients */
+	uint8_t textmessage_queuesize;										/*!< Number of text messages kept per device until it registers (0 = disabled) */
+	uint16_t textmessage_retention;										/*!< Seconds a queued text message is kept */
+	boolean_t adaptivecodecs;										/*!< Steer codec choice by measured link quality */
+	uint8_t adaptivecodecs_loss;										/*!< Packet loss (percent) marking a device link degraded */
+	uint16_t adaptivecodecs_jitter;										/*!< Jitter (ms) marking a device link degraded */
 	char *meetmeopts;											/*!< Meetme Options to be Used */
 #if HAVE_ICONV
 	char *iconvcodepage;											/*!< Iconv Codepage to use during conversion from UTF-8, for old phone models */
@@ -164,6 +242,9 @@ struct sccp_global_vars {
 	char *token_fallback;											/*!< Fall back immediatly on TokenReq (true/false/odd/even) */
 	int token_backoff_time;											/*!< Backoff time on TokenReject */
 	int server_priority;											/*!< Server Priority to fallback to */
+	char *replication;											/*!< Hot-standby replication role (off/primary/standby) */
+	struct sockaddr_storage replication_addr;								/*!< primary: standby to stream to, standby: primary to accept from (incl. port) */
+	char *replication_secret;									/*!< Shared secret for the replication hmac */
 
 	boolean_t reload_in_progress;										/*!< Reload in Progress */
 	boolean_t pendingUpdate;
@@ -35,11 +35,16 @@ SCCP_FILE_VERSION(__FILE__, "");
 #include "sccp_linedevice.h"
 #include "sccp_utils.h"
 #include "sccp_labels.h"
+#include "sccp_threadpool.h"
 
 #if defined(CS_AST_HAS_EVENT) && defined(HAVE_PBX_EVENT_H) 	// ast_event_subscribe
 #  include <asterisk/event.h>
 #endif
 
+#define SCCP_HINT_PERSIST_FAMILY "SCCP/hintstate"
+#define SCCP_HINT_PERSIST_MAXAGE 600										/*!< Seconds a persisted hint state stays plausible after a restart */
+#define SCCP_HINT_LINESTATE_BUCKETS 67										/*!< Number of buckets in the lineState lookup table (prime) */
+
 /* ========================================================================================================================= Struct Definitions */
 /*!
  *\brief SCCP Hint Subscribing Device Structure
@@ -77,6 +82,7 @@ struct sccp_hint_lineState
 	} callInfo;												/*!< Call Information Structure */
 
 	SCCP_LIST_ENTRY (struct sccp_hint_lineState) list;							/*!< Hint Type Linked List Entry */
+	SCCP_RWLIST_ENTRY (struct sccp_hint_lineState) lookup;							/*!< LineState Lookup Table Entry */
 };
 
 /*!
@@ -104,6 +110,7 @@ struct sccp_hint_list {
 	skinny_calltype_t calltype;										/*!< Skinny Call Type */
 
 	int stateid;												/*!< subscription id in asterisk */
+	boolean_t pendingRefresh;										/*!< state restored from the pbx database, live state still needs to be queried */
 #ifdef CS_USE_ASTERISK_DISTRIBUTED_DEVSTATE
 	PBX_EVENT_SUBSCRIPTION * device_state_sub; /*!< asterisk distributed device state subscription */
 #endif
@@ -128,6 +135,11 @@ static void sccp_hint_attachLine(sccp_line_t * line, sccp_device_t * device);
 static void sccp_hint_detachLine(sccp_line_t * line, sccp_device_t * device);
 static void sccp_hint_handleFeatureChangeEvent(const sccp_event_t * event);
 static void sccp_hint_eventListener(const sccp_event_t * event);
+static void sccp_hint_queryState(sccp_hint_list_t * hint);
+static void sccp_hint_applyState(sccp_hint_list_t * hint, enum ast_extension_states state);
+static boolean_t sccp_hint_restoreState(sccp_hint_list_t * hint);
+static void sccp_hint_persistStates(void);
+static void sccp_hint_scheduleRefresh(sccp_hint_list_t * hint);
 #ifdef CS_DYNAMIC_SPEEDDIAL
 static gcc_inline boolean_t sccp_hint_isCIDavailabe(const sccp_device_t * device, const uint8_t positionOnDevice);
 #endif
@@ -190,8 +202,40 @@ static void sccp_hint_distributed_devstate_cb(const pbx_event_t * event, void *d
 
 /* ========================================================================================================================= List Declarations */
 static SCCP_LIST_HEAD (, struct sccp_hint_lineState) lineStates;
+static SCCP_RWLIST_HEAD (, struct sccp_hint_lineState) lineStateTable[SCCP_HINT_LINESTATE_BUCKETS];	/*!< lineStates keyed by line name, read-locked per bucket on the query path */
 static SCCP_LIST_HEAD (, sccp_hint_list_t) sccp_hint_subscriptions;
 
+/*!
+ * \brief Get the lineStateTable bucket for a line name (case insensitive, like the line name comparison)
+ */
+gcc_inline static uint32_t sccp_hint_lineStateBucket(const char * linename)
+{
+	uint32_t hash = 2166136261U;										/* FNV-1a */
+
+	for (; *linename; linename++) {
+		hash = (hash ^ (uint8_t)tolower((unsigned char)*linename)) * 16777619U;
+	}
+	return hash % SCCP_HINT_LINESTATE_BUCKETS;
+}
+
+/*!
+ * \brief Find the lineState for a line in the lineStateTable
+ */
+static struct sccp_hint_lineState * sccp_hint_findLineState(const sccp_line_t * line)
+{
+	struct sccp_hint_lineState *lineState = NULL;
+	uint32_t bucket = sccp_hint_lineStateBucket(line->name);
+
+	SCCP_RWLIST_RDLOCK(&lineStateTable[bucket]);
+	SCCP_RWLIST_TRAVERSE(&lineStateTable[bucket], lineState, lookup) {
+		if (lineState->line == line) {
+			break;
+		}
+	}
+	SCCP_RWLIST_UNLOCK(&lineStateTable[bucket]);
+	return lineState;
+}
+
 /* ========================================================================================================================= Module Start/Stop */
 /*!
  * \brief starting hint-module
@@ -200,6 +244,9 @@ void sccp_hint_module_start(void)
 {
 	sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_2 "SCCP: Starting hint system\n");
 	SCCP_LIST_HEAD_INIT(&lineStates);
+	for (uint32_t bucket = 0; bucket < SCCP_HINT_LINESTATE_BUCKETS; bucket++) {
+		SCCP_RWLIST_HEAD_INIT(&lineStateTable[bucket]);
+	}
 	SCCP_LIST_HEAD_INIT(&sccp_hint_subscriptions);
 	sccp_event_subscribe(SCCP_EVENT_DEVICE_REGISTERED | SCCP_EVENT_DEVICE_ATTACHED | SCCP_EVENT_LINESTATUS_CHANGED, sccp_hint_eventListener, TRUE);
 	sccp_event_subscribe(SCCP_EVENT_DEVICE_UNREGISTERED | SCCP_EVENT_DEVICE_DETACHED, sccp_hint_eventListener, FALSE);
@@ -216,12 +263,17 @@ void sccp_hint_module_start(void)
 void sccp_hint_module_stop(void)
 {
 	sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_2 "SCCP: Stopping hint system\n");
+	sccp_hint_persistStates();
 	{
 		struct sccp_hint_lineState * lineState = NULL;
 
 		SCCP_LIST_LOCK(&lineStates);
 		while ((lineState = SCCP_LIST_REMOVE_HEAD(&lineStates, list))) {
 			if (lineState->line) {
+				uint32_t bucket = sccp_hint_lineStateBucket(lineState->line->name);
+				SCCP_RWLIST_WRLOCK(&lineStateTable[bucket]);
+				SCCP_RWLIST_REMOVE(&lineStateTable[bucket], lineState, lookup);
+				SCCP_RWLIST_UNLOCK(&lineStateTable[bucket]);
 				sccp_line_release(&lineState->line);		/* explicit release*/
 			}
 			sccp_free(lineState);
@@ -264,6 +316,9 @@ void sccp_hint_module_stop(void)
 	sccp_event_unsubscribe(SCCP_EVENT_FEATURE_CHANGED, sccp_hint_handleFeatureChangeEvent);
 
 	SCCP_LIST_HEAD_DESTROY(&lineStates);
+	for (uint32_t bucket = 0; bucket < SCCP_HINT_LINESTATE_BUCKETS; bucket++) {
+		SCCP_RWLIST_HEAD_DESTROY(&lineStateTable[bucket]);
+	}
 	SCCP_LIST_HEAD_DESTROY(&sccp_hint_subscriptions);
 }
 
@@ -383,6 +438,180 @@ static int sccp_hint_devstate_cb(char *context, char *id, enum ast_extension_sta
 	return 0;
 }
 
+/* ===================================================================================================================== Warm Restart */
+/*!
+ * \brief Query the current extension state from the pbx and notify the subscribers
+ * \param hint SCCP Hint Linked List Pointer
+ */
+static void sccp_hint_queryState(sccp_hint_list_t * hint)
+{
+	sccp_hint_applyState(hint, (enum ast_extension_states)pbx_extension_state(NULL, hint->context, hint->exten));
+}
+
+/*!
+ * \brief Apply an extension state queried from the pbx and notify the subscribers
+ * \param hint SCCP Hint Linked List Pointer
+ * \param state Extension State returned by pbx_extension_state
+ */
+static void sccp_hint_applyState(sccp_hint_list_t * hint, enum ast_extension_states state)
+{
+#if ASTERISK_VERSION_GROUP >= 111
+	struct ast_state_cb_info info;
+	info.exten_state = state;
+	sccp_hint_devstate_cb(hint->context, hint->exten, &info, hint);
+#else
+	sccp_hint_devstate_cb(hint->context, hint->exten, state, hint);
+#endif
+}
+
+/*!
+ * \brief Save the last known state of all hints to the pbx database, so that they can be restored after a restart
+ *
+ * Line states are not saved, they are derived from the sccp channels, which do not survive a restart.
+ */
+static void sccp_hint_persistStates(void)
+{
+	sccp_hint_list_t *hint = NULL;
+	char key[SCCP_MAX_EXTENSION + SCCP_MAX_CONTEXT + 2] = "";
+	char value[StationMaxNameSize + StationMaxDirnumSize + 40] = "";
+	int count = 0;
+
+	if (!iPbx.feature_addToDatabase || !iPbx.feature_removeTreeFromDatabase) {
+		return;
+	}
+	iPbx.feature_removeTreeFromDatabase("SCCP", "hintstate");
+
+	SCCP_LIST_LOCK(&sccp_hint_subscriptions);
+	SCCP_LIST_TRAVERSE(&sccp_hint_subscriptions, hint, list) {
+		char cidName[StationMaxNameSize] = "";
+		char cidNumber[StationMaxDirnumSize] = "";
+
+		if (hint->pendingRefresh) {									/* never got confirmed, don't pass it on */
+			continue;
+		}
+		if (hint->callInfo && hint->calltype != SKINNY_CALLTYPE_SENTINEL) {
+			if (hint->calltype == SKINNY_CALLTYPE_INBOUND) {
+				iCallInfo.Getter(hint->callInfo, SCCP_CALLINFO_CALLINGPARTY_NAME, &cidName, SCCP_CALLINFO_CALLINGPARTY_NUMBER, &cidNumber, SCCP_CALLINFO_KEY_SENTINEL);
+			} else {
+				iCallInfo.Getter(hint->callInfo, SCCP_CALLINFO_CALLEDPARTY_NAME, &cidName, SCCP_CALLINFO_CALLEDPARTY_NUMBER, &cidNumber, SCCP_CALLINFO_KEY_SENTINEL);
+			}
+		}
+		snprintf(key, sizeof(key), "%s@%s", hint->exten, hint->context);
+		snprintf(value, sizeof(value), "%jd|%d|%d|%s|%s", (intmax_t) time(NULL), hint->currentState, hint->calltype, cidNumber, cidName);
+		if (iPbx.feature_addToDatabase(SCCP_HINT_PERSIST_FAMILY, key, value)) {
+			count++;
+		}
+	}
+	SCCP_LIST_UNLOCK(&sccp_hint_subscriptions);
+	sccp_log((DEBUGCAT_HINT)) (VERBOSE_PREFIX_3 "SCCP: (hint_persistStates) Saved %d hint states\n", count);
+}
+
+/*!
+ * \brief Restore the state persisted by sccp_hint_persistStates, if it is recent enough
+ * \param hint SCCP Hint Linked List Pointer
+ * \return TRUE when a state was restored, the live state still needs to be queried (see sccp_hint_scheduleRefresh)
+ */
+static boolean_t sccp_hint_restoreState(sccp_hint_list_t * hint)
+{
+	char key[SCCP_MAX_EXTENSION + SCCP_MAX_CONTEXT + 2] = "";
+	char value[StationMaxNameSize + StationMaxDirnumSize + 40] = "";
+	char *splitter = value;
+
+	if (!iPbx.feature_getFromDatabase || !iPbx.feature_removeFromDatabase) {
+		return FALSE;
+	}
+	snprintf(key, sizeof(key), "%s@%s", hint->exten, hint->context);
+	if (!iPbx.feature_getFromDatabase(SCCP_HINT_PERSIST_FAMILY, key, value, sizeof(value))) {
+		return FALSE;
+	}
+	iPbx.feature_removeFromDatabase(SCCP_HINT_PERSIST_FAMILY, key);					/* consumed, the live state takes over from here */
+
+	const char *saved = strsep(&splitter, "|");
+	const char *state = strsep(&splitter, "|");
+	const char *calltype = strsep(&splitter, "|");
+	const char *cidNumber = strsep(&splitter, "|");
+	const char *cidName = splitter;									/* remainder, the name may contain a '|' */
+
+	if (!saved || !state || !calltype || !cidNumber || !cidName) {
+		return FALSE;
+	}
+	intmax_t age = (intmax_t) time(NULL) - strtoimax(saved, NULL, 10);
+	if (age < 0 || age > SCCP_HINT_PERSIST_MAXAGE) {
+		sccp_log((DEBUGCAT_HINT)) (VERBOSE_PREFIX_4 "%s (hint_restoreState) Ignoring persisted state, saved %jd seconds ago\n", hint->exten, age);
+		return FALSE;
+	}
+	hint->currentState = (sccp_channelstate_t) sccp_atoi(state, strlen(state));
+	hint->previousState = hint->currentState;
+	hint->calltype = (skinny_calltype_t) sccp_atoi(calltype, strlen(calltype));
+	if (hint->calltype == SKINNY_CALLTYPE_INBOUND) {
+		iCallInfo.Setter(hint->callInfo, SCCP_CALLINFO_CALLINGPARTY_NAME, cidName, SCCP_CALLINFO_CALLINGPARTY_NUMBER, cidNumber, SCCP_CALLINFO_KEY_SENTINEL);
+	} else if (hint->calltype != SKINNY_CALLTYPE_SENTINEL) {
+		iCallInfo.Setter(hint->callInfo, SCCP_CALLINFO_CALLEDPARTY_NAME, cidName, SCCP_CALLINFO_CALLEDPARTY_NUMBER, cidNumber, SCCP_CALLINFO_KEY_SENTINEL);
+	}
+	hint->pendingRefresh = TRUE;
+	sccp_log((DEBUGCAT_HINT)) (VERBOSE_PREFIX_3 "%s (hint_restoreState) Restored state %s for %s@%s (saved %jd seconds ago)\n", hint->exten, sccp_channelstate2str(hint->currentState), hint->exten, hint->context, age);
+	return TRUE;
+}
+
+/*!
+ * \brief Query the live state of a restored hint, in the background
+ * \param data hint key (exten@context), freed here
+ */
+static void *sccp_hint_refresh_thread(void *data)
+{
+	char *key = (char *) data;
+	char *context = key;
+	char *exten = strsep(&context, "@");
+	sccp_hint_list_t *hint = NULL;
+
+	if (GLOB(module_running) && exten && context) {
+		SCCP_LIST_LOCK(&sccp_hint_subscriptions);
+		SCCP_LIST_TRAVERSE(&sccp_hint_subscriptions, hint, list) {
+			if (hint->pendingRefresh && sccp_strequals(exten, hint->exten) && sccp_strequals(context, hint->context)) {
+				break;
+			}
+		}
+		SCCP_LIST_UNLOCK(&sccp_hint_subscriptions);
+	}
+	if (hint) {
+		/* query the pbx without holding the list lock, pbx_extension_state takes the dialplan locks */
+		enum ast_extension_states state = (enum ast_extension_states)pbx_extension_state(NULL, context, exten);
+
+		/* the hint may have been destroyed by sccp_hint_module_stop in the mean time, look it up again */
+		SCCP_LIST_LOCK(&sccp_hint_subscriptions);
+		SCCP_LIST_TRAVERSE(&sccp_hint_subscriptions, hint, list) {
+			if (hint->pendingRefresh && sccp_strequals(exten, hint->exten) && sccp_strequals(context, hint->context)) {
+				hint->pendingRefresh = FALSE;
+				sccp_hint_applyState(hint, state);
+				break;
+			}
+		}
+		SCCP_LIST_UNLOCK(&sccp_hint_subscriptions);
+	}
+	sccp_free(key);
+	return NULL;
+}
+
+/*!
+ * \brief Schedule the live query for a hint which was restored from the pbx database
+ * \param hint SCCP Hint Linked List Pointer
+ */
+static void sccp_hint_scheduleRefresh(sccp_hint_list_t * hint)
+{
+	char key[SCCP_MAX_EXTENSION + SCCP_MAX_CONTEXT + 2] = "";
+	char *data = NULL;
+
+	snprintf(key, sizeof(key), "%s@%s", hint->exten, hint->context);
+	if (GLOB(general_threadpool) && (data = pbx_strdup(key)) && sccp_threadpool_add_work(GLOB(general_threadpool), sccp_hint_refresh_thread, (void *) data)) {
+		return;
+	}
+	if (data) {
+		sccp_free(data);
+	}
+	hint->pendingRefresh = FALSE;										/* fallback to querying synchronously */
+	sccp_hint_queryState(hint);
+}
+
 /* ===================================================================================================================== SCCP Event Dispatchers */
 /*!
  * \brief Event Listener for Hints
@@ -563,6 +792,9 @@ static void sccp_hint_addSubscription4Device(const sccp_device_t * device, const
 		SCCP_LIST_LOCK(&sccp_hint_subscriptions);
 		SCCP_LIST_INSERT_HEAD(&sccp_hint_subscriptions, hint, list);
 		SCCP_LIST_UNLOCK(&sccp_hint_subscriptions);
+		if (hint->pendingRefresh) {
+			sccp_hint_scheduleRefresh(hint);
+		}
 	}
 
 	/* add subscribing device */
@@ -670,16 +902,11 @@ static sccp_hint_list_t *sccp_hint_create(char *hint_exten, char *hint_context)
 #endif
 #endif
 
-	/* force hint update to get currentState */
-#if ASTERISK_VERSION_GROUP >= 111
-	struct ast_state_cb_info info;
-	info.exten_state = (enum ast_extension_states)pbx_extension_state(NULL, hint->context, hint->exten);
-	sccp_hint_devstate_cb(hint->context, hint->exten, &info, hint);
-#else
-	enum ast_extension_states state = pbx_extension_state(NULL, hint->context, hint->exten);
-
-	sccp_hint_devstate_cb(hint->context, hint->exten, state, hint);
-#endif
+	/* warm restart: start from the state persisted at shutdown, the caller schedules the live query */
+	if (!sccp_hint_restoreState(hint)) {
+		/* force hint update to get currentState */
+		sccp_hint_queryState(hint);
+	}
 	return hint;
 }
 
@@ -689,11 +916,7 @@ static void sccp_hint_attachLine(sccp_line_t * line, sccp_device_t * device)
 	struct sccp_hint_lineState *lineState = NULL;
 
 	SCCP_LIST_LOCK(&lineStates);
-	SCCP_LIST_TRAVERSE(&lineStates, lineState, list) {
-		if (lineState->line == line) {
-			break;
-		}
-	}
+	lineState = sccp_hint_findLineState(line);
 	if (!lineState) {		/* create new lineState if necessary */
 		sccp_log((DEBUGCAT_HINT)) (VERBOSE_PREFIX_3 "%s (hint_attachLine) Create new hint_lineState for line: %s\n", DEV_ID_LOG(device), line->name);
 		lineState = (struct sccp_hint_lineState *) sccp_calloc(sizeof *lineState, 1);
@@ -702,12 +925,15 @@ static void sccp_hint_attachLine(sccp_line_t * line, sccp_device_t * device)
 			SCCP_LIST_UNLOCK(&lineStates);
 			return;
 		}
-		SCCP_LIST_INSERT_HEAD(&lineStates, lineState, list);
-	}
-
-	if (!lineState->line) {		/* retain one instance of line in lineState->line */
+		/* retain one instance of line in lineState->line */
 		//sccp_log((DEBUGCAT_HINT)) (VERBOSE_PREFIX_4 "%s (hint_attachLine) attaching line: %s\n", DEV_ID_LOG(device), line->name);
 		lineState->line = sccp_line_retain(line);
+		SCCP_LIST_INSERT_HEAD(&lineStates, lineState, list);
+
+		uint32_t bucket = sccp_hint_lineStateBucket(line->name);
+		SCCP_RWLIST_WRLOCK(&lineStateTable[bucket]);
+		SCCP_RWLIST_INSERT_HEAD(&lineStateTable[bucket], lineState, lookup);
+		SCCP_RWLIST_UNLOCK(&lineStateTable[bucket]);
 	}
 	SCCP_LIST_UNLOCK(&lineStates);
 
@@ -724,18 +950,16 @@ static void sccp_hint_detachLine(sccp_line_t * line, sccp_device_t * device)
 		if (line->statistic.numberOfActiveDevices == 0) {		/* release last instance of lineState->line */
 			//sccp_log((DEBUGCAT_HINT)) (VERBOSE_PREFIX_3 "%s (hint_detachLine) detaching line: %s, \n", DEV_ID_LOG(device), line->name);
 			SCCP_LIST_LOCK(&lineStates);
-			SCCP_LIST_TRAVERSE_SAFE_BEGIN(&lineStates, lineState, list) {
-				if (lineState->line == line) {
-					//sccp_log((DEBUGCAT_HINT)) (VERBOSE_PREFIX_4 "%s (hint_detachLine) line: %s detached\n", DEV_ID_LOG(device), line->name);
-					if (lineState->line) {
-						sccp_line_release(&lineState->line);		/* explicit release*/
-					}
-					SCCP_LIST_REMOVE_CURRENT(list);
-					sccp_free(lineState)
-					break;
-				}
+			if ((lineState = sccp_hint_findLineState(line))) {
+				//sccp_log((DEBUGCAT_HINT)) (VERBOSE_PREFIX_4 "%s (hint_detachLine) line: %s detached\n", DEV_ID_LOG(device), line->name);
+				uint32_t bucket = sccp_hint_lineStateBucket(line->name);
+				SCCP_RWLIST_WRLOCK(&lineStateTable[bucket]);
+				SCCP_RWLIST_REMOVE(&lineStateTable[bucket], lineState, lookup);
+				SCCP_RWLIST_UNLOCK(&lineStateTable[bucket]);
+				SCCP_LIST_REMOVE(&lineStates, lineState, list);
+				sccp_line_release(&lineState->line);		/* explicit release*/
+				sccp_free(lineState);
 			}
-			SCCP_LIST_TRAVERSE_SAFE_END;
 			SCCP_LIST_UNLOCK(&lineStates);
 		}
 	}
@@ -749,16 +973,8 @@ static void sccp_hint_detachLine(sccp_line_t * line, sccp_device_t * device)
  */
 static void sccp_hint_lineStatusChanged(sccp_line_t * line, sccp_channelstate_t state)
 {
-	struct sccp_hint_lineState *lineState = NULL;
+	struct sccp_hint_lineState *lineState = sccp_hint_findLineState(line);
 
-	SCCP_LIST_LOCK(&lineStates);
-	SCCP_LIST_TRAVERSE(&lineStates, lineState, list) {
-		if (lineState->line == line) {
-			break;
-		}
-	}
-	SCCP_LIST_UNLOCK(&lineStates);
-	
 	if (lineState && lineState->line) {
 		sccp_hint_updateLineState(lineState, state);
 	}
@@ -1489,8 +1705,13 @@ sccp_channelstate_t sccp_hint_getLinestate(const char *linename, const char *dev
 	struct sccp_hint_lineState *lineState = NULL;
 	sccp_channelstate_t state = SCCP_CHANNELSTATE_CONGESTION;
 
-	SCCP_LIST_LOCK(&lineStates);
-	SCCP_LIST_TRAVERSE(&lineStates, lineState, list) {
+	if (sccp_strlen_zero(linename)) {
+		return state;
+	}
+	uint32_t bucket = sccp_hint_lineStateBucket(linename);
+
+	SCCP_RWLIST_RDLOCK(&lineStateTable[bucket]);
+	SCCP_RWLIST_TRAVERSE(&lineStateTable[bucket], lineState, lookup) {
 		if (lineState->line && sccp_strcaseequals(lineState->line->name, linename)) {
                 	sccp_log(DEBUGCAT_HINT)(VERBOSE_PREFIX_3 "%s (getLinestate) state:%s, party:%s/%s, calltype:%s\n", lineState->line->name, sccp_channelstate2str(lineState->state),
                 	        lineState->callInfo.partyNumber,lineState->callInfo.partyName,
@@ -1499,7 +1720,7 @@ sccp_channelstate_t sccp_hint_getLinestate(const char *linename, const char *dev
 			break;
 		}
 	}
-	SCCP_LIST_UNLOCK(&lineStates);
+	SCCP_RWLIST_UNLOCK(&lineStateTable[bucket]);
 	return state;
 }
 
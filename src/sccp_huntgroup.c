@@ -0,0 +1,341 @@
+/*!
+ * \file        sccp_huntgroup.c
+ * \brief       SCCP Hunt Group
+ * \note        Hunt groups are dialed as SCCP/<name> and hand each call to one free member line (linear, circular or
+ *              longest idle). Which members are free is kept up to date from the line state (channels added / removed,
+ *              devices attached / detached, dnd toggled), so picking a member is a bit scan or a list head instead of a device
+ *              state query per member. A member that turns out to be stale when picked is dropped and the next one
+ *              is tried.
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#include "config.h"
+#include "common.h"
+#include "sccp_huntgroup.h"
+#include "sccp_device.h"
+#include "sccp_line.h"
+#include "sccp_linedevice.h"
+#include "sccp_utils.h"
+
+SCCP_FILE_VERSION(__FILE__, "");
+
+static void sccp_huntgroup_eventListener(const sccp_event_t * event);
+
+void sccp_huntgroup_module_start(void)
+{
+	SCCP_LIST_HEAD_INIT(&GLOB(huntgroups));
+	sccp_event_subscribe(SCCP_EVENT_DEVICE_ATTACHED | SCCP_EVENT_DEVICE_DETACHED | SCCP_EVENT_FEATURE_CHANGED, sccp_huntgroup_eventListener, TRUE);
+}
+
+void sccp_huntgroup_module_stop(void)
+{
+	sccp_huntgroup_t * huntgroup = NULL;
+
+	sccp_event_unsubscribe(SCCP_EVENT_DEVICE_ATTACHED | SCCP_EVENT_DEVICE_DETACHED | SCCP_EVENT_FEATURE_CHANGED, sccp_huntgroup_eventListener);
+	SCCP_LIST_LOCK(&GLOB(huntgroups));
+	while ((huntgroup = SCCP_LIST_REMOVE_HEAD(&GLOB(huntgroups), list))) {
+		sccp_free(huntgroup);
+	}
+	SCCP_LIST_UNLOCK(&GLOB(huntgroups));
+	SCCP_LIST_HEAD_DESTROY(&GLOB(huntgroups));
+}
+
+int sccp_huntgroup_str2strategy(const char * str)
+{
+	if (sccp_strcaseequals(str, "linear")) {
+		return SCCP_HUNTGROUP_LINEAR;
+	}
+	if (sccp_strcaseequals(str, "circular")) {
+		return SCCP_HUNTGROUP_CIRCULAR;
+	}
+	if (sccp_strcaseequals(str, "longestidle")) {
+		return SCCP_HUNTGROUP_LONGESTIDLE;
+	}
+	return -1;
+}
+
+const char * sccp_huntgroup_strategy2str(sccp_huntgroup_strategy_t strategy)
+{
+	switch (strategy) {
+		case SCCP_HUNTGROUP_CIRCULAR:
+			return "circular";
+		case SCCP_HUNTGROUP_LONGESTIDLE:
+			return "longestidle";
+		case SCCP_HUNTGROUP_LINEAR:
+		default:
+			return "linear";
+	}
+}
+
+/*!
+ * \brief Mark a member free / taken, keeping the idle list in the order the members became free
+ * \note GLOB(huntgroups) needs to be locked
+ */
+static void sccp_huntgroup_setAvailable(sccp_huntgroup_t * const huntgroup, int8_t idx, boolean_t available)
+{
+	uint64_t bit = 1ULL << idx;
+
+	if (available == ((huntgroup->available & bit) ? TRUE : FALSE)) {
+		return;
+	}
+	if (available) {
+		huntgroup->available |= bit;
+		huntgroup->members[idx].prev = huntgroup->idleTail;
+		huntgroup->members[idx].next = -1;
+		if (huntgroup->idleTail >= 0) {
+			huntgroup->members[huntgroup->idleTail].next = idx;
+		} else {
+			huntgroup->idleHead = idx;
+		}
+		huntgroup->idleTail = idx;
+	} else {
+		huntgroup->available &= ~bit;
+		if (huntgroup->members[idx].prev >= 0) {
+			huntgroup->members[huntgroup->members[idx].prev].next = huntgroup->members[idx].next;
+		} else {
+			huntgroup->idleHead = huntgroup->members[idx].next;
+		}
+		if (huntgroup->members[idx].next >= 0) {
+			huntgroup->members[huntgroup->members[idx].next].prev = huntgroup->members[idx].prev;
+		} else {
+			huntgroup->idleTail = huntgroup->members[idx].prev;
+		}
+		huntgroup->members[idx].prev = huntgroup->members[idx].next = -1;
+	}
+}
+
+/*!
+ * \brief Start a (new) hunt group with all members free, in configured order
+ * \note members are validated when they are picked, the ones that are not registered or busy are dropped at that point
+ */
+void sccp_huntgroup_initMembers(sccp_huntgroup_t * const huntgroup)
+{
+	huntgroup->available = 0;
+	huntgroup->idleHead = huntgroup->idleTail = -1;
+	huntgroup->cursor = 0;
+	for (int8_t x = 0; x < huntgroup->size; x++) {
+		sccp_huntgroup_setAvailable(huntgroup, x, TRUE);
+	}
+}
+
+/*!
+ * \brief Next free member according to the distribution
+ * \return member index or -1 when no member is free
+ * \note GLOB(huntgroups) needs to be locked
+ */
+static int8_t sccp_huntgroup_pick(const sccp_huntgroup_t * const huntgroup)
+{
+	uint64_t after = 0;
+
+	if (!huntgroup->available) {
+		return -1;
+	}
+	switch (huntgroup->strategy) {
+		case SCCP_HUNTGROUP_CIRCULAR:
+			after = huntgroup->available & (~0ULL << huntgroup->cursor);
+			return __builtin_ctzll(after ? after : huntgroup->available);
+		case SCCP_HUNTGROUP_LONGESTIDLE:
+			return huntgroup->idleHead;
+		case SCCP_HUNTGROUP_LINEAR:
+		default:
+			return __builtin_ctzll(huntgroup->available);
+	}
+}
+
+/*!
+ * \brief Find hunt group 'name'
+ * \note GLOB(huntgroups) needs to be locked
+ */
+static sccp_huntgroup_t * sccp_huntgroup_find(const char * name)
+{
+	sccp_huntgroup_t * huntgroup = NULL;
+
+	SCCP_LIST_TRAVERSE(&GLOB(huntgroups), huntgroup, list) {
+		if (sccp_strcaseequals(huntgroup->name, name)) {
+			break;
+		}
+	}
+	return huntgroup;
+}
+
+/*!
+ * \brief A line can take a hunt group call when it has no channels and at least one of its devices does not reject calls (dnd)
+ *
+ * \lock
+ *  - line->devices
+ */
+static boolean_t sccp_huntgroup_lineIsFree(constLinePtr line)
+{
+	sccp_linedevice_t * ld = NULL;
+	boolean_t isFree = FALSE;
+
+	AUTO_RELEASE(sccp_line_t, l, sccp_line_retain(line));
+	if (!l || SCCP_LIST_GETSIZE(&l->channels) > 0) {
+		return FALSE;
+	}
+	SCCP_LIST_LOCK(&l->devices);
+	SCCP_LIST_TRAVERSE(&l->devices, ld, list) {
+		if (ld->device && !(ld->device->dndFeature.enabled && ld->device->dndFeature.status == SCCP_DNDMODE_REJECT)) {
+			isFree = TRUE;
+			break;
+		}
+	}
+	SCCP_LIST_UNLOCK(&l->devices);
+	return isFree;
+}
+
+/*!
+ * \brief Select the member line that should receive a call to hunt group 'name'
+ * \param name Hunt Group Name
+ * \param isHuntgroup set to TRUE when name is a hunt group
+ * \return *retained* line, NULL when name is not a hunt group or none of its members is free
+ *
+ * \note the selected member is marked taken straight away, it becomes free again when its line has no channels left
+ * \note the picked member is checked outside of the huntgroups lock, a member that turns out to be busy, unregistered or in
+ *       dnd stays taken and the next one is picked
+ *
+ * \lock
+ *  - huntgroups
+ *  - see sccp_huntgroup_lineIsFree()
+ */
+sccp_line_t * sccp_huntgroup_select(const char * name, boolean_t * const isHuntgroup)
+{
+	sccp_huntgroup_t * huntgroup = NULL;
+	sccp_line_t * line = NULL;
+	char member[SCCP_MAX_EXTENSION] = "";
+	int8_t idx = -1;
+
+	*isHuntgroup = FALSE;
+	if (SCCP_LIST_EMPTY(&GLOB(huntgroups))) {
+		return NULL;
+	}
+	do {
+		SCCP_LIST_LOCK(&GLOB(huntgroups));
+		if ((huntgroup = sccp_huntgroup_find(name))) {
+			*isHuntgroup = TRUE;
+			if (line) {
+				huntgroup->calls++;
+			} else if ((idx = sccp_huntgroup_pick(huntgroup)) >= 0) {
+				sccp_huntgroup_setAvailable(huntgroup, idx, FALSE);
+				huntgroup->cursor = (idx + 1) % huntgroup->size;
+				sccp_copy_string(member, huntgroup->members[idx].name, sizeof(member));
+			} else {
+				huntgroup->overflows++;
+			}
+		}
+		SCCP_LIST_UNLOCK(&GLOB(huntgroups));
+		if (!huntgroup || line || idx < 0) {
+			break;
+		}
+		if ((line = sccp_line_find_byname(member, FALSE)) && !sccp_huntgroup_lineIsFree(line)) {
+			sccp_log((DEBUGCAT_PBX))(VERBOSE_PREFIX_3 "SCCP: Hunt Group %s skipping member %s\n", name, member);
+			sccp_line_release(&line);							// freed again by sccp_huntgroup_lineChanged
+		}
+	} while (TRUE);
+	if (!huntgroup && line) {										// hunt group removed by a reload in the meantime
+		sccp_huntgroup_lineChanged(line);
+		sccp_line_release(&line);
+	}
+
+	if (*isHuntgroup) {
+		sccp_log((DEBUGCAT_PBX))(VERBOSE_PREFIX_3 "SCCP: Hunt Group %s -> %s\n", name, line ? line->name : "no free member");
+	}
+	return line;
+}
+
+/*!
+ * \brief Update the members for this line after its channels, devices or their dnd state changed
+ *
+ * \lock
+ *  - huntgroups
+ */
+void sccp_huntgroup_lineChanged(constLinePtr l)
+{
+	sccp_huntgroup_t * huntgroup = NULL;
+
+	if (!l || SCCP_LIST_EMPTY(&GLOB(huntgroups))) {
+		return;
+	}
+	boolean_t available = sccp_huntgroup_lineIsFree(l);
+
+	SCCP_LIST_LOCK(&GLOB(huntgroups));
+	SCCP_LIST_TRAVERSE(&GLOB(huntgroups), huntgroup, list) {
+		for (int8_t x = 0; x < huntgroup->size; x++) {
+			if (sccp_strcaseequals(huntgroup->members[x].name, l->name)) {
+				sccp_huntgroup_setAvailable(huntgroup, x, available);
+			}
+		}
+	}
+	SCCP_LIST_UNLOCK(&GLOB(huntgroups));
+}
+
+static void sccp_huntgroup_eventListener(const sccp_event_t * event)
+{
+	if (!event) {
+		return;
+	}
+	switch (event->type) {
+		case SCCP_EVENT_DEVICE_ATTACHED:
+		case SCCP_EVENT_DEVICE_DETACHED:
+			if (event->deviceAttached.ld) {
+				sccp_huntgroup_lineChanged(event->deviceAttached.ld->line);
+			}
+			break;
+		case SCCP_EVENT_FEATURE_CHANGED:
+			if (event->featureChanged.featureType == SCCP_FEATURE_DND) {
+				sccp_device_t * d = event->featureChanged.device;				// already retained in the event
+				for (uint8_t instance = SCCP_FIRST_LINEINSTANCE; instance < d->lineButtons.size; instance++) {
+					if (d->lineButtons.instance[instance]) {
+						sccp_huntgroup_lineChanged(d->lineButtons.instance[instance]->line);
+					}
+				}
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/*!
+ * \brief Show Hunt Groups
+ * \param fd Fd as int
+ * \param totals Total number of lines as int
+ * \param s AMI Session
+ * \param m Message
+ * \param argc Argc as int
+ * \param argv[] Argv[] as char
+ * \return Result as int
+ *
+ * \called_from_asterisk
+ */
+#include <asterisk/cli.h>
+int sccp_show_huntgroups(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[])
+{
+	int local_line_total = 0;
+	int local_table_total = 0;
+
+#define CLI_AMI_TABLE_NAME Huntgroups
+#define CLI_AMI_TABLE_PER_ENTRY_NAME Huntgroup
+#define CLI_AMI_TABLE_LIST_ITER_HEAD &GLOB(huntgroups)
+#define CLI_AMI_TABLE_LIST_ITER_TYPE sccp_huntgroup_t
+#define CLI_AMI_TABLE_LIST_ITER_VAR huntgroup
+#define CLI_AMI_TABLE_LIST_LOCK SCCP_LIST_LOCK
+#define CLI_AMI_TABLE_LIST_ITERATOR SCCP_LIST_TRAVERSE
+#define CLI_AMI_TABLE_LIST_UNLOCK SCCP_LIST_UNLOCK
+#define CLI_AMI_TABLE_FIELDS 															\
+ 		CLI_AMI_TABLE_FIELD(Name,		"-20.20",	s,	20,	huntgroup->name)					\
+ 		CLI_AMI_TABLE_FIELD(Strategy,		"-11.11",	s,	11,	sccp_huntgroup_strategy2str(huntgroup->strategy))	\
+ 		CLI_AMI_TABLE_FIELD(Members,		"-7",		d,	7,	huntgroup->size)					\
+ 		CLI_AMI_TABLE_FIELD(Free,		"-4",		d,	4,	__builtin_popcountll(huntgroup->available))		\
+ 		CLI_AMI_TABLE_FIELD(Calls,		"-8",		d,	8,	huntgroup->calls)					\
+ 		CLI_AMI_TABLE_FIELD(Overflows,		"-9",		d,	9,	huntgroup->overflows)
+#include "sccp_cli_table.h"
+	local_table_total++;
+
+	if (s) {
+		totals->lines = local_line_total;
+		totals->tables = local_table_total;
+	}
+	return RESULT_SUCCESS;
+}
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
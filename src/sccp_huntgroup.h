@@ -0,0 +1,21 @@
+/*!
+ * \file        sccp_huntgroup.h
+ * \brief       SCCP Hunt Group Header
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#pragma once
+#include "sccp_cli.h"
+
+__BEGIN_C_EXTERN__
+SCCP_API void SCCP_CALL sccp_huntgroup_module_start(void);
+SCCP_API void SCCP_CALL sccp_huntgroup_module_stop(void);
+SCCP_API int SCCP_CALL sccp_huntgroup_str2strategy(const char * str);
+SCCP_API const char * SCCP_CALL sccp_huntgroup_strategy2str(sccp_huntgroup_strategy_t strategy);
+SCCP_API void SCCP_CALL sccp_huntgroup_initMembers(sccp_huntgroup_t * const huntgroup);
+SCCP_API sccp_line_t * SCCP_CALL sccp_huntgroup_select(const char * name, boolean_t * const isHuntgroup);
+SCCP_API void SCCP_CALL sccp_huntgroup_lineChanged(constLinePtr l);
+
+SCCP_API int SCCP_CALL sccp_show_huntgroups(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[]);
+__END_C_EXTERN__
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
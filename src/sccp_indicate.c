@@ -291,6 +291,7 @@ void __sccp_indicate (constDevicePtr maybe_device, channelPtr c, const sccp_chan
 				c->setTone(c, SKINNY_TONE_LINEBUSYTONE, SKINNY_TONEDIRECTION_USER);
 			}
 				sccp_dev_displayprompt(d, lineInstance, c->callid, SKINNY_DISP_BUSY, GLOB(digittimeout));
+				sccp_dev_set_keyset(d, lineInstance, c->callid, KEYMODE_RINGOUT);			/* offers callback (camp-on busy) and endcall */
 			}
 			break;
 		case SCCP_CHANNELSTATE_HOLD:
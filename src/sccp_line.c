@@ -12,11 +12,13 @@
 
 #include "config.h"
 #include "common.h"
+#include "sccp_callhistory.h"
 #include "sccp_channel.h"
 #include "sccp_device.h"
 #include "sccp_line.h"
 #include "sccp_config.h"
 #include "sccp_feature.h"
+#include "sccp_huntgroup.h"
 #include "sccp_linedevice.h"
 #include "sccp_mwi.h"
 #include "sccp_utils.h"
@@ -313,6 +315,9 @@ int __sccp_line_destroy(const void *ptr)
 		sccp_free(l->regcontext);
 	}
 
+	// cleanup call history
+	sccp_callhistory_destroy(&l->callhistory);
+
 	// destroy attached channels (if any / should be none)
 	SCCP_LIST_LOCK(&l->channels);
 	sccp_channel_t *channel;
@@ -531,6 +536,7 @@ void sccp_line_addChannel(constLinePtr line, constChannelPtr channel)
 			}
 		}
 		SCCP_LIST_UNLOCK(&l->channels);
+		sccp_huntgroup_lineChanged(l);
 	}
 }
 
@@ -564,6 +570,7 @@ void sccp_line_removeChannel(constLinePtr line, sccp_channel_t * channel)
 			sccp_channel_release(&c);					/* explicit release of channel from list */
 		}
 		SCCP_LIST_UNLOCK(&l->channels);
+		sccp_huntgroup_lineChanged(l);
 	}
 }
 
@@ -16,6 +16,7 @@
 #include "sccp_line.h"
 #	include "sccp_linedevice.h"
 #	include "sccp_management.h"
+#	include "sccp_provision.h"
 #	include "sccp_session.h"
 #	include "sccp_utils.h"
 #	include "sccp_labels.h"
@@ -180,6 +181,7 @@ static const char * deviceAddLine_command = "SCCPDeviceAddLine";
 static const char * configMetaData_command = "SCCPConfigMetaData";
 static const char * deviceRestart_command = "SCCPDeviceRestart";
 static const char * deviceSetDND_command = "SCCPDeviceSetDND";
+static const char * provision_command = "SCCPProvision";
 
 /* old */
 static int sccp_manager_show_devices(struct mansession * s, const struct message * m);
@@ -240,6 +242,7 @@ int sccp_register_management(void)
 	result |= iPbx.register_manager(configMetaData_command, _MAN_FLAGS, sccp_manager_config_metadata, NULL, NULL);
 	result |= iPbx.register_manager(deviceRestart_command, _MAN_FLAGS, sccp_manager_restart_device, NULL, NULL);
 	result |= iPbx.register_manager(deviceSetDND_command, _MAN_FLAGS, sccp_manager_device_set_dnd, NULL, NULL);
+	result |= iPbx.register_manager(provision_command, _MAN_FLAGS, sccp_manager_provision, NULL, NULL);
 #	undef _MAN_FLAGS
 
 #	if HAVE_PBX_MANAGER_HOOK_H
@@ -276,6 +279,7 @@ int sccp_unregister_management(void)
 	result |= pbx_manager_unregister(configMetaData_command);
 	result |= pbx_manager_unregister(deviceRestart_command);
 	result |= pbx_manager_unregister(deviceSetDND_command);
+	result |= pbx_manager_unregister(provision_command);
 #	if HAVE_PBX_MANAGER_HOOK_H
 	if (hook_registered) {
 		ast_manager_unregister_hook(&sccp_manager_hook);
@@ -574,9 +578,10 @@ static int sccp_manager_device_add_line(struct mansession *s, const struct messa
 		return 0;
 	}
 	if (sccp_config_addButton(&d->buttonconfig, -1, LINE, line->name, NULL, NULL) == SCCP_CONFIG_CHANGE_CHANGED) {
-		d->pendingUpdate = 1;
-		sccp_config_addButton(&d->buttonconfig, -1, LINE, line->name, NULL, NULL);
-		sccp_device_check_update(d);
+		if (!sccp_handle_button_template_refresh(d)) {
+			d->pendingUpdate = 1;
+			sccp_device_schedulePendingUpdates(d);
+		}
 		astman_append(s, "Done\r\n");
 		astman_append(s, "\r\n");
 	} else {
@@ -704,7 +709,9 @@ static int sccp_manager_device_update(struct mansession *s, const struct message
 
 	sccp_handle_soft_key_template_req(d->session, d, NULL);
 
-	sccp_handle_button_template_req(d->session, d, NULL);
+	if (!sccp_handle_button_template_refresh(d)) {
+		sccp_handle_button_template_req(d->session, d, NULL);					/* could not refresh in place, resend the template as before */
+	}
 
 	astman_send_ack(s, m, "Done");
 	return 0;
@@ -16,6 +16,7 @@
 #include "sccp_device.h"
 #include "sccp_conference.h"
 #include "sccp_feature.h"
+#include "sccp_huntgroup.h"
 #include "sccp_line.h"
 #include "sccp_utils.h"
 #include "sccp_indicate.h"
@@ -58,13 +59,23 @@ sccp_channel_request_status_t sccp_requestChannel(const char * lineName, sccp_au
 	};
 
 	AUTO_RELEASE(sccp_line_t, l, sccp_line_find_byname(mainId, FALSE));
+	boolean_t isHuntgroup = FALSE;
 	if (!l) {
-		sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "SCCP/%s does not exist!\n", mainId);
-		return SCCP_REQUEST_STATUS_LINEUNKNOWN;
+		if (!(l = sccp_huntgroup_select(mainId, &isHuntgroup))) {
+			if (isHuntgroup) {
+				sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "SCCP/%s has no free member.\n", mainId);
+				return SCCP_REQUEST_STATUS_LINEUNAVAIL;
+			}
+			sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "SCCP/%s does not exist!\n", mainId);
+			return SCCP_REQUEST_STATUS_LINEUNKNOWN;
+		}
 	}
 	sccp_log_and((DEBUGCAT_CORE + DEBUGCAT_HIGH)) (VERBOSE_PREFIX_1 "[SCCP] in file %s, line %d (%s)\n", __FILE__, __LINE__, __PRETTY_FUNCTION__);
 	if (SCCP_RWLIST_GETSIZE(&l->devices) == 0) {
 		sccp_log((DEBUGCAT_DEVICE + DEBUGCAT_LINE)) (VERBOSE_PREFIX_3 "SCCP/%s isn't currently registered anywhere.\n", l->name);
+		if (isHuntgroup) {
+			sccp_huntgroup_lineChanged(l);							// hand the hunt group member back
+		}
 		return SCCP_REQUEST_STATUS_LINEUNAVAIL;
 	}
 	sccp_log_and((DEBUGCAT_CORE + DEBUGCAT_HIGH)) (VERBOSE_PREFIX_1 "[SCCP] in file %s, line %d (%s)\n", __FILE__, __LINE__, __PRETTY_FUNCTION__);
@@ -74,6 +85,7 @@ sccp_channel_request_status_t sccp_requestChannel(const char * lineName, sccp_au
 	/* on multiline phone we set the line when answering or switching lines */
 	AUTO_RELEASE(sccp_channel_t, my_sccp_channel, sccp_channel_allocate(l, NULL));
 	if (!my_sccp_channel) {
+		sccp_huntgroup_lineChanged(l);								// hand a hunt group member back
 		return SCCP_REQUEST_STATUS_ERROR;
 	}
 
@@ -258,6 +270,7 @@ int sccp_pbx_call(channelPtr c, const char * dest, int timeout)
 	}
 	boolean_t isRinging = FALSE;
 	boolean_t isBusy = FALSE;
+	boolean_t noBandwidth = FALSE;
 	boolean_t bypassCallForward = !sccp_strlen_zero(pbx_builtin_getvar_helper(c->owner, "BYPASS_CFWD"));
 	sccp_linedevice_t * ForwardingLineDevice = NULL;
 
@@ -341,6 +354,14 @@ int sccp_pbx_call(channelPtr c, const char * dest, int timeout)
 			continue;
 		}
 
+		/* call admission control, bandwidth is reserved per location while ringing and handed to the device that answers */
+		if (!sccp_channel_reserveBandwidth(c, ld->device)) {
+			sccp_dev_displayprompt(ld->device, ld->lineInstance, c->callid, SKINNY_DISP_NOT_ENOUGH_BANDWIDTH, SCCP_DISPLAYSTATUS_TIMEOUT);
+			noBandwidth = TRUE;
+			c->subscribers--;
+			continue;
+		}
+
 		if (active_channel) {
 			sccp_indicate(ld->device, c, SCCP_CHANNELSTATE_CALLWAITING);
 			/* display the new call on prompt */
@@ -426,6 +447,9 @@ int sccp_pbx_call(channelPtr c, const char * dest, int timeout)
 		pbx_channel_set_hangupcause(c->owner, AST_CAUSE_BUSY);
 		res = 0;
 	} else {
+		if (noBandwidth) {
+			pbx_channel_set_hangupcause(c->owner, AST_CAUSE_BEARERCAPABILITY_NOTAVAIL);
+		}
 		iPbx.queue_control(c->owner, AST_CONTROL_CONGESTION);
 		res = -1;
 	}
@@ -510,6 +534,54 @@ int sccp_pbx_cfwdnoanswer_cb(const void * data)
 	return 0;
 }
 
+/*!
+ * \brief Completion Action registered by sccp_pbx_hangup, closes the receive channel once its OpenReceiveChannel was answered or timed out
+ * \param data callid of the hungup channel
+ */
+static void sccp_pbx_hangup_closeReceiveChannel(constSessionPtr session, uint32_t passThruPartyId, boolean_t completed, void *data)
+{
+	uint32_t callReference = (uint32_t)(uintptr_t) data;
+
+	AUTO_RELEASE(sccp_device_t, d , sccp_session_getDevice(session, FALSE));
+	if (d) {
+		sccp_msg_t *msg = NULL;
+
+		REQ(msg, CloseReceiveChannel);
+		if (!msg) {
+			return;
+		}
+		msg->data.CloseReceiveChannel.lel_conferenceId = htolel(callReference);
+		msg->data.CloseReceiveChannel.lel_passThruPartyId = htolel(passThruPartyId);
+		msg->data.CloseReceiveChannel.lel_callReference = htolel(callReference);
+		sccp_dev_send(d, msg);
+		sccp_log((DEBUGCAT_PBX + DEBUGCAT_RTP)) (VERBOSE_PREFIX_3 "%s: Closed receive channel %u of call %u after hangup (%s)\n", d->id, passThruPartyId, callReference, completed ? "opened" : "no answer");
+	}
+}
+
+/*!
+ * \brief Completion Action registered by sccp_pbx_hangup, stops the media transmission once its StartMediaTransmission was answered or timed out
+ * \param data callid of the hungup channel
+ */
+static void sccp_pbx_hangup_stopMediaTransmission(constSessionPtr session, uint32_t passThruPartyId, boolean_t completed, void *data)
+{
+	uint32_t callReference = (uint32_t)(uintptr_t) data;
+
+	AUTO_RELEASE(sccp_device_t, d , sccp_session_getDevice(session, FALSE));
+	if (d) {
+		sccp_msg_t *msg = NULL;
+
+		REQ(msg, StopMediaTransmission);
+		if (!msg) {
+			return;
+		}
+		msg->data.StopMediaTransmission.lel_conferenceId = htolel(callReference);
+		msg->data.StopMediaTransmission.lel_passThruPartyId = htolel(passThruPartyId);
+		msg->data.StopMediaTransmission.lel_callReference = htolel(callReference);
+		sccp_dev_send(d, msg);
+		sccp_log((DEBUGCAT_PBX + DEBUGCAT_RTP)) (VERBOSE_PREFIX_3 "%s: Stopped media transmission %u of call %u after hangup (%s)\n", d->id, passThruPartyId, callReference, completed ? "started" : "no answer");
+	}
+}
+
 /*!
  * \brief Handle Hangup Request by Asterisk
  * \param channel SCCP Channel
@@ -542,7 +614,17 @@ channelPtr sccp_pbx_hangup(constChannelPtr channel)
 
 	AUTO_RELEASE(sccp_device_t, d , sccp_channel_getDevice(c));
 	if(d && d->session) {
-		sccp_session_waitForPendingRequests(d->session);
+		/* don't wait for an OpenReceiveChannel / StartMediaTransmission still in flight, close it once the device answered (or did not in time).
+		 * Marking the direction inactive makes the completion action the only one sending the close. When the transaction is already gone,
+		 * the state is left alone and the regular closeAllMediaTransmitAndReceive takes care of it */
+		if ((sccp_rtp_getState(&c->rtp.audio, SCCP_RTP_RECEPTION) & SCCP_RTP_STATUS_PROGRESS)
+		    && sccp_session_onTransactionComplete(d->session, OpenReceiveChannel, c->passthrupartyid, sccp_pbx_hangup_closeReceiveChannel, (void *)(uintptr_t) c->callid)) {
+			sccp_rtp_setState(&c->rtp.audio, SCCP_RTP_RECEPTION, SCCP_RTP_STATUS_INACTIVE);
+		}
+		if ((sccp_rtp_getState(&c->rtp.audio, SCCP_RTP_TRANSMISSION) & SCCP_RTP_STATUS_PROGRESS)
+		    && sccp_session_onTransactionComplete(d->session, StartMediaTransmission, c->passthrupartyid, sccp_pbx_hangup_stopMediaTransmission, (void *)(uintptr_t) c->callid)) {
+			sccp_rtp_setState(&c->rtp.audio, SCCP_RTP_TRANSMISSION, SCCP_RTP_STATUS_INACTIVE);
+		}
 		/*		if (
 					GLOB(remotehangup_tone) &&
 					SKINNY_DEVICE_RS_OK == sccp_device_getRegistrationState(d) &&
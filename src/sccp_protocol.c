@@ -306,29 +306,41 @@ static void sccp_protocol_sendDialedNumberV18(constDevicePtr device, const uint8
 /* Display Prompt Message */
 
 /*!
- * \brief Send Display Prompt Message (Static)
+ * \brief Build Display Prompt Message (Static)
  */
-static void sccp_protocol_sendStaticDisplayprompt(constDevicePtr device, uint8_t lineInstance, uint32_t callid, uint8_t timeout, const char *message)
+static sccp_msg_t *sccp_protocol_buildStaticDisplayprompt(uint8_t lineInstance, uint32_t callid, uint8_t timeout, const char *message)
 {
 	sccp_msg_t *msg = NULL;
 
 	REQ(msg, DisplayPromptStatusMessage);
 	if (!msg) {
-		return;
+		return NULL;
 	}
 	msg->data.DisplayPromptStatusMessage.lel_messageTimeout = htolel(timeout);
 	msg->data.DisplayPromptStatusMessage.lel_callReference = htolel(callid);
 	msg->data.DisplayPromptStatusMessage.lel_lineInstance = htolel(lineInstance);
 	sccp_copy_string(msg->data.DisplayPromptStatusMessage.promptMessage, message, sizeof(msg->data.DisplayPromptStatusMessage.promptMessage));
+	return msg;
+}
 
+/*!
+ * \brief Send Display Prompt Message (Static)
+ */
+static void sccp_protocol_sendStaticDisplayprompt(constDevicePtr device, uint8_t lineInstance, uint32_t callid, uint8_t timeout, const char *message)
+{
+	sccp_msg_t *msg = sccp_protocol_buildStaticDisplayprompt(lineInstance, callid, timeout, message);
+
+	if (!msg) {
+		return;
+	}
 	sccp_dev_send(device, msg);
 	sccp_log((DEBUGCAT_DEVICE | DEBUGCAT_LINE)) (VERBOSE_PREFIX_3 "%s: Display prompt on line %d, callid %d, timeout %d\n", device->id, lineInstance, callid, timeout);
 }
 
 /*!
- * \brief Send Display Prompt Message (Dynamic)
+ * \brief Build Display Prompt Message (Dynamic)
  */
-static void sccp_protocol_sendDynamicDisplayprompt(constDevicePtr device, uint8_t lineInstance, uint32_t callid, uint8_t timeout, const char *message)
+static sccp_msg_t *sccp_protocol_buildDynamicDisplayprompt(uint8_t lineInstance, uint32_t callid, uint8_t timeout, const char *message)
 {
 	sccp_msg_t *msg = NULL;
 
@@ -336,13 +348,25 @@ static void sccp_protocol_sendDynamicDisplayprompt(constDevicePtr device, uint8_
 	int hdr_len = sizeof(msg->data.DisplayDynamicPromptStatusMessage) - 3;
 	msg = sccp_build_packet(DisplayDynamicPromptStatusMessage, hdr_len + msg_len);
 	if (!msg) {
-		return;
+		return NULL;
 	}
 	msg->data.DisplayDynamicPromptStatusMessage.lel_messageTimeout = htolel(timeout);
 	msg->data.DisplayDynamicPromptStatusMessage.lel_callReference = htolel(callid);
 	msg->data.DisplayDynamicPromptStatusMessage.lel_lineInstance = htolel(lineInstance);
 	memcpy(&msg->data.DisplayDynamicPromptStatusMessage.dummy, message, msg_len);
+	return msg;
+}
 
+/*!
+ * \brief Send Display Prompt Message (Dynamic)
+ */
+static void sccp_protocol_sendDynamicDisplayprompt(constDevicePtr device, uint8_t lineInstance, uint32_t callid, uint8_t timeout, const char *message)
+{
+	sccp_msg_t *msg = sccp_protocol_buildDynamicDisplayprompt(lineInstance, callid, timeout, message);
+
+	if (!msg) {
+		return;
+	}
 	sccp_dev_send(device, msg);
 	sccp_log((DEBUGCAT_DEVICE | DEBUGCAT_LINE)) (VERBOSE_PREFIX_3 "%s: Display prompt on line %d, callid %d, timeout %d\n", device->id, lineInstance, callid, timeout);
 }
@@ -396,28 +420,40 @@ static void sccp_protocol_sendDynamicDisplayNotify(constDevicePtr device, uint8_
 /* Display Priority Notify Message */
 
 /*!
- * \brief Send Priority Display Notify Message (Static)
+ * \brief Build Priority Display Notify Message (Static)
  */
-static void sccp_protocol_sendStaticDisplayPriNotify(constDevicePtr device, uint8_t priority, uint8_t timeout, const char *message)
+static sccp_msg_t *sccp_protocol_buildStaticDisplayPriNotify(uint8_t priority, uint8_t timeout, const char *message)
 {
 	sccp_msg_t *msg = NULL;
 
 	REQ(msg, DisplayPriNotifyMessage);
 	if (!msg) {
-		return;
+		return NULL;
 	}
 	msg->data.DisplayPriNotifyMessage.lel_displayTimeout = htolel(timeout);
 	msg->data.DisplayPriNotifyMessage.lel_priority = htolel(priority);
 	sccp_copy_string(msg->data.DisplayPriNotifyMessage.displayMessage, message, sizeof(msg->data.DisplayPriNotifyMessage.displayMessage));
+	return msg;
+}
+
+/*!
+ * \brief Send Priority Display Notify Message (Static)
+ */
+static void sccp_protocol_sendStaticDisplayPriNotify(constDevicePtr device, uint8_t priority, uint8_t timeout, const char *message)
+{
+	sccp_msg_t *msg = sccp_protocol_buildStaticDisplayPriNotify(priority, timeout, message);
 
+	if (!msg) {
+		return;
+	}
 	sccp_dev_send(device, msg);
 	sccp_log((DEBUGCAT_DEVICE | DEBUGCAT_LINE)) (VERBOSE_PREFIX_3 "%s: Display notify timeout %d\n", device->id, timeout);
 }
 
 /*!
- * \brief Send Priority Display Notify Message (Dynamic)
+ * \brief Build Priority Display Notify Message (Dynamic)
  */
-static void sccp_protocol_sendDynamicDisplayPriNotify(constDevicePtr device, uint8_t priority, uint8_t timeout, const char *message)
+static sccp_msg_t *sccp_protocol_buildDynamicDisplayPriNotify(uint8_t priority, uint8_t timeout, const char *message)
 {
 	sccp_msg_t *msg = NULL;
 
@@ -425,16 +461,67 @@ static void sccp_protocol_sendDynamicDisplayPriNotify(constDevicePtr device, uin
 	int hdr_len = sizeof(msg->data.DisplayDynamicPriNotifyMessage) - 3;
 	msg = sccp_build_packet(DisplayDynamicPriNotifyMessage, hdr_len + msg_len);
 	if (!msg) {
-		return;
+		return NULL;
 	}
 	msg->data.DisplayDynamicPriNotifyMessage.lel_displayTimeout = htolel(timeout);
 	msg->data.DisplayDynamicPriNotifyMessage.lel_priority = htolel(priority);
 	memcpy(&msg->data.DisplayDynamicPriNotifyMessage.dummy, message, msg_len);
+	return msg;
+}
 
+/*!
+ * \brief Send Priority Display Notify Message (Dynamic)
+ */
+static void sccp_protocol_sendDynamicDisplayPriNotify(constDevicePtr device, uint8_t priority, uint8_t timeout, const char *message)
+{
+	sccp_msg_t *msg = sccp_protocol_buildDynamicDisplayPriNotify(priority, timeout, message);
+
+	if (!msg) {
+		return;
+	}
 	sccp_dev_send(device, msg);
 	sccp_log((DEBUGCAT_DEVICE | DEBUGCAT_LINE)) (VERBOSE_PREFIX_3 "%s: Display notify timeout %d\n", device->id, timeout);
 }
 
+/*!
+ * \brief Build the Display Prompt (prompt=TRUE) or Priority Display Notify message a device using this protocol would be sent, without sending it
+ * \note Used to encode a message once per protocol variant (static/dynamic) and clone it for every device, see sccp_protocol_cloneMessage
+ */
+sccp_msg_t *sccp_protocol_buildDisplayMessage(const sccp_deviceProtocol_t * protocol, boolean_t prompt, uint8_t priority, uint8_t timeout, const char *message)
+{
+	if (!protocol || !message) {
+		return NULL;
+	}
+	if (prompt) {
+		return (protocol->displayPrompt == sccp_protocol_sendStaticDisplayprompt) ? sccp_protocol_buildStaticDisplayprompt(0, 0, timeout, message) : sccp_protocol_buildDynamicDisplayprompt(0, 0, timeout, message);
+	}
+	return (protocol->displayPriNotify == sccp_protocol_sendStaticDisplayPriNotify) ? sccp_protocol_buildStaticDisplayPriNotify(priority, timeout, message) : sccp_protocol_buildDynamicDisplayPriNotify(priority, timeout, message);
+}
+
+/*!
+ * \brief Does this protocol use the dynamic (variable length) display messages
+ */
+boolean_t sccp_protocol_hasDynamicDisplay(const sccp_deviceProtocol_t * protocol)
+{
+	return (protocol && protocol->displayPriNotify != sccp_protocol_sendStaticDisplayPriNotify) ? TRUE : FALSE;
+}
+
+/*!
+ * \brief Copy an already encoded message, the copy will be freed by sccp_dev_send
+ */
+sccp_msg_t *sccp_protocol_cloneMessage(const sccp_msg_t * msg)
+{
+	size_t len = letohl(msg->header.length) + 8;
+	sccp_msg_t *copy = (sccp_msg_t *)sccp_malloc(len);
+
+	if (!copy) {
+		pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP_Packet");
+		return NULL;
+	}
+	memcpy(copy, msg, len);
+	return copy;
+}
+
 /* done - display notify */
 
 /* callForwardStatus Message */
@@ -3438,6 +3438,9 @@ typedef struct {
 #define REQ(_x, _y)    _x = sccp_build_packet((_y), sizeof((_x)->data._y))
 #define REQCMD(_x, _y) _x = sccp_build_packet((_y), 0)
 SCCP_API messagePtr SCCP_CALL sccp_build_packet(sccp_mid_t t, size_t pkt_len);
+SCCP_API sccp_msg_t * SCCP_CALL sccp_protocol_buildDisplayMessage(const sccp_deviceProtocol_t * protocol, boolean_t prompt, uint8_t priority, uint8_t timeout, const char *message);
+SCCP_API boolean_t SCCP_CALL sccp_protocol_hasDynamicDisplay(const sccp_deviceProtocol_t * protocol);
+SCCP_API sccp_msg_t * SCCP_CALL sccp_protocol_cloneMessage(const sccp_msg_t * msg);
 SCCP_API boolean_t SCCP_CALL sccp_protocol_isProtocolSupported(uint8_t type, uint8_t version);
 SCCP_API uint8_t __CONST__ SCCP_CALL sccp_protocol_getMaxSupportedVersionNumber(int type);
 SCCP_API const sccp_deviceProtocol_t * SCCP_CALL sccp_protocol_getDeviceProtocol(constDevicePtr device, int type);
@@ -0,0 +1,912 @@
+/*!
+ * \file        sccp_provision.c
+ * \brief       SCCP Runtime Provisioning
+ * \note        Create, modify and delete devices and lines in memory through the SCCPProvision manager action, without
+ *              reloading sccp.conf. All entries of a request form one transaction: they are validated against the
+ *              device/line config options first and only applied when every entry is valid.
+ *              Provisioned objects are remembered, so that they survive a reload and later modifications can be merged
+ *              into their current configuration. With 'Persist: yes' they are also written to sccp_provision.conf,
+ *              which is read back when the module is loaded.
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#include "config.h"
+#include "common.h"
+#include "sccp_provision.h"
+#include "sccp_config.h"
+#include "sccp_device.h"
+#include "sccp_line.h"
+#include "sccp_linedevice.h"
+#include "sccp_utils.h"
+#include "sccp_webservice.h"
+
+SCCP_FILE_VERSION(__FILE__, "");
+
+#include <asterisk/paths.h>
+
+/*** DOCUMENTATION
+	<manager name="SCCPProvision" language="en_US">
+		<synopsis>Create, modify and delete SCCP devices and lines as one transaction.</synopsis>
+		<syntax>
+			<xi:include href="../core-en_US.xml" parse="xml"
+				xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])"/>
+			<parameter name="Persist" required="false" default="no">
+				<para>Write the provisioned objects to sccp_provision.conf, so that they are restored when the module is loaded again.</para>
+			</parameter>
+			<parameter name="DryRun" required="false" default="no">
+				<para>Only validate the transaction, do not apply it.</para>
+			</parameter>
+			<parameter name="Op-XXXXXX" required="true">
+				<para>Operation to perform on the object. <literal>XXXXXX</literal> is a zero padded number, starting at 000000.</para>
+				<enumlist>
+					<enum name="create">
+						<para>Create a new object, from the variables of all entries for this object.</para>
+					</enum>
+					<enum name="modify">
+						<para>Change the given variables of an existing object, an empty Value removes the variable.</para>
+					</enum>
+					<enum name="delete">
+						<para>Delete an existing object.</para>
+					</enum>
+				</enumlist>
+			</parameter>
+			<parameter name="Type-XXXXXX" required="true">
+				<enumlist>
+					<enum name="device"/>
+					<enum name="line"/>
+				</enumlist>
+			</parameter>
+			<parameter name="Name-XXXXXX" required="true">
+				<para>DeviceId or line name of the object.</para>
+			</parameter>
+			<parameter name="Var-XXXXXX" required="false">
+				<para>Name of a device/line parameter as used in sccp.conf.</para>
+			</parameter>
+			<parameter name="Value-XXXXXX" required="false">
+				<para>Value of the parameter.</para>
+			</parameter>
+		</syntax>
+		<description>
+			<para>Entries with the same Type and Name describe one object, multi valued parameters like <literal>button</literal> are
+			given once per entry and replace all current values of that parameter.</para>
+			<para>The whole transaction is rejected when one of the entries is invalid. Devices that need to be reset because of
+			a change are reset as soon as they have no active calls.</para>
+		</description>
+	</manager>
+ ***/
+
+#define SCCP_PROVISION_FILENAME "sccp_provision.conf"
+#define SCCP_PROVISION_MAXENTRIES 10000										/*!< maximum number of Op-XXXXXX entries per transaction */
+
+typedef enum {
+	SCCP_PROVISION_CREATE,
+	SCCP_PROVISION_MODIFY,
+	SCCP_PROVISION_DELETE,
+} sccp_provision_op_t;
+
+static const char * const provision_op2str[] = {
+	[SCCP_PROVISION_CREATE] = "create",
+	[SCCP_PROVISION_MODIFY] = "modify",
+	[SCCP_PROVISION_DELETE] = "delete",
+};
+
+/*!
+ * \brief Provisioned Device or Line
+ */
+struct sccp_provision_object {
+	SCCP_LIST_ENTRY(struct sccp_provision_object) list;
+	sccp_config_segment_t segment;
+	char name[StationMaxNameSize];
+	boolean_t deleted;											/*!< hides an object defined in sccp.conf */
+	boolean_t persist;											/*!< saved to sccp_provision.conf */
+	PBX_VARIABLE_TYPE * variables;
+};
+
+/*!
+ * \brief Object affected by the current transaction
+ */
+typedef struct {
+	sccp_provision_op_t op;
+	sccp_config_segment_t segment;
+	char name[StationMaxNameSize];
+	PBX_VARIABLE_TYPE * changes;										/*!< variables given in the request */
+	PBX_VARIABLE_TYPE * variables;										/*!< resulting configuration of the object */
+} sccp_provision_item_t;
+
+/* locked by the transaction or the reload that claimed GLOB(reload_in_progress), and while loading / saving; a transaction does not hold GLOB(lock) */
+static SCCP_LIST_HEAD(, struct sccp_provision_object) provisionedObjects;
+
+static void sccp_provision_load(void);
+
+static const char * sccp_provision_segment2str(const sccp_config_segment_t segment)
+{
+	return SCCP_CONFIG_DEVICE_SEGMENT == segment ? "device" : "line";
+}
+
+static void sccp_provision_destroyObject(struct sccp_provision_object * object)
+{
+	if (object->variables) {
+		pbx_variables_destroy(object->variables);
+	}
+	sccp_free(object);
+}
+
+void sccp_provision_module_start(void)
+{
+	SCCP_LIST_HEAD_INIT(&provisionedObjects);
+	sccp_provision_load();
+}
+
+void sccp_provision_module_stop(void)
+{
+	struct sccp_provision_object * object = NULL;
+
+	SCCP_LIST_LOCK(&provisionedObjects);
+	while ((object = SCCP_LIST_REMOVE_HEAD(&provisionedObjects, list))) {
+		sccp_provision_destroyObject(object);
+	}
+	SCCP_LIST_UNLOCK(&provisionedObjects);
+	SCCP_LIST_HEAD_DESTROY(&provisionedObjects);
+}
+
+/*!
+ * \brief Copy variables, leaving out the ones that are handled by the provisioning itself
+ */
+static PBX_VARIABLE_TYPE * sccp_provision_copyVariables(PBX_VARIABLE_TYPE * v)
+{
+	PBX_VARIABLE_TYPE * root = NULL;
+	PBX_VARIABLE_TYPE * tail = NULL;
+	PBX_VARIABLE_TYPE * tmp  = NULL;
+
+	for (; v; v = v->next) {
+		if (sccp_strcaseequals(v->name, "type") || sccp_strcaseequals(v->name, "_provision")) {
+			continue;
+		}
+		if (!(tmp = pbx_variable_new(v->name, v->value, ""))) {
+			pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+			break;
+		}
+		if (tail) {
+			tail->next = tmp;
+		} else {
+			root = tmp;
+		}
+		tail = tmp;
+	}
+	return root;
+}
+
+static boolean_t sccp_provision_hasVariable(PBX_VARIABLE_TYPE * v, const char * name)
+{
+	for (; v; v = v->next) {
+		if (sccp_strcaseequals(v->name, name)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*!
+ * \brief Merge the requested changes into the current configuration of an object
+ * \note a changed parameter replaces all current values of that parameter, an empty value only removes them
+ */
+static PBX_VARIABLE_TYPE * sccp_provision_mergeVariables(PBX_VARIABLE_TYPE * current, PBX_VARIABLE_TYPE * changes)
+{
+	PBX_VARIABLE_TYPE * root = NULL;
+	PBX_VARIABLE_TYPE * tail = NULL;
+	PBX_VARIABLE_TYPE * v    = NULL;
+
+	for (v = current; v; v = v->next) {
+		if (!sccp_provision_hasVariable(changes, v->name)) {
+			PBX_VARIABLE_TYPE * tmp = pbx_variable_new(v->name, v->value, "");
+			if (!tmp) {
+				break;
+			}
+			if (tail) {
+				tail->next = tmp;
+			} else {
+				root = tmp;
+			}
+			tail = tmp;
+		}
+	}
+	for (v = changes; v; v = v->next) {
+		if (!sccp_strlen_zero(v->value)) {
+			PBX_VARIABLE_TYPE * tmp = pbx_variable_new(v->name, v->value, "");
+			if (!tmp) {
+				break;
+			}
+			if (tail) {
+				tail->next = tmp;
+			} else {
+				root = tmp;
+			}
+			tail = tmp;
+		}
+	}
+	return root;
+}
+
+/*!
+ * \brief Find a provisioned object
+ * \note provisionedObjects needs to be locked
+ */
+static struct sccp_provision_object * sccp_provision_findObject(const sccp_config_segment_t segment, const char * name)
+{
+	struct sccp_provision_object * object = NULL;
+
+	SCCP_LIST_TRAVERSE(&provisionedObjects, object, list) {
+		if (object->segment == segment && sccp_strcaseequals(object->name, name)) {
+			break;
+		}
+	}
+	return object;
+}
+
+/*!
+ * \brief Is the object defined in sccp.conf
+ */
+static boolean_t sccp_provision_inConfigFile(const sccp_config_segment_t segment, const char * name)
+{
+	const char * type = GLOB(cfg) ? pbx_variable_retrieve(GLOB(cfg), name, "type") : NULL;
+
+	return (type && sccp_strcaseequals(type, sccp_provision_segment2str(segment))) ? TRUE : FALSE;
+}
+
+/*!
+ * \brief Current configuration of an object, either provisioned earlier or taken from sccp.conf
+ * \note provisionedObjects needs to be locked
+ */
+static PBX_VARIABLE_TYPE * sccp_provision_currentVariables(const sccp_config_segment_t segment, const char * name)
+{
+	struct sccp_provision_object * object = sccp_provision_findObject(segment, name);
+
+	if (object) {
+		return object->deleted ? NULL : sccp_provision_copyVariables(object->variables);
+	}
+	if (sccp_provision_inConfigFile(segment, name)) {
+		return sccp_provision_copyVariables(ast_variable_browse(GLOB(cfg), name));
+	}
+	return NULL;
+}
+
+/*!
+ * \brief Create or update a device/line from its configuration, the same way sccp_config_readDevicesLines does
+ */
+static void sccp_provision_build(const sccp_config_segment_t segment, const char * name, PBX_VARIABLE_TYPE * variables)
+{
+	sccp_configurationchange_t res = SCCP_CONFIG_NOUPDATENEEDED;
+
+	if (SCCP_CONFIG_DEVICE_SEGMENT == segment) {
+		AUTO_RELEASE(sccp_device_t, device, sccp_device_find_byid(name, FALSE));
+		boolean_t isNew = FALSE;
+		if (!device && (device = sccp_device_create(name)) /*ref_replace*/) {
+			isNew = TRUE;
+		}
+		if (!device) {
+			pbx_log(LOG_ERROR, "SCCP: (provision) unable to create device %s\n", name);
+			return;
+		}
+		device->pendingDelete = 0;
+		res = sccp_config_applyDeviceConfiguration(device, variables);
+		if (GLOB(reload_in_progress) && (res & SCCP_CONFIG_NEEDDEVICERESET)) {
+			device->pendingUpdate = 1;
+		}
+		if (isNew) {
+			sccp_device_addToGlobals(device);
+		}
+	} else {
+		AUTO_RELEASE(sccp_line_t, line, sccp_line_find_byname(name, FALSE));
+		boolean_t isNew = FALSE;
+		if (!line && (line = sccp_line_create(name)) /*ref_replace*/) {
+			isNew = TRUE;
+		}
+		if (!line) {
+			pbx_log(LOG_ERROR, "SCCP: (provision) unable to create line %s\n", name);
+			return;
+		}
+		line->pendingDelete = 0;
+		res = sccp_config_applyLineConfiguration(line, variables);
+		if (GLOB(reload_in_progress) && (res & SCCP_CONFIG_NEEDDEVICERESET)) {
+			line->pendingUpdate = 1;
+		}
+		if (isNew) {
+			sccp_line_addToGlobals(line);
+		}
+	}
+	sccp_log((DEBUGCAT_CONFIG))(VERBOSE_PREFIX_3 "%s: (provision) %s %s\n", name, sccp_provision_segment2str(segment), (res & SCCP_CONFIG_NEEDDEVICERESET) ? "changed, reset required" : "applied");
+}
+
+/*!
+ * \brief Apply the provisioned objects on top of sccp.conf
+ * \note called from sccp_config_readDevicesLines, after the devices and lines of sccp.conf have been read
+ */
+void sccp_provision_readDevicesLines(void)
+{
+	struct sccp_provision_object * object = NULL;
+
+	SCCP_LIST_LOCK(&provisionedObjects);
+	SCCP_LIST_TRAVERSE(&provisionedObjects, object, list) {
+		if (!object->deleted) {
+			sccp_provision_build(object->segment, object->name, object->variables);
+		} else if (SCCP_CONFIG_DEVICE_SEGMENT == object->segment) {
+			AUTO_RELEASE(sccp_device_t, device, sccp_device_find_byid(object->name, FALSE));
+			if (device) {
+				device->pendingDelete = 1;
+			}
+		} else {
+			AUTO_RELEASE(sccp_line_t, line, sccp_line_find_byname(object->name, FALSE));
+			if (line) {
+				line->pendingDelete = 1;
+			}
+		}
+	}
+	SCCP_LIST_UNLOCK(&provisionedObjects);
+}
+
+/*!
+ * \brief Restore the persisted objects
+ */
+static void sccp_provision_load(void)
+{
+	struct ast_flags config_flags = { 0 };
+	struct ast_config * cfg = pbx_config_load(SCCP_PROVISION_FILENAME, "chan_sccp", config_flags);
+	struct sccp_provision_object * object = NULL;
+	char * cat = NULL;
+	int count = 0;
+
+	if (!cfg || cfg == CONFIG_STATUS_FILEMISSING) {
+		return;
+	}
+	if (cfg == CONFIG_STATUS_FILEINVALID) {
+		pbx_log(LOG_ERROR, "SCCP: (provision) '%s' is not a valid config file, provisioned objects not restored\n", SCCP_PROVISION_FILENAME);
+		return;
+	}
+	SCCP_LIST_LOCK(&provisionedObjects);
+	while ((cat = pbx_category_browse(cfg, cat))) {
+		const char * type = pbx_variable_retrieve(cfg, cat, "type");
+		const char * state = pbx_variable_retrieve(cfg, cat, "_provision");
+
+		if (!type || (!sccp_strcaseequals(type, "device") && !sccp_strcaseequals(type, "line"))) {
+			pbx_log(LOG_WARNING, "SCCP: (provision) section '%s' in %s has no valid type, skipped\n", cat, SCCP_PROVISION_FILENAME);
+			continue;
+		}
+		if (!(object = (struct sccp_provision_object *)sccp_calloc(1, sizeof(struct sccp_provision_object)))) {
+			pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+			break;
+		}
+		object->segment = sccp_strcaseequals(type, "device") ? SCCP_CONFIG_DEVICE_SEGMENT : SCCP_CONFIG_LINE_SEGMENT;
+		sccp_copy_string(object->name, cat, sizeof(object->name));
+		object->deleted = sccp_strcaseequals(state, "deleted") ? TRUE : FALSE;
+		object->persist = TRUE;
+		object->variables = object->deleted ? NULL : sccp_provision_copyVariables(ast_variable_browse(cfg, cat));
+		SCCP_LIST_INSERT_TAIL(&provisionedObjects, object, list);
+		count++;
+	}
+	SCCP_LIST_UNLOCK(&provisionedObjects);
+	pbx_config_destroy(cfg);
+	sccp_log((DEBUGCAT_CONFIG))(VERBOSE_PREFIX_2 "SCCP: (provision) restored %d provisioned object(s) from %s\n", count, SCCP_PROVISION_FILENAME);
+}
+
+/*!
+ * \brief Write the persistent objects to sccp_provision.conf
+ * \note provisionedObjects needs to be locked
+ */
+static boolean_t sccp_provision_save(void)
+{
+	struct sccp_provision_object * object = NULL;
+	PBX_VARIABLE_TYPE * v = NULL;
+	char fn[PATH_MAX];
+	char tmpfn[PATH_MAX];
+	FILE * f = NULL;
+
+	snprintf(fn, sizeof(fn), "%s/%s", ast_config_AST_CONFIG_DIR, SCCP_PROVISION_FILENAME);
+	snprintf(tmpfn, sizeof(tmpfn), "%s.tmp", fn);
+	if (!(f = fopen(tmpfn, "w"))) {
+		pbx_log(LOG_WARNING, "SCCP: (provision) unable to write '%s': %s\n", tmpfn, strerror(errno));
+		return FALSE;
+	}
+	fprintf(f, ";\n; Devices and lines provisioned through the SCCPProvision manager action.\n; This file is rewritten by chan_sccp, manual changes will be lost.\n;\n");
+	SCCP_LIST_TRAVERSE(&provisionedObjects, object, list) {
+		if (!object->persist) {
+			continue;
+		}
+		fprintf(f, "\n[%s]\ntype=%s\n", object->name, sccp_provision_segment2str(object->segment));
+		if (object->deleted) {
+			fprintf(f, "_provision=deleted\n");
+			continue;
+		}
+		for (v = object->variables; v; v = v->next) {
+			fprintf(f, "%s=", v->name);
+			for (const char * c = v->value; *c; c++) {
+				if (*c == ';') {
+					fputc('\\', f);								/* ';' starts a comment */
+				}
+				fputc(*c, f);
+			}
+			fputc('\n', f);
+		}
+	}
+	if (fclose(f) || rename(tmpfn, fn)) {
+		pbx_log(LOG_WARNING, "SCCP: (provision) unable to write '%s': %s\n", fn, strerror(errno));
+		unlink(tmpfn);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static sccp_provision_item_t * sccp_provision_findItem(sccp_provision_item_t * items, int numItems, const sccp_config_segment_t segment, const char * name)
+{
+	for (int idx = 0; idx < numItems; idx++) {
+		if (items[idx].segment == segment && sccp_strcaseequals(items[idx].name, name)) {
+			return &items[idx];
+		}
+	}
+	return NULL;
+}
+
+/*!
+ * \brief Number of Op-XXXXXX entries in the request
+ */
+static int sccp_provision_numEntries(const struct message * m)
+{
+	char header[20];
+	int idx = 0;
+
+	for (idx = 0; idx < SCCP_PROVISION_MAXENTRIES; idx++) {
+		snprintf(header, sizeof(header), "Op-%06d", idx);
+		if (sccp_strlen_zero(astman_get_header(m, header))) {
+			break;
+		}
+	}
+	return idx;
+}
+
+/*!
+ * \brief Collect the Op-XXXXXX entries of the request per object
+ * \note items needs room for numEntries objects, numItems is kept up to date so that the caller can free the items on error
+ */
+static boolean_t sccp_provision_parse(const struct message * m, sccp_provision_item_t * items, int numEntries, int * numItems, char * errorbuf, size_t size)
+{
+	char header[20];
+
+	for (int idx = 0; idx < numEntries; idx++) {
+		snprintf(header, sizeof(header), "Op-%06d", idx);
+		const char * op = astman_get_header(m, header);
+		snprintf(header, sizeof(header), "Type-%06d", idx);
+		const char * type = astman_get_header(m, header);
+		snprintf(header, sizeof(header), "Name-%06d", idx);
+		const char * name = astman_get_header(m, header);
+		snprintf(header, sizeof(header), "Var-%06d", idx);
+		const char * var = astman_get_header(m, header);
+		snprintf(header, sizeof(header), "Value-%06d", idx);
+		const char * value = astman_get_header(m, header);
+
+		sccp_provision_op_t operation = SCCP_PROVISION_CREATE;
+		sccp_config_segment_t segment = SCCP_CONFIG_DEVICE_SEGMENT;
+		if (sccp_strcaseequals(op, "create")) {
+			operation = SCCP_PROVISION_CREATE;
+		} else if (sccp_strcaseequals(op, "modify")) {
+			operation = SCCP_PROVISION_MODIFY;
+		} else if (sccp_strcaseequals(op, "delete")) {
+			operation = SCCP_PROVISION_DELETE;
+		} else {
+			snprintf(errorbuf, size, "entry %d: unknown operation, use create, modify or delete", idx);
+			return FALSE;
+		}
+		if (sccp_strcaseequals(type, "device")) {
+			segment = SCCP_CONFIG_DEVICE_SEGMENT;
+		} else if (sccp_strcaseequals(type, "line")) {
+			segment = SCCP_CONFIG_LINE_SEGMENT;
+		} else {
+			snprintf(errorbuf, size, "entry %d: unknown type, use device or line", idx);
+			return FALSE;
+		}
+		if (sccp_strlen_zero(name) || strlen(name) >= (SCCP_CONFIG_DEVICE_SEGMENT == segment ? StationMaxDeviceNameSize : StationMaxNameSize)) {
+			snprintf(errorbuf, size, "entry %d: missing or too long %s name", idx, sccp_provision_segment2str(segment));
+			return FALSE;
+		}
+
+		sccp_provision_item_t * item = sccp_provision_findItem(items, *numItems, segment, name);
+		if (!item) {
+			item = &items[(*numItems)++];
+			item->op = operation;
+			item->segment = segment;
+			sccp_copy_string(item->name, name, sizeof(item->name));
+		} else if (item->op != operation && !(SCCP_PROVISION_CREATE == item->op && SCCP_PROVISION_MODIFY == operation)) {
+			snprintf(errorbuf, size, "entry %d: %s %s cannot be combined with %s", idx, sccp_provision_segment2str(segment), name, provision_op2str[item->op]);
+			return FALSE;
+		}
+		if (!sccp_strlen_zero(var) && SCCP_PROVISION_DELETE != operation) {
+			PBX_VARIABLE_TYPE * tmp = pbx_variable_new(var, value ? value : "", "");
+			if (!tmp) {
+				snprintf(errorbuf, size, "out of memory");
+				return FALSE;
+			}
+			tmp->lineno = idx;
+			if (!item->changes) {
+				item->changes = tmp;
+			} else {
+				PBX_VARIABLE_TYPE * tail = item->changes;
+				while (tail->next) {
+					tail = tail->next;
+				}
+				tail->next = tmp;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/*!
+ * \brief Will the line exist after the transaction
+ */
+static boolean_t sccp_provision_lineAvailable(sccp_provision_item_t * items, int numItems, const char * name)
+{
+	sccp_provision_item_t * item = sccp_provision_findItem(items, numItems, SCCP_CONFIG_LINE_SEGMENT, name);
+
+	if (item) {
+		return SCCP_PROVISION_DELETE != item->op;
+	}
+	AUTO_RELEASE(sccp_line_t, line, sccp_line_find_byname(name, FALSE));
+	return (line && !line->pendingDelete) ? TRUE : FALSE;
+}
+
+/*!
+ * \brief Find a device outside of the transaction which has a button for line 'name'
+ * \param deviceId set to the first such device
+ *
+ * \lock
+ *  - devices
+ *    - device->buttonconfig
+ */
+static boolean_t sccp_provision_lineReferenced(sccp_provision_item_t * items, int numItems, const char * name, char * deviceId, size_t size)
+{
+	sccp_device_t * d = NULL;
+	sccp_buttonconfig_t * config = NULL;
+	boolean_t found = FALSE;
+
+	SCCP_RWLIST_RDLOCK(&GLOB(devices));
+	SCCP_RWLIST_TRAVERSE(&GLOB(devices), d, list) {
+		if (d->pendingDelete || sccp_provision_findItem(items, numItems, SCCP_CONFIG_DEVICE_SEGMENT, d->id)) {
+			continue;										/* devices in the transaction are checked against their new buttons */
+		}
+		SCCP_LIST_LOCK(&d->buttonconfig);
+		SCCP_LIST_TRAVERSE(&d->buttonconfig, config, list) {
+			if (LINE == config->type && sccp_strcaseequals(config->button.line.name, name)) {
+				found = TRUE;
+				break;
+			}
+		}
+		SCCP_LIST_UNLOCK(&d->buttonconfig);
+		if (found) {
+			sccp_copy_string(deviceId, d->id, size);
+			break;
+		}
+	}
+	SCCP_RWLIST_UNLOCK(&GLOB(devices));
+	return found;
+}
+
+/*!
+ * \brief Validate all objects of the transaction, builds the resulting configuration of every object
+ * \note provisionedObjects needs to be locked, GLOB(reload_in_progress) is set
+ */
+static boolean_t sccp_provision_validate(sccp_provision_item_t * items, int numItems, char * errorbuf, size_t size)
+{
+	char reason[200] = "";
+
+	for (int idx = 0; idx < numItems; idx++) {
+		sccp_provision_item_t * item = &items[idx];
+		const char * type = sccp_provision_segment2str(item->segment);
+		boolean_t exists = FALSE;
+
+		if (SCCP_CONFIG_DEVICE_SEGMENT == item->segment) {
+			AUTO_RELEASE(sccp_device_t, device, sccp_device_find_byid(item->name, FALSE));
+			if (device && SCCP_PROVISION_CREATE != item->op) {
+				if (device->realtime || device->isAnonymous) {
+					snprintf(errorbuf, size, "device %s is a realtime or anonymous device", item->name);
+					return FALSE;
+				}
+			}
+			exists = device ? TRUE : FALSE;
+		} else {
+			AUTO_RELEASE(sccp_line_t, line, sccp_line_find_byname(item->name, FALSE));
+			if (line && SCCP_PROVISION_CREATE != item->op) {
+#ifdef CS_SCCP_REALTIME
+				if (line->realtime) {
+					snprintf(errorbuf, size, "line %s is a realtime line", item->name);
+					return FALSE;
+				}
+#endif
+				if (GLOB(hotline) && line == GLOB(hotline)->line) {
+					snprintf(errorbuf, size, "line %s is the hotline", item->name);
+					return FALSE;
+				}
+				if (SCCP_PROVISION_DELETE == item->op && SCCP_LIST_GETSIZE(&line->channels) > 0) {
+					snprintf(errorbuf, size, "line %s has active calls", item->name);
+					return FALSE;
+				}
+				char deviceId[StationMaxDeviceNameSize] = "";
+				if (SCCP_PROVISION_DELETE == item->op && sccp_provision_lineReferenced(items, numItems, item->name, deviceId, sizeof(deviceId))) {
+					snprintf(errorbuf, size, "line %s is still referenced by a button on device %s", item->name, deviceId);
+					return FALSE;
+				}
+			}
+			exists = line ? TRUE : FALSE;
+		}
+		if (SCCP_PROVISION_CREATE == item->op && exists) {
+			snprintf(errorbuf, size, "%s %s already exists", type, item->name);
+			return FALSE;
+		}
+		if (SCCP_PROVISION_CREATE != item->op && !exists) {
+			snprintf(errorbuf, size, "%s %s not found", type, item->name);
+			return FALSE;
+		}
+		if (SCCP_PROVISION_DELETE == item->op) {
+			continue;
+		}
+
+		PBX_VARIABLE_TYPE * current = SCCP_PROVISION_MODIFY == item->op ? sccp_provision_currentVariables(item->segment, item->name) : NULL;
+		item->variables = sccp_provision_mergeVariables(current, item->changes);
+		if (current) {
+			pbx_variables_destroy(current);
+		}
+		if (!sccp_config_validateConfiguration(item->segment, item->variables, reason, sizeof(reason))) {
+			snprintf(errorbuf, size, "%s %s: %s", type, item->name, reason);
+			return FALSE;
+		}
+	}
+
+	/* line buttons need to refer to lines which exist after this transaction */
+	for (int idx = 0; idx < numItems; idx++) {
+		if (SCCP_CONFIG_DEVICE_SEGMENT != items[idx].segment || SCCP_PROVISION_DELETE == items[idx].op) {
+			continue;
+		}
+		for (PBX_VARIABLE_TYPE * v = items[idx].variables; v; v = v->next) {
+			if (!sccp_strcaseequals(v->name, "button")) {
+				continue;
+			}
+			char * splitter = pbx_strdupa(v->value);
+			char * buttonType = strsep(&splitter, ",");
+			char * buttonName = strsep(&splitter, ",");
+			if (!buttonType || !buttonName || !sccp_strcaseequals(pbx_strip(buttonType), "line")) {
+				continue;
+			}
+			buttonName = pbx_strip(buttonName);
+			if (*buttonName == '!') {
+				buttonName++;
+			}
+			buttonName[strcspn(buttonName, "@")] = '\0';					/* strip subscription id */
+			if (!sccp_provision_lineAvailable(items, numItems, buttonName)) {
+				snprintf(errorbuf, size, "device %s: button refers to unknown line '%s'", items[idx].name, buttonName);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/*!
+ * \brief Mark the devices a line is attached to as needing an update
+ */
+static void sccp_provision_lineChanged(linePtr line)
+{
+	sccp_linedevice_t * ld = NULL;
+
+	SCCP_LIST_LOCK(&line->devices);
+	SCCP_LIST_TRAVERSE(&line->devices, ld, list) {
+		ld->device->pendingUpdate = 1;
+	}
+	SCCP_LIST_UNLOCK(&line->devices);
+}
+
+/*!
+ * \brief Set or clear pendingDelete on all buttons of a device, so that sccp_config_parse_button can compare them to the new configuration
+ */
+static void sccp_provision_markButtons(devicePtr device, boolean_t pendingDelete)
+{
+	sccp_buttonconfig_t * config = NULL;
+
+	SCCP_LIST_LOCK(&device->buttonconfig);
+	SCCP_LIST_TRAVERSE(&device->buttonconfig, config, list) {
+		config->pendingDelete = pendingDelete;
+		config->pendingUpdate = 0;
+	}
+	SCCP_LIST_UNLOCK(&device->buttonconfig);
+}
+
+/*!
+ * \brief Apply one object of a validated transaction
+ * \note provisionedObjects needs to be locked, GLOB(reload_in_progress) is set
+ */
+static boolean_t sccp_provision_commitItem(sccp_provision_item_t * item, boolean_t persist)
+{
+	struct sccp_provision_object * object = sccp_provision_findObject(item->segment, item->name);
+	boolean_t wasPersistent = object ? object->persist : FALSE;
+
+	if (SCCP_PROVISION_DELETE == item->op) {
+		if (SCCP_CONFIG_DEVICE_SEGMENT == item->segment) {
+			AUTO_RELEASE(sccp_device_t, device, sccp_device_find_byid(item->name, FALSE));
+			if (device) {
+				device->pendingDelete = 1;							/* removed by sccp_device_check_update when idle */
+			}
+		} else {
+			AUTO_RELEASE(sccp_line_t, line, sccp_line_find_byname(item->name, FALSE));
+			if (line) {
+				sccp_provision_lineChanged(line);
+				line->pendingDelete = 1;
+				sccp_line_clean(line, TRUE);
+			}
+		}
+		if (sccp_provision_inConfigFile(item->segment, item->name)) {
+			if (!object && (object = (struct sccp_provision_object *)sccp_calloc(1, sizeof(struct sccp_provision_object)))) {
+				object->segment = item->segment;
+				sccp_copy_string(object->name, item->name, sizeof(object->name));
+				SCCP_LIST_INSERT_TAIL(&provisionedObjects, object, list);
+			}
+			if (object) {
+				if (object->variables) {
+					pbx_variables_destroy(object->variables);
+					object->variables = NULL;
+				}
+				object->deleted = TRUE;
+				object->persist = persist;
+			}
+		} else if (object) {
+			SCCP_LIST_REMOVE(&provisionedObjects, object, list);
+			sccp_provision_destroyObject(object);
+		}
+		return persist || wasPersistent;
+	}
+
+	if (SCCP_CONFIG_DEVICE_SEGMENT == item->segment) {
+		AUTO_RELEASE(sccp_device_t, device, sccp_device_find_byid(item->name, FALSE));
+		if (device) {
+			sccp_provision_markButtons(device, TRUE);
+		}
+		sccp_provision_build(item->segment, item->name, item->variables);
+		if (device && !device->pendingUpdate) {
+			sccp_provision_markButtons(device, FALSE);
+		}
+	} else {
+		sccp_provision_build(item->segment, item->name, item->variables);
+		AUTO_RELEASE(sccp_line_t, line, sccp_line_find_byname(item->name, FALSE));
+		if (line && line->pendingUpdate) {
+			sccp_provision_lineChanged(line);
+			line->pendingUpdate = 0;
+		}
+	}
+
+	if (!object && (object = (struct sccp_provision_object *)sccp_calloc(1, sizeof(struct sccp_provision_object)))) {
+		object->segment = item->segment;
+		sccp_copy_string(object->name, item->name, sizeof(object->name));
+		SCCP_LIST_INSERT_TAIL(&provisionedObjects, object, list);
+	}
+	if (!object) {
+		pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+		return FALSE;
+	}
+	if (object->variables) {
+		pbx_variables_destroy(object->variables);
+	}
+	object->variables = item->variables;									/* ownership moves to the provisioned object */
+	item->variables = NULL;
+	object->deleted = FALSE;
+	object->persist = persist;
+	return persist || wasPersistent;
+}
+
+/*!
+ * \brief Apply a validated transaction, lines before devices, deletions last
+ * \note provisionedObjects needs to be locked, GLOB(reload_in_progress) is set
+ */
+static boolean_t sccp_provision_commit(sccp_provision_item_t * items, int numItems, boolean_t persist)
+{
+	boolean_t save = FALSE;
+
+	for (int pass = 0; pass < 4; pass++) {
+		for (int idx = 0; idx < numItems; idx++) {
+			sccp_provision_item_t * item = &items[idx];
+			boolean_t isDelete = SCCP_PROVISION_DELETE == item->op;
+			boolean_t isLine = SCCP_CONFIG_LINE_SEGMENT == item->segment;
+			if ((pass == 0 && isLine && !isDelete) || (pass == 1 && !isLine && !isDelete) || (pass == 2 && !isLine && isDelete) || (pass == 3 && isLine && isDelete)) {
+				save |= sccp_provision_commitItem(item, persist);
+			}
+		}
+	}
+	return save;
+}
+
+/*!
+ * \brief Create, modify and delete devices and lines as one transaction
+ * \param s Management Session
+ * \param m Message
+ * \return Success as int
+ *
+ * \called_from_asterisk
+ */
+int sccp_manager_provision(struct mansession * s, const struct message * m)
+{
+	boolean_t persist = sccp_true(astman_get_header(m, "Persist"));
+	boolean_t dryrun = sccp_true(astman_get_header(m, "DryRun"));
+	sccp_provision_item_t * items = NULL;
+	int numItems = 0;
+	boolean_t valid = FALSE;
+	boolean_t save = FALSE;
+	char errorbuf[256] = "";
+	char message[80] = "";
+
+	int numEntries = sccp_provision_numEntries(m);
+
+	if (!numEntries) {
+		astman_send_error(s, m, "Please specify at least one Op-000000, Type-000000 and Name-000000 entry");
+		return 0;
+	}
+	if (!(items = (sccp_provision_item_t *)sccp_calloc(numEntries, sizeof(sccp_provision_item_t)))) {
+		astman_send_error(s, m, "Out of memory");
+		return 0;
+	}
+	if (!sccp_provision_parse(m, items, numEntries, &numItems, errorbuf, sizeof(errorbuf))) {
+		astman_send_error(s, m, errorbuf);
+		goto EXIT;
+	}
+
+	/* like a reload: claim reload_in_progress under the lock, do the work without holding it */
+	pbx_rwlock_wrlock(&GLOB(lock));
+	if (GLOB(reload_in_progress)) {
+		pbx_rwlock_unlock(&GLOB(lock));
+		astman_send_error(s, m, "SCCP reload in progress, try again later");
+		goto EXIT;
+	}
+	GLOB(reload_in_progress) = TRUE;
+	pbx_rwlock_unlock(&GLOB(lock));
+
+	SCCP_LIST_LOCK(&provisionedObjects);
+	if ((valid = sccp_provision_validate(items, numItems, errorbuf, sizeof(errorbuf))) && !dryrun) {
+		save = sccp_provision_commit(items, numItems, persist);
+	}
+	SCCP_LIST_UNLOCK(&provisionedObjects);
+
+	pbx_rwlock_wrlock(&GLOB(lock));
+	GLOB(reload_in_progress) = FALSE;
+	pbx_rwlock_unlock(&GLOB(lock));
+
+	if (save) {
+		SCCP_LIST_LOCK(&provisionedObjects);
+		if (!sccp_provision_save()) {
+			snprintf(message, sizeof(message), "Provisioned %d object(s), but could not persist them", numItems);
+		}
+		SCCP_LIST_UNLOCK(&provisionedObjects);
+	}
+
+	if (!valid) {
+		sccp_log((DEBUGCAT_CONFIG))(VERBOSE_PREFIX_3 "SCCP: (provision) transaction rejected: %s\n", errorbuf);
+		astman_send_error(s, m, errorbuf);
+		goto EXIT;
+	}
+	if (dryrun) {
+		snprintf(message, sizeof(message), "Validated %d object(s)", numItems);
+	} else {
+		sccp_device_schedulePendingUpdates(NULL);
+		if (iWebService.invalidateCache) {
+			iWebService.invalidateCache();
+		}
+		if (sccp_strlen_zero(message)) {
+			snprintf(message, sizeof(message), "Provisioned %d object(s)", numItems);
+		}
+	}
+	astman_send_ack(s, m, message);
+EXIT:
+	for (int idx = 0; idx < numItems; idx++) {
+		if (items[idx].changes) {
+			pbx_variables_destroy(items[idx].changes);
+		}
+		if (items[idx].variables) {
+			pbx_variables_destroy(items[idx].variables);
+		}
+	}
+	sccp_free(items);
+	return 0;
+}
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
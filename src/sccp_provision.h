@@ -0,0 +1,15 @@
+/*!
+ * \file        sccp_provision.h
+ * \brief       SCCP Runtime Provisioning Header
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#pragma once
+
+__BEGIN_C_EXTERN__
+SCCP_API void SCCP_CALL sccp_provision_module_start(void);
+SCCP_API void SCCP_CALL sccp_provision_module_stop(void);
+SCCP_API void SCCP_CALL sccp_provision_readDevicesLines(void);
+SCCP_API int SCCP_CALL sccp_manager_provision(struct mansession *s, const struct message *m);
+__END_C_EXTERN__
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
@@ -0,0 +1,290 @@
+/*!
+ * \file        sccp_quota.c
+ * \brief       SCCP Call Quota
+ * \note        Concurrent call and call setup rate limits per line, device and dialplan context, checked when a new
+ *              sccp channel is allocated and released again when that channel is destroyed.
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#include "config.h"
+#include "common.h"
+#include "sccp_quota.h"
+#include "sccp_device.h"
+#include "sccp_line.h"
+#include "sccp_utils.h"
+
+SCCP_FILE_VERSION(__FILE__, "");
+
+#define SCCP_QUOTA_RATE_WINDOW 60										/*!< call setup rate window in seconds */
+
+/*!
+ * \brief Call Quota per Dialplan Context
+ */
+struct sccp_quota_context {
+	SCCP_LIST_ENTRY(struct sccp_quota_context) list;
+	char context[SCCP_MAX_CONTEXT];
+	sccp_quota_t quota;
+};
+
+/* the list lock also protects the counters of the line and device quota's */
+static SCCP_LIST_HEAD(, struct sccp_quota_context) quotaContexts;
+
+void sccp_quota_module_start(void)
+{
+	SCCP_LIST_HEAD_INIT(&quotaContexts);
+}
+
+void sccp_quota_module_stop(void)
+{
+	struct sccp_quota_context * quotaContext = NULL;
+
+	SCCP_LIST_LOCK(&quotaContexts);
+	while ((quotaContext = SCCP_LIST_REMOVE_HEAD(&quotaContexts, list))) {
+		sccp_free(quotaContext);
+	}
+	SCCP_LIST_UNLOCK(&quotaContexts);
+	SCCP_LIST_HEAD_DESTROY(&quotaContexts);
+}
+
+/*!
+ * \brief Find the quota for a context, creating it when requested
+ * \note quotaContexts needs to be locked
+ */
+static sccp_quota_t * sccp_quota_findContext(const char * context, boolean_t create)
+{
+	struct sccp_quota_context * quotaContext = NULL;
+
+	SCCP_LIST_TRAVERSE(&quotaContexts, quotaContext, list) {
+		if (sccp_strequals(quotaContext->context, context)) {
+			return &quotaContext->quota;
+		}
+	}
+	if (!create || !(quotaContext = (struct sccp_quota_context *) sccp_calloc(sizeof *quotaContext, 1))) {
+		return NULL;
+	}
+	sccp_copy_string(quotaContext->context, context, sizeof(quotaContext->context));
+	SCCP_LIST_INSERT_TAIL(&quotaContexts, quotaContext, list);
+	return &quotaContext->quota;
+}
+
+static void sccp_quota_rollWindow(sccp_quota_t * const quota, time_t now)
+{
+	if (now - quota->rateWindow >= SCCP_QUOTA_RATE_WINDOW) {
+		quota->rateWindow = now;
+		quota->rateCount = 0;
+	}
+}
+
+static boolean_t sccp_quota_allows(sccp_quota_t * const quota, time_t now)
+{
+	if (quota->maxcalls && quota->active >= quota->maxcalls) {
+		return FALSE;
+	}
+	sccp_quota_rollWindow(quota, now);
+	if (quota->maxcallrate && quota->rateCount >= quota->maxcallrate) {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void sccp_quota_charge(sccp_quota_t * const quota, time_t now)
+{
+	sccp_quota_rollWindow(quota, now);
+	quota->active++;
+	quota->rateCount++;
+}
+
+static void sccp_quota_uncharge(sccp_quota_t * const quota)
+{
+	if (quota->active) {
+		quota->active--;
+	}
+}
+
+/*!
+ * \brief Charge a new call against the line, device (optional) and context quota
+ * \param charged set to TRUE when the call was charged and needs to be released by sccp_quota_release
+ * \return FALSE when one of the quota would be exceeded, nothing is charged in that case
+ *
+ * \note Nothing is locked or allocated when no quota is configured, which is the common case
+ *
+ * \lock
+ *  - quotaContexts
+ */
+boolean_t sccp_quota_acquire(constLinePtr l, constDevicePtr d, boolean_t * const charged)
+{
+	sccp_quota_t * lineQuota = (sccp_quota_t *) &l->quota;
+	sccp_quota_t * deviceQuota = d ? (sccp_quota_t *) &d->quota : NULL;
+	sccp_quota_t * contextQuota = NULL;
+	const char * exceeded = NULL;
+	time_t now = 0;
+
+	*charged = FALSE;
+	if (!lineQuota->maxcalls && !lineQuota->maxcallrate && (!deviceQuota || (!deviceQuota->maxcalls && !deviceQuota->maxcallrate)) && !GLOB(context_quota).maxcalls && !GLOB(context_quota).maxcallrate) {
+		return TRUE;
+	}
+	now = time(0);
+
+	SCCP_LIST_LOCK(&quotaContexts);
+	if ((contextQuota = sccp_quota_findContext(l->context, TRUE))) {
+		contextQuota->maxcalls = GLOB(context_quota).maxcalls;					/* limits are global, pick up changes after reload */
+		contextQuota->maxcallrate = GLOB(context_quota).maxcallrate;
+	}
+	if (!sccp_quota_allows(lineQuota, now)) {
+		lineQuota->rejected++;
+		exceeded = "line";
+	} else if (deviceQuota && !sccp_quota_allows(deviceQuota, now)) {
+		deviceQuota->rejected++;
+		exceeded = "device";
+	} else if (contextQuota && !sccp_quota_allows(contextQuota, now)) {
+		contextQuota->rejected++;
+		exceeded = "context";
+	} else {
+		sccp_quota_charge(lineQuota, now);
+		if (deviceQuota) {
+			sccp_quota_charge(deviceQuota, now);
+		}
+		if (contextQuota) {
+			sccp_quota_charge(contextQuota, now);
+		}
+		*charged = TRUE;
+	}
+	SCCP_LIST_UNLOCK(&quotaContexts);
+
+	if (exceeded) {
+		pbx_log(LOG_NOTICE, "%s: Call Quota of %s exceeded (line:%s, context:%s), refusing new channel\n", d ? d->id : "SCCP", exceeded, l->name, l->context);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*!
+ * \brief Release a call charged by sccp_quota_acquire
+ * \param context context charged at the time of sccp_quota_acquire (the line context might have been changed by a reload)
+ *
+ * \lock
+ *  - quotaContexts
+ */
+void sccp_quota_release(constLinePtr l, constDevicePtr d, const char * context)
+{
+	sccp_quota_t * contextQuota = NULL;
+
+	SCCP_LIST_LOCK(&quotaContexts);
+	sccp_quota_uncharge((sccp_quota_t *) &l->quota);
+	if (d) {
+		sccp_quota_uncharge((sccp_quota_t *) &d->quota);
+	}
+	if ((contextQuota = sccp_quota_findContext(context, FALSE))) {
+		sccp_quota_uncharge(contextQuota);
+	}
+	SCCP_LIST_UNLOCK(&quotaContexts);
+}
+
+/*!
+ * \brief Format quota usage, like "1/4 calls, 3/10 per minute, 0 rejected"
+ */
+char * sccp_quota2str(const sccp_quota_t * const quota, char * buf, size_t size)
+{
+	char maxcalls[8] = "-";
+	char maxcallrate[8] = "-";
+
+	if (quota->maxcalls) {
+		snprintf(maxcalls, sizeof(maxcalls), "%d", quota->maxcalls);
+	}
+	if (quota->maxcallrate) {
+		snprintf(maxcallrate, sizeof(maxcallrate), "%d", quota->maxcallrate);
+	}
+	snprintf(buf, size, "%d/%s calls, %d/%s per minute, %u rejected", quota->active, maxcalls, (time(0) - quota->rateWindow < SCCP_QUOTA_RATE_WINDOW) ? quota->rateCount : 0, maxcallrate, quota->rejected);
+	return buf;
+}
+
+/*!
+ * \brief Show Call Quota
+ * \param fd Fd as int
+ * \param totals Total number of lines as int
+ * \param s AMI Session
+ * \param m Message
+ * \param argc Argc as int
+ * \param argv[] Argv[] as char
+ * \return Result as int
+ *
+ * \called_from_asterisk
+ */
+#include <asterisk/cli.h>
+int sccp_show_quotas(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[])
+{
+	int local_line_total = 0;
+	int local_table_total = 0;
+	time_t now = time(0);
+
+	/* lines and devices are only shown when they have a quota configured or when calls have been charged against them */
+#define CLI_AMI_TABLE_NAME LineQuotas
+#define CLI_AMI_TABLE_PER_ENTRY_NAME LineQuota
+#define CLI_AMI_TABLE_LIST_ITER_HEAD &GLOB(lines)
+#define CLI_AMI_TABLE_LIST_ITER_TYPE sccp_line_t
+#define CLI_AMI_TABLE_LIST_ITER_VAR l
+#define CLI_AMI_TABLE_LIST_LOCK SCCP_RWLIST_RDLOCK
+#define CLI_AMI_TABLE_LIST_ITERATOR SCCP_RWLIST_TRAVERSE
+#define CLI_AMI_TABLE_LIST_UNLOCK SCCP_RWLIST_UNLOCK
+#define CLI_AMI_TABLE_BEFORE_ITERATION														\
+	if (l->quota.maxcalls || l->quota.maxcallrate || l->quota.active || l->quota.rejected) {
+#define CLI_AMI_TABLE_AFTER_ITERATION 														\
+	}
+#define CLI_AMI_TABLE_FIELDS 															\
+ 		CLI_AMI_TABLE_FIELD(Name,		"-15.15",	s,	15,	l->name)						\
+ 		CLI_AMI_TABLE_FIELD(Context,		"-15.15",	s,	15,	l->context ? l->context : "")				\
+ 		CLI_AMI_TABLE_FIELD(Active,		"-6",		d,	6,	l->quota.active)					\
+ 		CLI_AMI_TABLE_FIELD(MaxCalls,		"-8",		d,	8,	l->quota.maxcalls)					\
+ 		CLI_AMI_TABLE_FIELD(Rate,		"-6",		d,	6,	(now - l->quota.rateWindow < SCCP_QUOTA_RATE_WINDOW) ? l->quota.rateCount : 0)	\
+ 		CLI_AMI_TABLE_FIELD(MaxRate,		"-7",		d,	7,	l->quota.maxcallrate)					\
+ 		CLI_AMI_TABLE_FIELD(Rejected,		"-8",		d,	8,	l->quota.rejected)
+#include "sccp_cli_table.h"
+	local_table_total++;
+
+#define CLI_AMI_TABLE_NAME DeviceQuotas
+#define CLI_AMI_TABLE_PER_ENTRY_NAME DeviceQuota
+#define CLI_AMI_TABLE_LIST_ITER_HEAD &GLOB(devices)
+#define CLI_AMI_TABLE_LIST_ITER_TYPE sccp_device_t
+#define CLI_AMI_TABLE_LIST_ITER_VAR d
+#define CLI_AMI_TABLE_LIST_LOCK SCCP_RWLIST_RDLOCK
+#define CLI_AMI_TABLE_LIST_ITERATOR SCCP_RWLIST_TRAVERSE
+#define CLI_AMI_TABLE_LIST_UNLOCK SCCP_RWLIST_UNLOCK
+#define CLI_AMI_TABLE_BEFORE_ITERATION														\
+	if (d->quota.maxcalls || d->quota.maxcallrate || d->quota.active || d->quota.rejected) {
+#define CLI_AMI_TABLE_AFTER_ITERATION 														\
+	}
+#define CLI_AMI_TABLE_FIELDS 															\
+ 		CLI_AMI_TABLE_FIELD(Name,		"-15.15",	s,	15,	d->id)							\
+ 		CLI_AMI_TABLE_FIELD(Active,		"-6",		d,	6,	d->quota.active)					\
+ 		CLI_AMI_TABLE_FIELD(MaxCalls,		"-8",		d,	8,	d->quota.maxcalls)					\
+ 		CLI_AMI_TABLE_FIELD(Rate,		"-6",		d,	6,	(now - d->quota.rateWindow < SCCP_QUOTA_RATE_WINDOW) ? d->quota.rateCount : 0)	\
+ 		CLI_AMI_TABLE_FIELD(MaxRate,		"-7",		d,	7,	d->quota.maxcallrate)					\
+ 		CLI_AMI_TABLE_FIELD(Rejected,		"-8",		d,	8,	d->quota.rejected)
+#include "sccp_cli_table.h"
+	local_table_total++;
+
+#define CLI_AMI_TABLE_NAME ContextQuotas
+#define CLI_AMI_TABLE_PER_ENTRY_NAME ContextQuota
+#define CLI_AMI_TABLE_LIST_ITER_HEAD &quotaContexts
+#define CLI_AMI_TABLE_LIST_ITER_TYPE struct sccp_quota_context
+#define CLI_AMI_TABLE_LIST_ITER_VAR quotaContext
+#define CLI_AMI_TABLE_LIST_LOCK SCCP_LIST_LOCK
+#define CLI_AMI_TABLE_LIST_ITERATOR SCCP_LIST_TRAVERSE
+#define CLI_AMI_TABLE_LIST_UNLOCK SCCP_LIST_UNLOCK
+#define CLI_AMI_TABLE_FIELDS 															\
+ 		CLI_AMI_TABLE_FIELD(Context,		"-31.31",	s,	31,	quotaContext->context)					\
+ 		CLI_AMI_TABLE_FIELD(Active,		"-6",		d,	6,	quotaContext->quota.active)				\
+ 		CLI_AMI_TABLE_FIELD(MaxCalls,		"-8",		d,	8,	GLOB(context_quota).maxcalls)				\
+ 		CLI_AMI_TABLE_FIELD(Rate,		"-6",		d,	6,	(now - quotaContext->quota.rateWindow < SCCP_QUOTA_RATE_WINDOW) ? quotaContext->quota.rateCount : 0)	\
+ 		CLI_AMI_TABLE_FIELD(MaxRate,		"-7",		d,	7,	GLOB(context_quota).maxcallrate)			\
+ 		CLI_AMI_TABLE_FIELD(Rejected,		"-8",		d,	8,	quotaContext->quota.rejected)
+#include "sccp_cli_table.h"
+	local_table_total++;
+
+	if (s) {
+		totals->lines = local_line_total;
+		totals->tables = local_table_total;
+	}
+	return RESULT_SUCCESS;
+}
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
@@ -0,0 +1,19 @@
+/*!
+ * \file        sccp_quota.h
+ * \brief       SCCP Call Quota Header
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#pragma once
+#include "sccp_cli.h"
+
+__BEGIN_C_EXTERN__
+SCCP_API void SCCP_CALL sccp_quota_module_start(void);
+SCCP_API void SCCP_CALL sccp_quota_module_stop(void);
+SCCP_API boolean_t SCCP_CALL sccp_quota_acquire(constLinePtr l, constDevicePtr d, boolean_t * const charged);
+SCCP_API void SCCP_CALL sccp_quota_release(constLinePtr l, constDevicePtr d, const char * context);
+SCCP_API char * SCCP_CALL sccp_quota2str(const sccp_quota_t * const quota, char * buf, size_t size);
+
+SCCP_API int SCCP_CALL sccp_show_quotas(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[]);
+__END_C_EXTERN__
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
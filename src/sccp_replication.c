@@ -0,0 +1,747 @@
+/*!
+ * \file        sccp_replication.c
+ * \brief       SCCP Hot-Standby State Replication
+ * \note        The primary streams device and feature state (registration, dnd, privacy, monitor and the call forwards per
+ *              line) as one UDP datagram per change to a standby chan_sccp instance. The standby keeps a mirror and writes
+ *              the state to astdb under the same keys the feature storage backend uses, so a phone failing over only has
+ *              to register: post registration finds dnd and call forward ready. Messages carry the full state of a device
+ *              or line (not a delta) and the primary pushes everything again every SCCP_REPLICATION_RESYNC seconds, which
+ *              covers lost datagrams. Only enabled when 'replication' is set to primary or standby in sccp.conf.
+ * \note        Every datagram carries an HMAC-SHA1 keyed with 'replication_secret' and the start time (epoch) of the primary
+ *              plus a sequence number, both covered by the HMAC. The epoch is kept in astdb and only ever goes up, also when
+ *              the primary restarts within the same second or after its clock was stepped back. The standby drops datagrams with a wrong HMAC and replays
+ *              (an older epoch, or a sequence number not above the last one seen for the current epoch).
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#include "config.h"
+#include "common.h"
+#include "sccp_replication.h"
+#include "sccp_device.h"
+#include "sccp_line.h"
+#include "sccp_linedevice.h"
+#include "sccp_netsock.h"
+#include "sccp_utils.h"
+#include <netinet/in.h>
+#include <asterisk/sha1.h>
+
+#ifndef CS_USE_POLL_COMPAT
+#include <poll.h>
+#include <sys/poll.h>
+#else
+#define AST_POLL_COMPAT 1
+#include <asterisk/poll-compat.h>
+#endif
+
+SCCP_FILE_VERSION(__FILE__, "");
+
+#define SCCP_REPLICATION_VERSION "SCCP/2"
+#define SCCP_REPLICATION_RESYNC 300										/*!< seconds between full state pushes from the primary */
+#define SCCP_REPLICATION_MSGSIZE 512
+#define SCCP_REPLICATION_BODYSIZE (SCCP_REPLICATION_MSGSIZE - 96)						/*!< leaves room for version, epoch, sequence number and hmac */
+#define SCCP_REPLICATION_MACSIZE (SHA1HashSize * 2)								/*!< hmac as hex string */
+#define SCCP_REPLICATION_SECRETSIZE 128
+
+typedef enum {
+	SCCP_REPLICATION_OFF,
+	SCCP_REPLICATION_PRIMARY,
+	SCCP_REPLICATION_STANDBY,
+} sccp_replication_role_t;
+
+static const char * const replication_role2str[] = {
+	[SCCP_REPLICATION_OFF]     = "off",
+	[SCCP_REPLICATION_PRIMARY] = "primary",
+	[SCCP_REPLICATION_STANDBY] = "standby",
+};
+
+/*!
+ * \brief Device state as last sent (primary) or received (standby)
+ */
+typedef struct sccp_replicated_device sccp_replicated_device_t;
+struct sccp_replicated_device {
+	char id[StationMaxDeviceNameSize];
+	boolean_t registered;
+	char dnd[8];
+	int privacy;
+	int monitor;
+	time_t updated;
+	SCCP_LIST_ENTRY (sccp_replicated_device_t) list;
+};
+
+static struct {
+	sccp_replication_role_t role;
+	int fd;
+	struct sockaddr_storage peer;										/*!< primary: standby to send to, standby: primary to accept from */
+	pthread_t thread;
+	boolean_t stopping;
+	char secret[SCCP_REPLICATION_SECRETSIZE];								/*!< hmac key, copied from replication_secret */
+	uint32_t epoch;												/*!< primary: our epoch (start time, kept increasing), standby: epoch of the primary last seen */
+	uint32_t seq;												/*!< primary: last sequence number sent, standby: last one received */
+	uint32_t messages;											/*!< messages sent / applied */
+	uint32_t lost;												/*!< standby: gaps in the sequence numbers */
+	uint32_t rejected;											/*!< standby: datagrams from another address, with a wrong hmac, replayed or not understood */
+	time_t lastSync;											/*!< primary: last full state push */
+} replication;
+AST_MUTEX_DEFINE_STATIC(replicationLock);
+static SCCP_LIST_HEAD (, sccp_replicated_device_t) replicatedDevices;
+
+static void sccp_replication_eventListener(const sccp_event_t * event);
+
+void sccp_replication_module_start(void)
+{
+	memset(&replication, 0, sizeof(replication));
+	replication.fd = -1;
+	replication.thread = AST_PTHREADT_NULL;
+	SCCP_LIST_HEAD_INIT(&replicatedDevices);
+	sccp_event_subscribe(SCCP_EVENT_DEVICE_REGISTERED | SCCP_EVENT_DEVICE_UNREGISTERED | SCCP_EVENT_FEATURE_CHANGED, sccp_replication_eventListener, TRUE);
+}
+
+static void sccp_replication_close(void)
+{
+	pthread_t thread = AST_PTHREADT_NULL;
+
+	pbx_mutex_lock(&replicationLock);
+	replication.stopping = TRUE;
+	thread = replication.thread;
+	replication.thread = AST_PTHREADT_NULL;
+	pbx_mutex_unlock(&replicationLock);
+
+	if (thread != AST_PTHREADT_NULL) {
+		pthread_join(thread, NULL);
+	}
+
+	pbx_mutex_lock(&replicationLock);
+	if (replication.fd > -1) {
+		close(replication.fd);
+		replication.fd = -1;
+	}
+	replication.role = SCCP_REPLICATION_OFF;
+	replication.stopping = FALSE;
+	memset(replication.secret, 0, sizeof(replication.secret));
+	pbx_mutex_unlock(&replicationLock);
+}
+
+void sccp_replication_module_stop(void)
+{
+	sccp_replicated_device_t * rd = NULL;
+
+	sccp_event_unsubscribe(SCCP_EVENT_DEVICE_REGISTERED | SCCP_EVENT_DEVICE_UNREGISTERED | SCCP_EVENT_FEATURE_CHANGED, sccp_replication_eventListener);
+	sccp_replication_close();
+	SCCP_LIST_LOCK(&replicatedDevices);
+	while ((rd = SCCP_LIST_REMOVE_HEAD(&replicatedDevices, list))) {
+		sccp_free(rd);
+	}
+	SCCP_LIST_UNLOCK(&replicatedDevices);
+	SCCP_LIST_HEAD_DESTROY(&replicatedDevices);
+}
+
+/*!
+ * \brief Remember the state of a device as sent / received
+ */
+static void sccp_replication_mirror(const char * const id, boolean_t registered, const char * const dnd, int privacy, int monitor)
+{
+	sccp_replicated_device_t * rd = NULL;
+
+	SCCP_LIST_LOCK(&replicatedDevices);
+	SCCP_LIST_TRAVERSE(&replicatedDevices, rd, list) {
+		if (sccp_strequals(rd->id, id)) {
+			break;
+		}
+	}
+	if (!rd) {
+		if (!(rd = (sccp_replicated_device_t *) sccp_calloc(1, sizeof(sccp_replicated_device_t)))) {
+			SCCP_LIST_UNLOCK(&replicatedDevices);
+			pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, id);
+			return;
+		}
+		sccp_copy_string(rd->id, id, sizeof(rd->id));
+		SCCP_LIST_INSERT_TAIL(&replicatedDevices, rd, list);
+	}
+	rd->registered = registered;
+	if (registered) {
+		sccp_copy_string(rd->dnd, dnd, sizeof(rd->dnd));
+		rd->privacy = privacy;
+		rd->monitor = monitor;
+	}
+	rd->updated = time(0);
+	SCCP_LIST_UNLOCK(&replicatedDevices);
+}
+
+/*!
+ * \brief HMAC-SHA1 (RFC 2104) of data keyed with secret, as hex string
+ */
+static void sccp_replication_hmac(const char * const secret, const char * const data, size_t len, char mac[SCCP_REPLICATION_MACSIZE + 1])
+{
+	SHA1Context sha;
+	uint8_t key[64] = { 0 };
+	uint8_t pad[64];
+	uint8_t digest[SHA1HashSize];
+	size_t keylen = strlen(secret);
+
+	if (keylen > sizeof(key)) {
+		SHA1Reset(&sha);
+		SHA1Input(&sha, (const uint8_t *) secret, keylen);
+		SHA1Result(&sha, key);
+	} else {
+		memcpy(key, secret, keylen);
+	}
+	for (uint i = 0; i < sizeof(pad); i++) {
+		pad[i] = key[i] ^ 0x36;
+	}
+	SHA1Reset(&sha);
+	SHA1Input(&sha, pad, sizeof(pad));
+	SHA1Input(&sha, (const uint8_t *) data, len);
+	SHA1Result(&sha, digest);
+	for (uint i = 0; i < sizeof(pad); i++) {
+		pad[i] = key[i] ^ 0x5c;
+	}
+	SHA1Reset(&sha);
+	SHA1Input(&sha, pad, sizeof(pad));
+	SHA1Input(&sha, digest, sizeof(digest));
+	SHA1Result(&sha, digest);
+	for (uint i = 0; i < sizeof(digest); i++) {
+		snprintf(mac + i * 2, 3, "%02x", digest[i]);
+	}
+}
+
+/*!
+ * \brief Send one message to the standby: "<version> <epoch> <seq> <body> <hmac>"
+ */
+static void sccp_replication_send(const char * const body)
+{
+	char msg[SCCP_REPLICATION_MSGSIZE];
+	char mac[SCCP_REPLICATION_MACSIZE + 1] = "";
+	int len = 0;
+
+	pbx_mutex_lock(&replicationLock);
+	if (replication.role == SCCP_REPLICATION_PRIMARY && replication.fd > -1) {
+		len = snprintf(msg, sizeof(msg), "%s %u %u %s", SCCP_REPLICATION_VERSION, replication.epoch, ++replication.seq, body);
+		if (len + 1 + SCCP_REPLICATION_MACSIZE < (int) sizeof(msg)) {
+			sccp_replication_hmac(replication.secret, msg, len, mac);
+			len += snprintf(msg + len, sizeof(msg) - len, " %s", mac);
+		}
+		if (len >= (int) sizeof(msg) || !mac[0]) {
+			pbx_log(LOG_WARNING, "SCCP: (replication) message too long, not sent: %s\n", body);
+		} else if (sendto(replication.fd, msg, len, 0, (struct sockaddr *) &replication.peer, sccp_netsock_sizeof(&replication.peer)) < 0) {
+			sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "SCCP: (replication) send failed: %s\n", strerror(errno));
+		} else {
+			replication.messages++;
+		}
+	}
+	pbx_mutex_unlock(&replicationLock);
+}
+
+/*!
+ * \brief Send the full state of a device and its lines
+ * \note device->lineButtons is not locked, same as the feature storage backend
+ */
+static void sccp_replication_sendDevice(constDevicePtr d)
+{
+	char body[SCCP_REPLICATION_BODYSIZE];
+	const char * dnd = "off";
+	boolean_t registered = (sccp_device_getRegistrationState(d) == SKINNY_DEVICE_RS_OK) ? TRUE : FALSE;
+	int monitor = (d->monitorFeature.status & SCCP_FEATURE_MONITOR_STATE_REQUESTED) ? 1 : 0;
+	int pos = 0;
+
+	if (d->dndFeature.status) {
+		dnd = (d->dndFeature.status == SCCP_DNDMODE_SILENT) ? "silent" : "reject";
+	}
+	snprintf(body, sizeof(body), "device %s %d %s %d %d", d->id, registered ? 1 : 0, dnd, (int) d->privacyFeature.status, monitor);
+	sccp_replication_send(body);
+	sccp_replication_mirror(d->id, registered, dnd, d->privacyFeature.status, monitor);
+	if (!registered) {
+		return;
+	}
+	for (uint8_t instance = SCCP_FIRST_LINEINSTANCE; instance < d->lineButtons.size; instance++) {
+		if (d->lineButtons.instance[instance]) {
+			AUTO_RELEASE(sccp_linedevice_t, ld, sccp_linedevice_retain(d->lineButtons.instance[instance]));
+			if (ld) {
+				pos = snprintf(body, sizeof(body), "cfwd %s %s", d->id, ld->line->name);
+				for (uint x = SCCP_CFWD_ALL; x < SCCP_CFWD_SENTINEL && pos < (int) sizeof(body); x++) {
+					pos += snprintf(body + pos, sizeof(body) - pos, " %s", (ld->cfwd[x].enabled && !sccp_strlen_zero(ld->cfwd[x].number)) ? ld->cfwd[x].number : "-");
+				}
+				sccp_replication_send(body);
+			}
+		}
+	}
+}
+
+/*!
+ * \brief Push the state of all registered devices to the standby
+ * \note the device ids are copied first, so the devices list is not locked while sending
+ */
+static void sccp_replication_sync(void)
+{
+	sccp_device_t * d = NULL;
+	struct sockaddr_storage peer;
+	char (*ids)[StationMaxDeviceNameSize] = NULL;
+	int numIds = 0;
+
+	pbx_mutex_lock(&replicationLock);
+	if (replication.role != SCCP_REPLICATION_PRIMARY) {
+		pbx_mutex_unlock(&replicationLock);
+		return;
+	}
+	replication.lastSync = time(0);
+	memcpy(&peer, &replication.peer, sizeof(peer));
+	pbx_mutex_unlock(&replicationLock);
+	SCCP_RWLIST_RDLOCK(&GLOB(devices));
+	if (SCCP_RWLIST_GETSIZE(&GLOB(devices)) && !(ids = (char (*)[StationMaxDeviceNameSize]) sccp_calloc(SCCP_RWLIST_GETSIZE(&GLOB(devices)), sizeof(*ids)))) {
+		SCCP_RWLIST_UNLOCK(&GLOB(devices));
+		pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+		return;
+	}
+	SCCP_RWLIST_TRAVERSE(&GLOB(devices), d, list) {
+		if (sccp_device_getRegistrationState(d) == SKINNY_DEVICE_RS_OK) {
+			sccp_copy_string(ids[numIds++], d->id, sizeof(ids[0]));
+		}
+	}
+	SCCP_RWLIST_UNLOCK(&GLOB(devices));
+
+	for (int idx = 0; idx < numIds; idx++) {
+		AUTO_RELEASE(sccp_device_t, device, sccp_device_find_byid(ids[idx], FALSE));
+		if (device && sccp_device_getRegistrationState(device) == SKINNY_DEVICE_RS_OK) {
+			sccp_replication_sendDevice(device);
+		}
+	}
+	if (ids) {
+		sccp_free(ids);
+	}
+	sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "SCCP: (replication) full state sent to %s\n", sccp_netsock_stringify(&peer));
+}
+
+static void sccp_replication_eventListener(const sccp_event_t * event)
+{
+	sccp_replication_role_t role = SCCP_REPLICATION_OFF;
+
+	if (!event) {
+		return;
+	}
+	pbx_mutex_lock(&replicationLock);
+	role = replication.role;
+	pbx_mutex_unlock(&replicationLock);
+	if (role != SCCP_REPLICATION_PRIMARY) {
+		return;
+	}
+	switch (event->type) {
+		case SCCP_EVENT_DEVICE_REGISTERED:
+		case SCCP_EVENT_DEVICE_UNREGISTERED:
+			if (event->deviceRegistered.device) {
+				sccp_replication_sendDevice(event->deviceRegistered.device);
+			}
+			break;
+		case SCCP_EVENT_FEATURE_CHANGED:
+			if (event->featureChanged.device) {
+				sccp_replication_sendDevice(event->featureChanged.device);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/*!
+ * \brief Is this device registered on this (standby) node, then its own state wins over what the primary sends
+ */
+static boolean_t sccp_replication_isLocal(const char * const id)
+{
+	AUTO_RELEASE(sccp_device_t, d, sccp_device_find_byid(id, FALSE));
+
+	return (d && sccp_device_getRegistrationState(d) != SKINNY_DEVICE_RS_NONE) ? TRUE : FALSE;
+}
+
+/*!
+ * \brief Apply a device message on the standby: "device <id> <registered> <dnd> <privacy> <monitor>"
+ */
+static boolean_t sccp_replication_applyDevice(const char * const args)
+{
+	char id[StationMaxDeviceNameSize] = "";
+	char dnd[8] = "";
+	char family[25] = "";
+	char data[16] = "";
+	int registered = 0;
+	int privacy = 0;
+	int monitor = 0;
+
+	if (sscanf(args, "%15s %d %7s %d %d", id, &registered, dnd, &privacy, &monitor) != 5) {
+		return FALSE;
+	}
+	if (sccp_replication_isLocal(id)) {
+		return TRUE;
+	}
+	sccp_replication_mirror(id, registered ? TRUE : FALSE, dnd, privacy, monitor);
+	if (!registered) {
+		return TRUE;
+	}
+	snprintf(family, sizeof(family), "SCCP/%s", id);
+	if (sccp_strequals(dnd, "off")) {
+		iPbx.feature_removeFromDatabase(family, "dnd");
+	} else {
+		iPbx.feature_addToDatabase(family, "dnd", dnd);
+	}
+	if (!privacy) {
+		iPbx.feature_removeFromDatabase(family, "privacy");
+	} else {
+		snprintf(data, sizeof(data), "%d", privacy);
+		iPbx.feature_addToDatabase(family, "privacy", data);
+	}
+	if (!monitor) {
+		iPbx.feature_removeFromDatabase(family, "monitor");
+	} else {
+		iPbx.feature_addToDatabase(family, "monitor", "on");
+	}
+	return TRUE;
+}
+
+/*!
+ * \brief Apply a call forward message on the standby: "cfwd <id> <line> <all> <busy> <noanswer>", '-' = not set
+ */
+static boolean_t sccp_replication_applyCfwd(const char * const args)
+{
+	char id[StationMaxDeviceNameSize] = "";
+	char line[StationMaxNameSize] = "";
+	char cfwdDeviceLineStore[60];										/* backward compatibiliy SCCP/Device/Line */
+	char cfwdLineDeviceStore[60];										/* new format cfwd: SCCP/Line/Device */
+	char * numbers = NULL;
+	char * number = NULL;
+	char * tokens = NULL;
+	int n = 0;
+
+	if (sscanf(args, "%15s %39s %n", id, line, &n) != 2 || !n) {
+		return FALSE;
+	}
+	if (sccp_replication_isLocal(id)) {
+		return TRUE;
+	}
+	numbers = pbx_strdupa(args + n);
+	snprintf(cfwdDeviceLineStore, sizeof(cfwdDeviceLineStore), "SCCP/%s/%s", id, line);
+	snprintf(cfwdLineDeviceStore, sizeof(cfwdLineDeviceStore), "SCCP/%s/%s", line, id);
+	for (uint x = SCCP_CFWD_ALL; x < SCCP_CFWD_SENTINEL; x++) {
+		char cfwdstr[15] = "";
+		if (!(number = strtok_r(x == SCCP_CFWD_ALL ? numbers : NULL, " \n", &tokens))) {
+			return FALSE;
+		}
+		snprintf(cfwdstr, 14, "cfwd%s", sccp_cfwd2str((sccp_cfwd_t)x));
+		if (sccp_strequals(number, "-")) {
+			iPbx.feature_removeFromDatabase(cfwdDeviceLineStore, cfwdstr);
+			iPbx.feature_removeFromDatabase(cfwdLineDeviceStore, cfwdstr);
+		} else {
+			iPbx.feature_addToDatabase(cfwdDeviceLineStore, cfwdstr, number);
+			iPbx.feature_addToDatabase(cfwdLineDeviceStore, cfwdstr, number);
+		}
+	}
+	return TRUE;
+}
+
+/*!
+ * \brief Check and strip the hmac at the end of a datagram received from the primary
+ * \note the hex strings are compared in constant time
+ */
+static boolean_t sccp_replication_verify(char * const msg, const char * const secret)
+{
+	char mac[SCCP_REPLICATION_MACSIZE + 1] = "";
+	char * received = strrchr(msg, ' ');
+	uint8_t diff = 0;
+
+	if (!received || strlen(received + 1) != SCCP_REPLICATION_MACSIZE) {
+		return FALSE;
+	}
+	sccp_replication_hmac(secret, msg, received - msg, mac);
+	for (uint i = 0; i < SCCP_REPLICATION_MACSIZE; i++) {
+		diff |= mac[i] ^ received[i + 1];
+	}
+	if (diff) {
+		return FALSE;
+	}
+	*received = '\0';
+	return TRUE;
+}
+
+/*!
+ * \brief Apply one datagram received from the primary
+ */
+static void sccp_replication_apply(char * const msg)
+{
+	char version[8] = "";
+	char type[8] = "";
+	char secret[SCCP_REPLICATION_SECRETSIZE] = "";
+	uint32_t epoch = 0;
+	uint32_t seq = 0;
+	boolean_t fresh = FALSE;
+	boolean_t applied = FALSE;
+	int n = 0;
+
+	pbx_mutex_lock(&replicationLock);
+	sccp_copy_string(secret, replication.secret, sizeof(secret));
+	pbx_mutex_unlock(&replicationLock);
+	if (!sccp_replication_verify(msg, secret)) {
+		pbx_mutex_lock(&replicationLock);
+		replication.rejected++;
+		pbx_mutex_unlock(&replicationLock);
+		sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "SCCP: (replication) dropping message with invalid hmac\n");
+		return;
+	}
+	if (sscanf(msg, "%7s %u %u %7s %n", version, &epoch, &seq, type, &n) != 4 || !n || !sccp_strequals(version, SCCP_REPLICATION_VERSION)) {
+		pbx_mutex_lock(&replicationLock);
+		replication.rejected++;
+		pbx_mutex_unlock(&replicationLock);
+		sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "SCCP: (replication) ignoring message '%s'\n", msg);
+		return;
+	}
+
+	pbx_mutex_lock(&replicationLock);
+	if (epoch > replication.epoch) {								/* primary (re)started, new sequence */
+		replication.epoch = epoch;
+		replication.seq = seq;
+		fresh = TRUE;
+	} else if (epoch == replication.epoch && seq > replication.seq) {
+		if (seq > replication.seq + 1) {
+			replication.lost += seq - replication.seq - 1;
+		}
+		replication.seq = seq;
+		fresh = TRUE;
+	} else {
+		replication.rejected++;
+	}
+	pbx_mutex_unlock(&replicationLock);
+	if (!fresh) {
+		sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "SCCP: (replication) dropping replayed message '%s'\n", msg);
+		return;
+	}
+
+	if (sccp_strequals(type, "device")) {
+		applied = sccp_replication_applyDevice(msg + n);
+	} else if (sccp_strequals(type, "cfwd")) {
+		applied = sccp_replication_applyCfwd(msg + n);
+	}
+	pbx_mutex_lock(&replicationLock);
+	if (!applied) {
+		replication.rejected++;
+	} else {
+		replication.messages++;
+	}
+	pbx_mutex_unlock(&replicationLock);
+	if (!applied) {
+		sccp_log((DEBUGCAT_CORE)) (VERBOSE_PREFIX_3 "SCCP: (replication) ignoring message '%s'\n", msg);
+	}
+}
+
+/*!
+ * \brief Standby: receive and apply the messages from the primary. Primary: push the full state every SCCP_REPLICATION_RESYNC seconds
+ */
+static void *sccp_replication_thread(void *data)
+{
+	char buffer[SCCP_REPLICATION_MSGSIZE];
+	struct sockaddr_storage from;
+	socklen_t fromlen = 0;
+	struct sockaddr_storage peer;
+	struct pollfd fds[1] = {{ 0 }};
+	sccp_replication_role_t role = SCCP_REPLICATION_OFF;
+	boolean_t stopping = FALSE;
+	boolean_t resync = FALSE;
+	ssize_t len = 0;
+
+	pbx_mutex_lock(&replicationLock);
+	fds[0].fd = replication.fd;
+	memcpy(&peer, &replication.peer, sizeof(peer));
+	pbx_mutex_unlock(&replicationLock);
+	fds[0].events = POLLIN;
+	while (1) {
+		pbx_mutex_lock(&replicationLock);
+		stopping = replication.stopping;
+		role = replication.role;
+		resync = (role == SCCP_REPLICATION_PRIMARY && time(0) - replication.lastSync >= SCCP_REPLICATION_RESYNC) ? TRUE : FALSE;
+		pbx_mutex_unlock(&replicationLock);
+		if (stopping) {
+			break;
+		}
+		if (resync) {
+			sccp_replication_sync();
+		}
+		if (poll(fds, 1, 1000) <= 0 || !(fds[0].revents & POLLIN)) {
+			continue;
+		}
+		fromlen = sizeof(from);
+		if ((len = recvfrom(fds[0].fd, buffer, sizeof(buffer) - 1, 0, (struct sockaddr *) &from, &fromlen)) <= 0) {
+			continue;
+		}
+		buffer[len] = '\0';
+		if (role != SCCP_REPLICATION_STANDBY) {
+			continue;
+		}
+		if (sccp_netsock_cmp_addr(&from, &peer)) {								// 0 = equal
+			pbx_mutex_lock(&replicationLock);
+			replication.rejected++;
+			pbx_mutex_unlock(&replicationLock);
+			continue;
+		}
+		sccp_replication_apply(buffer);
+	}
+	return NULL;
+}
+
+/*!
+ * \brief Epoch for a (re)starting primary: the current time, but always above the last epoch used (kept in astdb)
+ * \note a restart within the same second, or with the clock stepped back, would otherwise be taken for a replay by the standby
+ */
+static uint32_t sccp_replication_nextEpoch(void)
+{
+	char buffer[16] = "";
+	uint32_t epoch = (uint32_t) time(0);
+	uint32_t last = 0;
+
+	if (iPbx.feature_getFromDatabase("SCCP/replication", "epoch", buffer, sizeof(buffer)) && sscanf(buffer, "%u", &last) == 1 && last >= epoch) {
+		epoch = last + 1;
+	}
+	snprintf(buffer, sizeof(buffer), "%u", epoch);
+	if (!iPbx.feature_addToDatabase("SCCP/replication", "epoch", buffer)) {
+		pbx_log(LOG_WARNING, "SCCP: (replication) could not store epoch %u\n", epoch);
+	}
+	return epoch;
+}
+
+/*!
+ * \brief (Re)start replication after the configuration was read
+ */
+void sccp_replication_reload(void)
+{
+	sccp_replication_role_t role = SCCP_REPLICATION_OFF;
+	struct sockaddr_storage bindaddr = { 0 };
+	const char * secret = GLOB(replication_secret) ? GLOB(replication_secret) : "";
+	boolean_t unchanged = FALSE;
+	int fd = -1;
+
+	if (sccp_strcaseequals(GLOB(replication), "primary")) {
+		role = SCCP_REPLICATION_PRIMARY;
+	} else if (sccp_strcaseequals(GLOB(replication), "standby")) {
+		role = SCCP_REPLICATION_STANDBY;
+	} else if (!sccp_strlen_zero(GLOB(replication)) && !sccp_strcaseequals(GLOB(replication), "off")) {
+		pbx_log(LOG_WARNING, "SCCP: replication '%s' is not valid, use off, primary or standby\n", GLOB(replication));
+	}
+	pbx_mutex_lock(&replicationLock);
+	unchanged = (role == replication.role && sccp_strequals(replication.secret, secret) && !sccp_netsock_cmp_addr(&replication.peer, &GLOB(replication_addr)) && !sccp_netsock_cmp_port(&replication.peer, &GLOB(replication_addr))) ? TRUE : FALSE;
+	pbx_mutex_unlock(&replicationLock);
+	if (unchanged) {
+		return;
+	}
+	sccp_replication_close();
+	if (role == SCCP_REPLICATION_OFF) {
+		return;
+	}
+	if (sccp_netsock_is_any_addr(&GLOB(replication_addr))) {
+		pbx_log(LOG_ERROR, "SCCP: replication=%s needs replication_addr, replication disabled\n", replication_role2str[role]);
+		return;
+	}
+	if (sccp_strlen_zero(secret) || strlen(secret) >= SCCP_REPLICATION_SECRETSIZE) {
+		pbx_log(LOG_ERROR, "SCCP: replication=%s needs a replication_secret of 1 to %d characters, replication disabled\n", replication_role2str[role], SCCP_REPLICATION_SECRETSIZE - 1);
+		return;
+	}
+
+	if ((fd = socket(GLOB(replication_addr).ss_family, SOCK_DGRAM, 0)) < 0) {
+		pbx_log(LOG_ERROR, "SCCP: Unable to create replication socket: %s\n", strerror(errno));
+		return;
+	}
+	if (role == SCCP_REPLICATION_STANDBY) {
+		bindaddr.ss_family = GLOB(replication_addr).ss_family;
+		if (bindaddr.ss_family == AF_INET6) {
+			((struct sockaddr_in6 *) &bindaddr)->sin6_port = ((struct sockaddr_in6 *) &GLOB(replication_addr))->sin6_port;
+		} else {
+			((struct sockaddr_in *) &bindaddr)->sin_port = ((struct sockaddr_in *) &GLOB(replication_addr))->sin_port;
+		}
+		if (bind(fd, (struct sockaddr *) &bindaddr, sccp_netsock_sizeof(&bindaddr)) < 0) {
+			pbx_log(LOG_ERROR, "SCCP: Unable to bind replication port %d: %s\n", sccp_netsock_getPort(&GLOB(replication_addr)), strerror(errno));
+			close(fd);
+			return;
+		}
+	}
+
+	uint32_t epoch = (role == SCCP_REPLICATION_PRIMARY) ? sccp_replication_nextEpoch() : 0;
+
+	pbx_mutex_lock(&replicationLock);
+	replication.fd = fd;
+	replication.role = role;
+	memcpy(&replication.peer, &GLOB(replication_addr), sizeof(replication.peer));
+	sccp_copy_string(replication.secret, secret, sizeof(replication.secret));
+	replication.epoch = epoch;
+	replication.seq = 0;
+	replication.lastSync = 0;
+	if (pbx_pthread_create(&replication.thread, NULL, sccp_replication_thread, NULL)) {
+		pbx_log(LOG_ERROR, "SCCP: Unable to start replication thread\n");
+		replication.thread = AST_PTHREADT_NULL;
+		replication.role = SCCP_REPLICATION_OFF;
+		replication.fd = -1;
+		close(fd);
+	}
+	role = replication.role;
+	pbx_mutex_unlock(&replicationLock);
+	if (role != SCCP_REPLICATION_OFF) {
+		pbx_log(LOG_NOTICE, "SCCP: Replication %s %s\n", role == SCCP_REPLICATION_PRIMARY ? "streaming to standby" : "accepting from primary", sccp_netsock_stringify(&GLOB(replication_addr)));
+	}
+}
+
+/*!
+ * \brief Replication status line for 'sccp show globals'
+ */
+const char * sccp_replication_status(char * const buf, size_t size)
+{
+	pbx_mutex_lock(&replicationLock);
+	switch (replication.role) {
+		case SCCP_REPLICATION_PRIMARY:
+			snprintf(buf, size, "primary -> %s (sent:%u)", sccp_netsock_stringify(&replication.peer), replication.messages);
+			break;
+		case SCCP_REPLICATION_STANDBY:
+			snprintf(buf, size, "standby <- %s (applied:%u, lost:%u, rejected:%u)", sccp_netsock_stringify_addr(&replication.peer), replication.messages, replication.lost, replication.rejected);
+			break;
+		case SCCP_REPLICATION_OFF:
+		default:
+			snprintf(buf, size, "%s", replication_role2str[SCCP_REPLICATION_OFF]);
+			break;
+	}
+	pbx_mutex_unlock(&replicationLock);
+	return buf;
+}
+
+/*!
+ * \brief Show Replicated Devices
+ * \param fd Fd as int
+ * \param totals Total number of lines as int
+ * \param s AMI Session
+ * \param m Message
+ * \param argc Argc as int
+ * \param argv[] Argv[] as char
+ * \return Result as int
+ *
+ * \called_from_asterisk
+ */
+#include <asterisk/cli.h>
+int sccp_show_replication(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[])
+{
+	int local_line_total = 0;
+	int local_table_total = 0;
+	time_t now = time(0);
+
+#define CLI_AMI_TABLE_NAME Replication
+#define CLI_AMI_TABLE_PER_ENTRY_NAME Device
+#define CLI_AMI_TABLE_LIST_ITER_HEAD &replicatedDevices
+#define CLI_AMI_TABLE_LIST_ITER_TYPE sccp_replicated_device_t
+#define CLI_AMI_TABLE_LIST_ITER_VAR rd
+#define CLI_AMI_TABLE_LIST_LOCK SCCP_LIST_LOCK
+#define CLI_AMI_TABLE_LIST_ITERATOR SCCP_LIST_TRAVERSE
+#define CLI_AMI_TABLE_LIST_UNLOCK SCCP_LIST_UNLOCK
+#define CLI_AMI_TABLE_FIELDS 															\
+ 		CLI_AMI_TABLE_FIELD(Device,		"-16.16",	s,	16,	rd->id)							\
+ 		CLI_AMI_TABLE_FIELD(Registered,		"-10.10",	s,	10,	rd->registered ? "yes" : "no")				\
+ 		CLI_AMI_TABLE_FIELD(DND,		"-6.6",		s,	6,	rd->dnd)						\
+ 		CLI_AMI_TABLE_FIELD(Privacy,		"-7",		d,	7,	rd->privacy)						\
+ 		CLI_AMI_TABLE_FIELD(Monitor,		"-7",		d,	7,	rd->monitor)						\
+ 		CLI_AMI_TABLE_FIELD(Age,		"-8",		d,	8,	(int) (now - rd->updated))
+#include "sccp_cli_table.h"
+	local_table_total++;
+
+	if (s) {
+		totals->lines = local_line_total;
+		totals->tables = local_table_total;
+	}
+	return RESULT_SUCCESS;
+}
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
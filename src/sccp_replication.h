@@ -0,0 +1,18 @@
+/*!
+ * \file        sccp_replication.h
+ * \brief       SCCP Hot-Standby State Replication Header
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#pragma once
+#include "sccp_cli.h"
+
+__BEGIN_C_EXTERN__
+SCCP_API void SCCP_CALL sccp_replication_module_start(void);
+SCCP_API void SCCP_CALL sccp_replication_module_stop(void);
+SCCP_API void SCCP_CALL sccp_replication_reload(void);
+SCCP_API const char * SCCP_CALL sccp_replication_status(char * const buf, size_t size);
+
+SCCP_API int SCCP_CALL sccp_show_replication(int fd, sccp_cli_totals_t *totals, struct mansession *s, const struct message *m, int argc, char *argv[]);
+__END_C_EXTERN__
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
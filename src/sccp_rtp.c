@@ -359,6 +359,7 @@ void sccp_rtp_set_phone(constChannelPtr c, rtpPtr rtp, struct sockaddr_storage *
 		char peerIpStr[NI_MAXHOST + NI_MAXSERV];
 		char remoteIpStr[NI_MAXHOST + NI_MAXSERV];
 		char phoneIpStr[NI_MAXHOST + NI_MAXSERV];
+		memcpy(&rtp->phone_reported, new_peer, sizeof(rtp->phone_reported));
 		if (device->nat >= SCCP_NAT_ON) {
 			/* Rewrite ip-addres to the outside source address using the phones connection (device->sin) */
 			sccp_copy_string(peerIpStr, sccp_netsock_stringify(new_peer), sizeof(peerIpStr));
@@ -461,6 +462,117 @@ void sccp_rtp_print(constChannelPtr c, sccp_rtp_type_t type, struct ast_str * bu
 	}
 }
 
+/*!
+ * \brief Is addr inside the configured local networks ('localnet')
+ */
+static boolean_t sccp_rtp_isLocalNet(const struct sockaddr_storage * addr)
+{
+	return (GLOB(localaddr) && !sccp_netsock_is_any_addr(addr) && sccp_apply_ha_default(GLOB(localaddr), addr, AST_SENSE_DENY) == AST_SENSE_ALLOW) ? TRUE : FALSE;
+}
+
+/*!
+ * \brief Address the phone sends/receives media from, as reported in openreceivechannel_ack, or the session address before that
+ */
+static boolean_t sccp_rtp_getPhoneAddr(constDevicePtr d, constRtpPtr rtp, struct sockaddr_storage * addr)
+{
+	if (rtp && !sccp_netsock_is_any_addr(&rtp->phone)) {
+		memcpy(addr, &rtp->phone, sizeof(struct sockaddr_storage));
+		return TRUE;
+	}
+	return d->session ? sccp_session_getSas(d->session, addr) : FALSE;
+}
+
+/*!
+ * \brief Can the phone take part in direct rtp for this call, without knowing the remote endpoint yet (used for the rtp glue)
+ */
+static boolean_t sccp_rtp_mayUseDirectMedia(constDevicePtr d, constChannelPtr c, constRtpPtr rtp)
+{
+	struct sockaddr_storage phone = { 0 };
+
+	if (c->conference || d->nat > SCCP_NAT_AUTO_OFF) {
+		return FALSE;
+	}
+	if (d->directrtp) {
+		return TRUE;
+	}
+	return (d->autodirectrtp && sccp_rtp_getPhoneAddr(d, rtp, &phone) && sccp_rtp_isLocalNet(&phone)) ? TRUE : FALSE;
+}
+
+/*!
+ * \brief Media anchoring decision: can media flow directly between the phone and the remote rtp endpoint, or does it have to pass through the pbx
+ * \param d Device
+ * \param c Channel
+ * \param rtp rtp of the channel (audio/video)
+ * \param remote remote rtp address (the bridged peer)
+ * \param local local address of the rtp instance
+ * \param remoteNatActive remote side reports nat
+ *
+ * \note 'directrtp = yes' keeps the static behaviour (remote has to match the device permit/deny list).
+ *       'autodirectrtp = yes' decides per call: both the phone and the remote endpoint have to be inside 'localnet'
+ *       and of the same address family, no nat may be involved on either side.
+ */
+boolean_t sccp_rtp_allowDirectMedia(constDevicePtr d, constChannelPtr c, constRtpPtr rtp, const struct sockaddr_storage * remote, const struct sockaddr_storage * local, boolean_t remoteNatActive)
+{
+	struct sockaddr_storage phone = { 0 };
+
+	if (c->conference || remoteNatActive || d->nat >= SCCP_NAT_ON || sccp_netsock_is_any_addr(remote)) {
+		return FALSE;
+	}
+	if (d->directrtp) {
+		if (d->nat == SCCP_NAT_OFF) {									// forced nat off to circumvent autodetection + direcrtp, requires checking both phone_ip and external session ip address against devices permit/deny
+			return (sccp_apply_ha(d->ha, remote) == AST_SENSE_ALLOW && sccp_apply_ha(d->ha, local) == AST_SENSE_ALLOW) ? TRUE : FALSE;
+		}
+		return sccp_apply_ha(d->ha, remote) == AST_SENSE_ALLOW ? TRUE : FALSE;				// check remote sin against local device acl (to match netmask)
+	}
+	if (!d->autodirectrtp || !sccp_rtp_getPhoneAddr(d, rtp, &phone)) {
+		return FALSE;
+	}
+	boolean_t phoneIPv4 = sccp_netsock_is_IPv4(&phone) || sccp_netsock_is_mapped_IPv4(&phone);
+	boolean_t remoteIPv4 = sccp_netsock_is_IPv4(remote) || sccp_netsock_is_mapped_IPv4(remote);
+	boolean_t reachable = (phoneIPv4 == remoteIPv4 && sccp_rtp_isLocalNet(&phone) && sccp_rtp_isLocalNet(remote)) ? TRUE : FALSE;
+
+	if ((GLOB(debug) & DEBUGCAT_RTP) != 0) {
+		char phonestr[NI_MAXHOST];
+		sccp_copy_string(phonestr, sccp_netsock_stringify_addr(&phone), sizeof(phonestr));
+		sccp_log(DEBUGCAT_RTP)(VERBOSE_PREFIX_3 "%s: (allowDirectMedia) phone:%s, remote:%s => %s\n", c->designator, phonestr, sccp_netsock_stringify_addr(remote), reachable ? "direct rtp" : "anchored on pbx");
+	}
+	return reachable;
+}
+
+/*!
+ * \brief Does the phone need a firewall hole punch before early rtp can reach it
+ * \note punching is only necessary when there is a potential firewall between the phone and the pbx: the phone reported an address
+ *       that differs from the one its session comes from (address translation). With 'autodirectrtp' the media of a phone inside
+ *       'localnet' never crosses a firewall, so it is skipped as well.
+ * \note rtp->phone has already been rewritten to the session address when nat is on, compare the address the phone reported.
+ */
+boolean_t sccp_rtp_needsHolePunch(constDevicePtr d, constRtpPtr rtp)
+{
+	struct sockaddr_storage sas = { 0 };
+	struct sockaddr_storage phone = { 0 };
+	struct sockaddr_storage mapped = { 0 };
+
+	if (!d->session || !sccp_session_getSas(d->session, &sas)) {
+		return TRUE;
+	}
+	if (d->autodirectrtp && sccp_rtp_isLocalNet(&sas)) {
+		return FALSE;
+	}
+	if (rtp && !sccp_netsock_is_any_addr(&rtp->phone_reported)) {
+		memcpy(&phone, &rtp->phone_reported, sizeof(struct sockaddr_storage));
+		if (sccp_netsock_ipv4_mapped(&phone, &mapped)) {
+			memcpy(&phone, &mapped, sizeof(struct sockaddr_storage));
+		}
+		if (sccp_netsock_ipv4_mapped(&sas, &mapped)) {
+			memcpy(&sas, &mapped, sizeof(struct sockaddr_storage));
+		}
+		if (sccp_netsock_cmp_addr(&phone, &sas) == 0) {							// no address translation between phone and pbx
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 /*!
  * \brief Get Audio Peer RTP Information
  */
@@ -477,8 +589,7 @@ sccp_rtp_info_t sccp_rtp_getAudioPeerInfo(constChannelPtr c, sccp_rtp_t ** rtp)
 	*rtp = &(((sccp_channel_t *)c)->rtp.audio);
 
 	result = SCCP_RTP_INFO_AVAILABLE;
-	// \todo add apply_ha(d->ha, &sin) check here instead
-	if (device->directrtp && device->nat <= SCCP_NAT_AUTO_OFF && !c->conference) {
+	if (sccp_rtp_mayUseDirectMedia(device, c, *rtp)) {							// final decision per remote address in sccp_rtp_allowDirectMedia
 		result |= SCCP_RTP_INFO_ALLOW_DIRECTRTP;
 	}
 	return (sccp_rtp_info_t)result;
@@ -501,7 +612,7 @@ sccp_rtp_info_t sccp_rtp_getVideoPeerInfo(constChannelPtr c, sccp_rtp_t ** rtp)
 	*rtp = &(((sccp_channel_t *)c)->rtp.video);
 
 	result = SCCP_RTP_INFO_AVAILABLE;
-	if (device->directrtp && device->nat <= SCCP_NAT_AUTO_OFF && !c->conference) {
+	if (sccp_rtp_mayUseDirectMedia(device, c, *rtp)) {
 		result |= SCCP_RTP_INFO_ALLOW_DIRECTRTP;
 	}
 	return (sccp_rtp_info_t)result;
@@ -34,6 +34,7 @@ struct sccp_rtp {
 	sccp_rtp_direction_t reception;										/* receive rtp / ORC */
 	sccp_rtp_direction_t transmission;									/* transmit rtp / SMT */
 	struct sockaddr_storage phone;										/*!< our phone information (openreceive) */
+	struct sockaddr_storage phone_reported;									/*!< media address as reported by the phone, before the nat rewrite (sccp_rtp_needsHolePunch) */
 	struct sockaddr_storage phone_remote;									/*!< phone destination address (starttransmission) */
 	uint16_t RTCPPortNumber;										/*!< RTCP Port used by the phone */
  	boolean_t directMedia;											/*!< Show if we are running in directmedia mode (set in pbx_impl during rtp bridging) */
@@ -48,6 +49,8 @@ SCCP_API void SCCP_CALL sccp_rtp_set_phone(constChannelPtr c, rtpPtr rtp, struct
 SCCP_API int SCCP_CALL sccp_rtp_updateNatRemotePhone(constChannelPtr c, rtpPtr rtp);
 SCCP_API void SCCP_CALL sccp_rtp_print(constChannelPtr c, sccp_rtp_type_t type, struct ast_str * buf, int buflen);
 
+SCCP_API boolean_t SCCP_CALL sccp_rtp_allowDirectMedia(constDevicePtr d, constChannelPtr c, constRtpPtr rtp, const struct sockaddr_storage * remote, const struct sockaddr_storage * local, boolean_t remoteNatActive);
+SCCP_API boolean_t SCCP_CALL sccp_rtp_needsHolePunch(constDevicePtr d, constRtpPtr rtp);
 SCCP_API boolean_t SCCP_CALL sccp_rtp_getAudioPeer(constChannelPtr c, struct sockaddr_storage **new_peer);
 SCCP_API sccp_rtp_info_t SCCP_CALL sccp_rtp_getAudioPeerInfo(constChannelPtr c, sccp_rtp_t **rtp);
 #ifdef CS_SCCP_VIDEO
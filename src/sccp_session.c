@@ -51,6 +51,7 @@ SCCP_FILE_VERSION(__FILE__, "");
 #define KEEPALIVE_ADDITIONAL_PERCENT_DEVICE 1.20								/* extra time allowed for device keepalive overrun (percentage of GLOB(keepalive)) */
 #define KEEPALIVE_ADDITIONAL_PERCENT_ON_CALL 2.00								/* extra time allowed for device keepalive overrun (percentage of GLOB(keepalive)) */
 #define SESSION_REQUEST_TIMEOUT              5
+#define SESSION_MAX_TRANSACTIONS             8								/* concurrently tracked transactions per session */
 
 /* Lock Macro for Sessions */
 #define sccp_session_lock(x)			pbx_mutex_lock(&(x)->lock)
@@ -85,6 +86,12 @@ sccp_servercontext_t * sccp_servercontext_create(struct sockaddr_storage * binda
 	context->type = type;
 	switch(type) {
 		case SCCP_SERVERCONTEXT_TCP:
+#ifdef CS_EXPERIMENTAL
+			if((context->transport = fault_init()) != NULL) {
+				pbx_log(LOG_WARNING, "SCCP: (%s) fault injection enabled on the tcp transport (%s)\n", __func__, GLOB(transport_faults));
+				break;
+			}
+#endif
 			if((context->transport = tcp_init()) == NULL) {
 				pbx_log(LOG_ERROR, "SCCP: (%s) could not initialize tcp context\n", __func__);
 				sccp_free(context);
@@ -142,6 +149,17 @@ const struct sockaddr_storage * const sccp_servercontext_getBoundAddr(sccp_serve
 	return context ? &context->boundaddr : NULL;
 }
 
+/*!
+ * \brief SCCP Session Transaction (Request sent to the device, awaiting its response)
+ */
+typedef struct sccp_session_transaction {
+	uint32_t msgid;												/*!< Request MessageId, 0 = unused */
+	uint32_t transactionId;											/*!< PassThruPartyId the device will echo in its response */
+	time_t expires;
+	sccp_session_transaction_cb_t oncomplete;								/*!< Completion Action */
+	void *data;
+} sccp_session_transaction_t;
+
 /*!
  * \brief SCCP Session Structure
  * \note This contains the current session the phone is in
@@ -165,6 +183,7 @@ struct sccp_session {
 	char designator[40];
 	uint16_t requestsInFlight;
 	pbx_cond_t pendingRequest;
+	sccp_session_transaction_t transactions[SESSION_MAX_TRANSACTIONS];					/*!< Pending Transactions, protected by lock */
 };														/*!< SCCP Session Structure */
 
 int sccp_session_getFD(sccp_session_t * s)
@@ -307,6 +326,140 @@ static void response_received(sccp_session_t * s)
 	pbx_cond_broadcast(&s->pendingRequest);
 }
 
+/*!
+ * \brief Run the completion action of a transaction, must be called without holding the session lock
+ */
+static void transaction_finish(constSessionPtr s, const sccp_session_transaction_t * t, boolean_t completed)
+{
+	if (t->oncomplete) {
+		sccp_log(DEBUGCAT_SOCKET)(VERBOSE_PREFIX_3 "%s: Transaction %s (%u) %s, running completion action\n", s->designator, msginfo2str((sccp_mid_t)t->msgid), t->transactionId, completed ? "completed" : "expired");
+		t->oncomplete(s, t->transactionId, completed, t->data);
+	}
+}
+
+/*!
+ * \brief Start tracking a request which will be answered with a response carrying the same transactionId (passThruPartyId)
+ */
+static void transaction_begin(sccp_session_t * s, uint32_t msgid, uint32_t transactionId)
+{
+	sccp_session_transaction_t evicted = { 0 };
+	uint8_t idx = 0;
+	uint8_t slot = 0;
+
+	sccp_session_lock(s);
+	for (idx = 0; idx < SESSION_MAX_TRANSACTIONS; idx++) {
+		if (!s->transactions[idx].msgid) {
+			slot = idx;
+			break;
+		}
+		if (s->transactions[idx].expires < s->transactions[slot].expires) {
+			slot = idx;
+		}
+	}
+	if (s->transactions[slot].msgid) {
+		evicted = s->transactions[slot];									/* table full, drop the oldest */
+	}
+	s->transactions[slot].msgid = msgid;
+	s->transactions[slot].transactionId = transactionId;
+	s->transactions[slot].expires = time(0) + SESSION_REQUEST_TIMEOUT;
+	s->transactions[slot].oncomplete = NULL;
+	s->transactions[slot].data = NULL;
+	sccp_session_unlock(s);
+
+	if (evicted.msgid) {
+		transaction_finish(s, &evicted, FALSE);
+	}
+}
+
+/*!
+ * \brief Expire transactions which did not receive a response within SESSION_REQUEST_TIMEOUT (or all of them when the session ends)
+ */
+static void transaction_expire(sccp_session_t * s, boolean_t all)
+{
+	sccp_session_transaction_t expired[SESSION_MAX_TRANSACTIONS];
+	uint8_t numExpired = 0;
+	uint8_t idx = 0;
+	time_t now = time(0);
+
+	sccp_session_lock(s);
+	for (idx = 0; idx < SESSION_MAX_TRANSACTIONS; idx++) {
+		if (s->transactions[idx].msgid && (all || s->transactions[idx].expires <= now)) {
+			expired[numExpired++] = s->transactions[idx];
+			memset(&s->transactions[idx], 0, sizeof(sccp_session_transaction_t));
+		}
+	}
+	sccp_session_unlock(s);
+
+	for (idx = 0; idx < numExpired; idx++) {
+		if (!all) {
+			pbx_log(LOG_NOTICE, "%s: No response to %s (%u) within %d seconds\n", s->designator, msginfo2str((sccp_mid_t)expired[idx].msgid), expired[idx].transactionId, SESSION_REQUEST_TIMEOUT);
+		}
+		transaction_finish(s, &expired[idx], FALSE);
+	}
+}
+
+/*!
+ * \brief Register an action to be run when the pending request msgid with this transactionId gets its response or expires
+ * \return FALSE if there is no such transaction pending (anymore), the action will not be run
+ * \note requests of the same channel share the passThruPartyId, the msgid tells them apart
+ *
+ * Used to defer work until the device has answered, instead of blocking the calling thread.
+ */
+boolean_t sccp_session_onTransactionComplete(constSessionPtr session, sccp_mid_t msgid, uint32_t transactionId, sccp_session_transaction_cb_t callback, void *data)
+{
+	sessionPtr s = (sessionPtr)session;									/* discard const */
+	boolean_t res = FALSE;
+	uint8_t idx = 0;
+
+	if (!s || !transactionId) {
+		return FALSE;
+	}
+	SCOPED_SESSION(s);
+	for (idx = 0; idx < SESSION_MAX_TRANSACTIONS; idx++) {
+		if (s->transactions[idx].msgid == msgid && s->transactions[idx].transactionId == transactionId) {
+			s->transactions[idx].oncomplete = callback;
+			s->transactions[idx].data = data;
+			res = TRUE;
+			break;
+		}
+	}
+	return res;
+}
+
+/*!
+ * \brief Mark the transaction with this transactionId as answered by the device, running its completion action
+ * \param session SCCP Session
+ * \param msgid Request the response belongs to
+ * \param transactionId passThruPartyId from the response
+ * \param completed TRUE if the device accepted the request
+ * \return TRUE if a completion action was run
+ */
+boolean_t sccp_session_completeTransaction(constSessionPtr session, sccp_mid_t msgid, uint32_t transactionId, boolean_t completed)
+{
+	sessionPtr s = (sessionPtr)session;									/* discard const */
+	sccp_session_transaction_t found = { 0 };
+	uint8_t idx = 0;
+
+	if (!s || !transactionId) {
+		return FALSE;
+	}
+	sccp_session_lock(s);
+	for (idx = 0; idx < SESSION_MAX_TRANSACTIONS; idx++) {
+		if (s->transactions[idx].msgid == msgid && s->transactions[idx].transactionId == transactionId) {
+			found = s->transactions[idx];
+			memset(&s->transactions[idx], 0, sizeof(sccp_session_transaction_t));
+			break;
+		}
+	}
+	sccp_session_unlock(s);
+
+	if (found.oncomplete) {
+		transaction_finish(s, &found, completed);
+		return TRUE;
+	}
+	return FALSE;
+}
+
 static void socket_get_error(constSessionPtr s, const char * file, int line, const char * function)
 {
 	if (errno) {
@@ -360,7 +513,7 @@ static int session_dissect_header(sccp_session_t * s, sccp_header_t * header, st
 	return result;
 }
 
-static gcc_inline int session_buffer2msg(sccp_session_t * s, const unsigned char * const buffer, int lenAccordingToPacketHeader, sccp_msg_t * msg)
+static gcc_inline int session_buffer2msg(sccp_session_t * s, const unsigned char * const buffer, int lenAccordingToPacketHeader, sccp_msg_t * msg, boolean_t dispatch)
 {
 	int res = -5;
 	sccp_header_t msg_header = {0};
@@ -389,6 +542,9 @@ static gcc_inline int session_buffer2msg(sccp_session_t * s, const unsigned char
 	memset(msg, 0, SCCP_MAX_PACKET);
 	memcpy(msg, buffer, lenAccordingToOurProtocolSpec);
 	msg->header.length = lenAccordingToOurProtocolSpec;								// patch up msg->header.length to new size
+	if (!dispatch) {
+		return 0;
+	}
 
 	// handle the message
 	res = sccp_handle_message(msg, s);
@@ -401,7 +557,7 @@ static gcc_inline int session_buffer2msg(sccp_session_t * s, const unsigned char
 	return res;
 }
 
-static gcc_inline int process_buffer(sccp_session_t * s, sccp_msg_t * msg, unsigned char * const buffer, size_t * len)
+static gcc_inline int process_buffer(sccp_session_t * s, sccp_msg_t * msg, unsigned char * const buffer, size_t * len, boolean_t dispatch, uint32_t * decoded)
 {
 	int res = 0;
 	while (*len >= SCCP_PACKET_HEADER && *len <= SCCP_MAX_PACKET * 2) {										// We have at least SCCP_PACKET_HEADER, so we have the payload length
@@ -417,10 +573,13 @@ static gcc_inline int process_buffer(sccp_session_t * s, sccp_msg_t * msg, unsig
 			res = -1;
 			break;
 		}
-		if (dont_expect(session_buffer2msg(s, buffer, payload_len, msg) != 0)) {
+		if (dont_expect(session_buffer2msg(s, buffer, payload_len, msg, dispatch) != 0)) {
 			res = -2;
 			break;
 		}
+		if (decoded) {
+			(*decoded)++;
+		}
 
 		*len -= payload_len;
 		if (*len > 0) {												// Now shuffle the remaining data in the buffer back to the start
@@ -430,6 +589,26 @@ static gcc_inline int process_buffer(sccp_session_t * s, sccp_msg_t * msg, unsig
 	return res;
 }
 
+/*!
+ * \brief Run a Stream of Bytes through the inbound Framing and Message Decoder, without dispatching the Messages
+ * \param buffer Stream Buffer (at least SCCP_MAX_PACKET * 2 bytes), decoded messages are consumed
+ * \param len Number of valid bytes in buffer, updated to the number of bytes left over (incomplete message)
+ * \param decoded Incremented for every message that was decoded
+ * \return 0 on success, <0 when the stream would have closed a live session
+ *
+ * \note Used by "sccp test decoder" to exercise the parser with real and mutated messages outside of a live session
+ */
+int sccp_session_decodeStream(unsigned char * const buffer, size_t * len, uint32_t * decoded)
+{
+	sccp_session_t s = { 0 };
+	sccp_msg_t msg = { {0,} };
+
+	s.protocolType = SCCP_PROTOCOL;
+	s.sc.fd = -1;
+	sccp_copy_string(s.designator, "decoder", sizeof(s.designator));
+	return process_buffer(&s, &msg, buffer, len, FALSE, decoded);
+}
+
 /*!
  * \brief Find Session in Globals Lists
  * \param s SCCP Session
@@ -658,6 +837,9 @@ static void destroy_session(sccp_session_t * s)
 		}
 		sccp_session_unlock(s);
 
+		/* run the completion actions of transactions which will never be answered */
+		transaction_expire(s, TRUE);
+
 		/* destroying mutex and cleaning the session */
 		sccp_mutex_destroy(&s->lock);
 		sccp_mutex_destroy(&s->write_lock);
@@ -748,6 +930,12 @@ void *sccp_session_device_thread(void *session)
 	unsigned char recv_buffer[SCCP_MAX_PACKET * 2] = "";
 	size_t recv_len = 0;
 	sccp_msg_t msg = { {0,} };
+	uint32_t decoded = 0;
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	struct timespec cpu_last = { 0 };
+	struct timespec cpu_now = { 0 };
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_last);
+#endif
 
 	pthread_cleanup_push(sccp_session_device_thread_exit, session);
 	pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
@@ -761,18 +949,7 @@ void *sccp_session_device_thread(void *session)
 	while(s->sc.fd > 0 && !s->session_stop) {
 		if (s->device) {
 			sccp_device_t *d = s->device;
-			if (d->pendingUpdate || d->pendingDelete) {
-				pbx_rwlock_rdlock(&GLOB(lock));
-				boolean_t reload_in_progress = GLOB(reload_in_progress);
-				pbx_rwlock_unlock(&GLOB(lock));
-				if(reload_in_progress == FALSE && sccp_device_check_update(d)) {
-					continue;
-				}
-				sccp_safe_sleep(100);
-				if(!s->device) {
-					continue;
-				}
-			}
+			/* pending updates are applied by sccp_device_schedulePendingUpdates, when the reload finishes or the device becomes idle */
 			if ((d->active_channel ? TRUE : FALSE) != oncall) {
 				recalc_wait_time(s);
 				oncall = (d->active_channel) ? TRUE : FALSE;
@@ -781,6 +958,7 @@ void *sccp_session_device_thread(void *session)
 				tokenThread = TRUE;								// only does TCP-Keepalive
 			}
 		}
+		transaction_expire(s, FALSE);
 		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 		sccp_log_and((DEBUGCAT_SOCKET + DEBUGCAT_HIGH))(VERBOSE_PREFIX_4 "%s: set poll timeout %d for session %d\n", DEV_ID_LOG(s->device), (int)s->keepAliveInterval, fds[0].fd);
 
@@ -801,17 +979,21 @@ void *sccp_session_device_thread(void *session)
 				__sccp_session_stopthread(s, SKINNY_DEVICE_RS_TIMEOUT);
 				break;
 			}
+			if (s->device) {									/* safety net, in case a notification was missed */
+				sccp_device_schedulePendingUpdates(s->device);
+			}
 		} else if (res > 0) {										/* poll data processing */
 			if(fds[0].revents & POLLIN || fds[0].revents & POLLPRI) {                               /* POLLIN | POLLPRI */
 				// sccp_log_and((DEBUGCAT_SOCKET + DEBUGCAT_HIGH)) (VERBOSE_PREFIX_2 "%s: Session New Data Arriving at buffer position:%lu\n", DEV_ID_LOG(s->device), recv_len);
 				int result       = s->srvcontext->transport->recv(&s->sc, recv_buffer + recv_len, (ARRAY_LEN(recv_buffer) * sizeof(unsigned char)) - recv_len, 0);
 				s->lastKeepAlive = time(0);
+				decoded          = 0;
 				if (result <= 0) {
 					if (result < 0 || (errno != EINTR || errno != EAGAIN)) {
 						socket_get_error(s, __FILE__, __LINE__, __PRETTY_FUNCTION__);
 						break;
 					}
-				} else if (!((recv_len += result) && ((ARRAY_LEN(recv_buffer) * sizeof(unsigned char)) - recv_len) && process_buffer(s, &msg, recv_buffer, &recv_len) == 0)) {
+				} else if (!((recv_len += result) && ((ARRAY_LEN(recv_buffer) * sizeof(unsigned char)) - recv_len) && process_buffer(s, &msg, recv_buffer, &recv_len, TRUE, &decoded) == 0)) {
 					pbx_log(LOG_ERROR, "%s: (netsock_device_thread) Received a packet or message (with result:%d) which we could not handle, giving up session: %p!\n", s->designator, result, s);
 					sccp_dump_msg(&msg);
 					if (s->device) {
@@ -820,6 +1002,9 @@ void *sccp_session_device_thread(void *session)
 					__sccp_session_stopthread(s, SKINNY_DEVICE_RS_FAILED);
 					break;
 				}
+				if (s->device && result > 0) {
+					sccp_device_accountInbound(s->device, decoded, result);
+				}
 				s->lastKeepAlive = time(0);
 			} else { /* POLLHUP / POLLERR */
 				pbx_log(LOG_NOTICE, "%s: Closing session because we received POLLPRI/POLLHUP/POLLERR\n", s->designator);
@@ -829,6 +1014,12 @@ void *sccp_session_device_thread(void *session)
 		} else {											/* poll returned invalid res */
 			pbx_log(LOG_NOTICE, "%s: Poll Returned invalid result: %d.\n", DEV_ID_LOG(s->device), res);
 		}
+#ifdef CLOCK_THREAD_CPUTIME_ID
+		if (s->device && clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_now) == 0) {		/* time spent before registration is charged to the device that registers */
+			sccp_device_accountCpu(s->device, (size_t) ((cpu_now.tv_sec - cpu_last.tv_sec) * 1000000 + (cpu_now.tv_nsec - cpu_last.tv_nsec) / 1000));
+			cpu_last = cpu_now;
+		}
+#endif
 		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 		pthread_testcancel();
 		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
@@ -1235,6 +1426,12 @@ int sccp_session_send2(constSessionPtr session, sccp_msg_t * msg)
 		}
 		if(msginfo->type == SKINNY_MSGTYPE_REQUEST) {
 			request_pending(s);
+			if (msgid == OpenReceiveChannel) {
+				/* passThruPartyId is at the same offset for all protocol versions */
+				transaction_begin(s, msgid, letohl(msg->data.OpenReceiveChannel.v3.lel_passThruPartyId));
+			} else if (msgid == StartMediaTransmission) {
+				transaction_begin(s, msgid, letohl(msg->data.StartMediaTransmission.v3.lel_passThruPartyId));
+			}
 			sccp_log(DEBUGCAT_SOCKET)(VERBOSE_PREFIX_3 "%s: Request '%s' to device Pending\n", DEV_ID_LOG(s->device), msginfo->text);
 		}
 		if((GLOB(debug) & DEBUGCAT_MESSAGE) != 0) {
@@ -1268,6 +1465,8 @@ int sccp_session_send2(constSessionPtr session, sccp_msg_t * msg)
 	if (bytesSent < bufLen) {
 		pbx_log(LOG_ERROR, "%s: Could only send %d of %d bytes!\n", DEV_ID_LOG(s->device), (int) bytesSent, (int) bufLen);
 		res = -1;
+	} else if (s->device) {
+		sccp_device_accountOutbound(s->device, bytesSent, !pthread_equal(pthread_self(), s->session_thread) ? TRUE : FALSE);
 	}
 
 	return res;
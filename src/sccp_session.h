@@ -23,6 +23,8 @@ typedef enum {
 #endif
 } sccp_servercontexttype_t;
 
+typedef void (*sccp_session_transaction_cb_t)(constSessionPtr session, uint32_t transactionId, boolean_t completed, void *data);
+
 SCCP_API sccp_servercontext_t * SCCP_CALL sccp_servercontext_create(struct sockaddr_storage * bindaddr, sccp_servercontexttype_t type);
 SCCP_API int SCCP_CALL sccp_servercontext_stopListening(sccp_servercontext_t * context);
 SCCP_API int SCCP_CALL sccp_servercontext_destroy(sccp_servercontext_t * context);
@@ -36,6 +38,9 @@ SCCP_API void SCCP_CALL sccp_session_terminateAll(void);
 SCCP_API const char * const SCCP_CALL sccp_session_getDesignator(constSessionPtr session);
 SCCP_API int SCCP_CALL sccp_session_waitForPendingRequests(sccp_session_t * s);
 uint16_t sccp_session_getPendingRequests(sccp_session_t * s);
+SCCP_API boolean_t SCCP_CALL sccp_session_onTransactionComplete(constSessionPtr session, sccp_mid_t msgid, uint32_t transactionId, sccp_session_transaction_cb_t callback, void *data);
+SCCP_API boolean_t SCCP_CALL sccp_session_completeTransaction(constSessionPtr session, sccp_mid_t msgid, uint32_t transactionId, boolean_t completed);
+SCCP_API int SCCP_CALL sccp_session_decodeStream(unsigned char * const buffer, size_t * len, uint32_t * decoded);
 SCCP_API void SCCP_CALL sccp_session_sendmsg(constDevicePtr device, sccp_mid_t t);
 SCCP_API int SCCP_CALL sccp_session_send(constDevicePtr device, const sccp_msg_t * msg_in);
 SCCP_API int SCCP_CALL sccp_session_send2(constSessionPtr session, sccp_msg_t * msg);
@@ -16,6 +16,7 @@
 #include "sccp_channel.h"
 #include "sccp_softkeys.h"
 #include "sccp_actions.h"
+#include "sccp_callback.h"
 #include "sccp_device.h"
 #include "sccp_feature.h"
 #include "sccp_line.h"
@@ -898,8 +899,12 @@ static void sccp_sk_info(const sccp_softkeyMap_cb_t * const softkeyMap_cb, const
 static void sccp_sk_callback(const sccp_softkeyMap_cb_t * const softkeyMap_cb, constDevicePtr d, constLinePtr l, const uint32_t lineInstance, channelPtr c)
 {
 	sccp_log((DEBUGCAT_SOFTKEY)) (VERBOSE_PREFIX_3 "%s: SoftKey Callback Pressed\n", DEV_ID_LOG(d));
-	sccp_dev_displayprompt(d, lineInstance, c->callid, SKINNY_DISP_KEY_IS_NOT_ACTIVE, SCCP_DISPLAYSTATUS_TIMEOUT);
-	sccp_log((DEBUGCAT_SOFTKEY)) (VERBOSE_PREFIX_3 "### Callback Softkey not (yet) supported\n");
+	if (!sccp_callback_request(d, l, c)) {
+		sccp_dev_displayprompt(d, lineInstance, c->callid, SKINNY_DISP_KEY_IS_NOT_ACTIVE, SCCP_DISPLAYSTATUS_TIMEOUT);
+		return;
+	}
+	sccp_dev_displayprinotify(d, SKINNY_DISP_CALLBACK, SCCP_MESSAGE_PRIORITY_TIMEOUT, 5);
+	sccp_channel_endcall(c);
 }
 
 static void sccp_sk_empty(const sccp_softkeyMap_cb_t * const softkeyMap_cb, constDevicePtr d, constLinePtr l, const uint32_t lineInstance, channelPtr none)
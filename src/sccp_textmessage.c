@@ -0,0 +1,408 @@
+/*!
+ * \file        sccp_textmessage.c
+ * \brief       SCCP Text Message Queue
+ * \note        Text messages sent by the pbx (MessageSend) are queued per target device and pushed to the phone from the
+ *              general threadpool, so the pbx message thread never waits on a device session. Messages for devices that are
+ *              not registered are kept (at most 'textmessage_queue' per device, for 'textmessage_retention' seconds) and
+ *              delivered as soon as the device registers.
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#include "config.h"
+#include "common.h"
+#include "sccp_textmessage.h"
+#include "sccp_device.h"
+#include "sccp_line.h"
+#include "sccp_linedevice.h"
+#include "sccp_utils.h"
+
+SCCP_FILE_VERSION(__FILE__, "");
+
+struct sccp_textmessage {
+	SCCP_LIST_ENTRY (struct sccp_textmessage) list;
+	uint32_t id;
+	time_t queued;
+	char from[33];												/*!< pushTextMessage refuses longer senders */
+	char text[];
+};
+
+struct sccp_textmessage_queue {
+	SCCP_LIST_ENTRY (struct sccp_textmessage_queue) list;
+	char deviceId[StationMaxDeviceNameSize];
+	boolean_t scheduled;											/*!< a delivery is pending/running for this device */
+	uint16_t size;
+	SCCP_LIST_HEAD (, struct sccp_textmessage) messages;
+};
+
+/*!
+ * \brief All queues, the lock of this list protects the queues and their messages as well
+ */
+static SCCP_LIST_HEAD (, struct sccp_textmessage_queue) textMessageQueues;
+static uint32_t textMessageId;
+static uint16_t textMessageWorkers;									/*!< deliveries handed to the threadpool */
+static boolean_t textMessageStopping;
+
+static void sccp_textmessage_eventListener(const sccp_event_t * event);
+
+void sccp_textmessage_module_start(void)
+{
+	SCCP_LIST_HEAD_INIT(&textMessageQueues);
+	textMessageId = 0;
+	textMessageWorkers = 0;
+	textMessageStopping = FALSE;
+	sccp_event_subscribe(SCCP_EVENT_DEVICE_REGISTERED, sccp_textmessage_eventListener, TRUE);
+}
+
+static void sccp_textmessage_destroyQueue(struct sccp_textmessage_queue * queue)
+{
+	struct sccp_textmessage * message = NULL;
+
+	while ((message = SCCP_LIST_REMOVE_HEAD(&queue->messages, list))) {
+		sccp_free(message);
+	}
+	SCCP_LIST_HEAD_DESTROY(&queue->messages);
+	sccp_free(queue);
+}
+
+void sccp_textmessage_module_stop(void)
+{
+	struct sccp_textmessage_queue * queue = NULL;
+
+	sccp_event_unsubscribe(SCCP_EVENT_DEVICE_REGISTERED, sccp_textmessage_eventListener);
+
+	/* let running deliveries finish before freeing the queues */
+	SCCP_LIST_LOCK(&textMessageQueues);
+	textMessageStopping = TRUE;
+	while (textMessageWorkers) {
+		SCCP_LIST_UNLOCK(&textMessageQueues);
+		usleep(10000);
+		SCCP_LIST_LOCK(&textMessageQueues);
+	}
+	while ((queue = SCCP_LIST_REMOVE_HEAD(&textMessageQueues, list))) {
+		if (queue->size) {
+			sccp_log(DEBUGCAT_MESSAGE)(VERBOSE_PREFIX_3 "%s: (textmessage) dropping %d undelivered message(s)\n", queue->deviceId, queue->size);
+		}
+		sccp_textmessage_destroyQueue(queue);
+	}
+	SCCP_LIST_UNLOCK(&textMessageQueues);
+	SCCP_LIST_HEAD_DESTROY(&textMessageQueues);
+}
+
+/*!
+ * \note textMessageQueues has to be locked
+ */
+static struct sccp_textmessage_queue * sccp_textmessage_findQueue(const char * deviceId, boolean_t create)
+{
+	struct sccp_textmessage_queue * queue = NULL;
+
+	SCCP_LIST_TRAVERSE(&textMessageQueues, queue, list) {
+		if (sccp_strequals(queue->deviceId, deviceId)) {
+			return queue;
+		}
+	}
+	if (create) {
+		if (!(queue = (struct sccp_textmessage_queue *) sccp_calloc(1, sizeof(struct sccp_textmessage_queue)))) {
+			pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+			return NULL;
+		}
+		sccp_copy_string(queue->deviceId, deviceId, sizeof(queue->deviceId));
+		SCCP_LIST_HEAD_INIT(&queue->messages);
+		SCCP_LIST_INSERT_TAIL(&textMessageQueues, queue, list);
+	}
+	return queue;
+}
+
+/*!
+ * \brief Drop messages older than textmessage_retention
+ * \note textMessageQueues has to be locked
+ */
+static void sccp_textmessage_expire(struct sccp_textmessage_queue * queue, time_t now)
+{
+	struct sccp_textmessage * message = NULL;
+
+	while ((message = SCCP_LIST_FIRST(&queue->messages)) && GLOB(textmessage_retention) && now - message->queued > GLOB(textmessage_retention)) {
+		SCCP_LIST_REMOVE_HEAD(&queue->messages, list);
+		queue->size--;
+		sccp_log(DEBUGCAT_MESSAGE)(VERBOSE_PREFIX_3 "%s: (textmessage) message %u expired undelivered\n", queue->deviceId, message->id);
+		sccp_free(message);
+	}
+}
+
+/*!
+ * \note textMessageQueues has to be locked
+ */
+static void sccp_textmessage_removeIfIdle(struct sccp_textmessage_queue * queue)
+{
+	if (!queue->scheduled && SCCP_LIST_EMPTY(&queue->messages)) {
+		SCCP_LIST_REMOVE(&textMessageQueues, queue, list);
+		sccp_textmessage_destroyQueue(queue);
+	}
+}
+
+static void * sccp_textmessage_deliver_thread(void * data)
+{
+	char * deviceId = (char *) data;
+	struct sccp_textmessage_queue * queue = NULL;
+	struct sccp_textmessage * message = NULL;
+	sccp_push_result_t pushResult = SCCP_PUSH_RESULT_SUCCESS;
+	AUTO_RELEASE(sccp_device_t, d, sccp_device_find_byid(deviceId, FALSE));
+	boolean_t more = FALSE;
+
+	do {
+		message = NULL;
+		more = FALSE;
+		SCCP_LIST_LOCK(&textMessageQueues);
+		if ((queue = sccp_textmessage_findQueue(deviceId, FALSE))) {
+			sccp_textmessage_expire(queue, time(0));
+			if (pushResult == SCCP_PUSH_RESULT_FAIL || !d || !d->session || textMessageStopping || sccp_device_getRegistrationState(d) != SKINNY_DEVICE_RS_OK
+			    || !(message = SCCP_LIST_REMOVE_HEAD(&queue->messages, list))) {
+				queue->scheduled = FALSE;
+				sccp_textmessage_removeIfIdle(queue);
+			} else {
+				queue->size--;
+				more = TRUE;								/* loop once more to pick up the next message or clear 'scheduled' */
+			}
+		}
+		SCCP_LIST_UNLOCK(&textMessageQueues);
+
+		if (message) {
+			pushResult = d->pushTextMessage(d, message->text, message->from, 1, SKINNY_TONE_ZIP);
+			if (pushResult == SCCP_PUSH_RESULT_FAIL) {						/* keep it for the next registration */
+				SCCP_LIST_LOCK(&textMessageQueues);
+				if ((queue = sccp_textmessage_findQueue(deviceId, TRUE))) {
+					SCCP_LIST_INSERT_HEAD(&queue->messages, message, list);
+					queue->size++;
+					message = NULL;
+				}
+				SCCP_LIST_UNLOCK(&textMessageQueues);
+			} else {
+				sccp_log(DEBUGCAT_MESSAGE)(VERBOSE_PREFIX_3 "%s: (textmessage) message %u %s\n", deviceId, message->id, pushResult == SCCP_PUSH_RESULT_SUCCESS ? "delivered" : "not supported by device");
+			}
+			if (message) {
+				sccp_free(message);
+			}
+		}
+	} while (more);
+
+	SCCP_LIST_LOCK(&textMessageQueues);
+	textMessageWorkers--;
+	SCCP_LIST_UNLOCK(&textMessageQueues);
+	sccp_free(deviceId);
+	return NULL;
+}
+
+/*!
+ * \brief Mark the queue scheduled, returns TRUE when the caller has to start a delivery
+ * \note textMessageQueues has to be locked
+ */
+static boolean_t sccp_textmessage_markScheduled(struct sccp_textmessage_queue * queue)
+{
+	if (queue->scheduled || textMessageStopping || SCCP_LIST_EMPTY(&queue->messages)) {
+		return FALSE;
+	}
+	queue->scheduled = TRUE;
+	textMessageWorkers++;
+	return TRUE;
+}
+
+/*!
+ * \brief Start a delivery for a queue marked by sccp_textmessage_markScheduled
+ * \note textMessageQueues must not be locked, the fallback delivers synchronously
+ */
+static void sccp_textmessage_deliver(const char * deviceId)
+{
+	char * id = pbx_strdup(deviceId);
+
+	if (!id) {
+		pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+		SCCP_LIST_LOCK(&textMessageQueues);
+		struct sccp_textmessage_queue * queue = sccp_textmessage_findQueue(deviceId, FALSE);
+		if (queue) {
+			queue->scheduled = FALSE;
+		}
+		textMessageWorkers--;
+		SCCP_LIST_UNLOCK(&textMessageQueues);
+		return;
+	}
+	if (!GLOB(general_threadpool) || !sccp_threadpool_add_work(GLOB(general_threadpool), sccp_textmessage_deliver_thread, (void *) id)) {
+		sccp_textmessage_deliver_thread(id);							/* fallback to delivering synchronously */
+	}
+}
+
+/*!
+ * \brief Device a message is queued for
+ */
+struct sccp_textmessage_target {
+	char deviceId[StationMaxDeviceNameSize];
+	boolean_t registered;
+	boolean_t deliver;											/*!< this send has to start the delivery */
+};
+
+/*!
+ * \brief Does the device have a button for this line
+ */
+static boolean_t sccp_textmessage_deviceHasLineButton(constDevicePtr d, constLinePtr l)
+{
+	sccp_buttonconfig_t * config = NULL;
+	boolean_t found = FALSE;
+
+	SCCP_LIST_LOCK(&((devicePtr)d)->buttonconfig);
+	SCCP_LIST_TRAVERSE(&d->buttonconfig, config, list) {
+		if (config->type == LINE && sccp_strcaseequals(config->button.line.name, l->name)) {
+			found = TRUE;
+			break;
+		}
+	}
+	SCCP_LIST_UNLOCK(&((devicePtr)d)->buttonconfig);
+	return found;
+}
+
+/*!
+ * \brief Collect the devices a message for line l goes to: the registered devices attached to the line and, when messages are
+ *        kept for unregistered devices (textmessage_queue > 0), the unregistered devices with a button for the line
+ * \return number of targets, the targets array is allocated by this function
+ *
+ * \lock
+ *  - line->devices
+ *  - devices (only when textmessage_queue > 0)
+ *    - device->buttonconfig
+ */
+static int sccp_textmessage_collectTargets(constLinePtr line, struct sccp_textmessage_target ** targets)
+{
+	struct sccp_textmessage_target * tmp = NULL;
+	sccp_linedevice_t * ld = NULL;
+	sccp_device_t * d = NULL;
+	int numTargets = 0;
+
+	AUTO_RELEASE(sccp_line_t, l, sccp_line_retain(line));
+	if (!l) {
+		return 0;
+	}
+	SCCP_LIST_LOCK(&l->devices);
+	if (SCCP_LIST_GETSIZE(&l->devices) && !(*targets = (struct sccp_textmessage_target *) sccp_calloc(SCCP_LIST_GETSIZE(&l->devices), sizeof(struct sccp_textmessage_target)))) {
+		SCCP_LIST_UNLOCK(&l->devices);
+		pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+		return 0;
+	}
+	SCCP_LIST_TRAVERSE(&l->devices, ld, list) {
+		if (ld->device && ld->device->session && sccp_device_getRegistrationState(ld->device) == SKINNY_DEVICE_RS_OK) {
+			sccp_copy_string((*targets)[numTargets].deviceId, ld->device->id, sizeof((*targets)[numTargets].deviceId));
+			(*targets)[numTargets++].registered = TRUE;
+		}
+	}
+	SCCP_LIST_UNLOCK(&l->devices);
+
+	if (GLOB(textmessage_queuesize)) {
+		SCCP_RWLIST_RDLOCK(&GLOB(devices));
+		if (!(tmp = (struct sccp_textmessage_target *) sccp_realloc(*targets, (numTargets + SCCP_RWLIST_GETSIZE(&GLOB(devices)) + 1) * sizeof(struct sccp_textmessage_target)))) {
+			pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+		} else {
+			*targets = tmp;
+			SCCP_RWLIST_TRAVERSE(&GLOB(devices), d, list) {
+				if ((d->session && sccp_device_getRegistrationState(d) == SKINNY_DEVICE_RS_OK) || !sccp_textmessage_deviceHasLineButton(d, l)) {
+					continue;
+				}
+				sccp_copy_string((*targets)[numTargets].deviceId, d->id, sizeof((*targets)[numTargets].deviceId));
+				(*targets)[numTargets++].registered = FALSE;
+			}
+		}
+		SCCP_RWLIST_UNLOCK(&GLOB(devices));
+	}
+	return numTargets;
+}
+
+/*!
+ * \brief Queue a text message for every device carrying line l
+ * \return number of devices the message was queued for (registered devices, and unregistered ones when textmessage_queue > 0)
+ * \note returns immediately, delivery happens from the general threadpool
+ * \note the devices are collected before textMessageQueues is locked, see sccp_textmessage_collectTargets
+ */
+int sccp_textmessage_send(constLinePtr l, const char * messageText, const char * from)
+{
+	struct sccp_textmessage_queue * queue = NULL;
+	struct sccp_textmessage_target * targets = NULL;
+	int numTargets = 0;
+	int queued = 0;
+	size_t textlen = 0;
+	time_t now = time(0);
+
+	if (!l || sccp_strlen_zero(messageText)) {
+		return 0;
+	}
+	textlen = strlen(messageText);
+	if (!(numTargets = sccp_textmessage_collectTargets(l, &targets))) {
+		if (targets) {
+			sccp_free(targets);
+		}
+		return 0;
+	}
+
+	SCCP_LIST_LOCK(&textMessageQueues);
+	if (textMessageStopping) {
+		SCCP_LIST_UNLOCK(&textMessageQueues);
+		sccp_free(targets);
+		return 0;
+	}
+	uint32_t id = ++textMessageId;
+	for (int idx = 0; idx < numTargets; idx++) {
+		struct sccp_textmessage_target * target = &targets[idx];
+		uint16_t limit = GLOB(textmessage_queuesize) ? GLOB(textmessage_queuesize) : 1;		/* registered device, only the message in flight is kept */
+
+		struct sccp_textmessage * message = (struct sccp_textmessage *) sccp_calloc(1, sizeof(struct sccp_textmessage) + textlen + 1);
+		if (!message || !(queue = sccp_textmessage_findQueue(target->deviceId, TRUE))) {
+			pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+			sccp_free(message);
+			continue;
+		}
+		message->id = id;
+		message->queued = now;
+		sccp_copy_string(message->from, from ? from : "", sizeof(message->from));
+		memcpy(message->text, messageText, textlen + 1);
+
+		sccp_textmessage_expire(queue, now);
+		while (queue->size >= limit) {								/* drop the oldest */
+			struct sccp_textmessage * oldest = SCCP_LIST_REMOVE_HEAD(&queue->messages, list);
+			queue->size--;
+			sccp_log(DEBUGCAT_MESSAGE)(VERBOSE_PREFIX_3 "%s: (textmessage) queue full, dropping message %u\n", target->deviceId, oldest->id);
+			sccp_free(oldest);
+		}
+		SCCP_LIST_INSERT_TAIL(&queue->messages, message, list);
+		queue->size++;
+		queued++;
+		sccp_log(DEBUGCAT_MESSAGE)(VERBOSE_PREFIX_3 "%s: (textmessage) message %u for line %s queued (%s)\n", target->deviceId, id, l->name, target->registered ? "registered" : "waiting for registration");
+
+		target->deliver = (target->registered && sccp_textmessage_markScheduled(queue)) ? TRUE : FALSE;
+	}
+	SCCP_LIST_UNLOCK(&textMessageQueues);
+
+	for (int idx = 0; idx < numTargets; idx++) {
+		if (targets[idx].deliver) {
+			sccp_textmessage_deliver(targets[idx].deviceId);
+		}
+	}
+	sccp_free(targets);
+	return queued;
+}
+
+static void sccp_textmessage_eventListener(const sccp_event_t * event)
+{
+	boolean_t startDelivery = FALSE;
+
+	if (!event || event->type != SCCP_EVENT_DEVICE_REGISTERED || !event->deviceRegistered.device) {
+		return;
+	}
+	const char * deviceId = pbx_strdupa(event->deviceRegistered.device->id);
+
+	SCCP_LIST_LOCK(&textMessageQueues);
+	struct sccp_textmessage_queue * queue = sccp_textmessage_findQueue(deviceId, FALSE);
+	if (queue) {
+		startDelivery = sccp_textmessage_markScheduled(queue);
+	}
+	SCCP_LIST_UNLOCK(&textMessageQueues);
+
+	if (startDelivery) {
+		sccp_log(DEBUGCAT_MESSAGE)(VERBOSE_PREFIX_3 "%s: (textmessage) device registered, delivering queued message(s)\n", deviceId);
+		sccp_textmessage_deliver(deviceId);
+	}
+}
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
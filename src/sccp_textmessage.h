@@ -0,0 +1,14 @@
+/*!
+ * \file        sccp_textmessage.h
+ * \brief       SCCP Text Message Queue Header
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#pragma once
+
+__BEGIN_C_EXTERN__
+SCCP_API void SCCP_CALL sccp_textmessage_module_start(void);
+SCCP_API void SCCP_CALL sccp_textmessage_module_stop(void);
+SCCP_API int SCCP_CALL sccp_textmessage_send(constLinePtr l, const char * messageText, const char * from);
+__END_C_EXTERN__
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
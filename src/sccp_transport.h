@@ -47,6 +47,12 @@ struct sccp_transport {
 const sccp_transport_t * const tcp_init(void);
 #ifdef HAVE_LIBSSL
 const sccp_transport_t * const tls_init(void);
+boolean_t sccp_transport_tls_rotate(void);
+uint32_t sccp_transport_tls_getRotations(time_t * const last);
+#endif
+#ifdef CS_EXPERIMENTAL
+const sccp_transport_t * const fault_init(void);
+void sccp_transport_fault_getCounters(uint32_t * delays, uint32_t * interrupts, uint32_t * shorts, uint32_t * resets);
 #endif
 
 __END_C_EXTERN__
@@ -0,0 +1,326 @@
+/*!
+ * \file        sccp_transport_fault.c
+ * \brief       SCCP Fault Injection Transport
+ * \note        Plain TCP transport which injects seeded delays, EINTR, short reads/writes and connection resets,
+ *              to reproduce failure modes of slow, stalled or disappearing peers on demand.
+ *              Only available when built with --enable-experimental, enabled by setting 'transport_faults' in sccp.conf.
+ * \note        This program is free software and may be modified and distributed under the terms of the GNU Public License.
+ *              See the LICENSE file at the top of the source tree.
+ */
+#include "config.h"
+#include "common.h"
+
+SCCP_FILE_VERSION(__FILE__, "");
+
+#include "sccp_transport.h"
+#include "sccp_utils.h"
+
+#define REQUEST_RETRY_INTERVAL 5
+#define REQUEST_RETRY_COUNT    2
+#define DUPLICATE_INTERVAL     REQUEST_RETRY_INTERVAL * REQUEST_RETRY_COUNT
+
+#ifdef CS_EXPERIMENTAL
+/*!
+ * \brief Fault state of an accepted connection
+ */
+struct fault_connection {
+	struct fault_connection * next;
+	int fd;
+	uint32_t state[2];											/*!< xorshift state for recv and send */
+};
+
+/* local variables */
+static struct {
+	uint32_t seed;												/*!< the fault sequence of every connection is repeatable for a given seed */
+	uint32_t state;												/*!< xorshift state for operations on connections we did not accept */
+	uint32_t connections;											/*!< number of accepted connections, mixed into the per connection state */
+	struct fault_connection * connectionList;
+	uint8_t delay;												/*!< percentage of operations delayed */
+	uint16_t delaymax;											/*!< maximum delay in ms */
+	uint8_t eintr;												/*!< percentage of operations failing with EINTR */
+	uint8_t shortread;											/*!< percentage of short reads */
+	uint8_t shortwrite;											/*!< percentage of short writes */
+	uint8_t reset;												/*!< percentage of operations resetting the connection */
+	uint32_t injected[5];											/*!< number of injected faults per type */
+} faults;
+AST_MUTEX_DEFINE_STATIC(faultLock);
+
+enum fault_type {
+	FAULT_DELAY = 0,
+	FAULT_EINTR,
+	FAULT_SHORT,
+	FAULT_RESET,
+	FAULT_NONE,
+};
+
+/* forward declares */
+const sccp_transport_t faulttransport;
+
+static uint8_t fault_percentage(const char * value)
+{
+	int percentage = sccp_atoi(value, strlen(value));
+	return (uint8_t) (percentage < 0 ? 0 : percentage > 100 ? 100 : percentage);
+}
+
+/*!
+ * \brief Parse the fault specification, e.g. 'seed=42,delay=10:250,eintr=2,shortread=5,shortwrite=5,reset=1' (percentages)
+ */
+static boolean_t fault_parse(const char * spec)
+{
+	char * buf = pbx_strdupa(spec);
+	char * option = NULL;
+
+	pbx_mutex_lock(&faultLock);
+	struct fault_connection * connectionList = faults.connectionList;					/* connections outlive a reload */
+	memset(&faults, 0, sizeof(faults));
+	faults.connectionList = connectionList;
+	pbx_mutex_unlock(&faultLock);
+	faults.seed = 1;
+	faults.delaymax = 100;
+	while ((option = strsep(&buf, ","))) {
+		char * value = option;
+		char * name = strsep(&value, "=");
+		if (sccp_strlen_zero(name) || sccp_strlen_zero(value)) {
+			continue;
+		}
+		pbx_strip(name);
+		if (sccp_strcaseequals(name, "seed")) {
+			faults.seed = (uint32_t) strtoul(value, NULL, 10);
+		} else if (sccp_strcaseequals(name, "delay")) {
+			char * max = value;
+			strsep(&max, ":");
+			faults.delay = fault_percentage(value);
+			if (max) {
+				faults.delaymax = (uint16_t) sccp_atoi(max, strlen(max));
+			}
+		} else if (sccp_strcaseequals(name, "eintr")) {
+			faults.eintr = fault_percentage(value);
+		} else if (sccp_strcaseequals(name, "shortread")) {
+			faults.shortread = fault_percentage(value);
+		} else if (sccp_strcaseequals(name, "shortwrite")) {
+			faults.shortwrite = fault_percentage(value);
+		} else if (sccp_strcaseequals(name, "reset")) {
+			faults.reset = fault_percentage(value);
+		} else {
+			pbx_log(LOG_WARNING, "SCCP: (fault_parse) unknown fault '%s' in transport_faults, ignoring\n", name);
+		}
+	}
+	faults.state = faults.seed ? faults.seed : 1;
+	return (faults.delay || faults.eintr || faults.shortread || faults.shortwrite || faults.reset) ? TRUE : FALSE;
+}
+
+/*!
+ * \note faultLock needs to be locked
+ */
+static struct fault_connection * fault_findConnection(int fd)
+{
+	struct fault_connection * connection = faults.connectionList;
+
+	while (connection && connection->fd != fd) {
+		connection = connection->next;
+	}
+	return connection;
+}
+
+/*!
+ * \brief Roll the dice for the next operation on a connection
+ * \param sc connection, each accepted connection has its own repeatable sequence
+ * \param direction 0 for recv, 1 for send
+ * \param shortpercent percentage of short reads or writes for this operation
+ * \param delay_ms set to the delay to apply before the operation
+ * \param roll set to a random value, used to size short reads/writes
+ */
+static enum fault_type fault_next(sccp_socket_connection_t * sc, uint8_t direction, uint8_t shortpercent, int * delay_ms, uint32_t * roll)
+{
+	enum fault_type fault = FAULT_NONE;
+
+	pbx_mutex_lock(&faultLock);
+	struct fault_connection * connection = fault_findConnection(sc->fd);
+	uint32_t * state = connection ? &connection->state[direction] : &faults.state;
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	uint32_t dice = x % 100;
+	*roll = x >> 8;
+	*delay_ms = (faults.delay && ((x >> 16) % 100) < faults.delay) ? (int)(*roll % (faults.delaymax + 1)) : 0;
+	if (dice < faults.reset) {
+		fault = FAULT_RESET;
+	} else if (dice < faults.reset + faults.eintr) {
+		fault = FAULT_EINTR;
+	} else if (dice < faults.reset + faults.eintr + shortpercent) {
+		fault = FAULT_SHORT;
+	}
+	if (*delay_ms) {
+		faults.injected[FAULT_DELAY]++;
+	}
+	if (fault != FAULT_NONE) {
+		faults.injected[fault]++;
+	}
+	pbx_mutex_unlock(&faultLock);
+	return fault;
+}
+
+static int fault_inject(sccp_socket_connection_t * sc, const char * op, enum fault_type fault, int delay_ms)
+{
+	if (delay_ms) {
+		sccp_log_and((DEBUGCAT_SOCKET + DEBUGCAT_HIGH)) (VERBOSE_PREFIX_3 "SCCP: (fault) %s on fd:%d delayed by %dms\n", op, sc->fd, delay_ms);
+		usleep(delay_ms * 1000);
+	}
+	switch (fault) {
+		case FAULT_RESET:
+			sccp_log(DEBUGCAT_SOCKET) (VERBOSE_PREFIX_3 "SCCP: (fault) %s on fd:%d, resetting connection\n", op, sc->fd);
+			shutdown(sc->fd, SHUT_RDWR);
+			errno = ECONNRESET;
+			return -1;
+		case FAULT_EINTR:
+			sccp_log_and((DEBUGCAT_SOCKET + DEBUGCAT_HIGH)) (VERBOSE_PREFIX_3 "SCCP: (fault) %s on fd:%d, interrupted\n", op, sc->fd);
+			errno = EINTR;
+			return -1;
+		default:
+			break;
+	}
+	return 0;
+}
+
+const sccp_transport_t * const fault_init(void)
+{
+	if (sccp_strlen_zero(GLOB(transport_faults)) || !fault_parse(GLOB(transport_faults))) {
+		return NULL;
+	}
+	return &faulttransport;
+}
+
+/*!
+ * \brief Get the number of faults injected so far
+ */
+void sccp_transport_fault_getCounters(uint32_t * delays, uint32_t * interrupts, uint32_t * shorts, uint32_t * resets)
+{
+	pbx_mutex_lock(&faultLock);
+	*delays = faults.injected[FAULT_DELAY];
+	*interrupts = faults.injected[FAULT_EINTR];
+	*shorts = faults.injected[FAULT_SHORT];
+	*resets = faults.injected[FAULT_RESET];
+	pbx_mutex_unlock(&faultLock);
+}
+
+static int fault_bind(sccp_socket_connection_t * sc, struct sockaddr * addr, socklen_t addrlen)
+{
+	return bind(sc->fd, addr, addrlen);
+}
+
+static int fault_listen(sccp_socket_connection_t * sc, int backlog)
+{
+	return listen(sc->fd, backlog);
+}
+
+static sccp_socket_connection_t * fault_accept(sccp_socket_connection_t * in_sc, struct sockaddr * addr, socklen_t * addrlen, sccp_socket_connection_t * out_sc)
+{
+	struct fault_connection * connection = NULL;
+
+	out_sc->fd = accept(in_sc->fd, addr, addrlen);
+	if (out_sc->fd < 0) {
+		return out_sc;
+	}
+	if (!(connection = (struct fault_connection *) sccp_calloc(1, sizeof(struct fault_connection)))) {
+		pbx_log(LOG_ERROR, SS_Memory_Allocation_Error, "SCCP");
+		return out_sc;										/* falls back to the shared state */
+	}
+	connection->fd = out_sc->fd;
+	pbx_mutex_lock(&faultLock);
+	uint32_t state = (faults.seed ? faults.seed : 1) + 0x9E3779B9 * faults.connections++;			/* distinct, but repeatable, sequence per connection */
+	connection->state[0] = state ? state : 1;								/* xorshift never leaves 0 */
+	connection->state[1] = ~connection->state[0] ? ~connection->state[0] : 1;
+	connection->next = faults.connectionList;
+	faults.connectionList = connection;
+	pbx_mutex_unlock(&faultLock);
+	return out_sc;
+}
+
+static int fault_recv(sccp_socket_connection_t * sc, void * buf, size_t buflen, int flags)
+{
+	int delay_ms = 0;
+	uint32_t roll = 0;
+	enum fault_type fault = fault_next(sc, 0, faults.shortread, &delay_ms, &roll);
+
+	if (fault_inject(sc, "recv", fault, delay_ms) < 0) {
+		return -1;
+	}
+	if (fault == FAULT_SHORT && buflen > 1) {
+		buflen = 1 + (roll % (buflen - 1));
+	}
+	return recv(sc->fd, buf, buflen, flags);
+}
+
+static int fault_send(sccp_socket_connection_t * sc, void * buf, size_t buflen, int flags)
+{
+	int delay_ms = 0;
+	uint32_t roll = 0;
+	enum fault_type fault = fault_next(sc, 1, faults.shortwrite, &delay_ms, &roll);
+
+	if (fault_inject(sc, "send", fault, delay_ms) < 0) {
+		return -1;
+	}
+	if (fault == FAULT_SHORT && buflen > 1) {
+		buflen = 1 + (roll % (buflen - 1));
+	}
+	return send(sc->fd, buf, buflen, flags);
+}
+
+static int fault_shutdown(sccp_socket_connection_t * sc, int how)
+{
+	return shutdown(sc->fd, how);
+}
+
+static int fault_close(sccp_socket_connection_t * sc)
+{
+	struct fault_connection ** link = NULL;
+	struct fault_connection * connection = NULL;
+
+	pbx_mutex_lock(&faultLock);
+	for (link = &faults.connectionList; *link; link = &(*link)->next) {
+		if ((*link)->fd == sc->fd) {
+			connection = *link;
+			*link = connection->next;
+			break;
+		}
+	}
+	pbx_mutex_unlock(&faultLock);
+	if (connection) {
+		sccp_free(connection);
+	}
+	return close(sc->fd);
+}
+
+static const sccp_transport_t * const fault_destroy(uint8_t h)
+{
+	return NULL;
+}
+
+const sccp_transport_t faulttransport = {
+	.name           = "TCP (Fault Injection)",
+	.secret_default = "",
+	.socktype       = SOCK_STREAM,
+	.port_default   = "2000",
+
+	.retrycountdefault        = 0,
+	.retrycountmax            = 0,
+	.retryintervaldefault     = REQUEST_RETRY_INTERVAL * REQUEST_RETRY_COUNT,
+	.retryintervalmax         = 60,
+	.duplicateintervaldefault = DUPLICATE_INTERVAL,
+
+	.init     = fault_init,
+	.bind     = fault_bind,
+	.listen   = fault_listen,
+	.accept   = fault_accept,
+	.recv     = fault_recv,
+	.send     = fault_send,
+	.shutdown = fault_shutdown,
+	.close    = fault_close,
+	.destroy  = fault_destroy,
+};
+
+#endif
+// kate: indent-width 8; replace-tabs off; indent-mode cstyle; auto-insert-doxygen on; line-numbers on; tab-indents on; keep-extra-spaces off; auto-brackets off;
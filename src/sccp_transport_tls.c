@@ -27,7 +27,10 @@ SCCP_FILE_VERSION(__FILE__, "");
 #	define DUPLICATE_INTERVAL     REQUEST_RETRY_INTERVAL * REQUEST_RETRY_COUNT
 
 /* local variables */
-static SSL_CTX * sslctx = NULL;
+static SSL_CTX * sslctx = NULL;                                                             // used for new handshakes, swapped under sslctxLock
+AST_MUTEX_DEFINE_STATIC(sslctxLock);
+static uint32_t rotations = 0;
+static time_t rotated = 0;
 
 /* forward declares */
 const sccp_transport_t tlstransport;
@@ -122,17 +125,83 @@ static boolean_t configure_context(SSL_CTX * ctx)
 
 	return TRUE;
 }
+
+/*!
+ * \brief Replace the context used for new handshakes
+ * \note SSL_new takes its own reference on the context, established sessions keep using the context they were accepted with
+ *       until they are closed, freeing the old context here only drops our reference.
+ */
+static void tls_swapContext(SSL_CTX * ctx)
+{
+	SSL_CTX * old = NULL;
+
+	pbx_mutex_lock(&sslctxLock);
+	old = sslctx;
+	sslctx = ctx;
+	pbx_mutex_unlock(&sslctxLock);
+	if (old) {
+		SSL_CTX_free(old);
+	}
+}
+
 const sccp_transport_t * const tls_init(void)
 {
 	sccp_log(DEBUGCAT_SOCKET)(VERBOSE_PREFIX_1 "TLS Transport Initializing...\n");
-	sslctx = create_context();
-	if (sslctx && configure_context(sslctx)) {
+	SSL_CTX * ctx = create_context();
+	if (ctx && configure_context(ctx)) {
 		InitializeSSL();
+		tls_swapContext(ctx);
 		return &tlstransport;
 	}
+	if (ctx) {
+		SSL_CTX_free(ctx);
+	}
 	return NULL;
 }
 
+/*!
+ * \brief Load the certificate and private key (certfile) again into a fresh context and use it for new handshakes
+ * \return TRUE when the new certificate is in use, FALSE when tls is not active or the certificate could not be loaded (the current one stays in use)
+ */
+boolean_t sccp_transport_tls_rotate(void)
+{
+	SSL_CTX * ctx = NULL;
+	boolean_t active = FALSE;
+
+	pbx_mutex_lock(&sslctxLock);
+	active = sslctx ? TRUE : FALSE;
+	pbx_mutex_unlock(&sslctxLock);
+	if (!active) {
+		return FALSE;
+	}
+	if (!(ctx = create_context()) || !configure_context(ctx)) {
+		pbx_log(LOG_WARNING, "SCCP: TLS certificate rotation failed, keeping the current certificate\n");
+		if (ctx) {
+			SSL_CTX_free(ctx);
+		}
+		return FALSE;
+	}
+	tls_swapContext(ctx);
+
+	pbx_mutex_lock(&sslctxLock);
+	rotations++;
+	rotated = time(0);
+	pbx_mutex_unlock(&sslctxLock);
+	pbx_log(LOG_NOTICE, "SCCP: TLS certificate reloaded from %s, used for new connections from now on\n", GLOB(cert_file) ? GLOB(cert_file) : PBX_CERTFILE);
+	return TRUE;
+}
+
+uint32_t sccp_transport_tls_getRotations(time_t * const last)
+{
+	uint32_t res = 0;
+
+	pbx_mutex_lock(&sslctxLock);
+	res = rotations;
+	*last = rotated;
+	pbx_mutex_unlock(&sslctxLock);
+	return res;
+}
+
 static int tls_bind(sccp_socket_connection_t * sc, struct sockaddr * addr, socklen_t addrlen)
 {
 	// sccp_log(DEBUGCAT_SOCKET)(VERBOSE_PREFIX_1 "TLS Transport bind...\n");
@@ -158,7 +227,9 @@ static sccp_socket_connection_t * tls_accept(sccp_socket_connection_t * in_sc, s
 			break;
 		}
 
-		ssl = SSL_new(sslctx);
+		pbx_mutex_lock(&sslctxLock);
+		ssl = sslctx ? SSL_new(sslctx) : NULL;
+		pbx_mutex_unlock(&sslctxLock);
 		if (!ssl) {
 			pbx_log(LOG_ERROR, "Error creating new SSL structure\n");
 			break;
@@ -222,6 +293,7 @@ static int tls_close(sccp_socket_connection_t * sc)
 static const sccp_transport_t * const tls_destroy(uint8_t h)
 {
 	sccp_log(DEBUGCAT_SOCKET)(VERBOSE_PREFIX_1 "TLS Transport destroy...\n");
+	tls_swapContext(NULL);
 	DestroySSL();
 	return NULL;
 }
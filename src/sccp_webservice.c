@@ -18,6 +18,8 @@ SCCP_FILE_VERSION(__FILE__, "");
 
 #if defined(HAVE_PBX_HTTP_H) && defined(CS_EXPERIMENTAL_XML) && defined(HAVE_LIBXML2) && defined(HAVE_LIBXSLT) && defined(HAVE_LIBEXSLT_EXSLT_H)
 
+#	include "sccp_device.h"
+#	include "sccp_session.h"
 #	include "sccp_utils.h"
 #	include "sccp_vector.h"
 #	include "sccp_xml.h"
@@ -33,6 +35,7 @@ SCCP_FILE_VERSION(__FILE__, "");
 #	define MAX_PREFIX            80
 #	define DEFAULT_PORT          8088
 #	define DEFAULT_SESSION_LIMIT 100
+#	define RESPONSE_CACHE_MAX    256
 
 static boolean_t running = FALSE;
 static int       cookie_timeout;
@@ -42,6 +45,7 @@ typedef struct handler {
 	char                       uri[StationMaxServiceURLSize];
 	sccp_webservice_callback_t callback;
 	sccp_xml_outputfmt_t       outputfmt;
+	int                        maxage;							/*!< seconds a rendered response may be served from cache, 0 = never cached */
 } handler_t;
 
 char * outputfmt2contenttype[] = {
@@ -340,11 +344,218 @@ static __attribute__((malloc)) char * findStylesheet(const char * const uri, scc
 	return searchWebDirForFile(uri, outputfmt, "xsl");
 }
 
+/* begin response cache */
+/*!
+ * \brief Rendered Handler Response (Cache Entry)
+ */
+typedef struct response_entry {
+	char *      key;
+	pbx_str_t * content;
+	char        etag[23];
+	char        lastmodified[80];
+	time_t      expires;
+} response_entry_t;
+
+SCCP_VECTOR_RW(sccp_response_cache, response_entry_t *) responseCache;
+
+#	define RESPONSE_CB_CMP(elem, value)      (sccp_strequals((elem)->key, (value)))
+#	define RESPONSE_CB_CLEANUP(elem)         response_entry_destroy(elem)
+
+static void response_entry_destroy(response_entry_t * entry)
+{
+	if (entry) {
+		if (entry->content) {
+			ast_free(entry->content);
+		}
+		if (entry->key) {
+			sccp_free(entry->key);
+		}
+		sccp_free(entry);
+	}
+}
+
+/*!
+ * \brief Build the cache key for a request, the handler uri, the negotiated outputfmt and the request parameters in the order they were received
+ */
+static void response_cache_key(const handler_t * const handler, sccp_xml_outputfmt_t outputfmt, PBX_VARIABLE_TYPE * request_params, pbx_str_t ** key)
+{
+	PBX_VARIABLE_TYPE * param = NULL;
+	pbx_str_set(key, 0, "%s|%d|", handler->uri, outputfmt);
+	for (param = request_params; param; param = param->next) {
+		pbx_str_append(key, 0, "%s=%s&", param->name, param->value);
+	}
+}
+
+/*!
+ * \brief Find a fresh response in the cache
+ * \note returns a copy of the cached content, which will be freed by ast_http_send
+ */
+static pbx_str_t * response_cache_lookup(const char * const key, char etag[23], char lastmodified[80])
+{
+	pbx_str_t *         out   = NULL;
+	response_entry_t ** found = NULL;
+	time_t              now   = time(NULL);
+
+	SCCP_VECTOR_RW_RDLOCK(&responseCache);
+	if ((found = (response_entry_t **)SCCP_VECTOR_GET_CMP(&responseCache, key, RESPONSE_CB_CMP)) && (*found)->expires > now) {
+		if ((out = pbx_str_create(pbx_str_strlen((*found)->content) + 1))) {
+			pbx_str_set(&out, 0, "%s", pbx_str_buffer((*found)->content));
+			sccp_copy_string(etag, (*found)->etag, 23);
+			sccp_copy_string(lastmodified, (*found)->lastmodified, 80);
+		}
+	}
+	SCCP_VECTOR_RW_UNLOCK(&responseCache);
+	return out;
+}
+
+/*!
+ * \brief Store a freshly rendered response in the cache
+ *
+ * The ETag is derived from the content, so a re-rendered but unchanged response keeps its ETag and Last-Modified, and clients
+ * holding a copy still get their 304 after the entry expired. When the cache is full, expired entries are dropped first, then the
+ * entry closest to expiry.
+ */
+static void response_cache_store(const char * const key, pbx_str_t * const content, int maxage, char etag[23], char lastmodified[80])
+{
+	const char *        buf   = pbx_str_buffer(content);
+	size_t              len   = pbx_str_strlen(content);
+	uint32_t            hash  = 2166136261U;						/* FNV-1a */
+	time_t              now   = time(NULL);
+	response_entry_t *  entry = NULL;
+	response_entry_t ** found = NULL;
+	size_t              idx   = 0;
+
+	for (idx = 0; idx < len; idx++) {
+		hash = (hash ^ (uint8_t)buf[idx]) * 16777619U;
+	}
+	snprintf(etag, 23, "\"%08x-%zx\"", hash, len);
+
+	SCCP_VECTOR_RW_WRLOCK(&responseCache);
+	if ((found = (response_entry_t **)SCCP_VECTOR_GET_CMP(&responseCache, key, RESPONSE_CB_CMP))) {
+		entry = *found;
+		if (!sccp_strequals(entry->etag, etag)) {
+			pbx_str_set(&entry->content, 0, "%s", buf);
+			sccp_copy_string(entry->etag, etag, sizeof(entry->etag));
+			sccp_copy_string(entry->lastmodified, lastmodified, sizeof(entry->lastmodified));
+		} else {
+			sccp_copy_string(lastmodified, entry->lastmodified, 80);
+		}
+		entry->expires = now + maxage;
+		SCCP_VECTOR_RW_UNLOCK(&responseCache);
+		return;
+	}
+	if (SCCP_VECTOR_SIZE(&responseCache) >= RESPONSE_CACHE_MAX) {
+		size_t oldest = 0;
+		for (idx = SCCP_VECTOR_SIZE(&responseCache); idx > 0; idx--) {
+			if (SCCP_VECTOR_GET(&responseCache, idx - 1)->expires <= now) {
+				response_entry_destroy(SCCP_VECTOR_REMOVE_UNORDERED(&responseCache, idx - 1));
+			}
+		}
+		if (SCCP_VECTOR_SIZE(&responseCache) >= RESPONSE_CACHE_MAX) {
+			for (idx = 1; idx < SCCP_VECTOR_SIZE(&responseCache); idx++) {
+				if (SCCP_VECTOR_GET(&responseCache, idx)->expires < SCCP_VECTOR_GET(&responseCache, oldest)->expires) {
+					oldest = idx;
+				}
+			}
+			response_entry_destroy(SCCP_VECTOR_REMOVE_UNORDERED(&responseCache, oldest));
+		}
+	}
+	if ((entry = (response_entry_t *)sccp_calloc(sizeof *entry, 1)) && (entry->key = pbx_strdup(key)) && (entry->content = pbx_str_create(len + 1))) {
+		pbx_str_set(&entry->content, 0, "%s", buf);
+		sccp_copy_string(entry->etag, etag, sizeof(entry->etag));
+		sccp_copy_string(entry->lastmodified, lastmodified, sizeof(entry->lastmodified));
+		entry->expires = now + maxage;
+		if (SCCP_VECTOR_APPEND(&responseCache, entry) == 0) {
+			entry = NULL;
+		}
+	}
+	SCCP_VECTOR_RW_UNLOCK(&responseCache);
+	response_entry_destroy(entry);
+}
+
+/*!
+ * \brief Parse an HTTP-date (IMF-fixdate, RFC 7231)
+ * \return seconds since the epoch, or -1 when the date could not be parsed
+ */
+static time_t parse_http_date(const char * const date)
+{
+	struct tm    tm  = { 0 };
+	const char * end = strptime(date, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+
+	if (!end || *end != '\0') {
+		return -1;
+	}
+	return timegm(&tm);
+}
+
+/*!
+ * \brief Does the If-None-Match entity-tag list (comma separated, optionally weak) contain etag, or is it "*"
+ * \note If-None-Match uses the weak comparison (RFC 7232 3.2): a W/ prefix is ignored, the opaque tags have to be equal
+ */
+static boolean_t etag_list_matches(const char * const list, const char * const etag)
+{
+	const char * tag = list;
+	const char * end = NULL;
+	size_t       len = 0;
+
+	while (tag && *tag) {
+		while (*tag == ' ' || *tag == '\t' || *tag == ',') {
+			tag++;
+		}
+		if (!*tag) {
+			break;
+		}
+		if (*tag == '*') {
+			return TRUE;
+		}
+		if (strncmp(tag, "W/", 2) == 0) {
+			tag += 2;
+		}
+		/* an entity-tag is a quoted string, which does not contain a comma */
+		if (!(end = strchr(tag, ','))) {
+			end = tag + strlen(tag);
+		}
+		len = end - tag;
+		while (len && (tag[len - 1] == ' ' || tag[len - 1] == '\t')) {
+			len--;
+		}
+		if (len == strlen(etag) && strncmp(tag, etag, len) == 0) {
+			return TRUE;
+		}
+		tag = end;
+	}
+	return FALSE;
+}
+
+/*!
+ * \brief Check the conditional request headers (If-None-Match / If-Modified-Since) against the response validators
+ */
+static boolean_t response_not_modified(PBX_VARIABLE_TYPE * request_headers, const char * const etag, const char * const lastmodified)
+{
+	PBX_VARIABLE_TYPE * v = NULL;
+	for (v = request_headers; v; v = v->next) {
+		if (strcasecmp(v->name, "If-None-Match") == 0) {
+			/* If-None-Match takes precedence over If-Modified-Since (RFC 7232) */
+			return etag_list_matches(v->value, etag);
+		}
+	}
+	for (v = request_headers; v; v = v->next) {
+		if (strcasecmp(v->name, "If-Modified-Since") == 0) {
+			time_t since    = parse_http_date(v->value);
+			time_t modified = parse_http_date(lastmodified);
+			return (since != -1 && modified != -1 && modified <= since) ? TRUE : FALSE;
+		}
+	}
+	return FALSE;
+}
+/* end response cache */
+
 static int request_parser(struct ast_tcptls_session_instance * ser, enum ast_http_method method, const char * request_uri, PBX_VARIABLE_TYPE * request_params, PBX_VARIABLE_TYPE * request_headers)
 {
 	int         result      = 0;
 	pbx_str_t * http_header = NULL;
 	pbx_str_t * out         = NULL;
+	pbx_str_t * cachekey    = NULL;
 	sccp_log(DEBUGCAT_WEBSERVICE)(VERBOSE_PREFIX_1 "SCCP: (request_parser) Handling Callback\n");
 
 	handler_t * handler = get_request_handler(request_params);
@@ -391,24 +602,63 @@ static int request_parser(struct ast_tcptls_session_instance * ser, enum ast_htt
 			ast_http_error(ser, 500, "Server Error", "Internal Server Error\nURI or Headers could not be parsed\n");
 			break;
 		}
-		if (!handler->callback(handler->uri, request_params, request_headers, &out)) {
-			pbx_log(LOG_ERROR, "could not process request, callback failed\n");
-			ast_http_request_close_on_completion(ser);
-			ast_http_error(ser, 500, "Server Error", "Internal Server Error\nCould not process request, callback failed\n");
-			break;
-		}
-		sccp_log(DEBUGCAT_WEBSERVICE)(VERBOSE_PREFIX_3 "SCCP: (request_parser) Handling Callback: %s, remote-address: %s\n", request_uri, ast_sockaddr_stringify(&ser->remote_address));
-		char           timebuf[80];
-		struct timeval nowtv = ast_tvnow();
+		char           timebuf[80] = "";
+		char           etag[23]    = "";
+		pbx_str_t *    cached      = NULL;
+		struct timeval nowtv       = ast_tvnow();
 		struct ast_tm  now;
+		int            maxage      = handler->maxage;						/* copied, the handler might be removed while its callback runs */
 		ast_strftime(timebuf, sizeof(timebuf), "%a, %d %b %Y %H:%M:%S GMT", ast_localtime(&nowtv, &now, "GMT"));
-		ast_str_set(&http_header, 0,
-			    "Content-type: %s\r\n"
-			    "Cache-Control: no-cache;\r\n"
-			    "Set-Cookie: sccp_id=\"%08x\"; Version=1; Max-Age=%d\r\n"
-			    "Pragma: SuppressEvents\r\n"
-			    "Last-Modified: %s\r\n",
-			    outputfmt2contenttype[outputfmt], 1, cookie_timeout, timebuf);
+
+		if (maxage > 0) {
+			if (!(cachekey = pbx_str_create(DEFAULT_PBX_STR_BUFFERSIZE))) {
+				pbx_log(LOG_ERROR, "pbx_str_create() out of memory\n");
+				ast_http_error(ser, 500, "Server Error", "Internal Server Error\nast_str_create() out of memory\n");
+				break;
+			}
+			response_cache_key(handler, outputfmt, request_params, &cachekey);			/* grows with the uri and parameters, never truncated */
+			cached = response_cache_lookup(pbx_str_buffer(cachekey), etag, timebuf);
+		}
+		if (cached) {
+			sccp_log(DEBUGCAT_WEBSERVICE)(VERBOSE_PREFIX_3 "SCCP: (request_parser) Serving cached response: %s, remote-address: %s\n", request_uri, ast_sockaddr_stringify(&ser->remote_address));
+			ast_free(out);
+			out = cached;
+		} else {
+			if (!handler->callback(handler->uri, request_params, request_headers, &out)) {
+				pbx_log(LOG_ERROR, "could not process request, callback failed\n");
+				ast_http_request_close_on_completion(ser);
+				ast_http_error(ser, 500, "Server Error", "Internal Server Error\nCould not process request, callback failed\n");
+				break;
+			}
+			sccp_log(DEBUGCAT_WEBSERVICE)(VERBOSE_PREFIX_3 "SCCP: (request_parser) Handling Callback: %s, remote-address: %s\n", request_uri, ast_sockaddr_stringify(&ser->remote_address));
+			if (cachekey) {
+				response_cache_store(pbx_str_buffer(cachekey), out, maxage, etag, timebuf);
+			}
+		}
+		if (cachekey) {
+			ast_str_set(&http_header, 0,
+				    "Content-type: %s\r\n"
+				    "Cache-Control: max-age=%d\r\n"
+				    "Set-Cookie: sccp_id=\"%08x\"; Version=1; Max-Age=%d\r\n"
+				    "Pragma: SuppressEvents\r\n"
+				    "ETag: %s\r\n"
+				    "Last-Modified: %s\r\n",
+				    outputfmt2contenttype[outputfmt], maxage, 1, cookie_timeout, etag, timebuf);
+			if (response_not_modified(request_headers, etag, timebuf)) {
+				ast_free(out);
+				ast_http_send(ser, method, 304, "Not Modified", http_header, NULL, 0, 0);
+				http_header = out = NULL;
+				break;
+			}
+		} else {
+			ast_str_set(&http_header, 0,
+				    "Content-type: %s\r\n"
+				    "Cache-Control: no-cache;\r\n"
+				    "Set-Cookie: sccp_id=\"%08x\"; Version=1; Max-Age=%d\r\n"
+				    "Pragma: SuppressEvents\r\n"
+				    "Last-Modified: %s\r\n",
+				    outputfmt2contenttype[outputfmt], 1, cookie_timeout, timebuf);
+		}
 		// sccp_log(DEBUGCAT_WEBSERVICE) (VERBOSE_PREFIX_3 "SCCP: (request_parser) Returning Header:'%s'\n", pbx_str_buffer(http_header));
 		/*
 		if (handler->outputfmt == SCCP_XML_OUTPUTFMT_XML && handler->outputfmt != outputfmt && iXML.applyStyleSheet) {
@@ -436,6 +686,9 @@ static int request_parser(struct ast_tcptls_session_instance * ser, enum ast_htt
 		break;
 	} while (0);
 
+	if (cachekey) {
+		ast_free(cachekey);
+	}
 	if (http_header) {
 		ast_free(http_header);
 	}
@@ -604,6 +857,262 @@ static struct ast_http_uri sccp_webservice_xslt_uri = {
 	.key         = __FILE__,
 };
 
+/* begin provisioning */
+/*!
+ * \brief Rendered Provisioning File (Cache Entry)
+ */
+typedef struct provision_entry {
+	char                    name[StationMaxDeviceNameSize];
+	struct sockaddr_storage us;								/* our address as rendered in processNodeName */
+	uint8_t                 securityMode;							/* deviceSecurityMode as rendered */
+	pbx_str_t *             content;
+	char        etag[23];
+	char        lastmodified[80];
+} provision_entry_t;
+
+SCCP_VECTOR_RW(sccp_provision_cache, provision_entry_t *) provisionCache;
+static unsigned int provisionGeneration = 0;							/* protected by provisionCache lock */
+
+/*!
+ * \brief Provisioning Cache Key, the rendered file depends on the interface the phone reaches us on and on its security mode
+ */
+typedef struct provision_key {
+	const char *                    name;
+	const struct sockaddr_storage * us;
+	uint8_t                         securityMode;
+} provision_key_t;
+
+#	define PROVISION_CB_CMP(elem, key)       (sccp_strcaseequals((elem)->name, (key)->name) && (elem)->securityMode == (key)->securityMode && sccp_netsock_cmp_addr(&(elem)->us, (key)->us) == 0)
+#	define PROVISION_CB_CLEANUP(elem)        provision_entry_destroy(elem)
+
+static void provision_entry_destroy(provision_entry_t * entry)
+{
+	if (entry) {
+		if (entry->content) {
+			ast_free(entry->content);
+		}
+		sccp_free(entry);
+	}
+}
+
+/*!
+ * \brief Our address as seen by the requesting phone, rendered as processNodeName
+ * \param them Address of the requesting phone, used to find our address when we are bound to any
+ * \param us Our Address (output)
+ */
+static boolean_t provision_ouraddr(const struct sockaddr_storage * them, struct sockaddr_storage * const us)
+{
+	const struct sockaddr_storage * bound = GLOB(srvcontexts[SCCP_SERVERCONTEXT_TCP]) ? sccp_servercontext_getBoundAddr(GLOB(srvcontexts[SCCP_SERVERCONTEXT_TCP])) : &GLOB(bindaddr);
+
+	if (!sccp_netsock_is_any_addr(bound)) {
+		memcpy(us, bound, sizeof(struct sockaddr_storage));
+	} else if (!sccp_netsock_is_any_addr(&GLOB(externip))) {
+		memcpy(us, &GLOB(externip), sizeof(struct sockaddr_storage));
+	} else if (!them || !sccp_netsock_ouraddrfor(them, us)) {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*!
+ * \brief deviceSecurityMode to render: 3 (encrypted) when the phone fetches its config from our https listener, 1 (non secure) otherwise
+ * \note taken from the request, the phone has not registered (and has no session) yet when it fetches its config
+ */
+static uint8_t provision_securityMode(const struct ast_tcptls_session_instance * ser)
+{
+	if (ser->parent && ser->parent->tls_cfg && ser->parent->tls_cfg->enabled) {
+		return 3;
+	}
+	return 1;
+}
+
+/*!
+ * \brief Render the SEP<mac>.cnf.xml file for a device from the loaded device configuration
+ * \param d SCCP Device
+ * \param key Cache Key, provides our address and the security mode to render
+ * \param result pbx_str_t to append the rendered file to
+ */
+static boolean_t provision_render_device(constDevicePtr d, const provision_key_t * const key, pbx_str_t ** result)
+{
+	const struct sockaddr_storage * bound = GLOB(srvcontexts[SCCP_SERVERCONTEXT_TCP]) ? sccp_servercontext_getBoundAddr(GLOB(srvcontexts[SCCP_SERVERCONTEXT_TCP])) : &GLOB(bindaddr);
+	uint16_t                        port  = sccp_netsock_getPort(bound);
+
+	pbx_str_append(result, 0, "<?xml version=\"1.0\"?>\n");
+	pbx_str_append(result, 0, "<device>\n");
+	pbx_str_append(result, 0, "  <deviceProtocol>SCCP</deviceProtocol>\n");
+	pbx_str_append(result, 0, "  <devicePool>\n");
+	pbx_str_append(result, 0, "    <dateTimeSetting>\n");
+	pbx_str_append(result, 0, "      <dateTemplate>%s</dateTemplate>\n", GLOB(dateformat));
+	pbx_str_append(result, 0, "    </dateTimeSetting>\n");
+	pbx_str_append(result, 0, "    <callManagerGroup>\n");
+	pbx_str_append(result, 0, "      <members>\n");
+	pbx_str_append(result, 0, "        <member priority=\"0\">\n");
+	pbx_str_append(result, 0, "          <callManager>\n");
+	pbx_str_append(result, 0, "            <ports>\n");
+	pbx_str_append(result, 0, "              <ethernetPhonePort>%d</ethernetPhonePort>\n", port);
+	pbx_str_append(result, 0, "            </ports>\n");
+	pbx_str_append(result, 0, "            <processNodeName>%s</processNodeName>\n", sccp_netsock_stringify_addr(key->us));
+	pbx_str_append(result, 0, "          </callManager>\n");
+	pbx_str_append(result, 0, "        </member>\n");
+	pbx_str_append(result, 0, "      </members>\n");
+	pbx_str_append(result, 0, "    </callManagerGroup>\n");
+	pbx_str_append(result, 0, "  </devicePool>\n");
+	if (!sccp_strlen_zero(d->imageversion)) {
+		pbx_str_append(result, 0, "  <loadInformation>%s</loadInformation>\n", d->imageversion);
+	} else {
+		pbx_str_append(result, 0, "  <loadInformation/>\n");
+	}
+	pbx_str_append(result, 0, "  <deviceSecurityMode>%d</deviceSecurityMode>\n", key->securityMode);
+	pbx_str_append(result, 0, "  <dscpForSCCPPhoneConfig>%d</dscpForSCCPPhoneConfig>\n", GLOB(sccp_tos));
+	pbx_str_append(result, 0, "  <dscpForCm2Dvce>%d</dscpForCm2Dvce>\n", d->audio_tos);
+	pbx_str_append(result, 0, "</device>\n");
+	return TRUE;
+}
+
+/*!
+ * \brief Find a rendered provisioning file in the cache, rendering and adding it when missing
+ * \note entries are kept per device, per local address (processNodeName) and per security mode
+ * \note returns a copy of the cached content, which will be freed by ast_http_send
+ */
+static pbx_str_t * provision_lookup(const char * const name, const struct sockaddr_storage * them, uint8_t securityMode, char etag[23], char lastmodified[80])
+{
+	pbx_str_t *             out   = NULL;
+	provision_entry_t *     entry = NULL;
+	provision_entry_t **    found = NULL;
+	struct sockaddr_storage us    = { 0 };
+	provision_key_t         key   = { name, &us, securityMode };
+
+	if (!provision_ouraddr(them, &us)) {
+		pbx_log(LOG_WARNING, "%s: (provision_lookup) could not determine our address for provisioning\n", name);
+		return NULL;
+	}
+
+	SCCP_VECTOR_RW_RDLOCK(&provisionCache);
+	if ((found = (provision_entry_t **)SCCP_VECTOR_GET_CMP(&provisionCache, &key, PROVISION_CB_CMP))) {
+		entry = *found;
+		if ((out = pbx_str_create(pbx_str_strlen(entry->content) + 1))) {
+			pbx_str_set(&out, 0, "%s", pbx_str_buffer(entry->content));
+			sccp_copy_string(etag, entry->etag, 23);
+			sccp_copy_string(lastmodified, entry->lastmodified, 80);
+		}
+	}
+	SCCP_VECTOR_RW_UNLOCK(&provisionCache);
+	if (out) {
+		sccp_log(DEBUGCAT_WEBSERVICE)(VERBOSE_PREFIX_3 "SCCP: (provision_lookup) cache hit for '%s'\n", name);
+		return out;
+	}
+
+	/* the cache is emptied on reload, so only a miss needs the device */
+	AUTO_RELEASE(sccp_device_t, d, sccp_device_find_byid(name, FALSE));
+	if (!d) {
+		return NULL;
+	}
+	if (!(entry = (provision_entry_t *)sccp_calloc(sizeof *entry, 1)) || !(entry->content = pbx_str_create(1024)) || !provision_render_device(d, &key, &entry->content)
+	    || !(out = pbx_str_create(pbx_str_strlen(entry->content) + 1))) {
+		provision_entry_destroy(entry);
+		return NULL;
+	}
+	sccp_copy_string(entry->name, d->id, sizeof(entry->name));
+	memcpy(&entry->us, &us, sizeof(struct sockaddr_storage));
+	entry->securityMode = key.securityMode;
+
+	struct timeval nowtv = ast_tvnow();
+	struct ast_tm  now;
+	ast_strftime(entry->lastmodified, sizeof(entry->lastmodified), "%a, %d %b %Y %H:%M:%S GMT", ast_localtime(&nowtv, &now, "GMT"));
+
+	SCCP_VECTOR_RW_WRLOCK(&provisionCache);
+	snprintf(entry->etag, sizeof(entry->etag), "\"%x-%lx\"", (unsigned)provisionGeneration, (long)nowtv.tv_sec);
+	if ((found = (provision_entry_t **)SCCP_VECTOR_GET_CMP(&provisionCache, &key, PROVISION_CB_CMP))) {
+		/* another request rendered it in the meantime */
+		provision_entry_destroy(entry);
+		entry = *found;
+	} else if (SCCP_VECTOR_APPEND(&provisionCache, entry) != 0) {
+		SCCP_VECTOR_RW_UNLOCK(&provisionCache);
+		provision_entry_destroy(entry);
+		ast_free(out);
+		return NULL;
+	}
+	pbx_str_set(&out, 0, "%s", pbx_str_buffer(entry->content));
+	sccp_copy_string(etag, entry->etag, 23);
+	sccp_copy_string(lastmodified, entry->lastmodified, 80);
+	SCCP_VECTOR_RW_UNLOCK(&provisionCache);
+	sccp_log(DEBUGCAT_WEBSERVICE)(VERBOSE_PREFIX_3 "SCCP: (provision_lookup) rendered and cached '%s' for %s\n", name, sccp_netsock_stringify_addr(&us));
+	return out;
+}
+
+static int sccp_webservice_provision_callback(struct ast_tcptls_session_instance * ser, const struct ast_http_uri * urih, const char * uri, enum ast_http_method method, struct ast_variable * get_vars,
+					      struct ast_variable * headers)
+{
+	char                  name[StationMaxDeviceNameSize] = "";
+	char                  etag[23]                       = "";
+	char                  lastmodified[80]               = "";
+	const char *          ext                            = NULL;
+	struct ast_variable * v                              = NULL;
+	struct ast_str *      http_header                    = NULL;
+	pbx_str_t *           out                            = NULL;
+	int                   not_modified                   = 0;
+
+	if (method != AST_HTTP_GET && method != AST_HTTP_HEAD) {
+		ast_http_error(ser, 501, "Not Implemented", "Attempt to use unimplemented / unsupported method");
+		return 0;
+	}
+
+	/* only accept <devicename>.cnf.xml, no paths */
+	if (!(ext = strcasestr(uri, ".cnf.xml")) || ext[8] != '\0' || strchr(uri, '/') || (size_t)(ext - uri) >= sizeof(name) || ext == uri) {
+		goto out404;
+	}
+	sccp_copy_string(name, uri, (ext - uri) + 1);
+
+	if (!(out = provision_lookup(name, &ser->remote_address.ss, provision_securityMode(ser), etag, lastmodified))) {
+		goto out404;
+	}
+
+	/* check received "If-None-Match" request header against the Etag of the rendered file */
+	for (v = headers; v; v = v->next) {
+		if (strcasecmp(v->name, "If-None-Match") == 0) {
+			not_modified = etag_list_matches(v->value, etag);
+			break;
+		}
+	}
+
+	if (!(http_header = ast_str_create(255))) {
+		ast_free(out);
+		ast_http_request_close_on_completion(ser);
+		ast_http_error(ser, 500, "Server Error", "Out of memory");
+		return 0;
+	}
+	ast_str_set(&http_header, 0,
+		    "Content-type: text/xml\r\n"
+		    "ETag: %s\r\n"
+		    "Last-Modified: %s\r\n",
+		    etag, lastmodified);
+
+	/* ast_http_send() frees http_header and out, so we don't need to do it before returning */
+	sccp_log(DEBUGCAT_WEBSERVICE)(VERBOSE_PREFIX_3 "SCCP: (provision) Serving '%s' to %s\n", uri, ast_sockaddr_stringify(&ser->remote_address));
+	if (not_modified) {
+		ast_free(out);
+		ast_http_send(ser, method, 304, "Not Modified", http_header, NULL, 0, 0);
+	} else {
+		ast_http_send(ser, method, 200, NULL, http_header, out, 0, 0);
+	}
+	return 0;
+
+out404:
+	sccp_log(DEBUGCAT_WEBSERVICE)(VERBOSE_PREFIX_3 "SCCP: (provision) No provisioning file for '%s'\n", uri);
+	ast_http_error(ser, 404, "Not Found", "The requested URL was not found on this server.");
+	return 0;
+}
+
+static struct ast_http_uri sccp_webservice_provision_uri = {
+	.description = "SCCP Device Provisioning (SEP<mac>.cnf.xml)",
+	.uri         = "sccpprov",
+	.callback    = sccp_webservice_provision_callback,
+	.has_subtree = 1,
+	.data        = NULL,
+	.key         = __FILE__,
+};
+/* end provisioning */
+
 /* begin test */
 static boolean_t sccp_webservice_htmltest(const char * const uri, PBX_VARIABLE_TYPE * params, PBX_VARIABLE_TYPE * headers, pbx_str_t ** result)
 {
@@ -743,6 +1252,8 @@ static void __attribute__((constructor)) init_webservice(void)
 {
 	if (!running && parse_manager_conf() && parse_http_conf(baseURL)) {
 		SCCP_VECTOR_RW_INIT(&handlers, 1);
+		SCCP_VECTOR_RW_INIT(&provisionCache, 16);
+		SCCP_VECTOR_RW_INIT(&responseCache, 16);
 
 		/* begin test */
 		iWebService.addHandler("testhtml", sccp_webservice_htmltest, SCCP_XML_OUTPUTFMT_HTML);
@@ -751,6 +1262,7 @@ static void __attribute__((constructor)) init_webservice(void)
 
 		ast_http_uri_link(&sccp_webservice_uri);
 		ast_http_uri_link(&sccp_webservice_xslt_uri);
+		ast_http_uri_link(&sccp_webservice_provision_uri);
 		running = TRUE;
 	}
 }
@@ -758,8 +1270,17 @@ static void __attribute__((constructor)) init_webservice(void)
 static void __attribute__((destructor)) destroy_webservice(void)
 {
 	if (running) {
+		ast_http_uri_unlink(&sccp_webservice_provision_uri);
 		ast_http_uri_unlink(&sccp_webservice_xslt_uri);
 		ast_http_uri_unlink(&sccp_webservice_uri);
+		SCCP_VECTOR_RW_WRLOCK(&provisionCache);
+		SCCP_VECTOR_RESET(&provisionCache, PROVISION_CB_CLEANUP);
+		SCCP_VECTOR_RW_UNLOCK(&provisionCache);
+		SCCP_VECTOR_RW_FREE(&provisionCache);
+		SCCP_VECTOR_RW_WRLOCK(&responseCache);
+		SCCP_VECTOR_RESET(&responseCache, RESPONSE_CB_CLEANUP);
+		SCCP_VECTOR_RW_UNLOCK(&responseCache);
+		SCCP_VECTOR_RW_FREE(&responseCache);
 		SCCP_VECTOR_RW_WRLOCK(&handlers);
 		SCCP_VECTOR_RESET(&handlers, SCCP_VECTOR_ELEM_CLEANUP_NOOP);
 		SCCP_VECTOR_RW_UNLOCK(&handlers);
@@ -779,13 +1300,18 @@ static const char * const getBaseURL(void)
 	return baseURL;
 }
 
-static boolean_t addHandler(const char * const uri, sccp_webservice_callback_t callback, sccp_xml_outputfmt_t outputfmt)
+/*!
+ * \brief Register a handler whose rendered response only depends on the request parameters, so it can be served from cache for maxage seconds
+ * \note handlers which look at the request headers (for example the User-Agent) should not be registered as cacheable
+ */
+static boolean_t addCacheableHandler(const char * const uri, sccp_webservice_callback_t callback, sccp_xml_outputfmt_t outputfmt, int maxage)
 {
 	boolean_t result  = FALSE;
 	handler_t handler = {
 		.uri       = "",
 		.callback  = callback,
 		.outputfmt = outputfmt,
+		.maxage    = maxage > 0 ? maxage : 0,
 	};
 	sccp_copy_string(handler.uri, uri, sizeof(handler.uri));
 
@@ -797,6 +1323,11 @@ static boolean_t addHandler(const char * const uri, sccp_webservice_callback_t c
 	return result;
 }
 
+static boolean_t addHandler(const char * const uri, sccp_webservice_callback_t callback, sccp_xml_outputfmt_t outputfmt)
+{
+	return addCacheableHandler(uri, callback, outputfmt, 0);
+}
+
 static boolean_t removeHandler(const char * const uri)
 {
 	boolean_t result = FALSE;
@@ -807,15 +1338,49 @@ static boolean_t removeHandler(const char * const uri)
 	}
 	SCCP_VECTOR_RW_UNLOCK(&handlers);
 
+	/* drop the cached responses rendered by this handler */
+	SCCP_VECTOR_RW_WRLOCK(&responseCache);
+	size_t idx = SCCP_VECTOR_SIZE(&responseCache);
+	size_t len = strlen(uri);
+	while (idx > 0) {
+		response_entry_t * entry = SCCP_VECTOR_GET(&responseCache, --idx);
+		if (!strncmp(entry->key, uri, len) && entry->key[len] == '|') {
+			response_entry_destroy(SCCP_VECTOR_REMOVE_UNORDERED(&responseCache, idx));
+		}
+	}
+	SCCP_VECTOR_RW_UNLOCK(&responseCache);
+
 	return result;
 }
 
+/*!
+ * \brief Drop all rendered provisioning files and cached handler responses, they will be rendered again on the next request
+ * \note called after a reload, when the device objects might have changed
+ */
+static void invalidateCache(void)
+{
+	if (!running) {
+		return;
+	}
+	SCCP_VECTOR_RW_WRLOCK(&provisionCache);
+	provisionGeneration++;
+	sccp_log(DEBUGCAT_WEBSERVICE)(VERBOSE_PREFIX_2 "SCCP: (sccp_webservice) invalidating %d cached provisioning files\n", (int)SCCP_VECTOR_SIZE(&provisionCache));
+	SCCP_VECTOR_RESET(&provisionCache, PROVISION_CB_CLEANUP);
+	SCCP_VECTOR_RW_UNLOCK(&provisionCache);
+
+	SCCP_VECTOR_RW_WRLOCK(&responseCache);
+	SCCP_VECTOR_RESET(&responseCache, RESPONSE_CB_CLEANUP);
+	SCCP_VECTOR_RW_UNLOCK(&responseCache);
+}
+
 /* Assign to interface */
 const WebServiceInterface iWebService = {
-	.isRunning     = isRunning,
-	.getBaseURL    = getBaseURL,
-	.addHandler    = addHandler,
-	.removeHandler = removeHandler,
+	.isRunning           = isRunning,
+	.getBaseURL          = getBaseURL,
+	.addHandler          = addHandler,
+	.addCacheableHandler = addCacheableHandler,
+	.removeHandler       = removeHandler,
+	.invalidateCache     = invalidateCache,
 };
 #else
 const WebServiceInterface iWebService = { 0 };
@@ -26,7 +26,9 @@ typedef struct {
 	boolean_t (* const isRunning)(void);
 	const char * const (* const getBaseURL)(void);
 	boolean_t (* const addHandler)(const char * const uri, sccp_webservice_callback_t callback, sccp_xml_outputfmt_t outputfmt);
+	boolean_t (* const addCacheableHandler)(const char * const uri, sccp_webservice_callback_t callback, sccp_xml_outputfmt_t outputfmt, int maxage);
 	boolean_t (* const removeHandler)(const char * const uri);
+	void (* const invalidateCache)(void);
 } WebServiceInterface;
 
 extern const WebServiceInterface iWebService;